@@ -28,6 +28,8 @@
 #include <sys/ioctl.h>
 
 #include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
@@ -35,6 +37,41 @@
 #include <errno.h>
 
 #include "hostfs.h"
+#include "sim_internal.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+/* The single transfer slot shared between the simulated CPU and the helper
+ * thread.  The NuttX side of hostfs serializes all host calls, so at most
+ * one transfer is ever in flight.
+ */
+
+struct host_aio_s
+{
+  pthread_mutex_t lock;     /* Protects 'pending' */
+  pthread_cond_t  cond;     /* Wakes up the helper thread */
+  pthread_t       thread;   /* The helper thread */
+  pthread_t       target;   /* The CPU thread that receives the completion */
+  bool            pending;  /* A transfer has been submitted */
+  int             done;     /* A transfer has completed */
+  bool            iswrite;  /* The transfer is a write */
+  int             fd;       /* The host file descriptor */
+  void           *buf;      /* The NuttX transfer buffer */
+  size_t          count;    /* The number of bytes to transfer */
+  ssize_t         result;   /* The read()/write() result or -errno */
+};
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+static struct host_aio_s g_host_aio;
+#endif
 
 /****************************************************************************
  * Private Functions
@@ -117,6 +154,62 @@ static void host_stat_convert(struct stat *hostbuf, struct nuttx_stat_s *buf)
   buf->st_blocks       = hostbuf->st_blocks;
 }
 
+/****************************************************************************
+ * Name: host_aio_thread
+ *
+ * Description:
+ *   The host helper thread.  It performs the submitted transfers outside
+ *   of the simulated CPU and raises the completion interrupt on the CPU
+ *   thread once each of them has finished.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+static void *host_aio_thread(void *arg)
+{
+  struct host_aio_s *aio = arg;
+  sigset_t set;
+  ssize_t ret;
+
+  /* The simulated interrupts must only be delivered to the CPU threads */
+
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  for (; ; )
+    {
+      pthread_mutex_lock(&aio->lock);
+      while (!aio->pending)
+        {
+          pthread_cond_wait(&aio->cond, &aio->lock);
+        }
+
+      aio->pending = false;
+      pthread_mutex_unlock(&aio->lock);
+
+      do
+        {
+          if (aio->iswrite)
+            {
+              ret = write(aio->fd, aio->buf, aio->count);
+            }
+          else
+            {
+              ret = read(aio->fd, aio->buf, aio->count);
+            }
+        }
+      while (ret == -1 && errno == EINTR);
+
+      aio->result = ret == -1 ? -errno : ret;
+      __atomic_store_n(&aio->done, 1, __ATOMIC_RELEASE);
+
+      pthread_kill(aio->target, SIGUSR2);
+    }
+
+  return NULL;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -671,3 +764,82 @@ int host_chstat(const char *path, const struct nuttx_stat_s *buf, int flags)
 
   return 0;
 }
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+/****************************************************************************
+ * Name: host_aio_init
+ *
+ * Description:
+ *   Start the hostfs helper thread.  Completions are signalled to the
+ *   calling thread, which must be the thread of CPU0.
+ *
+ * Returned Value:
+ *   On success, the completion irq number is returned, otherwise a
+ *   negative value.
+ *
+ ****************************************************************************/
+
+int host_aio_init(void)
+{
+  int ret;
+
+  pthread_mutex_init(&g_host_aio.lock, NULL);
+  pthread_cond_init(&g_host_aio.cond, NULL);
+  g_host_aio.target = pthread_self();
+
+  ret = pthread_create(&g_host_aio.thread, NULL, host_aio_thread,
+                       &g_host_aio);
+  if (ret != 0)
+    {
+      return -ret;
+    }
+
+  return SIGUSR2;
+}
+
+/****************************************************************************
+ * Name: host_aio_submit
+ *
+ * Description:
+ *   Hand a read or write of 'count' bytes on the host file 'fd' over to
+ *   the helper thread.  The caller must not submit another transfer, nor
+ *   touch 'buf', until host_aio_done() has reported the completion.
+ *
+ ****************************************************************************/
+
+void host_aio_submit(bool iswrite, int fd, void *buf, size_t count)
+{
+  g_host_aio.iswrite = iswrite;
+  g_host_aio.fd      = fd;
+  g_host_aio.buf     = buf;
+  g_host_aio.count   = count;
+
+  pthread_mutex_lock(&g_host_aio.lock);
+  g_host_aio.pending = true;
+  pthread_cond_signal(&g_host_aio.cond);
+  pthread_mutex_unlock(&g_host_aio.lock);
+}
+
+/****************************************************************************
+ * Name: host_aio_done
+ *
+ * Description:
+ *   Check for and consume the completion of the submitted transfer.
+ *
+ * Returned Value:
+ *   True if the transfer has completed, in which case its read()/write()
+ *   result (or a negated errno) is returned in 'result'.
+ *
+ ****************************************************************************/
+
+bool host_aio_done(ssize_t *result)
+{
+  if (__atomic_exchange_n(&g_host_aio.done, 0, __ATOMIC_ACQ_REL) == 0)
+    {
+      return false;
+    }
+
+  *result = g_host_aio.result;
+  return true;
+}
+#endif
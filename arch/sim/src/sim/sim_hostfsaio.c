@@ -0,0 +1,172 @@
+/****************************************************************************
+ * arch/sim/src/sim/sim_hostfsaio.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sched.h>
+#include <stdbool.h>
+#include <debug.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/fs/hostfs.h>
+
+#include "sim_internal.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* How long to back off while a cancelled caller drains its transfer */
+
+#define SIM_HOSTFS_DRAIN_NSEC  1000000
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Posted from the completion interrupt.  hostfs serializes all of its host
+ * calls, so there is never more than one waiter.
+ */
+
+static sem_t g_hostfs_sem = SEM_INITIALIZER(0);
+static ssize_t g_hostfs_result;
+static bool g_hostfs_ready;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sim_hostfs_interrupt
+ *
+ * Description:
+ *   The completion interrupt raised by the host helper thread.
+ *
+ ****************************************************************************/
+
+static int sim_hostfs_interrupt(int irq, void *context, void *arg)
+{
+  if (host_aio_done(&g_hostfs_result))
+    {
+      nxsem_post(&g_hostfs_sem);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sim_hostfs_transfer
+ *
+ * Description:
+ *   Perform one hostfs read or write.  Large transfers issued from a task
+ *   are handed to the host helper thread and the caller sleeps until the
+ *   completion interrupt, so the rest of the simulation keeps running.
+ *   Everything else is done inline on the CPU thread as before.
+ *
+ ****************************************************************************/
+
+static ssize_t sim_hostfs_transfer(bool iswrite, int fd, void *buf,
+                                   size_t count)
+{
+  irqstate_t flags;
+  int ret;
+
+  if (!g_hostfs_ready || count < CONFIG_SIM_HOSTFS_ASYNC_THRESHOLD ||
+      up_interrupt_context() || sched_idletask())
+    {
+      return iswrite ? host_write(fd, buf, count) :
+                       host_read(fd, buf, count);
+    }
+
+  /* Keep the completion interrupt off this CPU while the request is
+   * being queued to the helper thread.
+   */
+
+  flags = up_irq_save();
+  host_aio_submit(iswrite, fd, buf, count);
+  up_irq_restore(flags);
+
+  ret = nxsem_wait_uninterruptible(&g_hostfs_sem);
+  while (ret < 0)
+    {
+      /* The wait was cancelled, but the helper thread still owns the
+       * buffer.  It must not be handed back before the host is done.
+       */
+
+      host_sleep(SIM_HOSTFS_DRAIN_NSEC);
+      ret = nxsem_trywait(&g_hostfs_sem);
+    }
+
+  return g_hostfs_result;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sim_hostfs_initialize
+ *
+ * Description:
+ *   Start the host helper thread and attach its completion interrupt.
+ *   Must be called on CPU0.  If the helper cannot be started, all hostfs
+ *   transfers stay synchronous.
+ *
+ ****************************************************************************/
+
+void sim_hostfs_initialize(void)
+{
+  int irq;
+
+  irq = host_aio_init();
+  if (irq < 0)
+    {
+      ferr("ERROR: Failed to start the hostfs helper: %d\n", irq);
+      return;
+    }
+
+  up_enable_irq(irq);
+  irq_attach(irq, sim_hostfs_interrupt, NULL);
+  g_hostfs_ready = true;
+}
+
+/****************************************************************************
+ * Name: sim_hostfs_read
+ ****************************************************************************/
+
+ssize_t sim_hostfs_read(int fd, void *buf, size_t count)
+{
+  return sim_hostfs_transfer(false, fd, buf, count);
+}
+
+/****************************************************************************
+ * Name: sim_hostfs_write
+ ****************************************************************************/
+
+ssize_t sim_hostfs_write(int fd, const void *buf, size_t count)
+{
+  return sim_hostfs_transfer(true, fd, (void *)buf, count);
+}
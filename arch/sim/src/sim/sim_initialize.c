@@ -272,6 +272,10 @@ void up_initialize(void)
   sim_registerblockdevice(); /* Our FAT ramdisk at /dev/ram0 */
 #endif
 
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+  sim_hostfs_initialize();      /* Asynchronous hostfs transfers */
+#endif
+
 #ifdef CONFIG_SIM_NETDEV
   sim_netdriver_init();         /* Our "real" network driver */
 #endif
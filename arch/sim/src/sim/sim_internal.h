@@ -200,6 +200,20 @@ void host_sleepuntil(uint64_t nsec);
 int host_timerirq(void);
 int host_settimer(uint64_t nsec);
 
+/* sim_hostfs.c *************************************************************/
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+int  host_aio_init(void);
+void host_aio_submit(bool iswrite, int fd, void *buf, size_t count);
+bool host_aio_done(ssize_t *result);
+#endif
+
+/* sim_hostfsaio.c **********************************************************/
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+void sim_hostfs_initialize(void);
+#endif
+
 /* sim_sigdeliver.c *********************************************************/
 
 void sim_sigdeliver(void);
@@ -33,6 +33,7 @@
 
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/pagecache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -60,6 +61,10 @@ struct bchlib_s
 #if defined(CONFIG_BCH_ENCRYPTION)
   uint8_t key[CONFIG_BCH_ENCRYPTION_KEY_SIZE];  /* Encryption key */
 #endif
+
+#ifdef CONFIG_BCH_PAGECACHE
+  struct pagecache_s cache; /* Recently used sectors */
+#endif
 };
 
 /****************************************************************************
@@ -83,6 +88,16 @@ EXTERN const struct file_operations g_bch_fops;
 
 EXTERN int  bchlib_flushsector(FAR struct bchlib_s *bch, bool discard);
 EXTERN int  bchlib_readsector(FAR struct bchlib_s *bch, size_t sector);
+EXTERN ssize_t bchlib_readsectors(FAR struct bchlib_s *bch,
+                                  FAR uint8_t *buffer, size_t sector,
+                                  size_t nsectors);
+EXTERN ssize_t bchlib_writesectors(FAR struct bchlib_s *bch,
+                                   FAR const uint8_t *buffer,
+                                   size_t sector, size_t nsectors);
+EXTERN int  bchlib_flush(FAR struct bchlib_s *bch);
+#ifdef CONFIG_BCH_PAGECACHE
+EXTERN int  bchlib_initcache(FAR struct bchlib_s *bch);
+#endif
 
 #undef EXTERN
 #if defined(__cplusplus)
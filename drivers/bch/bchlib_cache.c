@@ -25,6 +25,7 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <assert.h>
@@ -88,10 +89,138 @@ static int bch_cypher(FAR struct bchlib_s *bch, int encrypt)
 }
 #endif
 
+/****************************************************************************
+ * Name: bch_reload and bch_wrflush
+ *
+ * Description:
+ *   Page cache callouts that transfer sectors to and from the block driver
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_BCH_PAGECACHE
+static ssize_t bch_reload(FAR void *dev, FAR uint8_t *buffer,
+                          off_t startpage, size_t npages)
+{
+  FAR struct bchlib_s *bch = dev;
+
+  return bch->inode->u.i_bops->read(bch->inode, buffer, startpage, npages);
+}
+
+static ssize_t bch_wrflush(FAR void *dev, FAR const uint8_t *buffer,
+                           off_t startpage, size_t npages)
+{
+  FAR struct bchlib_s *bch = dev;
+
+  return bch->inode->u.i_bops->write(bch->inode, buffer, startpage,
+                                     npages);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: bchlib_initcache
+ *
+ * Description:
+ *   Set up the sector cache once the geometry of the device is known
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_BCH_PAGECACHE
+int bchlib_initcache(FAR struct bchlib_s *bch)
+{
+  if (bch->sectsize > UINT16_MAX)
+    {
+      return -EINVAL;
+    }
+
+  bch->cache.pagesize    = bch->sectsize;
+  bch->cache.npages      = bch->nsectors;
+  bch->cache.maxpages    = CONFIG_BCH_PAGECACHE_SECTORS;
+  bch->cache.ramaxpages  = CONFIG_BCH_PAGECACHE_READAHEAD;
+  bch->cache.directpages = CONFIG_BCH_PAGECACHE_DIRECT;
+  bch->cache.dev         = bch;
+  bch->cache.reload      = bch_reload;
+  bch->cache.flush       = bch->inode->u.i_bops->write ? bch_wrflush : NULL;
+
+  return pagecache_initialize(&bch->cache);
+}
+#endif
+
+/****************************************************************************
+ * Name: bchlib_readsectors
+ *
+ * Description:
+ *   Read whole sectors from the block device, through the sector cache if
+ *   it is enabled.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+ssize_t bchlib_readsectors(FAR struct bchlib_s *bch, FAR uint8_t *buffer,
+                           size_t sector, size_t nsectors)
+{
+#ifdef CONFIG_BCH_PAGECACHE
+  return pagecache_read(&bch->cache, buffer, sector, nsectors);
+#else
+  return bch->inode->u.i_bops->read(bch->inode, buffer, sector, nsectors);
+#endif
+}
+
+/****************************************************************************
+ * Name: bchlib_writesectors
+ *
+ * Description:
+ *   Write whole sectors to the block device, through the sector cache if
+ *   it is enabled.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+ssize_t bchlib_writesectors(FAR struct bchlib_s *bch,
+                            FAR const uint8_t *buffer,
+                            size_t sector, size_t nsectors)
+{
+#ifdef CONFIG_BCH_PAGECACHE
+  return pagecache_write(&bch->cache, buffer, sector, nsectors);
+#else
+  return bch->inode->u.i_bops->write(bch->inode, buffer, sector,
+                                     nsectors);
+#endif
+}
+
+/****************************************************************************
+ * Name: bchlib_flush
+ *
+ * Description:
+ *   Write all modified data back to the block device
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+int bchlib_flush(FAR struct bchlib_s *bch)
+{
+  int ret;
+
+  ret = bchlib_flushsector(bch, false);
+#ifdef CONFIG_BCH_PAGECACHE
+  if (ret >= 0)
+    {
+      ret = pagecache_flush(&bch->cache);
+    }
+#endif
+
+  return ret;
+}
+
 /****************************************************************************
  * Name: bchlib_flushsector
  *
@@ -105,7 +234,6 @@ static int bch_cypher(FAR struct bchlib_s *bch, int encrypt)
 
 int bchlib_flushsector(FAR struct bchlib_s *bch, bool discard)
 {
-  FAR struct inode *inode;
   ssize_t ret = OK;
 
   /* Check if the sector has been modified and is out of synch with the
@@ -114,8 +242,6 @@ int bchlib_flushsector(FAR struct bchlib_s *bch, bool discard)
 
   if (bch->dirty)
     {
-      inode = bch->inode;
-
 #if defined(CONFIG_BCH_ENCRYPTION)
       /* Encrypt data as necessary */
 
@@ -124,7 +250,7 @@ int bchlib_flushsector(FAR struct bchlib_s *bch, bool discard)
 
       /* Write the sector to the media */
 
-      ret = inode->u.i_bops->write(inode, bch->buffer, bch->sector, 1);
+      ret = bchlib_writesectors(bch, bch->buffer, bch->sector, 1);
       if (ret < 0)
         {
           ferr("Write failed: %zd\n", ret);
@@ -165,13 +291,10 @@ int bchlib_flushsector(FAR struct bchlib_s *bch, bool discard)
 
 int bchlib_readsector(FAR struct bchlib_s *bch, size_t sector)
 {
-  FAR struct inode *inode;
   ssize_t ret = OK;
 
   if (bch->sector != sector)
     {
-      inode = bch->inode;
-
       ret = bchlib_flushsector(bch, true);
       if (ret < 0)
         {
@@ -179,7 +302,7 @@ int bchlib_readsector(FAR struct bchlib_s *bch, size_t sector)
           return (int)ret;
         }
 
-      ret = inode->u.i_bops->read(inode, bch->buffer, sector, 1);
+      ret = bchlib_readsectors(bch, bch->buffer, sector, 1);
       if (ret < 0)
         {
           ferr("Read failed: %zd\n", ret);
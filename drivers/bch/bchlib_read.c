@@ -146,8 +146,21 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset,
           nsectors = bch->nsectors - sector;
         }
 
-      ret = bch->inode->u.i_bops->read(bch->inode, (FAR uint8_t *)buffer,
-                                       sector, nsectors);
+      /* The sector buffer may hold newer data for one of these sectors */
+
+      if (bch->dirty && sector <= bch->sector &&
+          bch->sector < sector + nsectors)
+        {
+          ret = bchlib_flushsector(bch, false);
+          if (ret < 0)
+            {
+              ferr("ERROR: Flush failed: %d\n", ret);
+              return ret;
+            }
+        }
+
+      ret = bchlib_readsectors(bch, (FAR uint8_t *)buffer, sector,
+                               nsectors);
       if (ret < 0)
         {
           ferr("ERROR: Read failed: %d\n", ret);
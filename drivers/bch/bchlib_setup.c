@@ -125,6 +125,16 @@ int bchlib_setup(const char *blkdev, bool readonly, FAR void **handle)
       goto errout_with_bch;
     }
 
+#ifdef CONFIG_BCH_PAGECACHE
+  ret = bchlib_initcache(bch);
+  if (ret < 0)
+    {
+      ferr("ERROR: Failed to set up sector cache: %d\n", ret);
+      kmm_free(bch->buffer);
+      goto errout_with_bch;
+    }
+#endif
+
   *handle = bch;
   return OK;
 
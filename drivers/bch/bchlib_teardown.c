@@ -63,6 +63,9 @@ int bchlib_teardown(FAR void *handle)
   /* Flush any pending data to the block driver */
 
   bchlib_flushsector(bch, false);
+#ifdef CONFIG_BCH_PAGECACHE
+  pagecache_uninitialize(&bch->cache);
+#endif
 
   /* Close the block driver */
 
@@ -38,7 +38,10 @@
 #include <debug.h>
 #include <errno.h>
 
+#include <nuttx/crc32.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/mtd/mtd.h>
@@ -60,10 +63,60 @@
 
 #define DEV_NAME_MAX    (NAME_MAX + 5)
 
+#ifdef CONFIG_FTL_LOG
+
+/* Background garbage collection needs the low priority work queue */
+
+#  ifdef CONFIG_FTL_LOG_GC_THRESHOLD
+#    define FTL_LOG_BACKGROUND 1
+#  endif
+
+/* Erase block states of the log-structured FTL */
+
+#  define FTL_LOG_FREE      0   /* Erased, available for writing */
+#  define FTL_LOG_DIRTY     1   /* Available for writing once erased */
+#  define FTL_LOG_ACTIVE    2   /* Being filled */
+#  define FTL_LOG_CLOSED    3   /* Filled, its summary is written */
+#  define FTL_LOG_PENDING   4   /* Collected, see ftl_log_collect() */
+#  define FTL_LOG_BAD       5   /* Not usable */
+
+#  define FTL_LOG_MAGIC     0x474f4c46 /* "FLOG" */
+#  define FTL_LOG_UNMAPPED  UINT32_MAX
+#  define FTL_LOG_NOBLOCK   UINT32_MAX
+
+#  define SIZEOF_FTL_LOG_SUMMARY(n) \
+     (offsetof(struct ftl_log_summary_s, lsn) + (n) * sizeof(uint32_t))
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_FTL_LOG
+/* The last block of each erase block of the log-structured FTL holds its
+ * summary: the logical sector held by each of the other blocks, or
+ * FTL_LOG_UNMAPPED.  The mapping table is rebuilt from the summaries,
+ * where the erase block with the highest sequence number wins.
+ */
+
+struct ftl_log_summary_s
+{
+  uint32_t magic;                 /* FTL_LOG_MAGIC */
+  uint32_t crc;                   /* CRC32 of the rest of the summary */
+  uint32_t seq;                   /* Order of closing the erase blocks */
+  uint32_t ec;                    /* Erase count of the erase block */
+  uint32_t lsn[1];                /* Actual size is dev->npages */
+};
+
+struct ftl_log_block_s
+{
+  uint32_t seq;                   /* Sequence number of the summary */
+  uint32_t ec;                    /* Erase count */
+  uint16_t nvalid;                /* Number of live blocks */
+  uint8_t  state;                 /* See FTL_LOG_* definitions */
+};
+#endif
+
 struct ftl_struct_s
 {
   FAR struct mtd_dev_s *mtd;      /* Contained MTD interface */
@@ -80,6 +133,27 @@ struct ftl_struct_s
 
   FAR off_t            *lptable;
   off_t                 lpcount;
+
+#ifdef CONFIG_FTL_LOG
+  /* Log-structured mode, used if l2p is not NULL */
+
+  mutex_t               lock;       /* Protects the state below */
+  FAR uint32_t         *l2p;        /* Logical sector to block map */
+  FAR uint32_t         *p2l;        /* Block to logical sector map */
+  FAR struct ftl_log_block_s *blocks; /* State of each erase block */
+  uint32_t              nsectors;   /* Number of logical sectors */
+  uint32_t              seq;        /* Next summary sequence number */
+  uint32_t              active;     /* Erase block being filled */
+  uint32_t              nfree;      /* Number of free and dirty blocks */
+  uint16_t              npages;     /* Data blocks per erase block */
+  uint16_t              nextpage;   /* Next block of the active block */
+  uint8_t               erasestate; /* Value of erased bytes */
+#ifdef FTL_LOG_BACKGROUND
+  struct work_s         work;       /* Background garbage collection */
+#endif
+#endif
+
+  struct ftl_stats_s    stats;      /* Statistics for BIOC_FTLSTATS */
 };
 
 /****************************************************************************
@@ -104,6 +178,16 @@ static int     ftl_ioctl(FAR struct inode *inode, int cmd,
 #ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
 static int     ftl_unlink(FAR struct inode *inode);
 #endif
+#ifdef CONFIG_FTL_LOG
+static ssize_t ftl_log_append(FAR struct ftl_struct_s *dev,
+                              FAR const uint8_t *buffer, uint32_t lsn,
+                              size_t count, bool gc);
+static int     ftl_log_sync(FAR struct ftl_struct_s *dev);
+static void    ftl_log_uninitialize(FAR struct ftl_struct_s *dev);
+#ifdef FTL_LOG_BACKGROUND
+static void    ftl_log_worker(FAR void *arg);
+#endif
+#endif
 
 /****************************************************************************
  * Private Data
@@ -198,218 +282,1112 @@ static size_t ftl_get_cblock(FAR struct ftl_struct_s *dev, off_t start,
         }
     }
 
-  return count;
+  return count;
+}
+
+/****************************************************************************
+ * Name: ftl_open
+ *
+ * Description: Open the block device
+ *
+ ****************************************************************************/
+
+static int ftl_open(FAR struct inode *inode)
+{
+  FAR struct ftl_struct_s *dev;
+
+  DEBUGASSERT(inode->i_private);
+  dev = inode->i_private;
+
+  dev->refs++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_close
+ *
+ * Description: close the block device
+ *
+ ****************************************************************************/
+
+static int ftl_close(FAR struct inode *inode)
+{
+  FAR struct ftl_struct_s *dev;
+
+  DEBUGASSERT(inode->i_private);
+  dev = inode->i_private;
+
+#ifdef CONFIG_FTL_WRITEBUFFER
+  rwb_flush(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_LOG
+  if (dev->l2p != NULL)
+    {
+      ftl_log_sync(dev);
+    }
+#endif
+
+  if (--dev->refs == 0 && dev->unlinked)
+    {
+#ifdef FTL_HAVE_RWBUFFER
+      rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_LOG
+      ftl_log_uninitialize(dev);
+#endif
+      if (dev->eblock)
+        {
+          kmm_free(dev->eblock);
+        }
+
+      kmm_free(dev);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_mtd_bread
+ *
+ * Description:
+ *   Read the specified number of sectors. If mtd device is nor flash, it
+ *   can be read once time. If mtd device is nand flash, it can be read one
+ *   block every time and need to skip bad block until the specified number
+ *   of sectors finish.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_bread(FAR struct ftl_struct_s *dev, off_t startblock,
+                             size_t nblocks, FAR uint8_t *buffer)
+{
+  off_t mask = dev->blkper - 1;
+  size_t nread = nblocks;
+  ssize_t ret = OK;
+
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_BREAD(dev->mtd, startblock, nblocks, buffer);
+      if (ret != nblocks)
+        {
+          ferr("ERROR: Read %zu blocks starting at block %" PRIdOFF
+               " failed: %zd\n", nblocks, startblock, ret);
+        }
+
+      return ret;
+    }
+
+  while (nblocks > 0)
+    {
+      off_t startphysicalblock;
+      off_t starteraseblock;
+      size_t count;
+
+      starteraseblock = startblock / dev->blkper;
+      if (starteraseblock >= dev->lpcount)
+        {
+          ret = -ENOSPC;
+          break;
+        }
+
+      count = ftl_get_cblock(dev, starteraseblock,
+                             (nblocks + mask) / dev->blkper);
+      count = MIN(count * dev->blkper, nblocks);
+      startphysicalblock = dev->lptable[starteraseblock] *
+                           dev->blkper + (startblock & mask);
+      ret = MTD_BREAD(dev->mtd, startphysicalblock, count, buffer);
+      if (ret == count || ret == -EUCLEAN)
+        {
+          nblocks -= count;
+          startblock += count;
+          buffer += count * dev->geo.blocksize;
+        }
+      else
+        {
+          ftl_update_map(dev, starteraseblock);
+          break;
+        }
+    }
+
+  return nblocks != nread ? nread - nblocks : ret;
+}
+
+/****************************************************************************
+ * Name: ftl_mtd_bwrite
+ *
+ * Description:
+ *   Write the specified eraseblocks. If mtd device is nor flash, it
+ *   can be written once time. If mtd device is nand flash, it can be write
+ *   one block every time and need to skip bad block until writing success.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_bwrite(FAR struct ftl_struct_s *dev, off_t startblock,
+                              FAR const uint8_t *buffer)
+{
+  off_t starteraseblock;
+  ssize_t ret;
+
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_BWRITE(dev->mtd, startblock, dev->blkper, buffer);
+      if (ret != dev->blkper)
+        {
+          ferr("ERROR: Write block %" PRIdOFF " failed: %zd\n",
+               startblock, ret);
+        }
+      else
+        {
+          dev->stats.flashwrites += dev->blkper;
+        }
+
+      return ret;
+    }
+
+  starteraseblock = startblock / dev->blkper;
+  while (1)
+    {
+      if (starteraseblock >= dev->lpcount)
+        {
+          return -ENOSPC;
+        }
+
+      ret = MTD_BWRITE(dev->mtd, dev->lptable[starteraseblock] * dev->blkper,
+                       dev->blkper, buffer);
+      if (ret == dev->blkper)
+        {
+          dev->stats.flashwrites += dev->blkper;
+          return ret;
+        }
+
+      MTD_MARKBAD(dev->mtd, dev->lptable[starteraseblock]);
+      ftl_update_map(dev, starteraseblock);
+    }
+}
+
+/****************************************************************************
+ * Name: ftl_mtd_erase
+ *
+ * Description:
+ *   Erase the specified number of sectors. If mtd device is nor flash, it
+ *   can be erased once time. If mtd device is nand flash, it can be erased
+ *   one block every time and need to skip bad block until the specified
+ *   number of sectors finish.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_erase(FAR struct ftl_struct_s *dev, off_t startblock)
+{
+  ssize_t ret;
+
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_ERASE(dev->mtd, startblock, 1);
+      if (ret < 0)
+        {
+          ferr("ERROR: Erase block %" PRIdOFF " failed: %zd\n",
+               startblock, ret);
+        }
+      else
+        {
+          dev->stats.erases++;
+        }
+
+      return ret;
+    }
+
+  while (1)
+    {
+      if (startblock >= dev->lpcount)
+        {
+          return -ENOSPC;
+        }
+
+      ret = MTD_ERASE(dev->mtd, dev->lptable[startblock], 1);
+      if (ret == 1)
+        {
+          dev->stats.erases++;
+          return ret;
+        }
+
+      MTD_MARKBAD(dev->mtd, dev->lptable[startblock]);
+      ftl_update_map(dev, startblock);
+    }
+}
+
+/****************************************************************************
+ * Name: ftl_alloc_eblock
+ *
+ * Description: Allocate the in-memory erase block buffer
+ *
+ ****************************************************************************/
+
+static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
+{
+  if (dev->eblock == NULL)
+    {
+      /* Allocate one, in-memory erase block buffer */
+
+      dev->eblock = kmm_malloc(dev->geo.erasesize);
+    }
+
+  return dev->eblock != NULL ? OK : -ENOMEM;
+}
+
+#ifdef CONFIG_FTL_LOG
+
+/****************************************************************************
+ * Name: ftl_log_erase
+ *
+ * Description: Erase a dirty erase block of the log-structured FTL.  An
+ *              erase block that fails to erase is marked bad.
+ *
+ ****************************************************************************/
+
+static int ftl_log_erase(FAR struct ftl_struct_s *dev, uint32_t block)
+{
+  FAR struct ftl_log_block_s *blk = &dev->blocks[block];
+  int ret;
+
+  ret = MTD_ERASE(dev->mtd, block, 1);
+  if (ret < 0)
+    {
+      ferr("ERROR: Erase block %" PRIu32 " failed: %d\n", block, ret);
+      MTD_MARKBAD(dev->mtd, block);
+      blk->state = FTL_LOG_BAD;
+      dev->nfree--;
+      return ret;
+    }
+
+  dev->stats.erases++;
+  blk->ec++;
+  blk->state = FTL_LOG_FREE;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_map
+ *
+ * Description: Map a logical sector to a block, or unmap it if 'page' is
+ *              FTL_LOG_UNMAPPED.
+ *
+ ****************************************************************************/
+
+static void ftl_log_map(FAR struct ftl_struct_s *dev, uint32_t lsn,
+                        uint32_t page)
+{
+  uint32_t old = dev->l2p[lsn];
+
+  if (old != FTL_LOG_UNMAPPED)
+    {
+      dev->p2l[old] = FTL_LOG_UNMAPPED;
+      dev->blocks[old / dev->blkper].nvalid--;
+    }
+
+  dev->l2p[lsn] = page;
+  if (page != FTL_LOG_UNMAPPED)
+    {
+      dev->p2l[page] = lsn;
+      dev->blocks[page / dev->blkper].nvalid++;
+    }
+}
+
+/****************************************************************************
+ * Name: ftl_log_alloc
+ *
+ * Description: Make the least worn free erase block the active one.  The
+ *              last free erase block is kept for the garbage collection.
+ *
+ ****************************************************************************/
+
+static int ftl_log_alloc(FAR struct ftl_struct_s *dev, bool gc)
+{
+  FAR struct ftl_log_block_s *blk;
+  uint32_t best;
+  uint32_t i;
+
+  while (dev->nfree > (gc ? 0 : 1))
+    {
+      best = FTL_LOG_NOBLOCK;
+      for (i = 0; i < dev->geo.neraseblocks; i++)
+        {
+          blk = &dev->blocks[i];
+          if ((blk->state == FTL_LOG_FREE || blk->state == FTL_LOG_DIRTY) &&
+              (best == FTL_LOG_NOBLOCK || blk->ec < dev->blocks[best].ec))
+            {
+              best = i;
+            }
+        }
+
+      DEBUGASSERT(best != FTL_LOG_NOBLOCK);
+      blk = &dev->blocks[best];
+      if (blk->state == FTL_LOG_DIRTY && ftl_log_erase(dev, best) < 0)
+        {
+          continue;
+        }
+
+      blk->state    = FTL_LOG_ACTIVE;
+      blk->nvalid   = 0;
+      dev->active   = best;
+      dev->nextpage = 0;
+      dev->nfree--;
+      return OK;
+    }
+
+  return -ENOSPC;
+}
+
+/****************************************************************************
+ * Name: ftl_log_close
+ *
+ * Description: Write the summary of the active erase block, which makes
+ *              its content persistent.
+ *
+ ****************************************************************************/
+
+static int ftl_log_close(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_log_summary_s *summary;
+  FAR struct ftl_log_block_s *blk;
+  uint32_t first;
+  uint32_t i;
+  ssize_t nxfrd;
+
+  if (dev->active == FTL_LOG_NOBLOCK)
+    {
+      return OK;
+    }
+
+  blk   = &dev->blocks[dev->active];
+  first = dev->active * dev->blkper;
+
+  /* The summary is built in the second I/O block of the erase block
+   * buffer, the first one is used by the garbage collection.
+   */
+
+  summary = (FAR struct ftl_log_summary_s *)
+            (dev->eblock + dev->geo.blocksize);
+  memset(summary, dev->erasestate, dev->geo.blocksize);
+
+  for (i = 0; i < dev->npages; i++)
+    {
+      summary->lsn[i] = i < dev->nextpage ? dev->p2l[first + i] :
+                                            FTL_LOG_UNMAPPED;
+    }
+
+  summary->magic = FTL_LOG_MAGIC;
+  summary->seq   = dev->seq;
+  summary->ec    = blk->ec;
+  summary->crc   = crc32((FAR const uint8_t *)&summary->seq,
+                         SIZEOF_FTL_LOG_SUMMARY(dev->npages) -
+                         offsetof(struct ftl_log_summary_s, seq));
+
+  /* The block stays active until its summary is on the media: its
+   * sectors are not persistent before, and a failure is reported again
+   * by the next write or flush.
+   */
+
+  nxfrd = MTD_BWRITE(dev->mtd, first + dev->npages, 1,
+                     (FAR const uint8_t *)summary);
+  if (nxfrd != 1)
+    {
+      ferr("ERROR: Write summary of block %" PRIu32 " failed: %zd\n",
+           first / dev->blkper, nxfrd);
+      return nxfrd < 0 ? nxfrd : -EIO;
+    }
+
+  dev->stats.flashwrites++;
+  dev->seq++;
+
+  blk->seq    = summary->seq;
+  blk->state  = FTL_LOG_CLOSED;
+  dev->active = FTL_LOG_NOBLOCK;
+
+  /* Everything written so far is persistent now, the collected erase
+   * blocks may be erased.
+   */
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      if (dev->blocks[i].state == FTL_LOG_PENDING)
+        {
+          dev->blocks[i].state = FTL_LOG_DIRTY;
+          dev->nfree++;
+        }
+    }
+
+#ifdef FTL_LOG_BACKGROUND
+  if (work_available(&dev->work))
+    {
+      work_queue(LPWORK, &dev->work, ftl_log_worker, dev, 0);
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_victim
+ *
+ * Description: Select the erase block to collect among those with at most
+ *              'room' live blocks: the one with the fewest live blocks or,
+ *              if 'cold', the least worn one.
+ *
+ ****************************************************************************/
+
+static uint32_t ftl_log_victim(FAR struct ftl_struct_s *dev,
+                               uint32_t room, bool cold)
+{
+  FAR struct ftl_log_block_s *blk;
+  FAR struct ftl_log_block_s *best = NULL;
+  uint32_t victim = FTL_LOG_NOBLOCK;
+  uint32_t i;
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      blk = &dev->blocks[i];
+      if (blk->state != FTL_LOG_CLOSED || blk->nvalid > room)
+        {
+          continue;
+        }
+
+      if (best == NULL ||
+          (cold && blk->ec < best->ec) ||
+          (!cold && (blk->nvalid < best->nvalid ||
+                     (blk->nvalid == best->nvalid && blk->ec < best->ec))))
+        {
+          best   = blk;
+          victim = i;
+        }
+    }
+
+  return victim;
+}
+
+/****************************************************************************
+ * Name: ftl_log_collect
+ *
+ * Description: Move the live blocks of an erase block to the active one.
+ *              Until the active erase block is closed, the collected one
+ *              may still hold the only persistent copy of its blocks, or
+ *              of blocks since rewritten, so it is only erased after that.
+ *
+ ****************************************************************************/
+
+static int ftl_log_collect(FAR struct ftl_struct_s *dev, uint32_t victim)
+{
+  FAR struct ftl_log_block_s *blk = &dev->blocks[victim];
+  uint32_t first = victim * dev->blkper;
+  uint32_t lsn;
+  uint32_t i;
+  ssize_t ret;
+
+  for (i = 0; i < dev->npages && blk->nvalid > 0; i++)
+    {
+      lsn = dev->p2l[first + i];
+      if (lsn == FTL_LOG_UNMAPPED)
+        {
+          continue;
+        }
+
+      ret = MTD_BREAD(dev->mtd, first + i, 1, dev->eblock);
+      if (ret != 1 && ret != -EUCLEAN)
+        {
+          return ret < 0 ? ret : -EIO;
+        }
+
+      ret = ftl_log_append(dev, dev->eblock, lsn, 1, true);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      dev->stats.gcmoves++;
+    }
+
+  if (dev->active == FTL_LOG_NOBLOCK)
+    {
+      blk->state = FTL_LOG_DIRTY;
+      dev->nfree++;
+    }
+  else
+    {
+      blk->state = FTL_LOG_PENDING;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_gc
+ *
+ * Description: Collect the erase block with the fewest live blocks, when
+ *              a write runs out of free erase blocks.  The reserved erase
+ *              blocks guarantee that it has fewer live blocks than fit in
+ *              one erase block.
+ *
+ ****************************************************************************/
+
+static int ftl_log_gc(FAR struct ftl_struct_s *dev)
+{
+  uint32_t victim;
+  int ret;
+
+  victim = ftl_log_victim(dev, dev->npages - 1, false);
+  if (victim == FTL_LOG_NOBLOCK)
+    {
+      return -ENOSPC;
+    }
+
+  if (dev->blocks[victim].nvalid > 0)
+    {
+      ret = ftl_log_alloc(dev, true);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return ftl_log_collect(dev, victim);
+}
+
+/****************************************************************************
+ * Name: ftl_log_append
+ *
+ * Description: Write sectors to the next free blocks of the active erase
+ *              block, opening a new one as needed.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_append(FAR struct ftl_struct_s *dev,
+                              FAR const uint8_t *buffer, uint32_t lsn,
+                              size_t count, bool gc)
+{
+  size_t remaining = count;
+  uint32_t page;
+  ssize_t nxfrd;
+  size_t n;
+  size_t i;
+  int ret;
+
+  while (remaining > 0)
+    {
+      if (dev->active != FTL_LOG_NOBLOCK && dev->nextpage >= dev->npages)
+        {
+          ret = ftl_log_close(dev);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      if (dev->active == FTL_LOG_NOBLOCK)
+        {
+          ret = ftl_log_alloc(dev, gc);
+          if (ret == -ENOSPC && !gc)
+            {
+              ret = ftl_log_gc(dev);
+            }
+
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          continue;
+        }
+
+      n     = MIN(remaining, dev->npages - dev->nextpage);
+      page  = dev->active * dev->blkper + dev->nextpage;
+      nxfrd = MTD_BWRITE(dev->mtd, page, n, buffer);
+      if (nxfrd != n)
+        {
+          ferr("ERROR: Write %zu blocks at %" PRIu32 " failed: %zd\n",
+               n, page, nxfrd);
+
+          /* Do not use the rest of this erase block */
+
+          dev->nextpage = dev->npages;
+          return nxfrd < 0 ? nxfrd : -EIO;
+        }
+
+      dev->nextpage            += n;
+      dev->stats.flashwrites   += n;
+
+      for (i = 0; i < n; i++)
+        {
+          ftl_log_map(dev, lsn + i, page + i);
+        }
+
+      lsn       += n;
+      remaining -= n;
+      buffer    += n * dev->geo.blocksize;
+    }
+
+  return count;
+}
+
+/****************************************************************************
+ * Name: ftl_log_worker
+ *
+ * Description: Background garbage collection: erase the dirty erase
+ *              blocks, collect one erase block if free ones run low and
+ *              move the content of the least worn erase block if the wear
+ *              becomes uneven.
+ *
+ ****************************************************************************/
+
+#ifdef FTL_LOG_BACKGROUND
+static void ftl_log_worker(FAR void *arg)
+{
+  FAR struct ftl_struct_s *dev = arg;
+  FAR struct ftl_log_block_s *blk;
+  uint32_t minec = UINT32_MAX;
+  uint32_t maxec = 0;
+  uint32_t victim;
+  uint32_t room;
+  uint32_t i;
+
+  if (nxmutex_lock(&dev->lock) < 0)
+    {
+      return;
+    }
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      blk = &dev->blocks[i];
+      if (blk->state == FTL_LOG_DIRTY)
+        {
+          ftl_log_erase(dev, i);
+        }
+
+      /* Only closed erase blocks can be moved, so the coldest of them
+       * is compared against the most worn of all usable ones.
+       */
+
+      if (blk->state == FTL_LOG_CLOSED)
+        {
+          minec = MIN(minec, blk->ec);
+        }
+
+      if (blk->state != FTL_LOG_BAD)
+        {
+          maxec = MAX(maxec, blk->ec);
+        }
+    }
+
+  /* The moved blocks must fit in the active erase block.  Without one,
+   * only erase blocks without live blocks can be collected.
+   */
+
+  room = 0;
+  if (dev->active != FTL_LOG_NOBLOCK)
+    {
+      room = dev->npages - dev->nextpage;
+    }
+
+  victim = FTL_LOG_NOBLOCK;
+  if (minec != UINT32_MAX && maxec - minec > CONFIG_FTL_LOG_WEAR_DELTA)
+    {
+      /* The coldest block that fits may be warmer than minec, so only
+       * move it if it is still well behind the most worn one.
+       */
+
+      victim = ftl_log_victim(dev, room, true);
+      if (victim != FTL_LOG_NOBLOCK &&
+          dev->blocks[victim].ec + CONFIG_FTL_LOG_WEAR_DELTA >= maxec)
+        {
+          victim = FTL_LOG_NOBLOCK;
+        }
+    }
+
+  if (victim == FTL_LOG_NOBLOCK && dev->nfree < CONFIG_FTL_LOG_GC_THRESHOLD)
+    {
+      victim = ftl_log_victim(dev, MIN(room, dev->npages - 1), false);
+    }
+
+  if (victim != FTL_LOG_NOBLOCK)
+    {
+      ftl_log_collect(dev, victim);
+    }
+
+  nxmutex_unlock(&dev->lock);
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_log_read
+ *
+ * Description: Read sectors of the log-structured FTL.  Sectors that were
+ *              never written read as erased.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_read(FAR struct ftl_struct_s *dev,
+                            FAR uint8_t *buffer, off_t startblock,
+                            size_t nblocks)
+{
+  FAR uint32_t *l2p = dev->l2p;
+  uint32_t page;
+  ssize_t ret;
+  size_t i;
+  size_t n;
+
+  if (startblock < 0 || startblock + nblocks > dev->nsectors)
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (i = 0; i < nblocks; i += n)
+    {
+      /* Read the sectors held by consecutive blocks at once */
+
+      page = l2p[startblock + i];
+      n    = 1;
+
+      if (page == FTL_LOG_UNMAPPED)
+        {
+          memset(buffer, dev->erasestate, dev->geo.blocksize);
+        }
+      else
+        {
+          while (i + n < nblocks && l2p[startblock + i + n] == page + n)
+            {
+              n++;
+            }
+
+          ret = MTD_BREAD(dev->mtd, page, n, buffer);
+          if (ret != n && ret != -EUCLEAN)
+            {
+              ferr("ERROR: Read %zu blocks at %" PRIu32 " failed: %zd\n",
+                   n, page, ret);
+              break;
+            }
+        }
+
+      buffer += n * dev->geo.blocksize;
+    }
+
+  nxmutex_unlock(&dev->lock);
+  if (i > 0)
+    {
+      return i;
+    }
+
+  return ret < 0 ? ret : -EIO;
+}
+
+/****************************************************************************
+ * Name: ftl_log_write
+ *
+ * Description: Write sectors of the log-structured FTL
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_write(FAR struct ftl_struct_s *dev,
+                             FAR const uint8_t *buffer, off_t startblock,
+                             size_t nblocks)
+{
+  ssize_t ret;
+
+  if (startblock < 0 || startblock + nblocks > dev->nsectors)
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = ftl_log_append(dev, buffer, startblock, nblocks, false);
+  nxmutex_unlock(&dev->lock);
+  return ret;
 }
 
 /****************************************************************************
- * Name: ftl_open
+ * Name: ftl_log_sync
  *
- * Description: Open the block device
+ * Description: Make the written sectors persistent
  *
  ****************************************************************************/
 
-static int ftl_open(FAR struct inode *inode)
+static int ftl_log_sync(FAR struct ftl_struct_s *dev)
 {
-  FAR struct ftl_struct_s *dev;
+  int ret;
 
-  DEBUGASSERT(inode->i_private);
-  dev = inode->i_private;
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
 
-  dev->refs++;
-  return OK;
+  ret = ftl_log_close(dev);
+  nxmutex_unlock(&dev->lock);
+  return ret;
 }
 
 /****************************************************************************
- * Name: ftl_close
+ * Name: ftl_log_discard
  *
- * Description: close the block device
+ * Description: Forget the content of sectors, so that the garbage
+ *              collection does not have to move them.  Discards are not
+ *              persistent: after a restart, the sectors may read as they
+ *              did before.
  *
  ****************************************************************************/
 
-static int ftl_close(FAR struct inode *inode)
+static int ftl_log_discard(FAR struct ftl_struct_s *dev,
+                           FAR const blkcnt_t *range)
 {
-  FAR struct ftl_struct_s *dev;
-
-  DEBUGASSERT(inode->i_private);
-  dev = inode->i_private;
+  blkcnt_t i;
+  int ret;
 
-#ifdef CONFIG_FTL_WRITEBUFFER
-  rwb_flush(&dev->rwb);
-#endif
+  if (range[0] > dev->nsectors || range[1] > dev->nsectors - range[0])
+    {
+      return -EINVAL;
+    }
 
-  if (--dev->refs == 0 && dev->unlinked)
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
     {
-#ifdef FTL_HAVE_RWBUFFER
-      rwb_uninitialize(&dev->rwb);
-#endif
-      if (dev->eblock)
-        {
-          kmm_free(dev->eblock);
-        }
+      return ret;
+    }
 
-      kmm_free(dev);
+  for (i = range[0]; i < range[0] + range[1]; i++)
+    {
+      ftl_log_map(dev, i, FTL_LOG_UNMAPPED);
     }
 
+  dev->stats.discards += range[1];
+  nxmutex_unlock(&dev->lock);
   return OK;
 }
 
 /****************************************************************************
- * Name: ftl_mtd_bread
+ * Name: ftl_log_stats
  *
- * Description:
- *   Read the specified number of sectors. If mtd device is nor flash, it
- *   can be read once time. If mtd device is nand flash, it can be read one
- *   block every time and need to skip bad block until the specified number
- *   of sectors finish.
+ * Description: Return the statistics of the log-structured FTL
  *
  ****************************************************************************/
 
-static ssize_t ftl_mtd_bread(FAR struct ftl_struct_s *dev, off_t startblock,
-                             size_t nblocks, FAR uint8_t *buffer)
+static int ftl_log_stats(FAR struct ftl_struct_s *dev,
+                         FAR struct ftl_stats_s *stats)
 {
-  off_t mask = dev->blkper - 1;
-  size_t nread = nblocks;
-  ssize_t ret = OK;
+  FAR struct ftl_log_block_s *blk;
+  uint32_t i;
+  int ret;
 
-  if (dev->lptable == NULL)
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
     {
-      ret = MTD_BREAD(dev->mtd, startblock, nblocks, buffer);
-      if (ret != nblocks)
-        {
-          ferr("ERROR: Read %zu blocks starting at block %" PRIdOFF
-               " failed: %zd\n", nblocks, startblock, ret);
-        }
-
       return ret;
     }
 
-  while (nblocks > 0)
-    {
-      off_t startphysicalblock;
-      off_t starteraseblock;
-      size_t count;
+  memcpy(stats, &dev->stats, sizeof(struct ftl_stats_s));
+  stats->minerase   = UINT32_MAX;
+  stats->freeblocks = dev->nfree;
 
-      starteraseblock = startblock / dev->blkper;
-      if (starteraseblock >= dev->lpcount)
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      blk = &dev->blocks[i];
+      if (blk->state != FTL_LOG_BAD)
         {
-          ret = -ENOSPC;
-          break;
+          stats->minerase = MIN(stats->minerase, blk->ec);
+          stats->maxerase = MAX(stats->maxerase, blk->ec);
         }
+    }
 
-      count = ftl_get_cblock(dev, starteraseblock,
-                             (nblocks + mask) / dev->blkper);
-      count = MIN(count * dev->blkper, nblocks);
-      startphysicalblock = dev->lptable[starteraseblock] *
-                           dev->blkper + (startblock & mask);
-      ret = MTD_BREAD(dev->mtd, startphysicalblock, count, buffer);
-      if (ret == count || ret == -EUCLEAN)
-        {
-          nblocks -= count;
-          startblock += count;
-          buffer += count * dev->geo.blocksize;
-        }
-      else
-        {
-          ftl_update_map(dev, starteraseblock);
-          break;
-        }
+  if (stats->minerase == UINT32_MAX)
+    {
+      stats->minerase = 0;
     }
 
-  return nblocks != nread ? nread - nblocks : ret;
+  nxmutex_unlock(&dev->lock);
+  return OK;
 }
 
 /****************************************************************************
- * Name: ftl_mtd_bwrite
+ * Name: ftl_log_uninitialize
  *
- * Description:
- *   Write the specified eraseblocks. If mtd device is nor flash, it
- *   can be written once time. If mtd device is nand flash, it can be write
- *   one block every time and need to skip bad block until writing success.
+ * Description: Release the resources of the log-structured FTL
  *
  ****************************************************************************/
 
-static ssize_t ftl_mtd_bwrite(FAR struct ftl_struct_s *dev, off_t startblock,
-                              FAR const uint8_t *buffer)
+static void ftl_log_uninitialize(FAR struct ftl_struct_s *dev)
 {
-  off_t starteraseblock;
-  ssize_t ret;
-
-  if (dev->lptable == NULL)
+  if (dev->l2p == NULL)
     {
-      ret = MTD_BWRITE(dev->mtd, startblock, dev->blkper, buffer);
-      if (ret != dev->blkper)
-        {
-          ferr("ERROR: Write block %" PRIdOFF " failed: %zd\n",
-               startblock, ret);
-        }
-
-      return ret;
+      return;
     }
 
-  starteraseblock = startblock / dev->blkper;
-  while (1)
-    {
-      if (starteraseblock >= dev->lpcount)
-        {
-          return -ENOSPC;
-        }
+#ifdef FTL_LOG_BACKGROUND
+  /* Wait for a running garbage collection to finish */
 
-      ret = MTD_BWRITE(dev->mtd, dev->lptable[starteraseblock] * dev->blkper,
-                       dev->blkper, buffer);
-      if (ret == dev->blkper)
-        {
-          return ret;
-        }
+  work_cancel(LPWORK, &dev->work);
+  nxmutex_lock(&dev->lock);
+  nxmutex_unlock(&dev->lock);
+#endif
 
-      MTD_MARKBAD(dev->mtd, dev->lptable[starteraseblock]);
-      ftl_update_map(dev, starteraseblock);
-    }
+  nxmutex_destroy(&dev->lock);
+  kmm_free(dev->blocks);
+  kmm_free(dev->p2l);
+  kmm_free(dev->l2p);
+  dev->l2p = NULL;
 }
 
 /****************************************************************************
- * Name: ftl_mtd_erase
+ * Name: ftl_log_initialize
  *
- * Description:
- *   Erase the specified number of sectors. If mtd device is nor flash, it
- *   can be erased once time. If mtd device is nand flash, it can be erased
- *   one block every time and need to skip bad block until the specified
- *   number of sectors finish.
+ * Description: Set up the log-structured FTL and rebuild its mapping table
+ *              from the erase block summaries.  Returns -ENOSYS if the
+ *              geometry of the device does not allow it.
  *
  ****************************************************************************/
 
-static ssize_t ftl_mtd_erase(FAR struct ftl_struct_s *dev, off_t startblock)
+static int ftl_log_initialize(FAR struct ftl_struct_s *dev)
 {
-  ssize_t ret;
+  FAR struct ftl_log_summary_s *summary;
+  FAR struct ftl_log_block_s *blk;
+  uint32_t nblocks = dev->geo.neraseblocks;
+  uint64_t ecsum = 0;
+  uint32_t ecknown = 0;
+  uint32_t first;
+  uint32_t page;
+  uint32_t old;
+  uint32_t lsn;
+  uint32_t i;
+  uint32_t j;
+  ssize_t nxfrd;
+  int ret;
 
-  if (dev->lptable == NULL)
+  if (dev->blkper < 2 || nblocks <= CONFIG_FTL_LOG_RESERVE ||
+      SIZEOF_FTL_LOG_SUMMARY(dev->blkper - 1) > dev->geo.blocksize)
     {
-      ret = MTD_ERASE(dev->mtd, startblock, 1);
-      if (ret < 0)
-        {
-          ferr("ERROR: Erase block %" PRIdOFF " failed: %zd\n",
-               startblock, ret);
-        }
+      fwarn("WARNING: Geometry does not allow a log-structured FTL\n");
+      return -ENOSYS;
+    }
 
+  ret = ftl_alloc_eblock(dev);
+  if (ret < 0)
+    {
       return ret;
     }
 
-  while (1)
+  dev->npages   = dev->blkper - 1;
+  dev->nsectors = (nblocks - CONFIG_FTL_LOG_RESERVE) * dev->npages;
+  dev->active   = FTL_LOG_NOBLOCK;
+
+  dev->blocks = kmm_zalloc(nblocks * sizeof(struct ftl_log_block_s));
+  dev->p2l    = kmm_malloc(nblocks * dev->blkper * sizeof(uint32_t));
+  dev->l2p    = kmm_malloc(dev->nsectors * sizeof(uint32_t));
+  if (dev->blocks == NULL || dev->p2l == NULL || dev->l2p == NULL)
     {
-      if (startblock >= dev->lpcount)
+      kmm_free(dev->blocks);
+      kmm_free(dev->p2l);
+      kmm_free(dev->l2p);
+      dev->l2p = NULL;
+      return -ENOMEM;
+    }
+
+  memset(dev->p2l, 0xff, nblocks * dev->blkper * sizeof(uint32_t));
+  memset(dev->l2p, 0xff, dev->nsectors * sizeof(uint32_t));
+  nxmutex_init(&dev->lock);
+
+  if (MTD_IOCTL(dev->mtd, MTDIOC_ERASESTATE,
+                (unsigned long)((uintptr_t)&dev->erasestate)) < 0)
+    {
+      dev->erasestate = 0xff;
+    }
+
+  /* Rebuild the mapping table from the summaries.  Erase blocks without
+   * a valid summary are either erased or were never closed; they are
+   * erased before use.
+   */
+
+  summary = (FAR struct ftl_log_summary_s *)dev->eblock;
+  for (i = 0; i < nblocks; i++)
+    {
+      blk   = &dev->blocks[i];
+      first = i * dev->blkper;
+
+      if (MTD_ISBAD(dev->mtd, i) > 0)
         {
-          return -ENOSPC;
+          blk->state = FTL_LOG_BAD;
+          continue;
         }
 
-      ret = MTD_ERASE(dev->mtd, dev->lptable[startblock], 1);
-      if (ret == 1)
+      nxfrd = MTD_BREAD(dev->mtd, first + dev->npages, 1, dev->eblock);
+      if ((nxfrd != 1 && nxfrd != -EUCLEAN) ||
+          summary->magic != FTL_LOG_MAGIC ||
+          summary->crc != crc32((FAR const uint8_t *)&summary->seq,
+                                SIZEOF_FTL_LOG_SUMMARY(dev->npages) -
+                                offsetof(struct ftl_log_summary_s, seq)))
         {
-          return ret;
+          blk->state = FTL_LOG_DIRTY;
+          dev->nfree++;
+          continue;
         }
 
-      MTD_MARKBAD(dev->mtd, dev->lptable[startblock]);
-      ftl_update_map(dev, startblock);
+      blk->state = FTL_LOG_CLOSED;
+      blk->seq   = summary->seq;
+      blk->ec    = summary->ec;
+      ecsum     += summary->ec;
+      ecknown++;
+
+      if (summary->seq >= dev->seq)
+        {
+          dev->seq = summary->seq + 1;
+        }
+
+      for (j = 0; j < dev->npages; j++)
+        {
+          lsn = summary->lsn[j];
+          if (lsn >= dev->nsectors)
+            {
+              continue;
+            }
+
+          /* Keep the copy of the most recently closed erase block */
+
+          page = first + j;
+          old  = dev->l2p[lsn];
+          if (old == FTL_LOG_UNMAPPED ||
+              dev->blocks[old / dev->blkper].seq <= blk->seq)
+            {
+              ftl_log_map(dev, lsn, page);
+            }
+        }
+    }
+
+  /* The erase counts of the other erase blocks are lost, assume that they
+   * are average.
+   */
+
+  for (i = 0; i < nblocks; i++)
+    {
+      if (dev->blocks[i].state == FTL_LOG_DIRTY && ecknown > 0)
+        {
+          dev->blocks[i].ec = ecsum / ecknown;
+        }
     }
+
+  finfo("%" PRIu32 " sectors, %" PRIu32 " free erase blocks\n",
+        dev->nsectors, dev->nfree);
+
+#ifdef FTL_LOG_BACKGROUND
+  work_queue(LPWORK, &dev->work, ftl_log_worker, dev, 0);
+#endif
+
+  return OK;
 }
+#endif /* CONFIG_FTL_LOG */
 
 /****************************************************************************
  * Name: ftl_reload
@@ -423,6 +1401,13 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 {
   struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
 
+#ifdef CONFIG_FTL_LOG
+  if (dev->l2p != NULL)
+    {
+      return ftl_log_read(dev, buffer, startblock, nblocks);
+    }
+#endif
+
   /* Read the full erase block into the buffer */
 
   return ftl_mtd_bread(dev, startblock, nblocks, buffer);
@@ -459,18 +1444,6 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
  *
  ****************************************************************************/
 
-static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
-{
-  if (dev->eblock == NULL)
-    {
-      /* Allocate one, in-memory erase block buffer */
-
-      dev->eblock = kmm_malloc(dev->geo.erasesize);
-    }
-
-  return dev->eblock != NULL ? OK : -ENOMEM;
-}
-
 static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                          off_t startblock, size_t nblocks)
 {
@@ -485,6 +1458,13 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
   int    nbytes;
   int    ret;
 
+#ifdef CONFIG_FTL_LOG
+  if (dev->l2p != NULL)
+    {
+      return ftl_log_write(dev, buffer, startblock, nblocks);
+    }
+#endif
+
   /* Get the aligned block.  Here is is assumed: (1) The number of R/W blocks
    * per erase block is a power of 2, and (2) the erase begins with that same
    * alignment.
@@ -662,6 +1642,7 @@ static ssize_t ftl_write(FAR struct inode *inode,
 
   DEBUGASSERT(inode->i_private);
   dev = inode->i_private;
+  dev->stats.hostwrites += nsectors;
 #ifdef FTL_HAVE_RWBUFFER
   return rwb_write(&dev->rwb, start_sector, nsectors, buffer);
 #else
@@ -690,6 +1671,13 @@ static int ftl_geometry(FAR struct inode *inode,
       geometry->geo_mediachanged  = false;
       geometry->geo_writeenabled  = true;
       geometry->geo_nsectors      = dev->geo.neraseblocks * dev->blkper;
+#ifdef CONFIG_FTL_LOG
+      if (dev->l2p != NULL)
+        {
+          geometry->geo_nsectors  = dev->nsectors;
+        }
+#endif
+
       geometry->geo_sectorsize    = dev->geo.blocksize;
 
       strlcpy(geometry->geo_model, dev->geo.model,
@@ -728,7 +1716,43 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
 #ifdef CONFIG_FTL_WRITEBUFFER
       rwb_flush(&dev->rwb);
 #endif
+#ifdef CONFIG_FTL_LOG
+      if (dev->l2p != NULL)
+        {
+          ret = ftl_log_sync(dev);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+#endif
+    }
+  else if (cmd == BIOC_FTLSTATS)
+    {
+      FAR struct ftl_stats_s *stats =
+        (FAR struct ftl_stats_s *)((uintptr_t)arg);
+
+#ifdef CONFIG_FTL_LOG
+      if (dev->l2p != NULL)
+        {
+          return ftl_log_stats(dev, stats);
+        }
+#endif
+
+      memcpy(stats, &dev->stats, sizeof(struct ftl_stats_s));
+      return OK;
+    }
+#ifdef CONFIG_FTL_LOG
+  else if (cmd == BIOC_DISCARD && dev->l2p != NULL)
+    {
+      /* Write out buffered sectors first, they might be discarded */
+
+#ifdef CONFIG_FTL_WRITEBUFFER
+      rwb_flush(&dev->rwb);
+#endif
+      return ftl_log_discard(dev, (FAR const blkcnt_t *)((uintptr_t)arg));
     }
+#endif
 
   /* No other block driver ioctl commands are not recognized by this
    * driver.  Other possible MTD driver ioctl commands are passed through
@@ -764,6 +1788,9 @@ static int ftl_unlink(FAR struct inode *inode)
     {
 #ifdef FTL_HAVE_RWBUFFER
       rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_LOG
+      ftl_log_uninitialize(dev);
 #endif
       if (dev->eblock)
         {
@@ -835,11 +1862,31 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd)
       dev->blkper = dev->geo.erasesize / dev->geo.blocksize;
       DEBUGASSERT(dev->blkper * dev->geo.blocksize == dev->geo.erasesize);
 
+#ifdef CONFIG_FTL_LOG
+      /* Use the log-structured mode if the geometry allows it */
+
+      ret = ftl_log_initialize(dev);
+      if (ret < 0 && ret != -ENOSYS)
+        {
+          ferr("ERROR: ftl_log_initialize failed: %d\n", ret);
+          kmm_free(dev->eblock);
+          kmm_free(dev);
+          return ret;
+        }
+#endif
+
       /* Configure read-ahead/write buffering */
 
 #ifdef FTL_HAVE_RWBUFFER
       dev->rwb.blocksize     = dev->geo.blocksize;
       dev->rwb.nblocks       = dev->geo.neraseblocks * dev->blkper;
+#ifdef CONFIG_FTL_LOG
+      if (dev->l2p != NULL)
+        {
+          dev->rwb.nblocks   = dev->nsectors;
+        }
+#endif
+
       dev->rwb.dev           = (FAR void *)dev;
       dev->rwb.wrflush       = ftl_flush;
       dev->rwb.rhreload      = ftl_reload;
@@ -857,12 +1904,22 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd)
       if (ret < 0)
         {
           ferr("ERROR: rwb_initialize failed: %d\n", ret);
+#ifdef CONFIG_FTL_LOG
+          ftl_log_uninitialize(dev);
+          kmm_free(dev->eblock);
+#endif
           kmm_free(dev);
           return ret;
         }
 #endif
 
+#ifdef CONFIG_FTL_LOG
+      /* Bad blocks are skipped by the log-structured mode itself */
+
+      if (dev->l2p == NULL && MTD_ISBAD(dev->mtd, 0) != -ENOSYS)
+#else
       if (MTD_ISBAD(dev->mtd, 0) != -ENOSYS)
+#endif
         {
           ret = ftl_init_map(dev);
           if (ret < 0)
@@ -881,6 +1938,10 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd)
 out:
 #ifdef FTL_HAVE_RWBUFFER
           rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_LOG
+          ftl_log_uninitialize(dev);
+          kmm_free(dev->eblock);
 #endif
           kmm_free(dev);
         }
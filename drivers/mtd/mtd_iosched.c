@@ -0,0 +1,1052 @@
+/****************************************************************************
+ * drivers/mtd/mtd_iosched.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* MTD driver that contains another MTD driver and queues the requests to
+ * it.  A kernel thread dispatches the queued requests: reads go before
+ * queued writes and erases of other blocks, requests on adjacent blocks are
+ * merged into one and erases may complete asynchronously.  A failed
+ * asynchronous erase is reported to the writers of its blocks until the
+ * blocks are erased again, and to the next erase or BIOC_FLUSH caller.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/kthread.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/mtd/mtd.h>
+
+#ifdef CONFIG_MTD_IOSCHED
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Request types.  Requests of the first three types may be merged. */
+
+#define IOSCHED_READ        0
+#define IOSCHED_WRITE       1
+#define IOSCHED_ERASE       2
+#define IOSCHED_BYTEREAD    3
+#define IOSCHED_BYTEWRITE   4
+#define IOSCHED_ISBAD       5
+#define IOSCHED_MARKBAD     6
+#define IOSCHED_IOCTL       7
+
+/* Requests that may not pass and may not be passed by any other */
+
+#define IOSCHED_BARRIER(r)  ((r)->type >= IOSCHED_ISBAD)
+
+/* Requests that modify the blocks that they access */
+
+#define IOSCHED_MODIFY(r)   ((r)->type == IOSCHED_WRITE || \
+                             (r)->type == IOSCHED_ERASE || \
+                             (r)->type == IOSCHED_BYTEWRITE)
+
+/* A read may pass a queued request this many times.  After that, the
+ * oldest request goes first.
+ */
+
+#define IOSCHED_MAXBYPASS   8
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One queued request.  Synchronous requests live on the stack of the
+ * caller, which waits for 'done'.  Asynchronous erases come from the pool
+ * in struct mtd_iosched_s.
+ */
+
+struct mtd_iosched_req_s
+{
+  dq_entry_t            node;     /* Link in the queue */
+  uint8_t               type;     /* See IOSCHED_* definitions */
+  uint8_t               bypassed; /* Times that a read went first */
+  bool                  async;    /* Nobody waits for the result */
+  int                   cmd;      /* IOSCHED_IOCTL command */
+  off_t                 start;    /* First block, erase block or byte */
+  size_t                count;    /* Number of blocks, erase blocks, etc. */
+  FAR void             *buffer;   /* Data, or argument of an ioctl */
+  off_t                 first;    /* First block accessed */
+  off_t                 nblocks;  /* Number of blocks accessed */
+  clock_t               time;     /* Time of submission */
+  ssize_t               result;   /* Result of the request */
+  sem_t                 done;     /* Posted when the request is done */
+};
+
+/* This type represents the state of the MTD device.
+ * The struct mtd_dev_s must appear at the beginning of the definition so
+ * that you can freely cast between pointers to struct mtd_dev_s and struct
+ * mtd_iosched_s.
+ */
+
+struct mtd_iosched_s
+{
+  struct mtd_dev_s      mtd;      /* Our exported MTD interface */
+  FAR struct mtd_dev_s *dev;      /* Saved lower level MTD interface */
+  mutex_t               lock;     /* Protects the state below */
+  sem_t                 wakeup;   /* Posted for each submitted request */
+  dq_queue_t            queue;    /* Requests in order of submission */
+  sq_queue_t            pool;     /* Free asynchronous erase requests */
+  sq_queue_t            failed;   /* Failed asynchronous erase requests */
+  int                   error;    /* First error of an asynchronous erase */
+  uint32_t              blocksize; /* Size of a read/write block */
+  uint16_t              spb;      /* Read/write blocks per erase block */
+  FAR uint8_t          *bounce;   /* Buffer for merged reads and writes */
+  struct mtd_iosched_stats_s stats;
+#if CONFIG_MTD_IOSCHED_NERASE > 0
+  struct mtd_iosched_req_s erases[CONFIG_MTD_IOSCHED_NERASE];
+#endif
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* MTD driver methods */
+
+static int mtd_iosched_erase(FAR struct mtd_dev_s *dev, off_t startblock,
+                             size_t nblocks);
+static ssize_t mtd_iosched_bread(FAR struct mtd_dev_s *dev,
+                                 off_t startblock, size_t nblocks,
+                                 FAR uint8_t *buffer);
+static ssize_t mtd_iosched_bwrite(FAR struct mtd_dev_s *dev,
+                                  off_t startblock, size_t nblocks,
+                                  FAR const uint8_t *buffer);
+static ssize_t mtd_iosched_read(FAR struct mtd_dev_s *dev, off_t offset,
+                                size_t nbytes, FAR uint8_t *buffer);
+#ifdef CONFIG_MTD_BYTE_WRITE
+static ssize_t mtd_iosched_write(FAR struct mtd_dev_s *dev, off_t offset,
+                                 size_t nbytes, FAR const uint8_t *buffer);
+#endif
+static int mtd_iosched_ioctl(FAR struct mtd_dev_s *dev, int cmd,
+                             unsigned long arg);
+static int mtd_iosched_isbad(FAR struct mtd_dev_s *dev, off_t block);
+static int mtd_iosched_markbad(FAR struct mtd_dev_s *dev, off_t block);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mtd_iosched_overlap
+ *
+ * Description:
+ *   Return true if two requests access a common block
+ *
+ ****************************************************************************/
+
+static bool mtd_iosched_overlap(FAR struct mtd_iosched_req_s *a,
+                                FAR struct mtd_iosched_req_s *b)
+{
+  return a->first < b->first + b->nblocks &&
+         b->first < a->first + a->nblocks;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_failed
+ *
+ * Description:
+ *   Return the error of a failed asynchronous erase of blocks that 'req'
+ *   writes, or OK.  Those blocks were not erased, so writes to them fail
+ *   until an erase of the blocks succeeds.
+ *
+ ****************************************************************************/
+
+static int mtd_iosched_failed(FAR struct mtd_iosched_s *priv,
+                              FAR struct mtd_iosched_req_s *req)
+{
+  FAR struct mtd_iosched_req_s *erase;
+  FAR sq_entry_t *entry;
+
+  if (req->type != IOSCHED_WRITE && req->type != IOSCHED_BYTEWRITE)
+    {
+      return OK;
+    }
+
+  for (entry = sq_peek(&priv->failed); entry != NULL; entry = sq_next(entry))
+    {
+      erase = (FAR struct mtd_iosched_req_s *)entry;
+      if (mtd_iosched_overlap(erase, req))
+        {
+          return erase->result;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_erased
+ *
+ * Description:
+ *   Forget the failed asynchronous erases of blocks that 'req' erased
+ *   successfully.
+ *
+ ****************************************************************************/
+
+static void mtd_iosched_erased(FAR struct mtd_iosched_s *priv,
+                               FAR struct mtd_iosched_req_s *req)
+{
+  FAR struct mtd_iosched_req_s *erase;
+  FAR sq_entry_t *entry;
+  FAR sq_entry_t *next;
+
+  for (entry = sq_peek(&priv->failed); entry != NULL; entry = next)
+    {
+      next  = sq_next(entry);
+      erase = (FAR struct mtd_iosched_req_s *)entry;
+      if (req->first <= erase->first &&
+          erase->first + erase->nblocks <= req->first + req->nblocks)
+        {
+          sq_rem(entry, &priv->failed);
+          sq_addlast(entry, &priv->pool);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_blocked
+ *
+ * Description:
+ *   Return true if a queued request has to wait for a request queued
+ *   before it: a barrier, or an overlapping request where one of both
+ *   modifies the blocks.
+ *
+ ****************************************************************************/
+
+static bool mtd_iosched_blocked(FAR struct mtd_iosched_s *priv,
+                                FAR struct mtd_iosched_req_s *req)
+{
+  FAR struct mtd_iosched_req_s *prev;
+  FAR dq_entry_t *entry;
+
+  if (IOSCHED_BARRIER(req))
+    {
+      return dq_peek(&priv->queue) != &req->node;
+    }
+
+  for (entry = dq_peek(&priv->queue); entry != &req->node;
+       entry = dq_next(entry))
+    {
+      prev = (FAR struct mtd_iosched_req_s *)entry;
+      if (IOSCHED_BARRIER(prev) ||
+          ((IOSCHED_MODIFY(prev) || IOSCHED_MODIFY(req)) &&
+           mtd_iosched_overlap(prev, req)))
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_pick
+ *
+ * Description:
+ *   Select the next request to dispatch: the oldest read that does not
+ *   have to wait, unless the oldest request was passed too often.
+ *
+ ****************************************************************************/
+
+static FAR struct mtd_iosched_req_s *
+mtd_iosched_pick(FAR struct mtd_iosched_s *priv)
+{
+  FAR struct mtd_iosched_req_s *head;
+  FAR struct mtd_iosched_req_s *req;
+  FAR dq_entry_t *entry;
+
+  head = (FAR struct mtd_iosched_req_s *)dq_peek(&priv->queue);
+  if (head == NULL || head->type == IOSCHED_READ ||
+      head->type == IOSCHED_BYTEREAD || IOSCHED_BARRIER(head) ||
+      head->bypassed >= IOSCHED_MAXBYPASS)
+    {
+      return head;
+    }
+
+  for (entry = dq_next(&head->node); entry != NULL; entry = dq_next(entry))
+    {
+      req = (FAR struct mtd_iosched_req_s *)entry;
+      if ((req->type == IOSCHED_READ || req->type == IOSCHED_BYTEREAD) &&
+          !mtd_iosched_blocked(priv, req))
+        {
+          head->bypassed++;
+          return req;
+        }
+
+      if (IOSCHED_BARRIER(req))
+        {
+          break;
+        }
+    }
+
+  return head;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_merge
+ *
+ * Description:
+ *   Move the queued requests of the same type that continue 'batch' at
+ *   either end to it, up to the size of the bounce buffer.  Returns the
+ *   total number of blocks or erase blocks.
+ *
+ ****************************************************************************/
+
+static size_t mtd_iosched_merge(FAR struct mtd_iosched_s *priv,
+                                FAR dq_queue_t *batch)
+{
+  FAR struct mtd_iosched_req_s *head;
+  FAR struct mtd_iosched_req_s *tail;
+  FAR struct mtd_iosched_req_s *req;
+  FAR dq_entry_t *entry;
+  size_t total;
+  bool merged;
+
+  head  = (FAR struct mtd_iosched_req_s *)dq_peek(batch);
+  tail  = head;
+  total = head->count;
+
+  if (head->type > IOSCHED_ERASE ||
+      (head->type != IOSCHED_ERASE && priv->bounce == NULL))
+    {
+      return total;
+    }
+
+  do
+    {
+      merged = false;
+      for (entry = dq_peek(&priv->queue); entry != NULL;
+           entry = dq_next(entry))
+        {
+          req = (FAR struct mtd_iosched_req_s *)entry;
+          if (IOSCHED_BARRIER(req))
+            {
+              break;
+            }
+
+          if (req->type != head->type ||
+              (req->type != IOSCHED_ERASE &&
+               total + req->count > CONFIG_MTD_IOSCHED_MAXBLOCKS) ||
+              (req->start != tail->start + tail->count &&
+               req->start + req->count != head->start) ||
+              mtd_iosched_blocked(priv, req) ||
+              mtd_iosched_failed(priv, req) < 0)
+            {
+              continue;
+            }
+
+          dq_rem(&req->node, &priv->queue);
+          if (req->start == tail->start + tail->count)
+            {
+              dq_addlast(&req->node, batch);
+              tail = req;
+            }
+          else
+            {
+              dq_addfirst(&req->node, batch);
+              head = req;
+            }
+
+          priv->stats.merged++;
+          total += req->count;
+          merged = true;
+          break;
+        }
+    }
+  while (merged);
+
+  return total;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_execute
+ *
+ * Description:
+ *   Perform one request on the contained MTD driver
+ *
+ ****************************************************************************/
+
+static ssize_t mtd_iosched_execute(FAR struct mtd_iosched_s *priv,
+                                   FAR struct mtd_iosched_req_s *req)
+{
+  FAR struct mtd_dev_s *dev = priv->dev;
+
+  switch (req->type)
+    {
+      case IOSCHED_READ:
+        return MTD_BREAD(dev, req->start, req->count, req->buffer);
+
+      case IOSCHED_WRITE:
+        return MTD_BWRITE(dev, req->start, req->count, req->buffer);
+
+      case IOSCHED_ERASE:
+        return MTD_ERASE(dev, req->start, req->count);
+
+      case IOSCHED_BYTEREAD:
+        return MTD_READ(dev, req->start, req->count, req->buffer);
+
+#ifdef CONFIG_MTD_BYTE_WRITE
+      case IOSCHED_BYTEWRITE:
+        return MTD_WRITE(dev, req->start, req->count, req->buffer);
+#endif
+
+      case IOSCHED_ISBAD:
+        return MTD_ISBAD(dev, req->start);
+
+      case IOSCHED_MARKBAD:
+        return MTD_MARKBAD(dev, req->start);
+
+      case IOSCHED_IOCTL:
+        return MTD_IOCTL(dev, req->cmd, (unsigned long)req->buffer);
+
+      default:
+        return -ENOSYS;
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_dispatch
+ *
+ * Description:
+ *   Perform a batch of adjacent requests of the same type with one call of
+ *   the contained MTD driver.  If a merged read fails, the reads are
+ *   retried one by one, so that each caller gets its own result.  Writes
+ *   and erases are not repeated: each gets the part of the result that
+ *   covers it.
+ *
+ ****************************************************************************/
+
+static void mtd_iosched_dispatch(FAR struct mtd_iosched_s *priv,
+                                 FAR dq_queue_t *batch, size_t total)
+{
+  FAR struct mtd_iosched_req_s *req;
+  FAR dq_entry_t *entry;
+  FAR uint8_t *ptr;
+  ssize_t offset = 0;
+  ssize_t ret;
+
+  req = (FAR struct mtd_iosched_req_s *)dq_peek(batch);
+  if (dq_next(&req->node) == NULL)
+    {
+      req->result = mtd_iosched_execute(priv, req);
+      return;
+    }
+
+  if (req->type == IOSCHED_ERASE)
+    {
+      ret = MTD_ERASE(priv->dev, req->start, total);
+    }
+  else
+    {
+      if (req->type == IOSCHED_WRITE)
+        {
+          ptr = priv->bounce;
+          for (entry = &req->node; entry != NULL; entry = dq_next(entry))
+            {
+              req = (FAR struct mtd_iosched_req_s *)entry;
+              memcpy(ptr, req->buffer, req->count * priv->blocksize);
+              ptr += req->count * priv->blocksize;
+            }
+
+          req = (FAR struct mtd_iosched_req_s *)dq_peek(batch);
+          ret = MTD_BWRITE(priv->dev, req->start, total, priv->bounce);
+        }
+      else
+        {
+          ret = MTD_BREAD(priv->dev, req->start, total, priv->bounce);
+        }
+
+      if (ret == -EUCLEAN)
+        {
+          ret = total;
+        }
+    }
+
+  for (entry = dq_peek(batch); entry != NULL; entry = dq_next(entry))
+    {
+      req = (FAR struct mtd_iosched_req_s *)entry;
+      if (ret < 0)
+        {
+          req->result = req->type == IOSCHED_READ ?
+                        mtd_iosched_execute(priv, req) : ret;
+        }
+      else if (req->type == IOSCHED_ERASE)
+        {
+          req->result = OK;
+        }
+      else if (ret >= offset + (ssize_t)req->count)
+        {
+          if (req->type == IOSCHED_READ)
+            {
+              memcpy(req->buffer,
+                     priv->bounce + offset * priv->blocksize,
+                     req->count * priv->blocksize);
+            }
+
+          req->result = req->count;
+        }
+      else if (req->type == IOSCHED_READ)
+        {
+          req->result = mtd_iosched_execute(priv, req);
+        }
+      else
+        {
+          req->result = ret > offset ? ret - offset : -EIO;
+        }
+
+      offset += req->count;
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_complete
+ *
+ * Description:
+ *   Account for the completed requests of a batch and release them
+ *
+ ****************************************************************************/
+
+static void mtd_iosched_complete(FAR struct mtd_iosched_s *priv,
+                                 FAR dq_queue_t *batch)
+{
+  FAR struct mtd_iosched_req_s *req;
+  uint32_t latency;
+
+  while ((req = (FAR struct mtd_iosched_req_s *)dq_remfirst(batch)) != NULL)
+    {
+      latency = (uint32_t)TICK2USEC(clock_systime_ticks() - req->time);
+      priv->stats.latency += latency;
+      if (latency > priv->stats.maxlatency)
+        {
+          priv->stats.maxlatency = latency;
+        }
+
+      priv->stats.depth--;
+
+      if (req->type == IOSCHED_ERASE && req->result >= 0)
+        {
+          mtd_iosched_erased(priv, req);
+        }
+
+      if (!req->async)
+        {
+          nxsem_post(&req->done);
+          continue;
+        }
+
+      /* Keep a failed erase until its blocks are erased again, so that
+       * writes to them fail instead of writing to unerased blocks.
+       */
+
+      if (req->result < 0)
+        {
+          ferr("ERROR: Erase of %" PRIdOFF " failed: %zd\n",
+               req->start, req->result);
+          if (priv->error == OK)
+            {
+              priv->error = req->result;
+            }
+
+          sq_addlast((FAR sq_entry_t *)&req->node, &priv->failed);
+          continue;
+        }
+
+      sq_addlast((FAR sq_entry_t *)&req->node, &priv->pool);
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_thread
+ *
+ * Description:
+ *   Dispatch the queued requests
+ *
+ ****************************************************************************/
+
+static int mtd_iosched_thread(int argc, FAR char *argv[])
+{
+  FAR struct mtd_iosched_s *priv;
+  FAR struct mtd_iosched_req_s *req;
+  dq_queue_t batch;
+  size_t total;
+
+  priv = (FAR struct mtd_iosched_s *)
+    ((uintptr_t)strtoul(argv[1], NULL, 16));
+
+  for (; ; )
+    {
+      nxsem_wait_uninterruptible(&priv->wakeup);
+      nxmutex_lock(&priv->lock);
+
+      req = mtd_iosched_pick(priv);
+      if (req == NULL)
+        {
+          nxmutex_unlock(&priv->lock);
+          continue;
+        }
+
+      dq_init(&batch);
+      dq_rem(&req->node, &priv->queue);
+      dq_addlast(&req->node, &batch);
+
+      /* A write to blocks whose asynchronous erase failed gets the error
+       * of the erase instead of being performed.
+       */
+
+      req->result = mtd_iosched_failed(priv, req);
+      if (req->result < 0)
+        {
+          mtd_iosched_complete(priv, &batch);
+          nxmutex_unlock(&priv->lock);
+          continue;
+        }
+
+      total = mtd_iosched_merge(priv, &batch);
+      priv->stats.dispatched++;
+
+      /* Merged requests were submitted with posts of their own, so they
+       * just cause empty iterations.  Do not hold the lock while the device
+       * is busy, so that new requests can be queued.
+       */
+
+      nxmutex_unlock(&priv->lock);
+      mtd_iosched_dispatch(priv, &batch, total);
+      nxmutex_lock(&priv->lock);
+      mtd_iosched_complete(priv, &batch);
+      nxmutex_unlock(&priv->lock);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_queue
+ *
+ * Description:
+ *   Queue a request.  The caller holds the lock.
+ *
+ ****************************************************************************/
+
+static void mtd_iosched_queue(FAR struct mtd_iosched_s *priv,
+                              FAR struct mtd_iosched_req_s *req)
+{
+  req->bypassed = 0;
+  req->time     = clock_systime_ticks();
+
+  dq_addlast(&req->node, &priv->queue);
+  priv->stats.requests++;
+  if (++priv->stats.depth > priv->stats.maxdepth)
+    {
+      priv->stats.maxdepth = priv->stats.depth;
+    }
+
+  nxsem_post(&priv->wakeup);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_submit
+ *
+ * Description:
+ *   Queue a request and wait for its result
+ *
+ ****************************************************************************/
+
+static ssize_t mtd_iosched_submit(FAR struct mtd_iosched_s *priv,
+                                  uint8_t type, off_t start, size_t count,
+                                  FAR void *buffer)
+{
+  struct mtd_iosched_req_s req;
+  int ret;
+
+  memset(&req, 0, sizeof(req));
+  req.type   = type;
+  req.start  = start;
+  req.count  = count;
+  req.buffer = buffer;
+
+  switch (type)
+    {
+      case IOSCHED_READ:
+      case IOSCHED_WRITE:
+        req.first   = start;
+        req.nblocks = count;
+        break;
+
+      case IOSCHED_ERASE:
+        req.first   = start * priv->spb;
+        req.nblocks = count * priv->spb;
+        break;
+
+      case IOSCHED_BYTEREAD:
+      case IOSCHED_BYTEWRITE:
+        req.first   = start / priv->blocksize;
+        req.nblocks = (start + count + priv->blocksize - 1) /
+                      priv->blocksize - req.first;
+        break;
+
+      default:
+        break;
+    }
+
+  nxsem_init(&req.done, 0, 0);
+
+  ret = nxmutex_lock(&priv->lock);
+  if (ret < 0)
+    {
+      nxsem_destroy(&req.done);
+      return ret;
+    }
+
+  mtd_iosched_queue(priv, &req);
+  nxmutex_unlock(&priv->lock);
+
+  nxsem_wait_uninterruptible(&req.done);
+  nxsem_destroy(&req.done);
+  return req.result;
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_erase
+ ****************************************************************************/
+
+static int mtd_iosched_erase(FAR struct mtd_dev_s *dev, off_t startblock,
+                             size_t nblocks)
+{
+  FAR struct mtd_iosched_s *priv = (FAR struct mtd_iosched_s *)dev;
+#if CONFIG_MTD_IOSCHED_NERASE > 0
+  FAR struct mtd_iosched_req_s *req;
+  int ret;
+
+  ret = nxmutex_lock(&priv->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Report the failure of an earlier erase, which nobody waited for */
+
+  ret = priv->error;
+  priv->error = OK;
+
+  /* Without a free asynchronous request, wait for the erase */
+
+  req = (FAR struct mtd_iosched_req_s *)sq_remfirst(&priv->pool);
+  if (req != NULL && ret == OK)
+    {
+      req->type    = IOSCHED_ERASE;
+      req->async   = true;
+      req->start   = startblock;
+      req->count   = nblocks;
+      req->first   = startblock * priv->spb;
+      req->nblocks = nblocks * priv->spb;
+      mtd_iosched_queue(priv, req);
+      nxmutex_unlock(&priv->lock);
+      return OK;
+    }
+
+  if (req != NULL)
+    {
+      sq_addfirst((FAR sq_entry_t *)&req->node, &priv->pool);
+    }
+
+  nxmutex_unlock(&priv->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+#endif
+
+  return mtd_iosched_submit(priv, IOSCHED_ERASE, startblock, nblocks, NULL);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_bread
+ ****************************************************************************/
+
+static ssize_t mtd_iosched_bread(FAR struct mtd_dev_s *dev,
+                                 off_t startblock, size_t nblocks,
+                                 FAR uint8_t *buffer)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev, IOSCHED_READ,
+                            startblock, nblocks, buffer);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_bwrite
+ ****************************************************************************/
+
+static ssize_t mtd_iosched_bwrite(FAR struct mtd_dev_s *dev,
+                                  off_t startblock, size_t nblocks,
+                                  FAR const uint8_t *buffer)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev, IOSCHED_WRITE,
+                            startblock, nblocks, (FAR void *)buffer);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_read
+ ****************************************************************************/
+
+static ssize_t mtd_iosched_read(FAR struct mtd_dev_s *dev, off_t offset,
+                                size_t nbytes, FAR uint8_t *buffer)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev,
+                            IOSCHED_BYTEREAD, offset, nbytes, buffer);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_write
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_BYTE_WRITE
+static ssize_t mtd_iosched_write(FAR struct mtd_dev_s *dev, off_t offset,
+                                 size_t nbytes, FAR const uint8_t *buffer)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev,
+                            IOSCHED_BYTEWRITE, offset, nbytes,
+                            (FAR void *)buffer);
+}
+#endif
+
+/****************************************************************************
+ * Name: mtd_iosched_isbad
+ ****************************************************************************/
+
+static int mtd_iosched_isbad(FAR struct mtd_dev_s *dev, off_t block)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev, IOSCHED_ISBAD,
+                            block, 0, NULL);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_markbad
+ ****************************************************************************/
+
+static int mtd_iosched_markbad(FAR struct mtd_dev_s *dev, off_t block)
+{
+  return mtd_iosched_submit((FAR struct mtd_iosched_s *)dev,
+                            IOSCHED_MARKBAD, block, 0, NULL);
+}
+
+/****************************************************************************
+ * Name: mtd_iosched_ioctl
+ ****************************************************************************/
+
+static int mtd_iosched_ioctl(FAR struct mtd_dev_s *dev, int cmd,
+                             unsigned long arg)
+{
+  FAR struct mtd_iosched_s *priv = (FAR struct mtd_iosched_s *)dev;
+  struct mtd_iosched_req_s req;
+  int ret;
+
+  finfo("cmd: %d\n", cmd);
+
+  if (cmd == MTDIOC_IOSCHEDSTATS)
+    {
+      FAR struct mtd_iosched_stats_s *stats =
+        (FAR struct mtd_iosched_stats_s *)((uintptr_t)arg);
+
+      if (stats == NULL)
+        {
+          return -EINVAL;
+        }
+
+      ret = nxmutex_lock(&priv->lock);
+      if (ret >= 0)
+        {
+          memcpy(stats, &priv->stats, sizeof(struct mtd_iosched_stats_s));
+          nxmutex_unlock(&priv->lock);
+        }
+
+      return ret;
+    }
+
+  /* Other commands are passed to the contained MTD driver once all
+   * requests queued before are done, including asynchronous erases.
+   */
+
+  memset(&req, 0, sizeof(req));
+  req.type   = IOSCHED_IOCTL;
+  req.cmd    = cmd;
+  req.buffer = (FAR void *)((uintptr_t)arg);
+  nxsem_init(&req.done, 0, 0);
+
+  ret = nxmutex_lock(&priv->lock);
+  if (ret < 0)
+    {
+      nxsem_destroy(&req.done);
+      return ret;
+    }
+
+  mtd_iosched_queue(priv, &req);
+  nxmutex_unlock(&priv->lock);
+  nxsem_wait_uninterruptible(&req.done);
+  nxsem_destroy(&req.done);
+
+  /* A flush reports the failure of an earlier asynchronous erase */
+
+  if (cmd == BIOC_FLUSH)
+    {
+      nxmutex_lock(&priv->lock);
+      if (priv->error < 0)
+        {
+          req.result  = priv->error;
+          priv->error = OK;
+        }
+
+      nxmutex_unlock(&priv->lock);
+    }
+
+  return req.result;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mtd_iosched_initialize
+ *
+ * Description:
+ *   Create an initialized MTD device instance.  This MTD driver contains
+ *   another MTD driver and queues the requests to it, see
+ *   include/nuttx/mtd/mtd.h.
+ *
+ ****************************************************************************/
+
+FAR struct mtd_dev_s *mtd_iosched_initialize(FAR struct mtd_dev_s *mtd)
+{
+  FAR struct mtd_iosched_s *priv;
+  struct mtd_geometry_s geo;
+  FAR char *argv[2];
+  char arg1[32];
+  int ret;
+  int i;
+
+  finfo("mtd: %p\n", mtd);
+  DEBUGASSERT(mtd && mtd->ioctl);
+
+  /* Get the device geometry */
+
+  ret = mtd->ioctl(mtd, MTDIOC_GEOMETRY, (unsigned long)((uintptr_t)&geo));
+  if (ret < 0)
+    {
+      ferr("ERROR: MTDIOC_GEOMETRY ioctl failed: %d\n", ret);
+      return NULL;
+    }
+
+  priv = (FAR struct mtd_iosched_s *)
+          kmm_zalloc(sizeof(struct mtd_iosched_s));
+  if (!priv)
+    {
+      ferr("ERROR: Failed to allocate mtd_iosched\n");
+      return NULL;
+    }
+
+  /* Initialize the allocated structure.  Methods not supported by the
+   * contained MTD driver are not supported either.
+   */
+
+  priv->mtd.erase    = mtd->erase ? mtd_iosched_erase : NULL;
+  priv->mtd.bread    = mtd->bread ? mtd_iosched_bread : NULL;
+  priv->mtd.bwrite   = mtd->bwrite ? mtd_iosched_bwrite : NULL;
+  priv->mtd.read     = mtd->read ? mtd_iosched_read : NULL;
+#ifdef CONFIG_MTD_BYTE_WRITE
+  priv->mtd.write    = mtd->write ? mtd_iosched_write : NULL;
+#endif
+  priv->mtd.ioctl    = mtd_iosched_ioctl;
+  priv->mtd.isbad    = mtd->isbad ? mtd_iosched_isbad : NULL;
+  priv->mtd.markbad  = mtd->markbad ? mtd_iosched_markbad : NULL;
+  priv->mtd.name     = mtd->name;
+
+  priv->dev          = mtd;
+  priv->blocksize    = geo.blocksize;
+  priv->spb          = geo.erasesize / geo.blocksize;
+
+  /* The bounce buffer is optional: without it, only erases are merged */
+
+  priv->bounce = kmm_malloc(CONFIG_MTD_IOSCHED_MAXBLOCKS * geo.blocksize);
+  if (priv->bounce == NULL)
+    {
+      fwarn("WARNING: No bounce buffer, reads and writes are not merged\n");
+    }
+
+  nxmutex_init(&priv->lock);
+  nxsem_init(&priv->wakeup, 0, 0);
+  dq_init(&priv->queue);
+  sq_init(&priv->pool);
+  sq_init(&priv->failed);
+
+#if CONFIG_MTD_IOSCHED_NERASE > 0
+  for (i = 0; i < CONFIG_MTD_IOSCHED_NERASE; i++)
+    {
+      sq_addlast((FAR sq_entry_t *)&priv->erases[i].node, &priv->pool);
+    }
+#else
+  UNUSED(i);
+#endif
+
+  /* Start the dispatcher thread */
+
+  snprintf(arg1, sizeof(arg1), "%p", priv);
+  argv[0] = arg1;
+  argv[1] = NULL;
+  ret = kthread_create("mtd_iosched", CONFIG_MTD_IOSCHED_PRIORITY,
+                       CONFIG_MTD_IOSCHED_STACKSIZE,
+                       mtd_iosched_thread, argv);
+  if (ret < 0)
+    {
+      ferr("ERROR: Failed to start the dispatcher: %d\n", ret);
+      nxsem_destroy(&priv->wakeup);
+      nxmutex_destroy(&priv->lock);
+      kmm_free(priv->bounce);
+      kmm_free(priv);
+      return NULL;
+    }
+
+  /* Return the implementation-specific state structure as the MTD device */
+
+  return &priv->mtd;
+}
+
+#endif /* CONFIG_MTD_IOSCHED */
@@ -142,6 +142,16 @@
 #define SMART_WEARFLAGS_FORCE_REORG         0x01
 #define SMART_WEARFLAGS_WRITE_NEEDED        0x02
 
+/* Sector map checkpoint.  Two slots of CONFIG_MTD_SMART_CHECKPOINT_BLOCKS
+ * erase blocks each are reserved at the end of the device and used in
+ * turn.  A checkpoint is valid while its state byte is still erased.
+ */
+
+#define SMART_CP_NSLOTS                     2
+#define SMART_CP_MAGIC                      "SMCP"
+#define SMART_CP_STALE                      \
+  ((uint8_t)~CONFIG_SMARTFS_ERASEDSTATE)
+
 #define SET_BITMAP(m, n) do { (m)[(n) / 8] |= 1 << ((n) % 8); } while (0)
 #define CLR_BITMAP(m, n) do { (m)[(n) / 8] &= ~(1 << ((n) % 8)); } while (0)
 #define ISSET_BITMAP(m, n) ((m)[(n) / 8] & (1 << ((n) % 8)))
@@ -297,7 +307,36 @@ struct smart_struct_s
   size_t                bytesalloc;
   struct smart_alloc_s  alloc[SMART_MAX_ALLOCS];   /* Array of memory allocations */
 #endif
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  uint32_t              cpblock;          /* First checkpoint block or 0 */
+  uint32_t              cpseq;            /* Last checkpoint sequence */
+  uint8_t               cpslot;           /* Slot of the last checkpoint */
+  bool                  cpvalid;          /* Checkpoint matches RAM */
+#endif
+};
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+/* Sector map checkpoint header.  It is followed by the smap array and the
+ * releasecount and freecount arrays exactly as they are laid out in RAM.
+ */
+
+struct smart_checkpoint_s
+{
+  uint8_t               magic[4];         /* SMART_CP_MAGIC */
+  uint8_t               state;            /* Erased = valid, else stale */
+  uint8_t               formatversion;    /* Format version on the device */
+  uint8_t               namesize;         /* Length of filenames */
+  uint8_t               reserved;
+  uint32_t              seq;              /* Incrementing sequence number */
+  uint32_t              crc;              /* CRC-32 of header and arrays */
+  uint16_t              sectorsize;       /* Sector size on device */
+  uint16_t              totalsectors;     /* Total number of sectors */
+  uint16_t              neraseblocks;     /* Number of erase blocks */
+  uint16_t              freesectors;      /* Total number of free sectors */
+  uint16_t              releasesectors;   /* Total released sectors */
+  uint16_t              lastallocblock;   /* Last block allocated from */
 };
+#endif
 
 #ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
 struct smart_multiroot_device_s
@@ -450,6 +489,12 @@ static int     smart_relocate_sector(FAR struct smart_struct_s *dev,
 static int     smart_fsck(FAR struct smart_struct_s *dev);
 #endif
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+static int     smart_checkpoint_load(FAR struct smart_struct_s *dev);
+static int     smart_checkpoint_write(FAR struct smart_struct_s *dev);
+static int     smart_checkpoint_invalidate(FAR struct smart_struct_s *dev);
+#endif
+
 #ifdef CONFIG_SMART_DEV_LOOP
 static ssize_t smart_loop_read(FAR struct file *filep, FAR char *buffer,
                  size_t buflen);
@@ -512,6 +557,13 @@ static int smart_open(FAR struct inode *inode)
 static int smart_close(FAR struct inode *inode)
 {
   finfo("Entry\n");
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* Save the sector map so that the next mount can skip the scan */
+
+  smart_checkpoint_write(inode->i_private);
+#endif
+
   return OK;
 }
 
@@ -946,6 +998,16 @@ static ssize_t smart_write(FAR struct inode *inode,
   dev = inode->i_private;
 #endif
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* The raw write bypasses the sector map, so any checkpoint is stale */
+
+  ret = smart_checkpoint_invalidate(dev);
+  if (ret < 0)
+    {
+      return ret;
+    }
+#endif
+
   /* I think maybe we need to lock on a mutex here */
 
   /* Get the aligned block.  Here is is assumed: (1) The number of R/W blocks
@@ -2683,6 +2745,360 @@ err_out:
   return ret;
 }
 
+/****************************************************************************
+ * Name: smart_checkpoint_size
+ *
+ * Description:  Returns the number of bytes of sector map and erase block
+ *               counts saved after the checkpoint header.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+static size_t smart_checkpoint_size(FAR struct smart_struct_s *dev)
+{
+  return dev->totalsectors * sizeof(uint16_t) + (dev->neraseblocks << 1);
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_offset
+ *
+ * Description:  Returns the byte offset of a checkpoint slot on the MTD.
+ *
+ ****************************************************************************/
+
+static size_t smart_checkpoint_offset(FAR struct smart_struct_s *dev,
+                                      uint8_t slot)
+{
+  uint32_t block = dev->cpblock + slot * CONFIG_MTD_SMART_CHECKPOINT_BLOCKS;
+
+  return (size_t)block * dev->geo.erasesize;
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_crc
+ *
+ * Description:  Calculates the CRC-32 of a checkpoint header and the data
+ *               following it.  The state byte and the CRC field itself are
+ *               not covered.
+ *
+ ****************************************************************************/
+
+static uint32_t
+smart_checkpoint_crc(FAR const struct smart_checkpoint_s *hdr,
+                     FAR const void *data, size_t len)
+{
+  struct smart_checkpoint_s tmp;
+
+  memcpy(&tmp, hdr, sizeof(tmp));
+  tmp.state = CONFIG_SMARTFS_ERASEDSTATE;
+  tmp.crc   = 0;
+
+  return crc32part(data, len, crc32((FAR const uint8_t *)&tmp,
+                                    sizeof(tmp)));
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_stale
+ *
+ * Description:  Marks the checkpoint in the given slot stale by programming
+ *               its state byte.
+ *
+ ****************************************************************************/
+
+static int smart_checkpoint_stale(FAR struct smart_struct_s *dev,
+                                  uint8_t slot)
+{
+  uint8_t state = SMART_CP_STALE;
+  ssize_t ret;
+
+  ret = smart_bytewrite(dev, smart_checkpoint_offset(dev, slot) +
+                        offsetof(struct smart_checkpoint_s, state),
+                        1, &state);
+  if (ret < 0)
+    {
+      ferr("ERROR: Error %zd invalidating checkpoint %d\n", -ret, slot);
+      return ret;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_invalidate
+ *
+ * Description:  Called before the first modification of the volume after
+ *               a checkpoint was loaded or written.  Once the checkpoint is
+ *               stale, an unclean shutdown makes the next mount fall back
+ *               to a full scan.
+ *
+ ****************************************************************************/
+
+static int smart_checkpoint_invalidate(FAR struct smart_struct_s *dev)
+{
+  int ret;
+
+  if (!dev->cpvalid)
+    {
+      return OK;
+    }
+
+  ret = smart_checkpoint_stale(dev, dev->cpslot);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  dev->cpvalid = false;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_write
+ *
+ * Description:  Saves the sector map and the erase block counts to the
+ *               next checkpoint slot.  Nothing is written if the on-flash
+ *               checkpoint is still valid or the volume is not formatted.
+ *
+ ****************************************************************************/
+
+static int smart_checkpoint_write(FAR struct smart_struct_s *dev)
+{
+  struct smart_checkpoint_s hdr;
+  FAR const uint8_t *src;
+  size_t total;
+  size_t pos;
+  size_t nbytes;
+  off_t  block;
+  uint16_t x;
+  uint8_t slot;
+  int ret;
+
+  if (dev->cpblock == 0 || dev->cpvalid ||
+      dev->formatstatus != SMART_FMT_STAT_FORMATTED)
+    {
+      return OK;
+    }
+
+#ifdef CONFIG_MTD_SMART_ENABLE_CRC
+  /* Sectors allocated but not yet written are only recovered by a scan */
+
+  if (dev->allocsector != NULL)
+    {
+      return OK;
+    }
+#endif
+
+  total = sizeof(hdr) + smart_checkpoint_size(dev);
+  if (total > (size_t)CONFIG_MTD_SMART_CHECKPOINT_BLOCKS *
+              dev->geo.erasesize)
+    {
+      finfo("Checkpoint of %zu bytes does not fit\n", total);
+      return OK;
+    }
+
+  /* Build the header for the next slot */
+
+  slot = (dev->cpslot + 1) % SMART_CP_NSLOTS;
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SMART_CP_MAGIC, sizeof(hdr.magic));
+  hdr.state          = CONFIG_SMARTFS_ERASEDSTATE;
+  hdr.formatversion  = dev->formatversion;
+  hdr.namesize       = dev->namesize;
+  hdr.seq            = dev->cpseq + 1;
+  hdr.sectorsize     = dev->sectorsize;
+  hdr.totalsectors   = dev->totalsectors;
+  hdr.neraseblocks   = dev->neraseblocks;
+  hdr.freesectors    = dev->freesectors;
+  hdr.releasesectors = dev->releasesectors;
+  hdr.lastallocblock = dev->lastallocblock;
+  hdr.crc            = smart_checkpoint_crc(&hdr, dev->smap,
+                                            smart_checkpoint_size(dev));
+
+  ret = MTD_ERASE(dev->mtd, dev->cpblock +
+                  slot * CONFIG_MTD_SMART_CHECKPOINT_BLOCKS,
+                  CONFIG_MTD_SMART_CHECKPOINT_BLOCKS);
+  if (ret < 0)
+    {
+      ferr("ERROR: Error %d erasing checkpoint %d\n", -ret, slot);
+      return ret;
+    }
+
+  /* Write the header followed by the arrays one sector at a time.  The
+   * state byte is left erased, so the checkpoint is valid once complete.
+   */
+
+  block = smart_checkpoint_offset(dev, slot) / dev->geo.blocksize;
+  for (pos = 0; pos < total; pos += dev->sectorsize)
+    {
+      memset(dev->rwbuffer, CONFIG_SMARTFS_ERASEDSTATE, dev->sectorsize);
+      for (x = 0; x < dev->sectorsize && pos + x < total; x += nbytes)
+        {
+          if (pos + x < sizeof(hdr))
+            {
+              src    = (FAR const uint8_t *)&hdr + pos + x;
+              nbytes = sizeof(hdr) - (pos + x);
+            }
+          else
+            {
+              src    = (FAR const uint8_t *)dev->smap +
+                       (pos + x - sizeof(hdr));
+              nbytes = total - (pos + x);
+            }
+
+          if (nbytes > (size_t)(dev->sectorsize - x))
+            {
+              nbytes = dev->sectorsize - x;
+            }
+
+          memcpy(&dev->rwbuffer[x], src, nbytes);
+        }
+
+      ret = MTD_BWRITE(dev->mtd, block, dev->mtdblkspersector,
+                       (FAR const uint8_t *)dev->rwbuffer);
+      if (ret != dev->mtdblkspersector)
+        {
+          ferr("ERROR: Error %d writing checkpoint %d\n", ret, slot);
+          return ret < 0 ? ret : -EIO;
+        }
+
+      block += dev->mtdblkspersector;
+    }
+
+  dev->cpseq   = hdr.seq;
+  dev->cpslot  = slot;
+  dev->cpvalid = true;
+
+  finfo("Checkpoint %" PRIu32 " written to slot %d\n", hdr.seq, slot);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_checkpoint_load
+ *
+ * Description:  Restores the sector map and the erase block counts from the
+ *               newest valid checkpoint instead of scanning the device.
+ *               Returns a negated errno if there is no usable checkpoint,
+ *               in which case the caller must perform a full scan.  Any
+ *               checkpoint that is found but not used is marked stale so
+ *               it cannot shadow changes made after the scan.
+ *
+ ****************************************************************************/
+
+static int smart_checkpoint_load(FAR struct smart_struct_s *dev)
+{
+  struct smart_checkpoint_s hdr;
+  struct smart_checkpoint_s best;
+  size_t size;
+  ssize_t nread;
+  uint8_t valid = 0;
+  uint8_t slot;
+  int ret = -ENOENT;
+
+  if (dev->cpblock == 0)
+    {
+      return -ENOENT;
+    }
+
+  /* Find the valid checkpoint with the highest sequence number */
+
+  for (slot = 0; slot < SMART_CP_NSLOTS; slot++)
+    {
+      nread = MTD_READ(dev->mtd, smart_checkpoint_offset(dev, slot),
+                       sizeof(hdr), (FAR uint8_t *)&hdr);
+      if (nread != sizeof(hdr) ||
+          memcmp(hdr.magic, SMART_CP_MAGIC, sizeof(hdr.magic)) != 0)
+        {
+          continue;
+        }
+
+      /* Keep the sequence numbers increasing across stale slots too */
+
+      if (hdr.seq > dev->cpseq)
+        {
+          dev->cpseq = hdr.seq;
+        }
+
+      if (hdr.state != CONFIG_SMARTFS_ERASEDSTATE)
+        {
+          continue;
+        }
+
+      valid |= 1 << slot;
+      if (ret < 0 || hdr.seq > best.seq)
+        {
+          memcpy(&best, &hdr, sizeof(best));
+          dev->cpslot = slot;
+          ret = OK;
+        }
+    }
+
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* The geometry must match the one the checkpoint was taken with */
+
+  ret = smart_setsectorsize(dev, best.sectorsize);
+  if (ret < 0 || dev->totalsectors != best.totalsectors ||
+      dev->neraseblocks != best.neraseblocks)
+    {
+      ferr("ERROR: Checkpoint geometry mismatch\n");
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  size  = smart_checkpoint_size(dev);
+  nread = MTD_READ(dev->mtd, smart_checkpoint_offset(dev, dev->cpslot) +
+                   sizeof(best), size, (FAR uint8_t *)dev->smap);
+  if (nread != (ssize_t)size)
+    {
+      ret = nread < 0 ? nread : -EIO;
+      goto errout;
+    }
+
+  if (smart_checkpoint_crc(&best, dev->smap, size) != best.crc)
+    {
+      ferr("ERROR: Checkpoint %" PRIu32 " CRC error\n", best.seq);
+      ret = -EIO;
+      goto errout;
+    }
+
+  /* Drop any other checkpoint still marked valid */
+
+  valid &= ~(1 << dev->cpslot);
+
+  dev->formatstatus   = SMART_FMT_STAT_FORMATTED;
+  dev->formatversion  = best.formatversion;
+  dev->namesize       = best.namesize;
+  dev->freesectors    = best.freesectors;
+  dev->releasesectors = best.releasesectors;
+  dev->lastallocblock = best.lastallocblock;
+  dev->cpvalid        = true;
+
+#ifdef CONFIG_MTD_SMART_WEAR_LEVEL
+  /* Read the wear leveling status bits */
+
+  smart_read_wearstatus(dev);
+#endif
+
+  finfo("Checkpoint %" PRIu32 " loaded from slot %d\n", best.seq,
+        dev->cpslot);
+
+errout:
+  for (slot = 0; slot < SMART_CP_NSLOTS; slot++)
+    {
+      if (valid & (1 << slot))
+        {
+          smart_checkpoint_stale(dev, slot);
+        }
+    }
+
+  return ret;
+}
+#endif /* CONFIG_MTD_SMART_CHECKPOINT */
+
 /****************************************************************************
  * Name: smart_erase_block_if_empty
  *
@@ -5490,6 +5906,41 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
   dev = inode->i_private;
 #endif
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* Mark the sector map checkpoint stale before the volume is modified.
+   * Anything not known to leave the media untouched counts as a
+   * modification, including MTD commands that are passed through.
+   */
+
+  switch (cmd)
+    {
+    case BIOC_GETFORMAT:
+    case BIOC_READSECT:
+    case BIOC_GETPROCFSD:
+    case BIOC_DEBUGCMD:
+    case BIOC_FLUSH:
+    case BIOC_XIPBASE:
+    case BIOC_PARTINFO:
+    case BIOC_BLKSSZGET:
+    case BIOC_BLKGETSIZE:
+    case MTDIOC_GEOMETRY:
+    case MTDIOC_SETSPEED:
+    case MTDIOC_ECCSTATUS:
+    case MTDIOC_ERASESTATE:
+    case MTDIOC_IOSCHEDSTATS:
+      break;
+
+    default:
+      ret = smart_checkpoint_invalidate(dev);
+      if (ret < 0)
+        {
+          goto ok_out;
+        }
+
+      break;
+    }
+#endif
+
   /* Process the ioctl's we care about first, pass any we don't respond
    * to directly to the underlying MTD device.
    */
@@ -5615,6 +6066,20 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
 #endif
 
       break;
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+    case BIOC_FLUSH:
+
+      /* Save a sector map checkpoint, then let the MTD flush its buffers */
+
+      ret = smart_checkpoint_write(dev);
+      if (ret < 0)
+        {
+          goto ok_out;
+        }
+
+      break;
+#endif
     }
 
   /* No other block driver ioctl commands are not recognized by this
@@ -6185,6 +6650,22 @@ int smart_initialize(int minor, FAR struct mtd_dev_s *mtd,
           goto errout;
         }
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+      /* Reserve the last erase blocks of the device for the checkpoint
+       * slots.  They are hidden from the rest of SMART by reducing the
+       * number of erase blocks.
+       */
+
+      if (dev->geo.neraseblocks >
+          2 * SMART_CP_NSLOTS * CONFIG_MTD_SMART_CHECKPOINT_BLOCKS)
+        {
+          dev->geo.neraseblocks -=
+            SMART_CP_NSLOTS * CONFIG_MTD_SMART_CHECKPOINT_BLOCKS;
+          dev->cpblock = dev->geo.neraseblocks;
+          dev->cpslot  = SMART_CP_NSLOTS - 1;
+        }
+#endif
+
       /* Set the sector size to the default for now */
 
       dev->sectorsize = 0;
@@ -6231,9 +6712,18 @@ int smart_initialize(int minor, FAR struct mtd_dev_s *mtd,
       dev->minor = minor;
 #endif
 
-      /* Do a scan of the device */
+      /* Do a scan of the device, unless the checkpoint saved at the last
+       * clean shutdown is still valid.
+       */
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+      ret = smart_checkpoint_load(dev);
+      if (ret < 0)
+#endif
+        {
+          ret = smart_scan(dev);
+        }
 
-      ret = smart_scan(dev);
       if (ret < 0)
         {
           ferr("ERROR: smart_scan failed: %d\n", -ret);
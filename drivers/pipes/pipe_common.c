@@ -42,6 +42,11 @@
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 
+#ifdef CONFIG_NET
+#  include <sys/socket.h>
+#  include <nuttx/net/net.h>
+#endif
+
 #include "pipe_common.h"
 
 #ifdef CONFIG_PIPES
@@ -78,6 +83,322 @@ static void pipecommon_wakeup(FAR sem_t *sem)
     }
 }
 
+/****************************************************************************
+ * Name: pipecommon_initsize
+ *
+ * Description:
+ *   Return the size of the buffer allocated when the pipe is opened.
+ *
+ ****************************************************************************/
+
+static size_t pipecommon_initsize(FAR struct pipe_dev_s *dev)
+{
+#if CONFIG_DEV_PIPE_GROWSIZE > 0
+  if (CONFIG_DEV_PIPE_GROWSIZE < dev->d_bufsize)
+    {
+      return CONFIG_DEV_PIPE_GROWSIZE;
+    }
+#endif
+
+  return dev->d_bufsize;
+}
+
+/****************************************************************************
+ * Name: pipecommon_grow
+ *
+ * Description:
+ *   Enlarge the buffer, up to the capacity of the pipe, so that 'needed'
+ *   more bytes fit.  If memory is short the buffer keeps its size and the
+ *   writer waits for readers as usual.  A splice works on the buffer
+ *   memory in place, so the buffer is not moved while one is in progress.
+ *
+ ****************************************************************************/
+
+static void pipecommon_grow(FAR struct pipe_dev_s *dev, size_t needed)
+{
+  size_t size = circbuf_size(&dev->d_buffer);
+  size_t used;
+
+  if (size == 0 || size >= dev->d_bufsize ||
+      PIPE_IS_SPLICING(dev->d_flags) ||
+      circbuf_space(&dev->d_buffer) >= needed)
+    {
+      return;
+    }
+
+  used = circbuf_used(&dev->d_buffer);
+  do
+    {
+      size *= 2;
+    }
+  while (size < used + needed && size < dev->d_bufsize);
+
+  if (size > dev->d_bufsize)
+    {
+      size = dev->d_bufsize;
+    }
+
+  circbuf_resize(&dev->d_buffer, size);
+}
+
+/****************************************************************************
+ * Name: pipecommon_shrink
+ *
+ * Description:
+ *   Return a drained buffer to its initial size, unless a splice still
+ *   works on the buffer memory.
+ *
+ ****************************************************************************/
+
+static void pipecommon_shrink(FAR struct pipe_dev_s *dev)
+{
+  size_t size = pipecommon_initsize(dev);
+
+  if (circbuf_is_empty(&dev->d_buffer) &&
+      !PIPE_IS_SPLICING(dev->d_flags) &&
+      circbuf_size(&dev->d_buffer) > size)
+    {
+      circbuf_resize(&dev->d_buffer, size);
+    }
+}
+
+/****************************************************************************
+ * Name: pipecommon_waitdata
+ *
+ * Description:
+ *   Wait until the pipe holds data.  Returns a positive value with
+ *   d_bflock held if it does, zero at end of file or a negated errno value.
+ *
+ ****************************************************************************/
+
+static int pipecommon_waitdata(FAR struct pipe_dev_s *dev, bool nonblock)
+{
+  int ret;
+
+  ret = nxmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  while (circbuf_is_empty(&dev->d_buffer) ||
+         PIPE_IS_SPLICERD(dev->d_flags))
+    {
+      /* If there are no writers on the pipe, then return end of file */
+
+      if (dev->d_nwriters <= 0 && circbuf_is_empty(&dev->d_buffer))
+        {
+          nxmutex_unlock(&dev->d_bflock);
+          return 0;
+        }
+
+      if (nonblock)
+        {
+          nxmutex_unlock(&dev->d_bflock);
+          return -EAGAIN;
+        }
+
+      nxmutex_unlock(&dev->d_bflock);
+      ret = nxsem_wait(&dev->d_rdsem);
+      if (ret < 0 || (ret = nxmutex_lock(&dev->d_bflock)) < 0)
+        {
+          return ret;
+        }
+    }
+
+  return 1;
+}
+
+/****************************************************************************
+ * Name: pipecommon_waitspace
+ *
+ * Description:
+ *   Wait until the pipe has room for more data, growing the buffer towards
+ *   'needed' free bytes if possible.  Returns OK with d_bflock held if it
+ *   does or a negated errno value.
+ *
+ ****************************************************************************/
+
+static int pipecommon_waitspace(FAR struct pipe_dev_s *dev, size_t needed,
+                                bool nonblock)
+{
+  int ret;
+
+  ret = nxmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (; ; )
+    {
+      if (dev->d_nreaders <= 0)
+        {
+          nxmutex_unlock(&dev->d_bflock);
+          return -EPIPE;
+        }
+
+      pipecommon_grow(dev, needed);
+      if (!circbuf_is_full(&dev->d_buffer) &&
+          !PIPE_IS_SPLICEWR(dev->d_flags))
+        {
+          return OK;
+        }
+
+      if (nonblock)
+        {
+          nxmutex_unlock(&dev->d_bflock);
+          return -EAGAIN;
+        }
+
+      nxmutex_unlock(&dev->d_bflock);
+      ret = nxsem_wait(&dev->d_wrsem);
+      if (ret < 0 || (ret = nxmutex_lock(&dev->d_bflock)) < 0)
+        {
+          return ret;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: pipecommon_consumed
+ *
+ * Description:
+ *   Notify writers and poll waiters that data was removed from the pipe
+ *   and release buffer memory that is no longer needed.  Poll waiters are
+ *   left alone while a splice holds the free space.
+ *
+ ****************************************************************************/
+
+static void pipecommon_consumed(FAR struct pipe_dev_s *dev)
+{
+  pipecommon_shrink(dev);
+
+  if (circbuf_used(&dev->d_buffer) <= (dev->d_bufsize - dev->d_polloutthrd)
+      && !PIPE_IS_SPLICEWR(dev->d_flags))
+    {
+      poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
+    }
+
+  pipecommon_wakeup(&dev->d_wrsem);
+}
+
+/****************************************************************************
+ * Name: pipecommon_produced
+ *
+ * Description:
+ *   Notify readers and poll waiters that data was added to the pipe.
+ *   Poll waiters are left alone while a splice holds the data.
+ *
+ ****************************************************************************/
+
+static void pipecommon_produced(FAR struct pipe_dev_s *dev)
+{
+  if (circbuf_used(&dev->d_buffer) > dev->d_pollinthrd &&
+      !PIPE_IS_SPLICERD(dev->d_flags))
+    {
+      poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
+    }
+
+  pipecommon_wakeup(&dev->d_rdsem);
+}
+
+/****************************************************************************
+ * Name: pipecommon_waitfile
+ *
+ * Description:
+ *   Wait until the other end of a splice reports one of 'events'.  The
+ *   splice waits here before it takes the data or the space of the pipe,
+ *   so that other readers and writers are not kept out while that file is
+ *   not ready.  A file that cannot be polled is taken as ready.
+ *
+ ****************************************************************************/
+
+static int pipecommon_waitfile(FAR struct file *filep, pollevent_t events)
+{
+  struct pollfd fds;
+  sem_t sem;
+  int ret;
+
+  memset(&fds, 0, sizeof(fds));
+  fds.events = events;
+  fds.arg    = &sem;
+  fds.cb     = poll_default_cb;
+
+  nxsem_init(&sem, 0, 0);
+  ret = file_poll(filep, &fds, true);
+  if (ret < 0)
+    {
+      nxsem_destroy(&sem);
+      return OK;
+    }
+
+  if (fds.revents == 0)
+    {
+      ret = nxsem_wait(&sem);
+    }
+
+  file_poll(filep, &fds, false);
+  nxsem_destroy(&sem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_spliceout
+ *
+ * Description:
+ *   Write pipe data held by a splice to 'outfile'.  A socket is written
+ *   without blocking; any other file was polled by the caller first.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_spliceout(FAR struct file *outfile,
+                                    FAR const void *buffer, size_t len,
+                                    FAR off_t *offset)
+{
+  if (offset != NULL)
+    {
+      return file_pwrite(outfile, buffer, len, *offset);
+    }
+
+#ifdef CONFIG_NET
+  if (INODE_IS_SOCKET(outfile->f_inode))
+    {
+      return psock_send(file_socket(outfile), buffer, len, MSG_DONTWAIT);
+    }
+#endif
+
+  return file_write(outfile, buffer, len);
+}
+
+/****************************************************************************
+ * Name: pipecommon_splicein
+ *
+ * Description:
+ *   Read from 'infile' into pipe space held by a splice.  A socket is
+ *   read without blocking; any other file was polled by the caller first.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splicein(FAR struct file *infile,
+                                   FAR void *buffer, size_t len,
+                                   FAR off_t *offset)
+{
+  if (offset != NULL)
+    {
+      return file_pread(infile, buffer, len, *offset);
+    }
+
+#ifdef CONFIG_NET
+  if (INODE_IS_SOCKET(infile->f_inode))
+    {
+      return psock_recv(file_socket(infile), buffer, len, MSG_DONTWAIT);
+    }
+#endif
+
+  return file_read(infile, buffer, len);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -152,7 +473,7 @@ int pipecommon_open(FAR struct file *filep)
 
   if (inode->i_crefs == 1 && !circbuf_is_init(&dev->d_buffer))
     {
-      ret = circbuf_init(&dev->d_buffer, NULL, dev->d_bufsize);
+      ret = circbuf_init(&dev->d_buffer, NULL, pipecommon_initsize(dev));
       if (ret < 0)
         {
           nxmutex_unlock(&dev->d_bflock);
@@ -432,13 +753,16 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
       return ret;
     }
 
-  /* If the pipe is empty, then wait for something to be written to it */
+  /* If the pipe is empty, then wait for something to be written to it.
+   * Data held by a splice in progress is not available either.
+   */
 
-  while (circbuf_is_empty(&dev->d_buffer))
+  while (circbuf_is_empty(&dev->d_buffer) ||
+         PIPE_IS_SPLICERD(dev->d_flags))
     {
       /* If there are no writers on the pipe, then return end of file */
 
-      if (dev->d_nwriters <= 0)
+      if (dev->d_nwriters <= 0 && circbuf_is_empty(&dev->d_buffer))
         {
           nxmutex_unlock(&dev->d_bflock);
           return 0;
@@ -473,20 +797,12 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
 
   nread = circbuf_read(&dev->d_buffer, buffer, len);
 
-  /* Notify all poll/select waiters that they can write to the
-   * FIFO when buffer can accept more than d_polloutthrd bytes.
-   */
-
-  if (circbuf_used(&dev->d_buffer) <= (dev->d_bufsize - dev->d_polloutthrd))
-    {
-      poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
-    }
-
-  /* Notify all waiting writers that bytes have been removed from the
-   * buffer.
+  /* Notify all poll/select waiters that they can write to the FIFO when
+   * buffer can accept more than d_polloutthrd bytes and all waiting
+   * writers that bytes have been removed from the buffer.
    */
 
-  pipecommon_wakeup(&dev->d_wrsem);
+  pipecommon_consumed(dev);
 
   nxmutex_unlock(&dev->d_bflock);
   pipe_dumpbuffer("From PIPE:", buffer, nread);
@@ -560,9 +876,13 @@ ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer,
           return nwritten == 0 ? -EPIPE : nwritten;
         }
 
-      /* Would the next write overflow the circular buffer? */
+      /* Would the next write overflow the circular buffer?  Grow it first
+       * if it is smaller than the pipe.
+       */
 
-      if (!circbuf_is_full(&dev->d_buffer))
+      pipecommon_grow(dev, len - nwritten);
+      if (!circbuf_is_full(&dev->d_buffer) &&
+          !PIPE_IS_SPLICEWR(dev->d_flags))
         {
           /* Loop until all of the bytes have been written */
 
@@ -575,17 +895,7 @@ ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer,
                * FIFO when buffer used exceeds poll threshold.
                */
 
-              if (circbuf_used(&dev->d_buffer) > dev->d_pollinthrd)
-                {
-                  poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS,
-                              POLLIN);
-                }
-
-              /* Yes.. Notify all of the waiting readers that more data is
-               * available.
-               */
-
-              pipecommon_wakeup(&dev->d_rdsem);
+              pipecommon_produced(dev);
 
               /* Return the number of bytes written */
 
@@ -605,7 +915,11 @@ ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer,
                * FIFO.
                */
 
-              poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
+              if (!PIPE_IS_SPLICERD(dev->d_flags))
+                {
+                  poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS,
+                              POLLIN);
+                }
 
               /* Yes.. Notify all of the waiting readers that more data is
                * available.
@@ -708,19 +1022,23 @@ int pipecommon_poll(FAR struct file *filep, FAR struct pollfd *fds,
 
       /* Notify the POLLOUT event if the pipe buffer can accept
        * more than d_polloutthrd bytes, but only if
-       * there is readers.
+       * there is readers.  Writers wait while a splice holds the
+       * free space, readers while a splice holds the data.  The splice
+       * notifies the waiters when it is done.
        */
 
       eventset = 0;
       if ((filep->f_oflags & O_WROK) &&
-          nbytes < (dev->d_bufsize - dev->d_polloutthrd))
+          nbytes < (dev->d_bufsize - dev->d_polloutthrd) &&
+          !PIPE_IS_SPLICEWR(dev->d_flags))
         {
           eventset |= POLLOUT;
         }
 
       /* Notify the POLLIN event if buffer used exceeds poll threshold */
 
-      if ((filep->f_oflags & O_RDOK) && (nbytes > dev->d_pollinthrd))
+      if ((filep->f_oflags & O_RDOK) && (nbytes > dev->d_pollinthrd) &&
+          !PIPE_IS_SPLICERD(dev->d_flags))
         {
           eventset |= POLLIN;
         }
@@ -860,11 +1178,62 @@ int pipecommon_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
       case FIONSPACE:
         {
-          *(FAR int *)((uintptr_t)arg) = circbuf_space(&dev->d_buffer);
+          *(FAR int *)((uintptr_t)arg) = dev->d_bufsize -
+                                         circbuf_used(&dev->d_buffer);
           ret = 0;
         }
         break;
 
+      case PIPEIOC_SETSIZE:
+        {
+          if (arg == 0 || arg > CONFIG_DEV_PIPE_MAXSIZE)
+            {
+              ret = -EINVAL;
+              break;
+            }
+
+          if (arg < circbuf_used(&dev->d_buffer) ||
+              PIPE_IS_SPLICING(dev->d_flags))
+            {
+              ret = -EBUSY;
+              break;
+            }
+
+          /* Only shrink the buffer here, it grows when it is written */
+
+          if (circbuf_size(&dev->d_buffer) > arg)
+            {
+              ret = circbuf_resize(&dev->d_buffer, arg);
+              if (ret < 0)
+                {
+                  break;
+                }
+            }
+
+          dev->d_bufsize = arg;
+          if (dev->d_pollinthrd >= dev->d_bufsize)
+            {
+              dev->d_pollinthrd = dev->d_bufsize - 1;
+            }
+
+          if (dev->d_polloutthrd >= dev->d_bufsize)
+            {
+              dev->d_polloutthrd = dev->d_bufsize - 1;
+            }
+
+          /* Writers may fit now */
+
+          pipecommon_consumed(dev);
+          ret = dev->d_bufsize;
+        }
+        break;
+
+      case PIPEIOC_GETSIZE:
+        {
+          ret = dev->d_bufsize;
+        }
+        break;
+
       case BIOC_FLUSH:
         ret = -EINVAL;
         break;
@@ -878,6 +1247,339 @@ int pipecommon_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
   return ret;
 }
 
+/****************************************************************************
+ * Name: pipecommon_splice_read
+ *
+ * Description:
+ *   Move up to 'len' bytes out of the pipe 'filep' into 'outfile'.  If
+ *   'offset' is not NULL, the data is written at that position of
+ *   'outfile' and 'offset' is advanced.
+ *
+ *   'outfile' is written straight from the pipe buffer, one contiguous
+ *   region per call, so a wrapped buffer gives a short count.  d_bflock
+ *   is released meanwhile; PIPE_FLAG_SPLICERD keeps other readers away
+ *   from the data and the buffer in place.  Only what 'outfile' accepted
+ *   is consumed.
+ *
+ *   To hold the data no longer than needed, the splice first waits for
+ *   'outfile' to become writable, and a socket is written without
+ *   blocking.  Another file may still block the write if it fills up in
+ *   between.
+ *
+ ****************************************************************************/
+
+ssize_t pipecommon_splice_read(FAR struct file *filep,
+                               FAR struct file *outfile,
+                               FAR off_t *offset, size_t len,
+                               unsigned int flags)
+{
+  FAR struct inode      *inode = filep->f_inode;
+  FAR struct pipe_dev_s *dev   = inode->i_private;
+  ssize_t                nwritten;
+  FAR void              *buffer;
+  size_t                 n;
+  bool                   nonblock;
+  int                    ret;
+
+  DEBUGASSERT(dev);
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  nonblock = (filep->f_oflags & O_NONBLOCK) != 0 ||
+             (flags & SPLICE_F_NONBLOCK) != 0;
+
+  for (; ; )
+    {
+      if (!nonblock)
+        {
+          ret = pipecommon_waitfile(outfile, POLLOUT);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      ret = pipecommon_waitdata(dev, nonblock);
+      if (ret <= 0)
+        {
+          return ret;
+        }
+
+      buffer = circbuf_get_readptr(&dev->d_buffer, &n);
+      if (n > len)
+        {
+          n = len;
+        }
+
+      dev->d_flags |= PIPE_FLAG_SPLICERD;
+      nxmutex_unlock(&dev->d_bflock);
+
+      nwritten = pipecommon_spliceout(outfile, buffer, n, offset);
+
+      /* Consume what was written; the rest stays at the head of the pipe */
+
+      nxmutex_lock(&dev->d_bflock);
+      dev->d_flags &= ~PIPE_FLAG_SPLICERD;
+
+      if (nwritten > 0)
+        {
+          pipe_dumpbuffer("From PIPE:", buffer, nwritten);
+          circbuf_readcommit(&dev->d_buffer, nwritten);
+          if (offset != NULL)
+            {
+              *offset += nwritten;
+            }
+
+          pipecommon_consumed(dev);
+        }
+
+      /* Let the readers held back by the splice have a look */
+
+      pipecommon_produced(dev);
+      nxmutex_unlock(&dev->d_bflock);
+
+      /* A socket that filled up since it was polled is polled again */
+
+      if (nwritten != -EAGAIN || nonblock ||
+          (outfile->f_oflags & O_NONBLOCK) != 0)
+        {
+          return nwritten;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_write
+ *
+ * Description:
+ *   Move up to 'len' bytes from 'infile' into the pipe 'filep'.  If
+ *   'offset' is not NULL, the data is read at that position of 'infile'
+ *   and 'offset' is advanced.
+ *
+ *   'infile' is read straight into the pipe buffer, one contiguous region
+ *   per call.  d_bflock is released meanwhile; PIPE_FLAG_SPLICEWR keeps
+ *   other writers away from the free space and the buffer in place.
+ *
+ *   To hold the space no longer than needed, the splice first waits for
+ *   'infile' to become readable, and a socket is read without blocking.
+ *   Another file may still block the read if it is drained in between.
+ *
+ ****************************************************************************/
+
+ssize_t pipecommon_splice_write(FAR struct file *filep,
+                                FAR struct file *infile,
+                                FAR off_t *offset, size_t len,
+                                unsigned int flags)
+{
+  FAR struct inode      *inode = filep->f_inode;
+  FAR struct pipe_dev_s *dev   = inode->i_private;
+  ssize_t                nread;
+  FAR void              *buffer;
+  size_t                 n;
+  bool                   nonblock;
+  int                    ret;
+
+  DEBUGASSERT(dev);
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  nonblock = (filep->f_oflags & O_NONBLOCK) != 0 ||
+             (flags & SPLICE_F_NONBLOCK) != 0;
+
+  for (; ; )
+    {
+      if (!nonblock)
+        {
+          ret = pipecommon_waitfile(infile, POLLIN);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      ret = pipecommon_waitspace(dev, len, nonblock);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      buffer = circbuf_get_writeptr(&dev->d_buffer, &n);
+      if (n > len)
+        {
+          n = len;
+        }
+
+      dev->d_flags |= PIPE_FLAG_SPLICEWR;
+      nxmutex_unlock(&dev->d_bflock);
+
+      nread = pipecommon_splicein(infile, buffer, n, offset);
+
+      nxmutex_lock(&dev->d_bflock);
+      dev->d_flags &= ~PIPE_FLAG_SPLICEWR;
+
+      if (nread > 0)
+        {
+          pipe_dumpbuffer("To PIPE:", buffer, nread);
+          circbuf_writecommit(&dev->d_buffer, nread);
+          if (offset != NULL)
+            {
+              *offset += nread;
+            }
+
+          pipecommon_produced(dev);
+        }
+
+      /* Let the writers held back by the splice have a look */
+
+      pipecommon_consumed(dev);
+      nxmutex_unlock(&dev->d_bflock);
+
+      /* A socket that was drained since it was polled is polled again */
+
+      if (nread != -EAGAIN || nonblock ||
+          (infile->f_oflags & O_NONBLOCK) != 0)
+        {
+          return nread;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: pipecommon_tee
+ *
+ * Description:
+ *   Copy up to 'len' bytes from the pipe 'filep' to the pipe 'outfile'
+ *   without consuming them.
+ *
+ ****************************************************************************/
+
+ssize_t pipecommon_tee(FAR struct file *filep, FAR struct file *outfile,
+                       size_t len, unsigned int flags)
+{
+  FAR struct pipe_dev_s *indev  = filep->f_inode->i_private;
+  FAR struct pipe_dev_s *outdev = outfile->f_inode->i_private;
+  FAR struct pipe_dev_s *first;
+  FAR struct pipe_dev_s *second;
+  FAR void              *buffer;
+  size_t                 ncopied;
+  size_t                 total;
+  size_t                 n;
+  bool                   nonblock;
+  int                    ret;
+
+  DEBUGASSERT(indev && outdev && indev != outdev);
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  nonblock = (flags & SPLICE_F_NONBLOCK) != 0;
+
+  /* Both pipes must be locked for the copy.  Lock them in a fixed order so
+   * that two tee() calls in opposite directions cannot deadlock.
+   */
+
+  first  = indev < outdev ? indev : outdev;
+  second = indev < outdev ? outdev : indev;
+
+  for (; ; )
+    {
+      /* Wait for data and for room without holding both locks */
+
+      ret = pipecommon_waitdata(indev, nonblock ||
+                                (filep->f_oflags & O_NONBLOCK) != 0);
+      if (ret <= 0)
+        {
+          return ret;
+        }
+
+      nxmutex_unlock(&indev->d_bflock);
+
+      ret = pipecommon_waitspace(outdev, len, nonblock ||
+                                 (outfile->f_oflags & O_NONBLOCK) != 0);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      nxmutex_unlock(&outdev->d_bflock);
+
+      ret = nxmutex_lock(&first->d_bflock);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = nxmutex_lock(&second->d_bflock);
+      if (ret < 0)
+        {
+          nxmutex_unlock(&first->d_bflock);
+          return ret;
+        }
+
+      if (outdev->d_nreaders <= 0)
+        {
+          ret = -EPIPE;
+          break;
+        }
+
+      /* Either pipe may have changed while it was unlocked */
+
+      if (!circbuf_is_empty(&indev->d_buffer) &&
+          !PIPE_IS_SPLICERD(indev->d_flags) &&
+          !circbuf_is_full(&outdev->d_buffer) &&
+          !PIPE_IS_SPLICEWR(outdev->d_flags))
+        {
+          break;
+        }
+
+      nxmutex_unlock(&second->d_bflock);
+      nxmutex_unlock(&first->d_bflock);
+    }
+
+  if (ret >= 0)
+    {
+      total = circbuf_used(&indev->d_buffer);
+      pipecommon_grow(outdev, total < len ? total : len);
+      if (total > circbuf_space(&outdev->d_buffer))
+        {
+          total = circbuf_space(&outdev->d_buffer);
+        }
+
+      if (total > len)
+        {
+          total = len;
+        }
+
+      for (ncopied = 0; ncopied < total; ncopied += n)
+        {
+          buffer = circbuf_get_writeptr(&outdev->d_buffer, &n);
+          if (n > total - ncopied)
+            {
+              n = total - ncopied;
+            }
+
+          circbuf_peekat(&indev->d_buffer, indev->d_buffer.tail + ncopied,
+                         buffer, n);
+          circbuf_writecommit(&outdev->d_buffer, n);
+        }
+
+      pipecommon_produced(outdev);
+      ret = total;
+    }
+
+  nxmutex_unlock(&second->d_bflock);
+  nxmutex_unlock(&first->d_bflock);
+  return ret;
+}
+
 /****************************************************************************
  * Name: pipecommon_unlink
  ****************************************************************************/
@@ -71,6 +71,12 @@
 #  define CONFIG_DEV_FIFO_SIZE 0
 #endif
 
+/* Initial buffer size of a pipe that grows on demand, 0 to disable */
+
+#ifndef CONFIG_DEV_PIPE_GROWSIZE
+#  define CONFIG_DEV_PIPE_GROWSIZE 0
+#endif
+
 /* Maximum number of threads than can be waiting for POLL events */
 
 #ifndef CONFIG_DEV_PIPE_NPOLLWAITERS
@@ -85,6 +91,8 @@
 
 #define PIPE_FLAG_POLICY    (1 << 0) /* Bit 0: Policy=Free buffer when empty */
 #define PIPE_FLAG_UNLINKED  (1 << 1) /* Bit 1: The driver has been unlinked */
+#define PIPE_FLAG_SPLICERD  (1 << 2) /* Bit 2: A splice holds the data */
+#define PIPE_FLAG_SPLICEWR  (1 << 3) /* Bit 3: A splice holds the space */
 
 #define PIPE_POLICY_0(f)    do { (f) &= ~PIPE_FLAG_POLICY; } while (0)
 #define PIPE_POLICY_1(f)    do { (f) |= PIPE_FLAG_POLICY; } while (0)
@@ -94,6 +102,11 @@
 #define PIPE_UNLINK(f)      do { (f) |= PIPE_FLAG_UNLINKED; } while (0)
 #define PIPE_IS_UNLINKED(f) (((f) & PIPE_FLAG_UNLINKED) != 0)
 
+#define PIPE_IS_SPLICERD(f) (((f) & PIPE_FLAG_SPLICERD) != 0)
+#define PIPE_IS_SPLICEWR(f) (((f) & PIPE_FLAG_SPLICEWR) != 0)
+#define PIPE_IS_SPLICING(f) \
+  (((f) & (PIPE_FLAG_SPLICERD | PIPE_FLAG_SPLICEWR)) != 0)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -120,7 +133,8 @@ struct pipe_dev_s
                                    * block O_RDONLY open until there is at least one writer */
   sem_t            d_wrsem;       /* Full buffer - Writer waits for data read AND
                                    * block O_WRONLY open until there is at least one reader */
-  pipe_ndx_t       d_bufsize;     /* allocated size of d_buffer in bytes */
+  pipe_ndx_t       d_bufsize;     /* Capacity of the pipe in bytes.  d_buffer
+                                   * may be smaller and grow up to this */
   pipe_ndx_t       d_pollinthrd;  /* Buffer threshold for POLLIN to occur */
   pipe_ndx_t       d_polloutthrd; /* Buffer threshold for POLLOUT to occur */
   uint8_t          d_nwriters;    /* Number of reference counts for write access */
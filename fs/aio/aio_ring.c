@@ -0,0 +1,1112 @@
+/****************************************************************************
+ * fs/aio/aio_ring.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/aioring.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/irq.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/kthread.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/spinlock.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/net/net.h>
+
+#ifdef CONFIG_FS_AIO_RING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Without spinlock support there is no other CPU to order the stores for */
+
+#ifndef SP_DMB
+#  define SP_DMB()
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct aioring_dev_s;
+
+/* One operation in flight.  Each ring pre-allocates one per completion
+ * queue entry.
+ */
+
+struct aioring_op_s
+{
+  sq_entry_t node;                  /* Free, pending or deferred list link */
+  FAR struct aioring_dev_s *dev;    /* The ring that submitted the op */
+  FAR struct file *filep;           /* The file to operate on */
+  struct aioring_sqe_s sqe;         /* Copy of the submission entry */
+  struct pollfd fds;                /* POLL: Poll setup on the file */
+  bool queued;                      /* POLL: Handed over to a worker */
+#ifdef CONFIG_NET
+  FAR struct socket *newsock;       /* ACCEPT: Socket awaiting an fd */
+#endif
+};
+
+/* The state behind one ring file descriptor.  The lists, inflight,
+ * nwaiters, closed and the completion queue tail are protected by a
+ * critical section because completions are posted from the workers and
+ * from poll callbacks.  The queue sizes are copied at setup: the ring is
+ * shared with the application, which may rewrite them at any time.
+ */
+
+struct aioring_dev_s
+{
+  mutex_t lock;                     /* Serializes submission and teardown */
+  sem_t waitsem;                    /* Wakes up threads awaiting completion */
+  FAR struct aioring_s *ring;       /* Rings shared with the application */
+  FAR struct aioring_op_s *ops;     /* Operation pool */
+  uint32_t sq_mask;                 /* Submission queue index mask */
+  uint32_t cq_entries;              /* Completion queue size and pool size */
+  uint32_t cq_mask;                 /* Completion queue index mask */
+  sq_queue_t freeops;               /* Unused operations */
+  sq_queue_t deferred;              /* Accepted sockets awaiting an fd */
+  uint32_t inflight;                /* Operations not yet completed */
+  uint16_t nwaiters;                /* Threads waiting on waitsem */
+  uint8_t crefs;                    /* References to the ring */
+  bool closed;                      /* Last reference closed */
+  FAR struct pollfd *fds[CONFIG_FS_AIO_RING_NPOLLWAITERS];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int aioring_open(FAR struct file *filep);
+static int aioring_close(FAR struct file *filep);
+static int aioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                        bool setup);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct file_operations g_aioring_fops =
+{
+  aioring_open,  /* open */
+  aioring_close, /* close */
+  NULL,          /* read */
+  NULL,          /* write */
+  NULL,          /* seek */
+  NULL,          /* ioctl */
+  NULL,          /* mmap */
+  NULL,          /* truncate */
+  aioring_poll   /* poll */
+};
+
+static struct inode g_aioring_inode =
+{
+  NULL,                   /* i_parent */
+  NULL,                   /* i_peer */
+  NULL,                   /* i_child */
+  1,                      /* i_crefs */
+  FSNODEFLAG_TYPE_DRIVER, /* i_flags */
+  {
+    &g_aioring_fops       /* u */
+  }
+};
+
+/* Operations waiting for a worker, shared by all rings */
+
+static sq_queue_t g_aioring_pending;
+static sem_t g_aioring_sem = SEM_INITIALIZER(0);
+static mutex_t g_aioring_startlock = NXMUTEX_INITIALIZER;
+static bool g_aioring_started;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aioring_queue
+ *
+ * Description:
+ *   Hand an operation over to the worker threads.  May be called from
+ *   interrupt context.
+ *
+ ****************************************************************************/
+
+static void aioring_queue(FAR struct aioring_op_s *op)
+{
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  sq_addlast(&op->node, &g_aioring_pending);
+  nxsem_post(&g_aioring_sem);
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name: aioring_wakeup
+ *
+ * Description:
+ *   Wake up the threads waiting in aioring_enter() and poll().  Must be
+ *   called within the critical section.
+ *
+ ****************************************************************************/
+
+static void aioring_wakeup(FAR struct aioring_dev_s *dev)
+{
+  for (; dev->nwaiters > 0; dev->nwaiters--)
+    {
+      nxsem_post(&dev->waitsem);
+    }
+
+  poll_notify(dev->fds, CONFIG_FS_AIO_RING_NPOLLWAITERS, POLLIN);
+}
+
+/****************************************************************************
+ * Name: aioring_free
+ *
+ * Description:
+ *   Free a ring whose last reference was closed and whose last operation
+ *   completed.
+ *
+ ****************************************************************************/
+
+static void aioring_free(FAR struct aioring_dev_s *dev)
+{
+  nxmutex_destroy(&dev->lock);
+  nxsem_destroy(&dev->waitsem);
+  kmm_free(dev);
+}
+
+/****************************************************************************
+ * Name: aioring_complete
+ *
+ * Description:
+ *   Post the completion of an operation to the completion queue and return
+ *   the operation to the pool.  Once the ring is closed, the application
+ *   may have released the queues, so the result is dropped and the last
+ *   completion frees the ring.
+ *
+ ****************************************************************************/
+
+static void aioring_complete(FAR struct aioring_op_s *op, ssize_t res)
+{
+  FAR struct aioring_dev_s *dev = op->dev;
+  FAR struct aioring_s *ring = dev->ring;
+  FAR struct aioring_cqe_s *cqe;
+  irqstate_t flags;
+  bool release;
+
+  flags = enter_critical_section();
+
+  if (!dev->closed)
+    {
+      cqe            = &ring->cqes[ring->cq_tail & dev->cq_mask];
+      cqe->user_data = op->sqe.user_data;
+      cqe->res       = res;
+
+      /* Make the entry visible before the new tail */
+
+      SP_DMB();
+      ring->cq_tail++;
+
+      aioring_wakeup(dev);
+    }
+
+  op->filep = NULL;
+  sq_addlast(&op->node, &dev->freeops);
+  release = --dev->inflight == 0 && dev->closed;
+
+  leave_critical_section(flags);
+
+  if (release)
+    {
+      aioring_free(dev);
+    }
+}
+
+/****************************************************************************
+ * Name: aioring_poll_cb
+ *
+ * Description:
+ *   Poll callback of an AIORING_OP_POLL operation.  The poll has to be torn
+ *   down in thread context, so a worker finishes the operation.
+ *
+ ****************************************************************************/
+
+static void aioring_poll_cb(FAR struct pollfd *fds)
+{
+  FAR struct aioring_op_s *op = fds->arg;
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  if (!op->queued)
+    {
+      op->queued = true;
+      aioring_queue(op);
+    }
+
+  leave_critical_section(flags);
+}
+
+#ifdef CONFIG_NET
+/****************************************************************************
+ * Name: aioring_accept
+ *
+ * Description:
+ *   Accept a connection on a worker thread.  The new socket needs a file
+ *   descriptor in the task group that submitted the operation, which only
+ *   that group can allocate.  The operation is therefore parked on the
+ *   deferred list until the next aioring_enter() call picks it up.
+ *
+ ****************************************************************************/
+
+static void aioring_accept(FAR struct aioring_op_s *op)
+{
+  FAR struct aioring_dev_s *dev = op->dev;
+  FAR struct socket *newsock;
+  socklen_t addrlen = op->sqe.len;
+  irqstate_t flags;
+  int ret;
+
+  newsock = kmm_zalloc(sizeof(*newsock));
+  if (newsock == NULL)
+    {
+      aioring_complete(op, -ENOMEM);
+      return;
+    }
+
+  ret = psock_accept(file_socket(op->filep), op->sqe.buf,
+                     op->sqe.buf != NULL ? &addrlen : NULL, newsock,
+                     op->sqe.flags);
+  if (ret < 0)
+    {
+      kmm_free(newsock);
+      aioring_complete(op, ret);
+      return;
+    }
+
+  op->newsock = newsock;
+
+  flags = enter_critical_section();
+  if (dev->closed)
+    {
+      /* Nobody is left to pick the socket up */
+
+      leave_critical_section(flags);
+      psock_close(newsock);
+      kmm_free(newsock);
+      op->newsock = NULL;
+      aioring_complete(op, -ECANCELED);
+      return;
+    }
+
+  sq_addlast(&op->node, &dev->deferred);
+  aioring_wakeup(dev);
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name: aioring_finish_deferred
+ *
+ * Description:
+ *   Give the sockets accepted by the workers a file descriptor in the
+ *   calling task group.  If 'cancel' is true, close them instead.
+ *
+ ****************************************************************************/
+
+static void aioring_finish_deferred(FAR struct aioring_dev_s *dev,
+                                    bool cancel)
+{
+  FAR struct aioring_op_s *op;
+  irqstate_t flags;
+  int oflags;
+  int fd;
+
+  for (; ; )
+    {
+      flags = enter_critical_section();
+      op = (FAR struct aioring_op_s *)sq_remfirst(&dev->deferred);
+      leave_critical_section(flags);
+
+      if (op == NULL)
+        {
+          break;
+        }
+
+      oflags = O_RDWR;
+      if ((op->sqe.flags & SOCK_CLOEXEC) != 0)
+        {
+          oflags |= O_CLOEXEC;
+        }
+
+      if ((op->sqe.flags & SOCK_NONBLOCK) != 0)
+        {
+          oflags |= O_NONBLOCK;
+        }
+
+      fd = cancel ? -ECANCELED : sockfd_allocate(op->newsock, oflags);
+      if (fd < 0)
+        {
+          psock_close(op->newsock);
+          kmm_free(op->newsock);
+          fd = cancel ? fd : -ENFILE;
+        }
+
+      op->newsock = NULL;
+      aioring_complete(op, fd);
+    }
+}
+#else
+#  define aioring_finish_deferred(dev, cancel)
+#endif
+
+/****************************************************************************
+ * Name: aioring_execute
+ *
+ * Description:
+ *   Perform one operation on a worker thread.
+ *
+ ****************************************************************************/
+
+static void aioring_execute(FAR struct aioring_op_s *op)
+{
+  FAR struct aioring_sqe_s *sqe = &op->sqe;
+  ssize_t res;
+
+  switch (sqe->opcode)
+    {
+      case AIORING_OP_READ:
+        res = sqe->off < 0 ?
+              file_read(op->filep, sqe->buf, sqe->len) :
+              file_pread(op->filep, sqe->buf, sqe->len, sqe->off);
+        break;
+
+      case AIORING_OP_WRITE:
+        res = sqe->off < 0 ?
+              file_write(op->filep, sqe->buf, sqe->len) :
+              file_pwrite(op->filep, sqe->buf, sqe->len, sqe->off);
+        break;
+
+      case AIORING_OP_FSYNC:
+        res = file_fsync(op->filep);
+        break;
+
+      case AIORING_OP_POLL:
+        file_poll(op->filep, &op->fds, false);
+        res = op->fds.revents;
+        break;
+
+#ifdef CONFIG_NET
+      case AIORING_OP_ACCEPT:
+        aioring_accept(op);
+        return;
+
+      case AIORING_OP_SEND:
+        res = psock_send(file_socket(op->filep), sqe->buf, sqe->len,
+                         sqe->flags);
+        break;
+
+      case AIORING_OP_RECV:
+        res = psock_recvfrom(file_socket(op->filep), sqe->buf, sqe->len,
+                             sqe->flags, NULL, NULL);
+        break;
+#endif
+
+      default:
+        res = -EINVAL;
+        break;
+    }
+
+  aioring_complete(op, res);
+}
+
+/****************************************************************************
+ * Name: aioring_worker
+ *
+ * Description:
+ *   Body of the worker threads shared by all rings.
+ *
+ ****************************************************************************/
+
+static int aioring_worker(int argc, FAR char *argv[])
+{
+  FAR struct aioring_op_s *op;
+  irqstate_t flags;
+
+  for (; ; )
+    {
+      nxsem_wait_uninterruptible(&g_aioring_sem);
+
+      flags = enter_critical_section();
+      op = (FAR struct aioring_op_s *)sq_remfirst(&g_aioring_pending);
+      leave_critical_section(flags);
+
+      if (op != NULL)
+        {
+          aioring_execute(op);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aioring_start_workers
+ *
+ * Description:
+ *   Start the worker threads when the first ring is created.
+ *
+ ****************************************************************************/
+
+static int aioring_start_workers(void)
+{
+  int ret;
+  int i;
+
+  ret = nxmutex_lock(&g_aioring_startlock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (i = 0; !g_aioring_started && i < CONFIG_FS_AIO_RING_NWORKERS; i++)
+    {
+      ret = kthread_create("aioring", CONFIG_FS_AIO_RING_PRIORITY,
+                           CONFIG_FS_AIO_RING_STACKSIZE,
+                           aioring_worker, NULL);
+      if (ret < 0)
+        {
+          ferr("ERROR: Failed to start worker %d: %d\n", i, ret);
+          break;
+        }
+    }
+
+  /* Run with fewer workers rather than none */
+
+  if (i > 0)
+    {
+      g_aioring_started = true;
+    }
+
+  nxmutex_unlock(&g_aioring_startlock);
+  return g_aioring_started ? OK : ret;
+}
+
+/****************************************************************************
+ * Name: aioring_start
+ *
+ * Description:
+ *   Start an operation taken from the submission queue.  Runs in the
+ *   context of the submitting task so that its file descriptors can be
+ *   resolved.
+ *
+ ****************************************************************************/
+
+static void aioring_start(FAR struct aioring_op_s *op)
+{
+  FAR struct aioring_sqe_s *sqe = &op->sqe;
+  int ret;
+
+  op->queued = true;
+
+  if (sqe->opcode == AIORING_OP_NOP)
+    {
+      aioring_complete(op, 0);
+      return;
+    }
+  else if (sqe->opcode > AIORING_OP_RECV)
+    {
+      aioring_complete(op, -EINVAL);
+      return;
+    }
+
+  ret = fs_getfilep(sqe->fd, &op->filep);
+  if (ret < 0)
+    {
+      aioring_complete(op, ret);
+      return;
+    }
+
+  if (sqe->opcode >= AIORING_OP_ACCEPT)
+    {
+#ifdef CONFIG_NET
+      if (file_socket(op->filep) == NULL)
+        {
+          aioring_complete(op, -ENOTSOCK);
+          return;
+        }
+#else
+      aioring_complete(op, -ENOTSOCK);
+      return;
+#endif
+    }
+
+  if (sqe->opcode == AIORING_OP_POLL)
+    {
+      /* Polls do not occupy a worker while they wait, the callback hands
+       * them over once an event arrived.
+       */
+
+      memset(&op->fds, 0, sizeof(op->fds));
+      op->fds.fd     = sqe->fd;
+      op->fds.events = sqe->events;
+      op->fds.arg    = op;
+      op->fds.cb     = aioring_poll_cb;
+      op->queued     = false;
+
+      ret = file_poll(op->filep, &op->fds, true);
+      if (ret < 0)
+        {
+          op->queued = true;
+          aioring_complete(op, ret);
+        }
+
+      return;
+    }
+
+  aioring_queue(op);
+}
+
+/****************************************************************************
+ * Name: aioring_submit
+ *
+ * Description:
+ *   Consume up to 'to_submit' entries from the submission queue.  No more
+ *   operations are started than the completion queue can take, counting
+ *   the completions that the application has not consumed yet.
+ *
+ ****************************************************************************/
+
+static int aioring_submit(FAR struct aioring_dev_s *dev,
+                          unsigned int to_submit)
+{
+  FAR struct aioring_s *ring = dev->ring;
+  FAR struct aioring_op_s *op;
+  irqstate_t flags;
+  uint32_t head;
+  unsigned int n;
+
+  for (n = 0; n < to_submit && ring->sq_head != ring->sq_tail; n++)
+    {
+      flags = enter_critical_section();
+      if (dev->inflight + (ring->cq_tail - ring->cq_head) >=
+          dev->cq_entries)
+        {
+          leave_critical_section(flags);
+          break;
+        }
+
+      /* The check above relies on the application's view of cq_head.  A
+       * corrupted one must not run the pool dry.
+       */
+
+      op = (FAR struct aioring_op_s *)sq_remfirst(&dev->freeops);
+      if (op == NULL)
+        {
+          leave_critical_section(flags);
+          break;
+        }
+
+      dev->inflight++;
+      leave_critical_section(flags);
+
+      head    = ring->sq_head;
+      op->sqe = ring->sqes[head & dev->sq_mask];
+      ring->sq_head = head + 1;
+
+      aioring_start(op);
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: aioring_cancel_polls
+ *
+ * Description:
+ *   Complete the poll operations that are still waiting for an event.
+ *
+ ****************************************************************************/
+
+static void aioring_cancel_polls(FAR struct aioring_dev_s *dev)
+{
+  FAR struct aioring_op_s *op;
+  irqstate_t flags;
+  bool claimed;
+  uint32_t i;
+
+  for (i = 0; i < dev->cq_entries; i++)
+    {
+      op = &dev->ops[i];
+
+      flags   = enter_critical_section();
+      claimed = op->sqe.opcode == AIORING_OP_POLL && !op->queued;
+      op->queued = true;
+      leave_critical_section(flags);
+
+      if (claimed)
+        {
+          file_poll(op->filep, &op->fds, false);
+          aioring_complete(op, -ECANCELED);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: aioring_cancel_pending
+ *
+ * Description:
+ *   Complete the operations of a ring that no worker has picked up yet.
+ *
+ ****************************************************************************/
+
+static void aioring_cancel_pending(FAR struct aioring_dev_s *dev)
+{
+  FAR struct aioring_op_s *op;
+  FAR sq_entry_t *next;
+  FAR sq_entry_t *node;
+  sq_queue_t cancelled;
+  irqstate_t flags;
+
+  sq_init(&cancelled);
+
+  flags = enter_critical_section();
+  for (node = sq_peek(&g_aioring_pending); node != NULL; node = next)
+    {
+      next = sq_next(node);
+      op   = (FAR struct aioring_op_s *)node;
+      if (op->dev == dev)
+        {
+          sq_rem(node, &g_aioring_pending);
+          sq_addlast(node, &cancelled);
+        }
+    }
+
+  leave_critical_section(flags);
+
+  while ((op = (FAR struct aioring_op_s *)sq_remfirst(&cancelled)) != NULL)
+    {
+      if (op->sqe.opcode == AIORING_OP_POLL)
+        {
+          file_poll(op->filep, &op->fds, false);
+        }
+
+      aioring_complete(op, -ECANCELED);
+    }
+}
+
+/****************************************************************************
+ * Name: aioring_open
+ ****************************************************************************/
+
+static int aioring_open(FAR struct file *filep)
+{
+  FAR struct aioring_dev_s *dev = filep->f_priv;
+  int ret;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (dev->crefs >= 255)
+    {
+      ret = -EMFILE;
+    }
+  else
+    {
+      dev->crefs++;
+    }
+
+  nxmutex_unlock(&dev->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: aioring_close
+ ****************************************************************************/
+
+static int aioring_close(FAR struct file *filep)
+{
+  FAR struct aioring_dev_s *dev = filep->f_priv;
+  irqstate_t flags;
+  bool release;
+  int ret;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (--dev->crefs > 0)
+    {
+      nxmutex_unlock(&dev->lock);
+      return OK;
+    }
+
+  /* Last reference.  Hold the ring with a pseudo operation while the
+   * rest are cancelled, so that their completions cannot free it yet.
+   */
+
+  flags = enter_critical_section();
+  dev->inflight++;
+  dev->closed = true;
+  leave_critical_section(flags);
+
+  /* Cancel everything that has not reached a worker.  Operations that a
+   * worker is executing may block for good, e.g. a read of a socket that
+   * never gets data, so they are not waited for: the last one to complete
+   * frees the ring.
+   */
+
+  aioring_cancel_polls(dev);
+  aioring_cancel_pending(dev);
+  aioring_finish_deferred(dev, true);
+
+  flags = enter_critical_section();
+  release = --dev->inflight == 0;
+  leave_critical_section(flags);
+
+  nxmutex_unlock(&dev->lock);
+  if (release)
+    {
+      aioring_free(dev);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aioring_poll
+ ****************************************************************************/
+
+static int aioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                        bool setup)
+{
+  FAR struct aioring_dev_s *dev = filep->f_priv;
+  FAR struct aioring_s *ring = dev->ring;
+  irqstate_t flags;
+  int ret;
+  int i;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (!setup)
+    {
+      /* This is a request to tear down the poll. */
+
+      FAR struct pollfd **slot = (FAR struct pollfd **)fds->priv;
+
+      flags = enter_critical_section();
+      if (slot != NULL)
+        {
+          *slot     = NULL;
+          fds->priv = NULL;
+        }
+
+      leave_critical_section(flags);
+      goto out;
+    }
+
+  flags = enter_critical_section();
+  for (i = 0; i < CONFIG_FS_AIO_RING_NPOLLWAITERS; i++)
+    {
+      if (dev->fds[i] == NULL)
+        {
+          dev->fds[i] = fds;
+          fds->priv   = &dev->fds[i];
+          break;
+        }
+    }
+
+  if (i >= CONFIG_FS_AIO_RING_NPOLLWAITERS)
+    {
+      fds->priv = NULL;
+      ret       = -EBUSY;
+    }
+  else if (ring->cq_tail != ring->cq_head || !sq_empty(&dev->deferred))
+    {
+      /* Completions are ready to be consumed or picked up */
+
+      poll_notify(&fds, 1, POLLIN);
+    }
+
+  leave_critical_section(flags);
+
+out:
+  nxmutex_unlock(&dev->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aioring_setup
+ *
+ * Description:
+ *   Create a submission/completion ring pair for batched asynchronous I/O.
+ *   The rings live in application memory described by 'ring'.  The entries
+ *   of both queues are reset.
+ *
+ * Input Parameters:
+ *   ring  - Description of the rings
+ *   flags - AIORING_CLOEXEC or 0
+ *
+ * Returned Value:
+ *   A new file descriptor on success; -1 (ERROR) on failure with errno set
+ *   appropriately.
+ *
+ ****************************************************************************/
+
+int aioring_setup(FAR struct aioring_s *ring, int flags)
+{
+  FAR struct aioring_dev_s *dev;
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t i;
+  int ret;
+
+  if (ring == NULL || ring->sqes == NULL || ring->cqes == NULL ||
+      (flags & ~AIORING_CLOEXEC) != 0)
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  /* Read the sizes once; only the validated copies are used from now on */
+
+  sq_entries = ring->sq_entries;
+  cq_entries = ring->cq_entries;
+
+  if (sq_entries == 0 || cq_entries == 0 ||
+      (sq_entries & (sq_entries - 1)) != 0 ||
+      (cq_entries & (cq_entries - 1)) != 0)
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  ret = aioring_start_workers();
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  /* Allocate the ring state together with one operation per completion
+   * queue entry.
+   */
+
+  dev = kmm_zalloc(sizeof(*dev) +
+                   cq_entries * sizeof(struct aioring_op_s));
+  if (dev == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  nxmutex_init(&dev->lock);
+  nxsem_init(&dev->waitsem, 0, 0);
+  sq_init(&dev->freeops);
+  sq_init(&dev->deferred);
+
+  dev->ring       = ring;
+  dev->ops        = (FAR struct aioring_op_s *)(dev + 1);
+  dev->sq_mask    = sq_entries - 1;
+  dev->cq_entries = cq_entries;
+  dev->cq_mask    = cq_entries - 1;
+  dev->crefs      = 1;
+
+  for (i = 0; i < dev->cq_entries; i++)
+    {
+      dev->ops[i].dev    = dev;
+      dev->ops[i].queued = true;
+      sq_addlast(&dev->ops[i].node, &dev->freeops);
+    }
+
+  ring->sq_head = 0;
+  ring->sq_tail = 0;
+  ring->cq_head = 0;
+  ring->cq_tail = 0;
+
+  ret = file_allocate(&g_aioring_inode, O_RDWR | flags, 0, dev, 0, true);
+  if (ret < 0)
+    {
+      aioring_free(dev);
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: aioring_enter
+ *
+ * Description:
+ *   Submit queued entries and optionally wait for completions.
+ *
+ * Input Parameters:
+ *   fd           - The file descriptor returned by aioring_setup()
+ *   to_submit    - Maximum number of submission queue entries to consume
+ *   min_complete - Wait until this many completions are available
+ *   timeout      - Maximum time to wait in milliseconds, -1 for no limit
+ *
+ * Returned Value:
+ *   The number of entries consumed from the submission queue, which is
+ *   less than requested if the completion queue is short of space.  On
+ *   failure, -1 (ERROR) is returned with errno set appropriately.  Running
+ *   out of time is not a failure; the caller checks the completion queue.
+ *
+ ****************************************************************************/
+
+int aioring_enter(int fd, unsigned int to_submit,
+                  unsigned int min_complete, int timeout)
+{
+  FAR struct aioring_dev_s *dev;
+  FAR struct aioring_s *ring;
+  FAR struct file *filep;
+  irqstate_t flags;
+  clock_t deadline = 0;
+  clock_t now;
+  int submitted;
+  int ret;
+
+  ret = fs_getfilep(fd, &filep);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  if (filep->f_inode != &g_aioring_inode)
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  dev  = filep->f_priv;
+  ring = dev->ring;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  submitted = aioring_submit(dev, to_submit);
+  aioring_finish_deferred(dev, false);
+
+  if (min_complete > dev->cq_entries)
+    {
+      min_complete = dev->cq_entries;
+    }
+
+  if (timeout >= 0)
+    {
+      deadline = clock_systime_ticks() + MSEC2TICK(timeout);
+    }
+
+  for (; ; )
+    {
+      flags = enter_critical_section();
+      if (ring->cq_tail - ring->cq_head >= min_complete ||
+          dev->inflight == 0)
+        {
+          leave_critical_section(flags);
+          ret = OK;
+          break;
+        }
+
+      dev->nwaiters++;
+      leave_critical_section(flags);
+
+      nxmutex_unlock(&dev->lock);
+
+      if (timeout < 0)
+        {
+          ret = nxsem_wait(&dev->waitsem);
+        }
+      else
+        {
+          now = clock_systime_ticks();
+          ret = now >= deadline ? -ETIMEDOUT :
+                nxsem_tickwait(&dev->waitsem, deadline - now);
+        }
+
+      nxmutex_lock(&dev->lock);
+
+      if (ret < 0)
+        {
+          /* A completion may have taken our registration and posted the
+           * semaphore already.  That only leads to one spurious wakeup.
+           */
+
+          flags = enter_critical_section();
+          if (dev->nwaiters > 0)
+            {
+              dev->nwaiters--;
+            }
+
+          leave_critical_section(flags);
+          break;
+        }
+
+      aioring_finish_deferred(dev, false);
+    }
+
+  nxmutex_unlock(&dev->lock);
+
+  if (ret < 0 && ret != -ETIMEDOUT && submitted == 0)
+    {
+      goto errout;
+    }
+
+  return submitted;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+#endif /* CONFIG_FS_AIO_RING */
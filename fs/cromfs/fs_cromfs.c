@@ -39,6 +39,7 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 
@@ -68,9 +69,21 @@ struct cromfs_dir_s
 struct cromfs_file_s
 {
   FAR const struct cromfs_node_s *ff_node;  /* The open file node */
-  uint32_t ff_offset;                       /* Cached block offset (zero means none) */
-  uint16_t ff_ulen;                         /* Length of decompressed data in cache */
-  FAR uint8_t *ff_buffer;                   /* Cached, decompressed data */
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+  FAR uint32_t *ff_index;                   /* Block offsets, may be NULL */
+#endif
+};
+
+/* One decompressed block in the block cache, which is shared by all open
+ * files.
+ */
+
+struct cromfs_cache_s
+{
+  uint32_t cc_offset;      /* Offset of the block data (zero means unused) */
+  uint32_t cc_age;         /* Time of last use, for LRU replacement */
+  uint16_t cc_ulen;        /* Length of the decompressed data */
+  FAR uint8_t *cc_buffer;  /* Decompressed data */
 };
 
 /* This is the form of the callback from cromfs_foreach_node(): */
@@ -114,6 +127,17 @@ static FAR void *cromfs_offset2addr(FAR const struct cromfs_volume_s *fs,
                   uint32_t offset);
 static uint32_t cromfs_addr2offset(FAR const struct cromfs_volume_s *fs,
                   FAR const void *addr);
+static uint32_t cromfs_blkinfo(FAR const struct lzf_header_s *hdr,
+                  FAR uint16_t *ulen, FAR uint16_t *clen);
+static int      cromfs_cache_read(FAR const struct cromfs_volume_s *fs,
+                  FAR const uint8_t *src, uint16_t clen, uint16_t ulen,
+                  FAR uint8_t *dest, unsigned int copyoffs,
+                  unsigned int copysize);
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+static FAR uint32_t *cromfs_build_index(
+                  FAR const struct cromfs_volume_s *fs,
+                  FAR const struct cromfs_node_s *node);
+#endif
 static int      cromfs_follow_link(FAR const struct cromfs_volume_s *fs,
                   FAR const struct cromfs_node_s **ppnode, bool follow,
                   FAR struct cromfs_node_s *newnode);
@@ -220,6 +244,16 @@ const struct mountpt_operations g_cromfs_operations =
 
 extern const struct cromfs_volume_s g_cromfs_image;
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The decompressed block cache */
+
+static struct cromfs_cache_s g_cromfs_cache[CONFIG_FS_CROMFS_CACHE_NBLOCKS];
+static uint32_t g_cromfs_cache_age;
+static mutex_t g_cromfs_cache_lock = NXMUTEX_INITIALIZER;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -288,6 +322,200 @@ static uint32_t cromfs_addr2offset(FAR const struct cromfs_volume_s *fs,
   return offset;
 }
 
+/****************************************************************************
+ * Name: cromfs_blkinfo
+ *
+ * Description:
+ *   Get the uncompressed and compressed lengths of the data of a block and
+ *   return the size of the whole block, header included.
+ *
+ ****************************************************************************/
+
+static uint32_t cromfs_blkinfo(FAR const struct lzf_header_s *hdr,
+                               FAR uint16_t *ulen, FAR uint16_t *clen)
+{
+  if (hdr->lzf_type == LZF_TYPE0_HDR)
+    {
+      FAR const struct lzf_type0_header_s *hdr0 =
+        (FAR const struct lzf_type0_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr0->lzf_len[0] << 8 |
+              (uint16_t)hdr0->lzf_len[1];
+      *clen = *ulen;
+      return (uint32_t)*ulen + LZF_TYPE0_HDR_SIZE;
+    }
+  else
+    {
+      FAR const struct lzf_type1_header_s *hdr1 =
+        (FAR const struct lzf_type1_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr1->lzf_ulen[0] << 8 |
+              (uint16_t)hdr1->lzf_ulen[1];
+      *clen = (uint16_t)hdr1->lzf_clen[0] << 8 |
+              (uint16_t)hdr1->lzf_clen[1];
+      return (uint32_t)*clen + LZF_TYPE1_HDR_SIZE;
+    }
+}
+
+/****************************************************************************
+ * Name: cromfs_cache_read
+ *
+ * Description:
+ *   Copy 'copysize' bytes at 'copyoffs' of the decompressed data of the
+ *   compressed block at 'src' to 'dest', decompressing the block into the
+ *   block cache unless it is already there.  A whole block that is not
+ *   cached is decompressed straight into 'dest' and not cached: that is a
+ *   sequential read that will not come back to the block.
+ *
+ ****************************************************************************/
+
+static int cromfs_cache_read(FAR const struct cromfs_volume_s *fs,
+                             FAR const uint8_t *src, uint16_t clen,
+                             uint16_t ulen, FAR uint8_t *dest,
+                             unsigned int copyoffs, unsigned int copysize)
+{
+  FAR struct cromfs_cache_s *victim;
+  FAR struct cromfs_cache_s *cc;
+  unsigned int decomplen;
+  uint32_t voloffs;
+  int ret;
+  int i;
+
+  voloffs = cromfs_addr2offset(fs, src);
+
+  ret = nxmutex_lock(&g_cromfs_cache_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Look for the block in the cache, remembering the least recently used
+   * entry in case it is not there.
+   */
+
+  victim = &g_cromfs_cache[0];
+  for (i = 0; i < CONFIG_FS_CROMFS_CACHE_NBLOCKS; i++)
+    {
+      cc = &g_cromfs_cache[i];
+      if (cc->cc_offset == voloffs)
+        {
+          DEBUGASSERT(cc->cc_ulen >= copyoffs + copysize);
+
+          finfo("Cache hit: voloffs=%" PRIu32 "\n", voloffs);
+          memcpy(dest, &cc->cc_buffer[copyoffs], copysize);
+          cc->cc_age = ++g_cromfs_cache_age;
+          goto out;
+        }
+
+      if (cc->cc_offset == 0 ||
+          (victim->cc_offset != 0 &&
+           (int32_t)(cc->cc_age - victim->cc_age) < 0))
+        {
+          victim = cc;
+        }
+    }
+
+  /* A miss.  Decompress a whole block directly into the user buffer */
+
+  if (copyoffs == 0 && copysize == ulen)
+    {
+      decomplen = lzf_decompress(src, clen, dest, copysize);
+      if (decomplen != ulen)
+        {
+          ret = -EIO;
+        }
+
+      goto out;
+    }
+
+  /* Otherwise replace the least recently used entry */
+
+  if (victim->cc_buffer == NULL)
+    {
+      victim->cc_buffer = kmm_malloc(fs->cv_bsize);
+      if (victim->cc_buffer == NULL)
+        {
+          ret = -ENOMEM;
+          goto out;
+        }
+    }
+
+  decomplen = lzf_decompress(src, clen, victim->cc_buffer, fs->cv_bsize);
+  if (decomplen != ulen)
+    {
+      victim->cc_offset = 0;
+      ret = -EIO;
+      goto out;
+    }
+
+  finfo("Cache fill: voloffs=%" PRIu32 " ulen=%" PRIu16 "\n",
+        voloffs, ulen);
+
+  victim->cc_offset = voloffs;
+  victim->cc_ulen   = ulen;
+  victim->cc_age    = ++g_cromfs_cache_age;
+  memcpy(dest, &victim->cc_buffer[copyoffs], copysize);
+
+out:
+  nxmutex_unlock(&g_cromfs_cache_lock);
+  return ret;
+}
+
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+/****************************************************************************
+ * Name: cromfs_build_index
+ *
+ * Description:
+ *   Build an array of the image offsets of the blocks of a file so that the
+ *   block holding any file position can be found without walking the block
+ *   headers.  This relies on all blocks but the last one holding exactly
+ *   cv_bsize bytes of file data, which is what gencromfs produces.  NULL is
+ *   returned if that is not the case, if the file has only one block or if
+ *   there is not enough memory; the caller then walks the headers.
+ *
+ ****************************************************************************/
+
+static FAR uint32_t *cromfs_build_index(FAR const struct cromfs_volume_s *fs,
+                                        FAR const struct cromfs_node_s *node)
+{
+  FAR uint32_t *index;
+  uint32_t nblocks;
+  uint32_t offset;
+  uint32_t i;
+  uint16_t ulen;
+  uint16_t clen;
+
+  nblocks = (node->cn_size + fs->cv_bsize - 1) / fs->cv_bsize;
+  if (nblocks < 2)
+    {
+      return NULL;
+    }
+
+  index = kmm_malloc(nblocks * sizeof(uint32_t));
+  if (index == NULL)
+    {
+      return NULL;
+    }
+
+  offset = node->u.cn_blocks;
+  for (i = 0; i < nblocks; i++)
+    {
+      FAR const struct lzf_header_s *hdr = cromfs_offset2addr(fs, offset);
+
+      index[i] = offset;
+      offset  += cromfs_blkinfo(hdr, &ulen, &clen);
+
+      if (ulen != fs->cv_bsize && i + 1 < nblocks)
+        {
+          kmm_free(index);
+          return NULL;
+        }
+    }
+
+  return index;
+}
+#endif
+
 /****************************************************************************
  * Name: cromfs_follow_link
  *
@@ -786,20 +1014,15 @@ static int cromfs_open(FAR struct file *filep, FAR const char *relpath,
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
-
-  ff->ff_buffer = kmm_malloc(fs->cv_bsize);
-  if (!ff->ff_buffer)
-    {
-      kmm_free(ff);
-      return -ENOMEM;
-    }
-
   /* Save the node in the open file instance */
 
   ff->ff_node = (FAR const struct cromfs_node_s *)
     cromfs_offset2addr(fs, offset);
 
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+  ff->ff_index = cromfs_build_index(fs, ff->ff_node);
+#endif
+
   /* Save the index as the open-specific state in filep->f_priv */
 
   filep->f_priv = (FAR void *)ff;
@@ -820,11 +1043,13 @@ static int cromfs_close(FAR struct file *filep)
   /* Get the open file instance from the file structure */
 
   ff = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   /* Free all resources consumed by the opened file */
 
-  kmm_free(ff->ff_buffer);
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+  kmm_free(ff->ff_index);
+#endif
   kmm_free(ff);
 
   return OK;
@@ -851,6 +1076,7 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   uint16_t clen;
   unsigned int copysize;
   unsigned int copyoffs;
+  int ret;
 
   finfo("Read %zu bytes from offset %jd\n", buflen, (intmax_t)filep->f_pos);
   DEBUGASSERT(filep->f_priv != NULL);
@@ -866,7 +1092,7 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   /* Get the open file instance from the file structure */
 
   ff = (FAR struct cromfs_file_s *)filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   /* Check for a read past the end of the file */
 
@@ -903,50 +1129,48 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
 
   while (remaining > 0)
     {
-      /* Search for the next block containing the fpos file offset.  This is
-       * real search on the first time through but the remaining blocks
-       * should be contiguous so that the logic should not loop.
-       *
-       */
-
-      do
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+      if (ff->ff_index != NULL)
         {
-          uint32_t blksize;
+          uint32_t blkno = fpos / fs->cv_bsize;
 
-          /* Go to the next block */
+          /* The index gives the block containing fpos directly */
 
-          currhdr  = nexthdr;
-          blkoffs += ulen;
+          currhdr = (FAR struct lzf_header_s *)
+                    cromfs_offset2addr(fs, ff->ff_index[blkno]);
+          blkoffs = blkno * fs->cv_bsize;
+          cromfs_blkinfo(currhdr, &ulen, &clen);
+        }
+      else
+#endif
+        {
+          /* Search for the next block containing the fpos file offset.
+           * This is real search on the first time through but the
+           * remaining blocks should be contiguous so that the logic should
+           * not loop.
+           */
 
-          if (currhdr->lzf_type == LZF_TYPE0_HDR)
+          do
             {
-              FAR struct lzf_type0_header_s *hdr0 =
-                (FAR struct lzf_type0_header_s *)currhdr;
+              /* Go to the next block */
 
-              ulen    = (uint16_t)hdr0->lzf_len[0] << 8 |
-                        (uint16_t)hdr0->lzf_len[1];
-              blksize = (uint32_t)ulen + LZF_TYPE0_HDR_SIZE;
-            }
-          else
-            {
-              FAR struct lzf_type1_header_s * hdr1 =
-                (FAR struct lzf_type1_header_s *)currhdr;
-
-              ulen    = (uint16_t)hdr1->lzf_ulen[0] << 8 |
-                        (uint16_t)hdr1->lzf_ulen[1];
-              clen    = (uint16_t)hdr1->lzf_clen[0] << 8 |
-                        (uint16_t)hdr1->lzf_clen[1];
-              blksize = (uint32_t)clen + LZF_TYPE1_HDR_SIZE;
+              currhdr  = nexthdr;
+              blkoffs += ulen;
+              nexthdr  = (FAR struct lzf_header_s *)
+                         ((FAR uint8_t *)currhdr +
+                          cromfs_blkinfo(currhdr, &ulen, &clen));
             }
-
-          nexthdr  = (FAR struct lzf_header_s *)
-                     ((FAR uint8_t *)currhdr + blksize);
+          while (fpos >= (blkoffs + ulen));
         }
-      while (fpos >= (blkoffs + ulen));
 
-      /* Check if we need to decompress the next block into the user
-       * buffer.
-       */
+      copyoffs = fpos - blkoffs;
+      DEBUGASSERT(ulen > copyoffs);
+      copysize = ulen - copyoffs;
+
+      if (copysize > remaining)  /* Clip to the size really needed */
+        {
+          copysize = remaining;
+        }
 
       if (currhdr->lzf_type == LZF_TYPE0_HDR)
         {
@@ -954,103 +1178,28 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
            * user buffer.
            */
 
-          copyoffs = (blkoffs >= filep->f_pos) ? 0 : filep->f_pos - blkoffs;
-          DEBUGASSERT(ulen > copyoffs);
-          copysize = ulen - copyoffs;
-
-          if (copysize > remaining)  /* Clip to the size really needed */
-            {
-              copysize = remaining;
-            }
-
           src = (FAR const uint8_t *)currhdr + LZF_TYPE0_HDR_SIZE;
           memcpy(dest, &src[copyoffs], copysize);
-
-          finfo("blkoffs=%" PRIu32 " ulen=%" PRIu16 " copysize=%u\n",
-                blkoffs, ulen, copysize);
         }
       else
         {
-          /* If the source of the data is at the beginning of the compressed
-           * data buffer and if the uncompressed data would not overrun the
-           * buffer, then we can decompress directly into the user buffer.
+          /* Get the data from the block cache, decompressing it there or
+           * directly into the user buffer if necessary.
            */
 
-          if (filep->f_pos <= blkoffs && ulen <= remaining)
+          src = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
+          ret = cromfs_cache_read(fs, src, clen, ulen, dest, copyoffs,
+                                  copysize);
+          if (ret < 0)
             {
-              uint32_t voloffs;
-
-              copyoffs = 0;
-              copysize = ulen;
-
-              /* Get the address and offset in the CROMFS image to obtain
-               * the data.  Check if we already have this offset in the
-               * cache.
-               */
-
-              src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, dest, fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
-
-              finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32
-                    " ulen=%" PRIu16 " ff_offset=%" PRIu32 " copysize=%u\n",
-                    voloffs, blkoffs, ulen, ff->ff_offset, copysize);
-              DEBUGASSERT(ff->ff_ulen >= copysize);
-            }
-          else
-            {
-              uint32_t voloffs;
-
-              /* No, we will need to decompress into the our intermediate
-               * decompression buffer.
-               */
-
-              copyoffs = (blkoffs >= filep->f_pos) ?
-                            0 : filep->f_pos - blkoffs;
-              DEBUGASSERT(ulen > copyoffs);
-              copysize = ulen - copyoffs;
-
-              if (copysize > remaining)  /* Clip to the size really needed */
-                {
-                  copysize = remaining;
-                }
-
-              DEBUGASSERT((copyoffs + copysize) <=  fs->cv_bsize);
-
-              src = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, ff->ff_buffer,
-                                             fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
-
-              finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32 " ulen=%" PRIu16
-                    " clen=%" PRIu16 " ff_offset=%" PRIu32
-                    "  copyoffs=%u copysize=%u\n",
-                    voloffs, blkoffs, ulen, clen, ff->ff_offset,
-                    copyoffs, copysize);
-              DEBUGASSERT(ff->ff_ulen >= (copyoffs + copysize));
-
-              /* Then copy to user buffer */
-
-              memcpy(dest, &ff->ff_buffer[copyoffs], copysize);
+              ferr("ERROR: Failed to decompress block: %d\n", ret);
+              return ret;
             }
         }
 
+      finfo("blkoffs=%" PRIu32 " ulen=%" PRIu16 " copyoffs=%u"
+            " copysize=%u\n", blkoffs, ulen, copyoffs, copysize);
+
       /* Adjust pointers counts and offset */
 
       dest      += copysize;
@@ -1087,7 +1236,6 @@ static int cromfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
 static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
 {
-  FAR struct cromfs_volume_s *fs;
   FAR struct cromfs_file_s *oldff;
   FAR struct cromfs_file_s *newff;
 
@@ -1095,15 +1243,10 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
   DEBUGASSERT(oldp->f_priv != NULL && oldp->f_inode != NULL &&
               newp->f_priv == NULL && newp->f_inode != NULL);
 
-  /* Recover our private data from the struct file instance */
-
-  fs = oldp->f_inode->i_private;
-  DEBUGASSERT(fs != NULL);
-
   /* Get the open file instance from the file structure */
 
   oldff = oldp->f_priv;
-  DEBUGASSERT(oldff->ff_node != NULL && oldff->ff_buffer != NULL);
+  DEBUGASSERT(oldff->ff_node != NULL);
 
   /* Allocate and initialize an new open file instance referring to the
    * same node.
@@ -1115,19 +1258,28 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
-
-  newff->ff_buffer = kmm_malloc(fs->cv_bsize);
-  if (newff->ff_buffer == NULL)
-    {
-      kmm_free(newff);
-      return -ENOMEM;
-    }
-
   /* Save the node in the open file instance */
 
   newff->ff_node = oldff->ff_node;
 
+#ifdef CONFIG_FS_CROMFS_SEEKINDEX
+  /* Give the new file its own copy of the block index */
+
+  if (oldff->ff_index != NULL)
+    {
+      FAR const struct cromfs_volume_s *fs = oldp->f_inode->i_private;
+      size_t size;
+
+      size = (newff->ff_node->cn_size + fs->cv_bsize - 1) / fs->cv_bsize *
+             sizeof(uint32_t);
+      newff->ff_index = kmm_malloc(size);
+      if (newff->ff_index != NULL)
+        {
+          memcpy(newff->ff_index, oldff->ff_index, size);
+        }
+    }
+#endif
+
   /* Copy the index from the old to the new file structure */
 
   newp->f_priv = newff;
@@ -1160,7 +1312,7 @@ static int cromfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
    */
 
   ff              = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   inode           = filep->f_inode;
   fs              = inode->i_private;
@@ -153,6 +153,61 @@ const struct mountpt_operations g_fat_operations =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: fat_contigsectors
+ *
+ * Description:
+ *   Return the number of sectors, up to nsectors, that can be transferred
+ *   with a single request starting at ff_currentsector.  Clusters that
+ *   directly follow the current cluster on the media are merged into the
+ *   run and the last of them is returned in lastcluster.  If extend is
+ *   true, the chain is extended as needed as when writing.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_FAT_FORCE_INDIRECT
+static int fat_contigsectors(FAR struct fat_mountpt_s *fs,
+                             FAR struct fat_file_s *ff,
+                             unsigned int nsectors, bool extend,
+                             FAR uint32_t *lastcluster)
+{
+  unsigned int avail = ff->ff_sectorsincluster;
+  uint32_t current = ff->ff_currentcluster;
+  off_t next;
+
+  while (avail < nsectors)
+    {
+      if (extend)
+        {
+          next = fat_extendchain(fs, current);
+        }
+      else
+        {
+          next = fat_getcluster(fs, current);
+        }
+
+      if (next < 0)
+        {
+          return next;
+        }
+      else if (next != (off_t)current + 1)
+        {
+          /* End of the chain or a fragment boundary.  The caller deals
+           * with the next cluster on its next pass.
+           */
+
+          break;
+        }
+
+      current = next;
+      avail  += fs->fs_fatsecperclus;
+    }
+
+  *lastcluster = current;
+  return avail;
+}
+#endif
+
 /****************************************************************************
  * Name: fat_open
  ****************************************************************************/
@@ -488,7 +543,9 @@ static ssize_t fat_read(FAR struct file *filep, FAR char *buffer,
   int ret;
 
 #ifndef CONFIG_FAT_FORCE_INDIRECT
+  unsigned int clustersectors;
   unsigned int nsectors;
+  uint32_t lastcluster;
   bool force_indirect = false;
 #endif
 
@@ -614,12 +671,20 @@ fat_read_restart:
            *
            * Limit the number of sectors that we read on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and the clusters that follow it on the
+           * media.
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ret = fat_contigsectors(fs, ff, nsectors, false, &lastcluster);
+          if (ret < 0)
             {
-              nsectors = ff->ff_sectorsincluster;
+              goto errout_with_lock;
+            }
+
+          clustersectors = ret;
+          if (nsectors > clustersectors)
+            {
+              nsectors = clustersectors;
             }
 
           /* We are not sure of the state of the file buffer so
@@ -654,7 +719,8 @@ fat_read_restart:
               goto errout_with_lock;
             }
 
-          ff->ff_sectorsincluster -= nsectors;
+          ff->ff_currentcluster    = lastcluster;
+          ff->ff_sectorsincluster  = clustersectors - nsectors;
           ff->ff_currentsector    += nsectors;
           bytesread                = nsectors * fs->fs_hwsectorsize;
         }
@@ -728,7 +794,9 @@ static ssize_t fat_write(FAR struct file *filep, FAR const char *buffer,
   int ret;
 
 #ifndef CONFIG_FAT_FORCE_INDIRECT
+  unsigned int clustersectors;
   unsigned int nsectors;
+  uint32_t lastcluster;
   bool force_indirect = false;
 #endif
 
@@ -865,12 +933,20 @@ fat_write_restart:
            *
            * Limit the number of sectors that we write on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and the clusters that follow it on the
+           * media.
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ret = fat_contigsectors(fs, ff, nsectors, true, &lastcluster);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+
+          clustersectors = ret;
+          if (nsectors > clustersectors)
             {
-              nsectors = ff->ff_sectorsincluster;
+              nsectors = clustersectors;
             }
 
           /* We are not sure of the state of the sector cache so the
@@ -906,7 +982,8 @@ fat_write_restart:
               goto errout_with_lock;
             }
 
-          ff->ff_sectorsincluster -= nsectors;
+          ff->ff_currentcluster    = lastcluster;
+          ff->ff_sectorsincluster  = clustersectors - nsectors;
           ff->ff_currentsector    += nsectors;
           writesize                = nsectors * fs->fs_hwsectorsize;
           ff->ff_bflags           |= FFBUFF_MODIFIED;
@@ -1436,6 +1513,15 @@ static int fat_sync(FAR struct file *filep)
       ret          = fat_updatefsinfo(fs);
     }
 
+#ifdef CONFIG_FAT_PAGECACHE
+  /* Make sure that everything written so far has reached the media */
+
+  if (ret >= 0)
+    {
+      ret = pagecache_flush(&fs->fs_cache);
+    }
+#endif
+
 errout_with_lock:
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -2270,6 +2356,17 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
         }
     }
 
+#ifdef CONFIG_FAT_PAGECACHE
+  /* Write back and release the cached sectors while the block driver is
+   * still open.
+   */
+
+  if (fs->fs_buffer)
+    {
+      pagecache_uninitialize(&fs->fs_cache);
+    }
+
+#endif
   /* Unmount ... close the block driver */
 
   if (fs->fs_blkdriver)
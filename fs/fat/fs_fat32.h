@@ -34,6 +34,7 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/mutex.h>
+#include <nuttx/fs/pagecache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -887,6 +888,9 @@ struct fat_mountpt_s
   uint8_t  fs_fatsecperclus;       /* MBR: Sectors per allocation unit: 2**n, n=0..7 */
   uint8_t *fs_buffer;              /* This is an allocated buffer to hold one
                                     * sector from the device */
+#ifdef CONFIG_FAT_PAGECACHE
+  struct pagecache_s fs_cache;     /* Recently used sectors of the volume */
+#endif
 };
 
 /* This structure represents on open file under the mountpoint.  An instance
@@ -1034,6 +1038,8 @@ EXTERN int    fat_hwread(FAR struct fat_mountpt_s *fs, FAR uint8_t *buffer,
                          off_t sector, unsigned int nsectors);
 EXTERN int    fat_hwwrite(FAR struct fat_mountpt_s *fs, FAR uint8_t *buffer,
                           off_t sector, unsigned int nsectors);
+EXTERN void   fat_hwdiscard(FAR struct fat_mountpt_s *fs, off_t sector,
+                            off_t nsectors);
 
 /* Cluster / cluster chain access helpers */
 
@@ -38,6 +38,7 @@
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/fat.h>
+#include <nuttx/fs/ioctl.h>
 
 #include "inode/inode.h"
 #include "fs_fat32.h"
@@ -263,6 +264,33 @@ static int fat_checkbootrecord(struct fat_mountpt_s *fs)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fat_cachereload and fat_cacheflush
+ *
+ * Description:
+ *   Page cache callouts that transfer sectors between the cache and the
+ *   block driver.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_PAGECACHE
+static ssize_t fat_cachereload(FAR void *dev, FAR uint8_t *buffer,
+                               off_t startpage, size_t npages)
+{
+  FAR struct inode *inode = dev;
+
+  return inode->u.i_bops->read(inode, buffer, startpage, npages);
+}
+
+static ssize_t fat_cacheflush(FAR void *dev, FAR const uint8_t *buffer,
+                              off_t startpage, size_t npages)
+{
+  FAR struct inode *inode = dev;
+
+  return inode->u.i_bops->write(inode, buffer, startpage, npages);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -513,6 +541,27 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
       goto errout;
     }
 
+#ifdef CONFIG_FAT_PAGECACHE
+  /* All sector transfers go through the sector cache from here on */
+
+  fs->fs_cache.pagesize    = fs->fs_hwsectorsize;
+  fs->fs_cache.npages      = fs->fs_hwnsectors;
+  fs->fs_cache.maxpages    = CONFIG_FAT_PAGECACHE_SECTORS;
+  fs->fs_cache.ramaxpages  = CONFIG_FAT_PAGECACHE_READAHEAD;
+  fs->fs_cache.directpages = CONFIG_FAT_PAGECACHE_DIRECT;
+  fs->fs_cache.dev         = inode;
+  fs->fs_cache.reload      = fat_cachereload;
+  fs->fs_cache.flush       = inode->u.i_bops->write ? fat_cacheflush : NULL;
+
+  ret = pagecache_initialize(&fs->fs_cache);
+  if (ret < 0)
+    {
+      fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
+      fs->fs_buffer = NULL;
+      goto errout;
+    }
+#endif
+
   /* Search FAT boot record on the drive.  First check the MBR at sector
    * zero.  This could be either the boot record or a partition that refers
    * to the boot record.
@@ -651,6 +700,10 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   return OK;
 
 errout_with_buffer:
+#ifdef CONFIG_FAT_PAGECACHE
+  pagecache_uninitialize(&fs->fs_cache);
+#endif
+
   fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
   fs->fs_buffer = NULL;
 
@@ -696,7 +749,13 @@ int fat_checkmount(struct fat_mountpt_s *fs)
             }
         }
 
-      /* If we get here, the mount is NOT healthy */
+      /* If we get here, the mount is NOT healthy.  Whatever is still
+       * cached belongs to media that is gone.
+       */
+
+#ifdef CONFIG_FAT_PAGECACHE
+      pagecache_invalidate(&fs->fs_cache, 0, fs->fs_hwnsectors);
+#endif
 
       fs->fs_mounted = false;
     }
@@ -721,8 +780,13 @@ int fat_hwread(struct fat_mountpt_s *fs, uint8_t *buffer,  off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->read)
         {
+#ifdef CONFIG_FAT_PAGECACHE
+          ssize_t nsectorsread = pagecache_read(&fs->fs_cache, buffer,
+                                                sector, nsectors);
+#else
           ssize_t nsectorsread = inode->u.i_bops->read(inode, buffer,
                                                        sector, nsectors);
+#endif
           if (nsectorsread == nsectors)
             {
               ret = OK;
@@ -754,8 +818,13 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->write)
         {
+#ifdef CONFIG_FAT_PAGECACHE
+          ssize_t nsectorswritten =
+              pagecache_write(&fs->fs_cache, buffer, sector, nsectors);
+#else
           ssize_t nsectorswritten =
               inode->u.i_bops->write(inode, buffer, sector, nsectors);
+#endif
 
           if (nsectorswritten == nsectors)
             {
@@ -771,6 +840,30 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
   return ret;
 }
 
+/****************************************************************************
+ * Name: fat_hwdiscard
+ *
+ * Description:
+ *   Tell the block driver that the specified sectors no longer hold data.
+ *   This is only a hint: drivers that do not support it ignore it.
+ *
+ ****************************************************************************/
+
+void fat_hwdiscard(FAR struct fat_mountpt_s *fs, off_t sector,
+                   off_t nsectors)
+{
+  FAR struct inode *inode = fs->fs_blkdriver;
+  blkcnt_t range[2];
+
+  if (nsectors > 0 && inode && inode->u.i_bops && inode->u.i_bops->ioctl)
+    {
+      range[0] = sector;
+      range[1] = nsectors;
+      inode->u.i_bops->ioctl(inode, BIOC_DISCARD,
+                             (unsigned long)((uintptr_t)range));
+    }
+}
+
 /****************************************************************************
  * Name: fat_cluster2sector
  *
@@ -1109,6 +1202,9 @@ int fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno,
 int fat_removechain(struct fat_mountpt_s *fs, uint32_t cluster)
 {
   int32_t nextcluster;
+  off_t  discard = 0;
+  off_t  ndiscard = 0;
+  off_t  sector;
   int    ret;
 
   /* Loop while there are clusters in the chain */
@@ -1141,11 +1237,30 @@ int fat_removechain(struct fat_mountpt_s *fs, uint32_t cluster)
           fs->fs_fsidirty = true;
         }
 
+      /* Discard the sectors of the cluster, merged with those of the
+       * previous clusters if they are contiguous.
+       */
+
+      sector = fat_cluster2sector(fs, cluster);
+      if (ndiscard > 0 && sector != discard + ndiscard)
+        {
+          fat_hwdiscard(fs, discard, ndiscard);
+          ndiscard = 0;
+        }
+
+      if (ndiscard == 0)
+        {
+          discard = sector;
+        }
+
+      ndiscard += fs->fs_fatsecperclus;
+
       /* Then set up to remove the next cluster */
 
       cluster = nextcluster;
     }
 
+  fat_hwdiscard(fs, discard, ndiscard);
   return OK;
 }
 
@@ -1210,9 +1325,26 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
           return startsector;
         }
 
-      /* Okay.. it checks out */
+      /* Okay.. it checks out.  The cluster right after it keeps the file
+       * contiguous, so take it if it is free.  Otherwise resume the search
+       * where the last allocation left off instead of rescanning every
+       * cluster in between.
+       */
 
       startcluster = cluster;
+      if (cluster + 1 < fs->fs_nclusters)
+        {
+          startsector = fat_getcluster(fs, cluster + 1);
+          if (startsector < 0)
+            {
+              return startsector;
+            }
+          else if (startsector != 0 && fs->fs_fsinextfree >= 2 &&
+                   fs->fs_fsinextfree < fs->fs_nclusters)
+            {
+              startcluster = fs->fs_fsinextfree;
+            }
+        }
     }
 
   /* Loop until (1) we discover that there are not free clusters
@@ -51,6 +51,18 @@
 
 #define HOSTFS_RETRY_DELAY_MS       10
 
+/* On the simulator, large transfers can be completed by a host helper
+ * thread so that they do not stall the whole simulation.
+ */
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+#  define hostfs_hostread(fd, buf, len)   sim_hostfs_read(fd, buf, len)
+#  define hostfs_hostwrite(fd, buf, len)  sim_hostfs_write(fd, buf, len)
+#else
+#  define hostfs_hostread(fd, buf, len)   host_read(fd, buf, len)
+#  define hostfs_hostwrite(fd, buf, len)  host_write(fd, buf, len)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -461,7 +473,7 @@ static ssize_t hostfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Call the host to perform the read */
 
-  ret = host_read(hf->fd, buffer, buflen);
+  ret = hostfs_hostread(hf->fd, buffer, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -513,7 +525,7 @@ static ssize_t hostfs_write(FAR struct file *filep, const char *buffer,
 
   /* Call the host to perform the write */
 
-  ret = host_write(hf->fd, buffer, buflen);
+  ret = hostfs_hostwrite(hf->fd, buffer, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -57,7 +57,9 @@
 
 static int files_extend(FAR struct filelist *list, size_t row)
 {
+  FAR struct file **files;
   FAR struct file **tmp;
+  irqstate_t flags;
   int i;
 
   if (row <= list->fl_rows)
@@ -70,7 +72,12 @@ static int files_extend(FAR struct filelist *list, size_t row)
       return -EMFILE;
     }
 
-  tmp = kmm_realloc(list->fl_files, sizeof(FAR struct file *) * row);
+  /* Build the new row array aside instead of reallocating it in place:
+   * fs_getfilep() does not take fl_lock and may still be indexing the
+   * current one.
+   */
+
+  tmp = kmm_malloc(sizeof(FAR struct file *) * row);
   DEBUGASSERT(tmp);
   if (tmp == NULL)
     {
@@ -95,8 +102,19 @@ static int files_extend(FAR struct filelist *list, size_t row)
     }
   while (++i < row);
 
+  if (list->fl_rows > 0)
+    {
+      memcpy(tmp, list->fl_files,
+             sizeof(FAR struct file *) * list->fl_rows);
+    }
+
+  flags = spin_lock_irqsave(&list->fl_spin);
+  files = list->fl_files;
   list->fl_files = tmp;
   list->fl_rows = row;
+  spin_unlock_irqrestore(&list->fl_spin, flags);
+
+  kmm_free(files);
 
   /* Note: If assertion occurs, the fl_rows has a overflow.
    * And there may be file descriptors leak in system.
@@ -153,6 +171,7 @@ void files_initlist(FAR struct filelist *list)
   /* Initialize the list access mutex */
 
   nxmutex_init(&list->fl_lock);
+  spin_initialize(&list->fl_spin, SP_UNLOCKED);
 }
 
 /****************************************************************************
@@ -417,7 +436,8 @@ out:
 int fs_getfilep(int fd, FAR struct file **filep)
 {
   FAR struct filelist *list;
-  int ret;
+  irqstate_t flags;
+  int ret = OK;
 
 #ifdef CONFIG_FDCHECK
   fd = fdcheck_restore(fd);
@@ -439,35 +459,37 @@ int fs_getfilep(int fd, FAR struct file **filep)
       return -EAGAIN;
     }
 
-  if (fd < 0 || fd >= list->fl_rows * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK)
-    {
-      return -EBADF;
-    }
-
-  /* The descriptor is in a valid range to file descriptor... Get the
-   * thread-specific file list.
+  /* This is on the path of every I/O operation, so fl_lock is not taken
+   * here.  The rows of the list are never freed or moved while the list
+   * exists; only the array of row pointers is replaced when the list is
+   * extended, which is done under fl_spin.
    */
 
-  /* And return the file pointer from the list */
+  flags = spin_lock_irqsave_wo_note(&list->fl_spin);
 
-  ret = nxmutex_lock(&list->fl_lock);
-  if (ret < 0)
+  if (fd < 0 || fd >= list->fl_rows * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK)
     {
-      return ret;
+      ret = -EBADF;
     }
+  else
+    {
+      /* The descriptor is in a valid range to file descriptor... return
+       * the file pointer from the list.
+       */
 
-  *filep = &list->fl_files[fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK]
-                          [fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+      *filep = &list->fl_files[fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK]
+                              [fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
 
-  /* if f_inode is NULL, fd was closed */
+      /* if f_inode is NULL, fd was closed */
 
-  if (!(*filep)->f_inode)
-    {
-      *filep = NULL;
-      ret = -EBADF;
+      if (!(*filep)->f_inode)
+        {
+          *filep = NULL;
+          ret = -EBADF;
+        }
     }
 
-  nxmutex_unlock(&list->fl_lock);
+  spin_unlock_irqrestore_wo_note(&list->fl_spin, flags);
   return ret;
 }
 
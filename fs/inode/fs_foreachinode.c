@@ -184,11 +184,11 @@ int foreach_inode(foreach_inode_t handler, FAR void *arg)
 
   /* Start the recursion at the root inode */
 
-  ret = inode_lock();
+  ret = inode_rlock();
   if (ret >= 0)
     {
       ret = foreach_inodelevel(g_root_inode->i_child, info);
-      inode_unlock();
+      inode_runlock();
     }
 
   /* Free the info structure and return the result */
@@ -208,11 +208,11 @@ int foreach_inode(foreach_inode_t handler, FAR void *arg)
 
   /* Start the recursion at the root inode */
 
-  ret = inode_lock();
+  ret = inode_rlock();
   if (ret >= 0)
     {
       ret = foreach_inodelevel(g_root_inode->i_child, &info);
-      inode_unlock();
+      inode_runlock();
     }
 
   return ret;
@@ -29,7 +29,7 @@
 #include <errno.h>
 
 #include <nuttx/fs/fs.h>
-#include <nuttx/mutex.h>
+#include <nuttx/rwsem.h>
 
 #include "inode/inode.h"
 
@@ -45,7 +45,7 @@
  * Private Data
  ****************************************************************************/
 
-static rmutex_t g_inode_lock = NXRMUTEX_INITIALIZER;
+static rw_semaphore_t g_inode_lock = RWSEM_INITIALIZER;
 
 /****************************************************************************
  * Public Functions
@@ -71,13 +71,17 @@ void inode_initialize(void)
  * Name: inode_lock
  *
  * Description:
- *   Get exclusive access to the in-memory inode tree (g_inode_sem).
+ *   Get exclusive access to the in-memory inode tree (g_inode_sem).  This
+ *   must not be called with inode_rlock() held, e.g. from inode_find() or a
+ *   foreach_inode() callback: the caller would wait for itself.  With
+ *   CONFIG_DEBUG_ASSERTIONS, down_write() asserts on that.
  *
  ****************************************************************************/
 
 int inode_lock(void)
 {
-  return nxrmutex_lock(&g_inode_lock);
+  down_write(&g_inode_lock);
+  return OK;
 }
 
 /****************************************************************************
@@ -90,5 +94,34 @@ int inode_lock(void)
 
 void inode_unlock(void)
 {
-  DEBUGVERIFY(nxrmutex_unlock(&g_inode_lock));
+  up_write(&g_inode_lock);
+}
+
+/****************************************************************************
+ * Name: inode_rlock
+ *
+ * Description:
+ *   Get shared, read-only access to the in-memory inode tree.  Any number
+ *   of threads may search the tree concurrently while no thread holds
+ *   inode_lock() or waits for it.  The read lock is not recursive.
+ *
+ ****************************************************************************/
+
+int inode_rlock(void)
+{
+  down_read(&g_inode_lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: inode_runlock
+ *
+ * Description:
+ *   Relinquish shared access to the in-memory inode tree.
+ *
+ ****************************************************************************/
+
+void inode_runlock(void)
+{
+  up_read(&g_inode_lock);
 }
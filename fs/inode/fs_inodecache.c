@@ -0,0 +1,224 @@
+/****************************************************************************
+ * fs/inode/fs_inodecache.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nuttx/spinlock.h>
+#include <nuttx/fs/fs.h>
+
+#include "inode/inode.h"
+
+#ifdef CONFIG_FS_INODE_CACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if (CONFIG_FS_INODE_CACHE_NBUCKETS & \
+     (CONFIG_FS_INODE_CACHE_NBUCKETS - 1)) != 0
+#  error CONFIG_FS_INODE_CACHE_NBUCKETS must be a power of two
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One cached result of looking up a name among the children of 'parent'.
+ * 'node' is NULL for a name that does not exist.  'peer' is the node to
+ * the left of where the name is or would be, as returned in
+ * inode_search_s.
+ */
+
+struct inode_cache_s
+{
+  FAR struct inode *parent;
+  FAR struct inode *node;
+  FAR struct inode *peer;
+  uint32_t hash;
+  uint32_t gen;
+  char name[CONFIG_FS_INODE_CACHE_NAMELEN];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct inode_cache_s g_inode_cache[CONFIG_FS_INODE_CACHE_NBUCKETS];
+static spinlock_t g_inode_cache_lock = SP_UNLOCKED;
+
+/* Every change of the inode tree starts a new generation, which stales all
+ * entries at once.  Entry generation zero is never valid.
+ */
+
+static uint32_t g_inode_cache_gen = 1;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cache_hash
+ *
+ * Description:
+ *   Hash one path segment together with its parent.  Returns the length of
+ *   the segment in 'len'.
+ *
+ ****************************************************************************/
+
+static uint32_t inode_cache_hash(FAR struct inode *parent,
+                                 FAR const char *name, FAR size_t *len)
+{
+  uint32_t hash = 2166136261u ^ (uint32_t)(uintptr_t)parent;
+  size_t i;
+
+  for (i = 0; name[i] != '\0' && name[i] != '/'; i++)
+    {
+      hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+
+  *len = i;
+  return hash;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cache_lookup
+ *
+ * Description:
+ *   Look up the first segment of 'name' among the children of 'parent'
+ *   (NULL for the top level).  On a hit, the node, or NULL if the name is
+ *   known not to exist, and its left peer are returned.
+ *
+ * Assumptions:
+ *   The caller holds the inode tree lock, at least for reading.
+ *
+ ****************************************************************************/
+
+bool inode_cache_lookup(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode **node, FAR struct inode **peer)
+{
+  FAR struct inode_cache_s *entry;
+  irqstate_t flags;
+  uint32_t hash;
+  size_t len;
+  bool hit;
+
+  hash = inode_cache_hash(parent, name, &len);
+  if (len >= CONFIG_FS_INODE_CACHE_NAMELEN)
+    {
+      return false;
+    }
+
+  entry = &g_inode_cache[hash & (CONFIG_FS_INODE_CACHE_NBUCKETS - 1)];
+
+  flags = spin_lock_irqsave(&g_inode_cache_lock);
+  hit = entry->gen == g_inode_cache_gen && entry->hash == hash &&
+        entry->parent == parent && strncmp(entry->name, name, len) == 0 &&
+        entry->name[len] == '\0';
+  if (hit)
+    {
+      *node = entry->node;
+      *peer = entry->peer;
+    }
+
+  spin_unlock_irqrestore(&g_inode_cache_lock, flags);
+  return hit;
+}
+
+/****************************************************************************
+ * Name: inode_cache_add
+ *
+ * Description:
+ *   Remember the result of looking up the first segment of 'name' among
+ *   the children of 'parent'.
+ *
+ * Assumptions:
+ *   The caller holds the inode tree lock, at least for reading.
+ *
+ ****************************************************************************/
+
+void inode_cache_add(FAR struct inode *parent, FAR const char *name,
+                     FAR struct inode *node, FAR struct inode *peer)
+{
+  FAR struct inode_cache_s *entry;
+  irqstate_t flags;
+  uint32_t hash;
+  size_t len;
+
+  hash = inode_cache_hash(parent, name, &len);
+  if (len >= CONFIG_FS_INODE_CACHE_NAMELEN)
+    {
+      return;
+    }
+
+  entry = &g_inode_cache[hash & (CONFIG_FS_INODE_CACHE_NBUCKETS - 1)];
+
+  flags = spin_lock_irqsave(&g_inode_cache_lock);
+  entry->parent = parent;
+  entry->node   = node;
+  entry->peer   = peer;
+  entry->hash   = hash;
+  entry->gen    = g_inode_cache_gen;
+  memcpy(entry->name, name, len);
+  entry->name[len] = '\0';
+  spin_unlock_irqrestore(&g_inode_cache_lock, flags);
+}
+
+/****************************************************************************
+ * Name: inode_cache_invalidate
+ *
+ * Description:
+ *   Forget all cached lookups.  Called whenever an inode is linked into or
+ *   unlinked from the tree, which covers registration, removal, rename,
+ *   mount and unmount.
+ *
+ * Assumptions:
+ *   The caller holds the inode tree lock for writing.
+ *
+ ****************************************************************************/
+
+void inode_cache_invalidate(void)
+{
+  irqstate_t flags;
+
+  flags = spin_lock_irqsave(&g_inode_cache_lock);
+  if (++g_inode_cache_gen == 0)
+    {
+      /* Wrapped around, make sure that no old entry looks current */
+
+      memset(g_inode_cache, 0, sizeof(g_inode_cache));
+      g_inode_cache_gen = 1;
+    }
+
+  spin_unlock_irqrestore(&g_inode_cache_lock, flags);
+}
+
+#endif /* CONFIG_FS_INODE_CACHE */
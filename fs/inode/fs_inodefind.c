@@ -28,6 +28,7 @@
 #include <errno.h>
 
 #include <nuttx/fs/fs.h>
+#include <nuttx/spinlock.h>
 
 #include "inode/inode.h"
 
@@ -55,7 +56,7 @@ int inode_find(FAR struct inode_search_s *desc)
    * references on the node.
    */
 
-  ret = inode_lock();
+  ret = inode_rlock();
   if (ret < 0)
     {
       return ret;
@@ -67,13 +68,20 @@ int inode_find(FAR struct inode_search_s *desc)
       /* Found it */
 
       FAR struct inode *node = desc->node;
+      irqstate_t flags;
+
       DEBUGASSERT(node != NULL);
 
-      /* Increment the reference count on the inode */
+      /* Increment the reference count on the inode.  Other readers may be
+       * doing the same, so this must be atomic.  Reference counts are only
+       * decremented with the inode tree locked exclusively.
+       */
 
+      flags = spin_lock_irqsave(NULL);
       node->i_crefs++;
+      spin_unlock_irqrestore(NULL, flags);
     }
 
-  inode_unlock();
+  inode_runlock();
   return ret;
 }
@@ -77,6 +77,10 @@ FAR struct inode *inode_unlink(FAR const char *path)
       node = desc.node;
       DEBUGASSERT(node != NULL);
 
+      /* Cached lookups must not find the node anymore */
+
+      inode_cache_invalidate();
+
       /* If peer is non-null, then remove the node from the right of
        * of that peer node.
        */
@@ -105,6 +105,10 @@ static void inode_insert(FAR struct inode *node,
                          FAR struct inode *peer,
                          FAR struct inode *parent)
 {
+  /* Cached lookups below 'parent', found or not, may change */
+
+  inode_cache_invalidate();
+
   /* If peer is non-null, then new node simply goes to the right
    * of that peer node.
    */
@@ -223,6 +223,8 @@ static int _inode_search(FAR struct inode_search_s *desc)
   FAR struct inode *left    = NULL;
   FAR struct inode *above   = NULL;
   FAR const char   *relpath = NULL;
+  bool lookup  = true;  /* At the first node of a level */
+  bool scanned = false; /* The level was searched node by node */
   int ret = -ENOENT;
 
   /* Get the search path, skipping over the leading '/'.  The leading '/' is
@@ -244,7 +246,31 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
   while (node != NULL)
     {
-      int result = _inode_compare(name, node);
+      int result;
+
+      /* Try the cache before comparing the names in this level one by
+       * one.
+       */
+
+      if (lookup)
+        {
+          FAR struct inode *cached;
+
+          lookup  = false;
+          scanned = !inode_cache_lookup(above, name, &cached, &left);
+          if (!scanned)
+            {
+              node = cached;
+              if (node == NULL)
+                {
+                  /* The name is known not to exist */
+
+                  break;
+                }
+            }
+        }
+
+      result = scanned ? _inode_compare(name, node) : 0;
 
       /* Case 1:  The name is less than the name of the node.
        * Since the names are ordered, these means that there
@@ -275,6 +301,11 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
       else
         {
+          if (scanned)
+            {
+              inode_cache_add(above, name, node, left);
+            }
+
           /* Now there are three remaining possibilities:
            *   (1) This is the node that we are looking for.
            *   (2) The node we are looking for is "below" this one.
@@ -386,13 +417,22 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
               /* Keep looking at the next level "down" */
 
-              above = node;
-              left  = NULL;
-              node  = node->i_child;
+              above   = node;
+              left    = NULL;
+              node    = node->i_child;
+              lookup  = true;
+              scanned = false;
             }
         }
     }
 
+  /* Remember a name that was not found among its peers */
+
+  if (node == NULL && scanned)
+    {
+      inode_cache_add(above, name, NULL, left);
+    }
+
   /* The node may or may not be null as per one of the following four cases:
    *
    * With node = NULL
@@ -167,6 +167,26 @@ int inode_lock(void);
 
 void inode_unlock(void);
 
+/****************************************************************************
+ * Name: inode_rlock
+ *
+ * Description:
+ *   Get shared, read-only access to the in-memory inode tree.
+ *
+ ****************************************************************************/
+
+int inode_rlock(void);
+
+/****************************************************************************
+ * Name: inode_runlock
+ *
+ * Description:
+ *   Relinquish shared access to the in-memory inode tree.
+ *
+ ****************************************************************************/
+
+void inode_runlock(void);
+
 /****************************************************************************
  * Name: inode_checkflags
  *
@@ -203,6 +223,28 @@ int inode_checkflags(FAR struct inode *inode, int oflags);
 
 int inode_search(FAR struct inode_search_s *desc);
 
+/****************************************************************************
+ * Name: inode_cache_lookup, inode_cache_add and inode_cache_invalidate
+ *
+ * Description:
+ *   Hashed cache of path segment lookups used by inode_search().  Both
+ *   found and missing names are cached.  Any change of the inode tree
+ *   invalidates the whole cache.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODE_CACHE
+bool inode_cache_lookup(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode **node, FAR struct inode **peer);
+void inode_cache_add(FAR struct inode *parent, FAR const char *name,
+                     FAR struct inode *node, FAR struct inode *peer);
+void inode_cache_invalidate(void);
+#else
+#  define inode_cache_lookup(parent, name, node, peer) ((void)(node), false)
+#  define inode_cache_add(parent, name, node, peer)
+#  define inode_cache_invalidate()
+#endif
+
 /****************************************************************************
  * Name: inode_find
  *
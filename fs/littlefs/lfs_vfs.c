@@ -24,12 +24,17 @@
 
 #include <nuttx/config.h>
 
+#include <ctype.h>
+#include <debug.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <nuttx/fs/fs.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/lib/lib.h>
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/mutex.h>
 
@@ -47,6 +52,11 @@
 #  error littlefs requires CONFIG_C99_BOOL to be selected
 #endif
 
+#if CONFIG_FS_LITTLEFS_STAT_CACHE == 0
+#  define littlefs_stat_forget(fs, hash)
+#  define littlefs_stat_flush(fs)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -61,7 +71,27 @@ struct littlefs_file_s
 {
   struct lfs_file       file;
   int                   refs;
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  uint32_t              hash;   /* Hash of the path, see littlefs_stat_s */
+#endif
+};
+
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+/* One cached result of lfs_stat(): the type and size of a path, or that it
+ * does not exist (result is -ENOENT).  An entry is forgotten when the file
+ * is created, written or truncated, and all are forgotten when something
+ * is removed or renamed.  Unused entries have an empty path.
+ */
+
+struct littlefs_stat_s
+{
+  uint32_t              hash;
+  int                   result;
+  uint8_t               type;
+  lfs_size_t            size;
+  char                  path[CONFIG_FS_LITTLEFS_STAT_CACHE_PATHLEN];
 };
+#endif
 
 /* This structure represents the overall mountpoint state. An instance of
  * this structure is retained as inode private data on each mountpoint that
@@ -75,6 +105,10 @@ struct littlefs_mountpt_s
   struct mtd_geometry_s geo;
   struct lfs_config     cfg;
   struct lfs            lfs;
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  struct littlefs_stat_s stats[CONFIG_FS_LITTLEFS_STAT_CACHE];
+  unsigned int          nextstat; /* Next entry to replace */
+#endif
 };
 
 /****************************************************************************
@@ -274,6 +308,125 @@ static int littlefs_convert_oflags(int oflags)
   return ret;
 }
 
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+/****************************************************************************
+ * Name: littlefs_stat_hash
+ ****************************************************************************/
+
+static uint32_t littlefs_stat_hash(FAR const char *path)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*path != '\0')
+    {
+      hash = (hash ^ (uint8_t)*path++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_find
+ *
+ * Description: Return the cached lfs_stat() result of a path, or NULL.
+ *   The caller holds the mountpoint lock.
+ *
+ ****************************************************************************/
+
+static FAR struct littlefs_stat_s *
+littlefs_stat_find(FAR struct littlefs_mountpt_s *fs, FAR const char *path,
+                   uint32_t hash)
+{
+  FAR struct littlefs_stat_s *entry;
+  int i;
+
+  for (i = 0; i < CONFIG_FS_LITTLEFS_STAT_CACHE; i++)
+    {
+      entry = &fs->stats[i];
+      if (entry->hash == hash && entry->path[0] != '\0' &&
+          strcmp(entry->path, path) == 0)
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_add
+ *
+ * Description: Remember the lfs_stat() result of a path.  The caller holds
+ *   the mountpoint lock.
+ *
+ ****************************************************************************/
+
+static void littlefs_stat_add(FAR struct littlefs_mountpt_s *fs,
+                              FAR const char *path, uint32_t hash,
+                              int result, FAR const struct lfs_info *info)
+{
+  FAR struct littlefs_stat_s *entry;
+
+  if (strlen(path) >= CONFIG_FS_LITTLEFS_STAT_CACHE_PATHLEN)
+    {
+      return;
+    }
+
+  entry = littlefs_stat_find(fs, path, hash);
+  if (entry == NULL)
+    {
+      entry = &fs->stats[fs->nextstat];
+      fs->nextstat = (fs->nextstat + 1) % CONFIG_FS_LITTLEFS_STAT_CACHE;
+    }
+
+  entry->hash   = hash;
+  entry->result = result;
+  entry->type   = info != NULL ? info->type : 0;
+  entry->size   = info != NULL ? info->size : 0;
+  strlcpy(entry->path, path, sizeof(entry->path));
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_forget
+ *
+ * Description: Forget the cached lfs_stat() result of the path with this
+ *   hash.  The caller holds the mountpoint lock.
+ *
+ ****************************************************************************/
+
+static void littlefs_stat_forget(FAR struct littlefs_mountpt_s *fs,
+                                 uint32_t hash)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_LITTLEFS_STAT_CACHE; i++)
+    {
+      if (fs->stats[i].hash == hash)
+        {
+          fs->stats[i].path[0] = '\0';
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_flush
+ *
+ * Description: Forget all cached lfs_stat() results.  The caller holds the
+ *   mountpoint lock.
+ *
+ ****************************************************************************/
+
+static void littlefs_stat_flush(FAR struct littlefs_mountpt_s *fs)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_LITTLEFS_STAT_CACHE; i++)
+    {
+      fs->stats[i].path[0] = '\0';
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: littlefs_open
  ****************************************************************************/
@@ -311,6 +464,25 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
       goto errlock;
     }
 
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  /* A file that is known not to exist cannot be opened without O_CREAT,
+   * and there is no need to search the directory for it.
+   */
+
+  priv->hash = littlefs_stat_hash(relpath);
+  if ((oflags & O_CREAT) == 0)
+    {
+      FAR struct littlefs_stat_s *entry;
+
+      entry = littlefs_stat_find(fs, relpath, priv->hash);
+      if (entry != NULL && entry->result == -ENOENT)
+        {
+          ret = -ENOENT;
+          goto errout;
+        }
+    }
+#endif
+
   /* Try to open the file */
 
   oflags = littlefs_convert_oflags(oflags);
@@ -320,9 +492,21 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
     {
       /* Error opening file */
 
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+      if (ret == -ENOENT)
+        {
+          littlefs_stat_add(fs, relpath, priv->hash, ret, NULL);
+        }
+#endif
+
       goto errout;
     }
 
+  if (oflags & (LFS_O_CREAT | LFS_O_TRUNC))
+    {
+      littlefs_stat_forget(fs, priv->hash);
+    }
+
   /* In append mode, we need to set the file pointer to the end of the
    * file.
    */
@@ -390,6 +574,7 @@ static int littlefs_close(FAR struct file *filep)
   if (--priv->refs <= 0)
     {
       ret = littlefs_convert_result(lfs_file_close(&fs->lfs, &priv->file));
+      littlefs_stat_forget(fs, priv->hash);
     }
 
   nxmutex_unlock(&fs->lock);
@@ -494,6 +679,8 @@ static ssize_t littlefs_write(FAR struct file *filep, const char *buffer,
       filep->f_pos += ret;
     }
 
+  littlefs_stat_forget(fs, priv->hash);
+
 out:
   nxmutex_unlock(&fs->lock);
   return ret;
@@ -596,6 +783,7 @@ static int littlefs_sync(FAR struct file *filep)
     }
 
   ret = littlefs_convert_result(lfs_file_sync(&fs->lfs, &priv->file));
+  littlefs_stat_forget(fs, priv->hash);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -713,6 +901,7 @@ static int littlefs_truncate(FAR struct file *filep, off_t length)
 
   ret = littlefs_convert_result(lfs_file_truncate(&fs->lfs, &priv->file,
                                                   length));
+  littlefs_stat_forget(fs, priv->hash);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -914,6 +1103,10 @@ static int littlefs_read_block(FAR const struct lfs_config *c,
   block = (block * c->block_size + off) / geo->blocksize;
   size  = size / geo->blocksize;
 
+  /* littlefs passes whole cache lines or, for large file reads, everything
+   * up to the end of the block at once, so this is a single transfer.
+   */
+
   if (INODE_IS_MTD(drv))
     {
       ret = MTD_BREAD(drv->u.i_mtd, block, size, buffer);
@@ -923,7 +1116,12 @@ static int littlefs_read_block(FAR const struct lfs_config *c,
       ret = drv->u.i_bops->read(drv, buffer, block, size);
     }
 
-  return ret >= 0 ? OK : ret;
+  if (ret == -EUCLEAN)
+    {
+      ret = size;
+    }
+
+  return ret == (int)size ? OK : ret < 0 ? ret : -EIO;
 }
 
 /****************************************************************************
@@ -951,7 +1149,7 @@ static int littlefs_write_block(FAR const struct lfs_config *c,
       ret = drv->u.i_bops->write(drv, buffer, block, size);
     }
 
-  return ret >= 0 ? OK : ret;
+  return ret == (int)size ? OK : ret < 0 ? ret : -EIO;
 }
 
 /****************************************************************************
@@ -1006,6 +1204,149 @@ static int littlefs_sync_block(FAR const struct lfs_config *c)
   return ret == -ENOTTY ? OK : ret;
 }
 
+/****************************************************************************
+ * Name: littlefs_parse_size
+ *
+ * Description: Parse the value of a size mount option.  The whole string
+ *   must be an unsigned number.
+ *
+ ****************************************************************************/
+
+static int littlefs_parse_size(FAR const char *str, FAR lfs_size_t *size)
+{
+  FAR char *endptr;
+  unsigned long value;
+
+  value = strtoul(str, &endptr, 0);
+  if (!isdigit(*str) || *endptr != '\0' || value > UINT32_MAX)
+    {
+      return -EINVAL;
+    }
+
+  *size = value;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: littlefs_parse_options
+ *
+ * Description: Parse the mount options, a comma separated list of:
+ *   "forceformat" or "autoformat", see littlefs_bind()
+ *   "read_size=N", "prog_size=N", "cache_size=N", "lookahead_size=N" and
+ *   "block_cycles=N", which override the corresponding Kconfig values for
+ *   this mount.  Sizes are in bytes.
+ *
+ ****************************************************************************/
+
+static int littlefs_parse_options(FAR struct littlefs_mountpt_s *fs,
+                                  FAR const char *data,
+                                  FAR bool *forceformat,
+                                  FAR bool *autoformat)
+{
+  FAR struct lfs_config *cfg = &fs->cfg;
+  FAR char *saveptr;
+  FAR char *options;
+  FAR char *ptr;
+  int ret = OK;
+
+  *forceformat = false;
+  *autoformat  = false;
+
+  if (data == NULL)
+    {
+      return OK;
+    }
+
+  options = strdup(data);
+  if (options == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ptr = strtok_r(options, ",", &saveptr);
+  while (ptr != NULL)
+    {
+      if (strcmp(ptr, "forceformat") == 0)
+        {
+          *forceformat = true;
+        }
+      else if (strcmp(ptr, "autoformat") == 0)
+        {
+          *autoformat = true;
+        }
+      else if (strncmp(ptr, "read_size=", 10) == 0)
+        {
+          ret = littlefs_parse_size(&ptr[10], &cfg->read_size);
+        }
+      else if (strncmp(ptr, "prog_size=", 10) == 0)
+        {
+          ret = littlefs_parse_size(&ptr[10], &cfg->prog_size);
+        }
+      else if (strncmp(ptr, "cache_size=", 11) == 0)
+        {
+          ret = littlefs_parse_size(&ptr[11], &cfg->cache_size);
+        }
+      else if (strncmp(ptr, "lookahead_size=", 15) == 0)
+        {
+          ret = littlefs_parse_size(&ptr[15], &cfg->lookahead_size);
+        }
+      else if (strncmp(ptr, "block_cycles=", 13) == 0)
+        {
+          FAR char *endptr;
+
+          /* -1 disables wear leveling, zero is not allowed */
+
+          cfg->block_cycles = strtol(&ptr[13], &endptr, 0);
+          if (endptr == &ptr[13] || *endptr != '\0' ||
+              cfg->block_cycles == 0)
+            {
+              ret = -EINVAL;
+            }
+        }
+      else
+        {
+          ferr("ERROR: Unknown option: %s\n", ptr);
+          ret = -EINVAL;
+          break;
+        }
+
+      if (ret < 0)
+        {
+          ferr("ERROR: Invalid option: %s\n", ptr);
+          break;
+        }
+
+      ptr = strtok_r(NULL, ",", &saveptr);
+    }
+
+  lib_free(options);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* The driver transfers whole blocks, and littlefs needs the cache size
+   * to be a multiple of the read and program sizes and a factor of the
+   * block size.
+   */
+
+  if (cfg->read_size == 0 || cfg->read_size % fs->geo.blocksize != 0 ||
+      cfg->prog_size == 0 || cfg->prog_size % fs->geo.blocksize != 0 ||
+      cfg->cache_size == 0 || cfg->cache_size % cfg->read_size != 0 ||
+      cfg->cache_size % cfg->prog_size != 0 ||
+      cfg->block_size % cfg->cache_size != 0 ||
+      cfg->lookahead_size == 0 || cfg->lookahead_size % 8 != 0)
+    {
+      ferr("ERROR: Invalid sizes: read %" PRIu32 " prog %" PRIu32
+           " cache %" PRIu32 " lookahead %" PRIu32 "\n",
+           cfg->read_size, cfg->prog_size, cfg->cache_size,
+           cfg->lookahead_size);
+      return -EINVAL;
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: littlefs_bind
  ****************************************************************************/
@@ -1014,6 +1355,8 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
                          FAR void **handle)
 {
   FAR struct littlefs_mountpt_s *fs;
+  bool forceformat;
+  bool autoformat;
   int ret;
 
   /* Open the block driver */
@@ -1114,13 +1457,21 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
   fs->cfg.lookahead_size = CONFIG_FS_LITTLEFS_LOOKAHEAD_SIZE;
 #endif
 
+  /* The mount options may override the sizes */
+
+  ret = littlefs_parse_options(fs, data, &forceformat, &autoformat);
+  if (ret < 0)
+    {
+      goto errout_with_fs;
+    }
+
   /* Then get information about the littlefs filesystem on the devices
    * managed by this driver.
    */
 
   /* Force format the device if -o forceformat */
 
-  if (data && strcmp(data, "forceformat") == 0)
+  if (forceformat)
     {
       ret = littlefs_convert_result(lfs_format(&fs->lfs, &fs->cfg));
       if (ret < 0)
@@ -1134,7 +1485,7 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
     {
       /* Auto format the device if -o autoformat */
 
-      if (ret != -EFAULT || !data || strcmp(data, "autoformat"))
+      if (ret != -EFAULT || !autoformat)
         {
           goto errout_with_fs;
         }
@@ -1294,6 +1645,7 @@ static int littlefs_unlink(FAR struct inode *mountpt,
     }
 
   ret = littlefs_convert_result(lfs_remove(&fs->lfs, relpath));
+  littlefs_stat_flush(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1325,6 +1677,9 @@ static int littlefs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
     }
 
   ret = lfs_mkdir(&fs->lfs, relpath);
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  littlefs_stat_forget(fs, littlefs_stat_hash(relpath));
+#endif
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1386,6 +1741,7 @@ static int littlefs_rename(FAR struct inode *mountpt,
 
   ret = littlefs_convert_result(lfs_rename(&fs->lfs, oldrelpath,
                                            newrelpath));
+  littlefs_stat_flush(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1403,6 +1759,10 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 {
   FAR struct littlefs_mountpt_s *fs;
   struct lfs_info info;
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  FAR struct littlefs_stat_s *entry;
+  uint32_t hash;
+#endif
   int ret;
 
   memset(buf, 0, sizeof(*buf));
@@ -1419,7 +1779,30 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+#if CONFIG_FS_LITTLEFS_STAT_CACHE > 0
+  /* The cached result avoids searching the directories of the path */
+
+  hash  = littlefs_stat_hash(relpath);
+  entry = littlefs_stat_find(fs, relpath, hash);
+  if (entry != NULL)
+    {
+      ret       = entry->result;
+      info.type = entry->type;
+      info.size = entry->size;
+    }
+  else
+    {
+      ret = littlefs_convert_result(lfs_stat(&fs->lfs, relpath, &info));
+      if (ret >= 0 || ret == -ENOENT)
+        {
+          littlefs_stat_add(fs, relpath, hash, ret,
+                            ret >= 0 ? &info : NULL);
+        }
+    }
+#else
   ret = lfs_stat(&fs->lfs, relpath, &info);
+#endif
+
   nxmutex_unlock(&fs->lock);
 
   if (ret >= 0)
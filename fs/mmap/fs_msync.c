@@ -0,0 +1,137 @@
+/****************************************************************************
+ * fs/mmap/fs_msync.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/mm/map.h>
+
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "inode/inode.h"
+#include "fs_rammap.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int file_msync_(FAR void *start, size_t length, int flags)
+{
+  FAR struct mm_map_s *mm = get_current_mm();
+  FAR struct mm_map_entry_s *entry;
+  uintptr_t end;
+  int ret;
+
+  if ((flags & ~(MS_ASYNC | MS_SYNC | MS_INVALIDATE)) != 0 ||
+      (flags & (MS_ASYNC | MS_SYNC)) == (MS_ASYNC | MS_SYNC))
+    {
+      return -EINVAL;
+    }
+
+  ret = mm_map_lock();
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Synchronize each mapping that overlaps the range */
+
+  end = (uintptr_t)start + length;
+  while (length > 0)
+    {
+      uintptr_t mapend;
+      size_t nbytes;
+
+      entry = mm_map_find(mm, start, 1);
+      if (entry == NULL)
+        {
+          /* Part of the range is not mapped */
+
+          ret = -ENOMEM;
+          break;
+        }
+
+      mapend = (uintptr_t)entry->vaddr + entry->length;
+      nbytes = (mapend < end ? mapend : end) - (uintptr_t)start;
+
+      ret = rammap_msync(entry, start, nbytes, flags);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      start   = (FAR uint8_t *)start + nbytes;
+      length -= nbytes;
+    }
+
+  mm_map_unlock();
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: msync
+ *
+ * Description:
+ *   msync() flushes the changes made to a MAP_SHARED file mapping back to
+ *   the file.  Mappings provided directly by a driver or file system need
+ *   no synchronization; the in-memory copies made by CONFIG_FS_RAMMAP are
+ *   written back to the file here and when the last mapping of the copy is
+ *   removed.
+ *
+ * Input Parameters:
+ *   start   The start address of the range to synchronize
+ *   length  The length of the range
+ *   flags   MS_SYNC to wait for the file to reach the storage, MS_ASYNC to
+ *           only schedule it.  MS_INVALIDATE is accepted and has no effect
+ *           since all mappings of a file share the same copy.
+ *
+ * Returned Value:
+ *   On success, msync() returns 0, on failure -1, and errno is set:
+ *
+ *     EINVAL
+ *       'flags' is invalid
+ *     ENOMEM
+ *       Part of the range is not mapped
+ *
+ ****************************************************************************/
+
+int msync(FAR void *start, size_t length, int flags)
+{
+  int ret;
+
+  ret = file_msync_(start, length, flags);
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      ret = ERROR;
+    }
+
+  return ret;
+}
@@ -24,15 +24,21 @@
 
 #include <nuttx/config.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
 
 #include <assert.h>
 #include <debug.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <nuttx/fs/fs.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
 #include <nuttx/sched.h>
 
 #include "fs_rammap.h"
@@ -40,13 +46,492 @@
 #ifdef CONFIG_FS_RAMMAP
 
 /****************************************************************************
- * Public Data
+ * Private Types
  ****************************************************************************/
 
+/* The in-memory copy behind MAP_SHARED mappings.  All shared mappings of
+ * the same range of the same file use one region, so that they see each
+ * other's changes.  A region is written back to the file by msync() and
+ * when the last mapping goes away.
+ *
+ * Without an MMU, stores to the copy cannot be trapped.  Writable regions
+ * therefore keep a snapshot of the copy as last read from or written to
+ * the file, and only the bytes that differ from it are written back.  The
+ * rest of the file may have been changed by write() in the meantime.
+ *
+ * With CONFIG_BUILD_KERNEL, user memory is private to each address space,
+ * so a region in user memory is only shared within its own address space.
+ */
+
+struct rammap_region_s
+{
+  sq_entry_t node;        /* Link in g_rammap_regions */
+  FAR uint8_t *vaddr;     /* The in-memory copy */
+  FAR uint8_t *clean;     /* Snapshot of the copy, if writing back */
+#ifdef CONFIG_BUILD_KERNEL
+  FAR struct mm_map_s *mm; /* Address space of user memory */
+#endif
+  size_t length;          /* Size of the copy */
+  size_t valid;           /* Bytes of the copy that are backed by the file */
+  off_t offset;           /* File offset of the copy */
+  FAR char *path;         /* Path of the file, NULL if unknown */
+  unsigned int crefs;     /* Number of mappings */
+  bool kernel;            /* Allocated with kmm_malloc() */
+  bool writeback;         /* Changes are written back to 'file' */
+  struct file file;       /* Reference to the file for the write-back */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static sq_queue_t g_rammap_regions;
+static mutex_t g_rammap_lock = NXMUTEX_INITIALIZER;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: rammap_read
+ *
+ * Description:
+ *   Read 'length' bytes at 'offset' of the file into 'buffer', zero filling
+ *   beyond the end of the file.  Returns the number of bytes read from the
+ *   file.
+ *
+ ****************************************************************************/
+
+static ssize_t rammap_read(FAR struct file *filep, off_t offset,
+                           FAR uint8_t *buffer, size_t length)
+{
+  ssize_t nread;
+  size_t total = 0;
+  off_t fpos;
+
+  /* Seek to the specified file offset */
+
+  fpos = file_seek(filep, offset, SEEK_SET);
+  if (fpos < 0)
+    {
+      /* Seek failed... errno has already been set, but EINVAL is probably
+       * the correct response.
+       */
+
+      ferr("ERROR: Seek to position %zu failed\n", (size_t)offset);
+      return fpos;
+    }
+
+  /* Read the file data into the memory region */
+
+  while (length > 0)
+    {
+      nread = file_read(filep, buffer, length);
+      if (nread < 0)
+        {
+          /* Handle the special case where the read was interrupted by a
+           * signal.
+           */
+
+          if (nread != -EINTR)
+            {
+              /* All other read errors are bad. */
+
+              ferr("ERROR: Read failed: offset=%zu ret=%zd\n",
+                   (size_t)offset, nread);
+              return nread;
+            }
+
+          continue;
+        }
+
+      /* Check for end of file. */
+
+      if (nread == 0)
+        {
+          break;
+        }
+
+      /* Increment number of bytes read */
+
+      buffer += nread;
+      length -= nread;
+      total  += nread;
+    }
+
+  /* Zero any memory beyond the amount read from the file */
+
+  memset(buffer, 0, length);
+  return total;
+}
+
+/****************************************************************************
+ * Name: rammap_write
+ *
+ * Description:
+ *   Write 'length' bytes at 'start' (relative to the region) back to the
+ *   file and record them in the snapshot.
+ *
+ ****************************************************************************/
+
+static int rammap_write(FAR struct rammap_region_s *region,
+                        size_t start, size_t length)
+{
+  ssize_t nwritten;
+
+  while (length > 0)
+    {
+      nwritten = file_pwrite(&region->file, region->vaddr + start, length,
+                             region->offset + start);
+      if (nwritten < 0)
+        {
+          if (nwritten == -EINTR)
+            {
+              continue;
+            }
+
+          ferr("ERROR: Write back failed: offset=%zu ret=%zd\n",
+               (size_t)(region->offset + start), nwritten);
+          return nwritten;
+        }
+
+      memcpy(region->clean + start, region->vaddr + start, nwritten);
+      start  += nwritten;
+      length -= nwritten;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rammap_writeback
+ *
+ * Description:
+ *   Write the bytes of a shared region between 'start' and
+ *   'start + length' (relative to the region) that differ from the
+ *   snapshot back to the file.
+ *
+ ****************************************************************************/
+
+static int rammap_writeback(FAR struct rammap_region_s *region,
+                            size_t start, size_t length, bool sync)
+{
+  size_t dirty;
+  size_t end;
+  int ret;
+
+  if (!region->writeback || start >= region->valid)
+    {
+      return OK;
+    }
+
+  /* Never extend the file, only the part that existed when it was mapped
+   * is written.
+   */
+
+  end = length > region->valid - start ? region->valid : start + length;
+
+  while (start < end)
+    {
+      /* Find the next run of modified bytes */
+
+      while (start < end && region->vaddr[start] == region->clean[start])
+        {
+          start++;
+        }
+
+      dirty = start;
+      while (dirty < end && region->vaddr[dirty] != region->clean[dirty])
+        {
+          dirty++;
+        }
+
+      if (dirty > start)
+        {
+          ret = rammap_write(region, start, dirty - start);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      start = dirty;
+    }
+
+  return sync ? file_fsync(&region->file) : OK;
+}
+
+/****************************************************************************
+ * Name: rammap_startwriteback
+ *
+ * Description:
+ *   Take the file of the first writable mapping of a region for the
+ *   write-back.  The copy as it is now is the snapshot that later changes
+ *   are compared with.
+ *
+ ****************************************************************************/
+
+static int rammap_startwriteback(FAR struct rammap_region_s *region,
+                                 FAR struct file *filep)
+{
+  int ret;
+
+  region->clean = kmm_malloc(region->valid > 0 ? region->valid : 1);
+  if (region->clean == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ret = file_dup2(filep, &region->file);
+  if (ret < 0)
+    {
+      kmm_free(region->clean);
+      region->clean = NULL;
+      return ret;
+    }
+
+  memcpy(region->clean, region->vaddr, region->valid);
+  region->writeback = true;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rammap_release
+ *
+ * Description:
+ *   Drop one mapping of a shared region, writing it back and freeing it
+ *   with the last one.
+ *
+ ****************************************************************************/
+
+static void rammap_release(FAR struct rammap_region_s *region)
+{
+  nxmutex_lock(&g_rammap_lock);
+  if (--region->crefs > 0)
+    {
+      nxmutex_unlock(&g_rammap_lock);
+      return;
+    }
+
+  sq_rem(&region->node, &g_rammap_regions);
+  nxmutex_unlock(&g_rammap_lock);
+
+  rammap_writeback(region, 0, region->length, false);
+  if (region->writeback)
+    {
+      file_close(&region->file);
+      kmm_free(region->clean);
+    }
+
+  if (region->kernel)
+    {
+      kmm_free(region->vaddr);
+    }
+  else
+    {
+      kumm_free(region->vaddr);
+    }
+
+  kmm_free(region->path);
+  kmm_free(region);
+}
+
+/****************************************************************************
+ * Name: unmap_sharedmap
+ *
+ * Description:
+ *   Unmap a MAP_SHARED mapping.  The memory is shared with other mappings,
+ *   so unmapping the end of a mapping only shortens it; the memory stays
+ *   allocated until the whole region is unmapped.
+ *
+ ****************************************************************************/
+
+static int unmap_sharedmap(FAR struct task_group_s *group,
+                           FAR struct mm_map_entry_s *entry,
+                           FAR void *start,
+                           size_t length)
+{
+  FAR struct rammap_region_s *region = entry->priv.p;
+  off_t offset;
+  int ret;
+
+  offset = (uintptr_t)start - (uintptr_t)entry->vaddr;
+  if (offset + length < entry->length)
+    {
+      ferr("ERROR: Cannot umap without unmapping to the end\n");
+      return -ENOSYS;
+    }
+
+  if (offset > 0)
+    {
+      entry->length = offset;
+      return OK;
+    }
+
+  ret = mm_map_remove(get_group_mm(group), entry);
+  rammap_release(region);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: rammap_shared
+ *
+ * Description:
+ *   Set up a MAP_SHARED mapping, reusing the region of an earlier mapping
+ *   of the same range of the same file if there is one.
+ *
+ ****************************************************************************/
+
+static int rammap_shared(FAR struct file *filep,
+                         FAR struct mm_map_entry_s *entry, bool kernel)
+{
+  FAR struct rammap_region_s *region;
+  FAR char *path;
+  bool writeback;
+  ssize_t nread;
+  int ret;
+
+  writeback = (entry->prot & PROT_WRITE) != 0 &&
+              (filep->f_oflags & O_WROK) != 0;
+
+  /* The path identifies the file.  Without one the region is not shared
+   * with other file descriptors.
+   */
+
+  path = kmm_malloc(PATH_MAX);
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  if (file_ioctl(filep, FIOC_FILEPATH, (unsigned long)(uintptr_t)path) < 0)
+    {
+      kmm_free(path);
+      path = NULL;
+    }
+
+  ret = nxmutex_lock(&g_rammap_lock);
+  if (ret < 0)
+    {
+      goto errout_with_path;
+    }
+
+  for (region = (FAR struct rammap_region_s *)sq_peek(&g_rammap_regions);
+       region != NULL;
+       region = (FAR struct rammap_region_s *)sq_next(&region->node))
+    {
+      if (path != NULL && region->path != NULL &&
+          region->offset == entry->offset &&
+          region->length == entry->length && region->kernel == kernel &&
+#ifdef CONFIG_BUILD_KERNEL
+          (kernel || region->mm == get_current_mm()) &&
+#endif
+          strcmp(region->path, path) == 0)
+        {
+          break;
+        }
+    }
+
+  if (region != NULL)
+    {
+      /* If this is the first writer, take its file for the write-back */
+
+      if (writeback && !region->writeback)
+        {
+          ret = rammap_startwriteback(region, filep);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+        }
+
+      kmm_free(path);
+      region->crefs++;
+    }
+  else
+    {
+      region = kmm_zalloc(sizeof(*region));
+      if (region == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_lock;
+        }
+
+      region->vaddr = kernel ? kmm_malloc(entry->length) :
+                               kumm_malloc(entry->length);
+      if (region->vaddr == NULL)
+        {
+          ferr("ERROR: Region allocation failed, length: %zu\n",
+               entry->length);
+          ret = -ENOMEM;
+          goto errout_with_region;
+        }
+
+      nread = rammap_read(filep, entry->offset, region->vaddr,
+                          entry->length);
+      if (nread < 0)
+        {
+          ret = nread;
+          goto errout_with_vaddr;
+        }
+
+      region->length    = entry->length;
+      region->valid     = nread;
+      region->offset    = entry->offset;
+      region->path      = path;
+      region->crefs     = 1;
+      region->kernel    = kernel;
+#ifdef CONFIG_BUILD_KERNEL
+      region->mm        = get_current_mm();
+#endif
+
+      if (writeback)
+        {
+          ret = rammap_startwriteback(region, filep);
+          if (ret < 0)
+            {
+              goto errout_with_vaddr;
+            }
+        }
+
+      sq_addlast(&region->node, &g_rammap_regions);
+    }
+
+  nxmutex_unlock(&g_rammap_lock);
+
+  entry->vaddr  = region->vaddr;
+  entry->priv.p = region;
+  entry->munmap = unmap_sharedmap;
+
+  ret = mm_map_add(get_current_mm(), entry);
+  if (ret < 0)
+    {
+      rammap_release(region);
+    }
+
+  return ret;
+
+errout_with_vaddr:
+  if (kernel)
+    {
+      kmm_free(region->vaddr);
+    }
+  else
+    {
+      kumm_free(region->vaddr);
+    }
+
+errout_with_region:
+  kmm_free(region);
+
+errout_with_lock:
+  nxmutex_unlock(&g_rammap_lock);
+
+errout_with_path:
+  kmm_free(path);
+  return ret;
+}
+
 static int unmap_rammap(FAR struct task_group_s *group,
                         FAR struct mm_map_entry_s *entry,
                         FAR void *start,
@@ -154,22 +639,15 @@ int rammap(FAR struct file *filep, FAR struct mm_map_entry_s *entry,
 {
   FAR uint8_t *rdbuffer;
   ssize_t nread;
-  off_t fpos;
   int ret;
   size_t length = entry->length;
 
-  /* There is a major design flaw that I have not yet thought of fix for:
-   * The goal is to have a single region of memory that represents a single
-   * file and can be shared by many threads.  That is, given a filename a
-   * thread should be able to open the file, get a file descriptor, and
-   * call mmap() to get a memory region.  Different file descriptors opened
-   * with the same file path should get the same memory region when mapped.
-   *
-   * The design flaw is that I don't have sufficient knowledge to know that
-   * these different file descriptors map to the same file.  So, for the time
-   * being, a new memory region is created each time that rammap() is called.
-   * Not very useful!
-   */
+  /* Shared mappings of the same file use the same memory */
+
+  if ((entry->flags & MAP_SHARED) != 0)
+    {
+      return rammap_shared(filep, entry, kernel);
+    }
 
   /* Allocate a region of memory of the specified size */
 
@@ -182,60 +660,15 @@ int rammap(FAR struct file *filep, FAR struct mm_map_entry_s *entry,
 
   entry->vaddr = rdbuffer; /* save the buffer firstly */
 
-  /* Seek to the specified file offset */
-
-  fpos = file_seek(filep, entry->offset, SEEK_SET);
-  if (fpos < 0)
-    {
-      /* Seek failed... errno has already been set, but EINVAL is probably
-       * the correct response.
-       */
-
-      ferr("ERROR: Seek to position %zu failed\n", (size_t)entry->offset);
-      ret = fpos;
-      goto errout_with_region;
-    }
-
   /* Read the file data into the memory region */
 
-  while (length > 0)
+  nread = rammap_read(filep, entry->offset, rdbuffer, length);
+  if (nread < 0)
     {
-      nread = file_read(filep, rdbuffer, length);
-      if (nread < 0)
-        {
-          /* Handle the special case where the read was interrupted by a
-           * signal.
-           */
-
-          if (nread != -EINTR)
-            {
-              /* All other read errors are bad. */
-
-              ferr("ERROR: Read failed: offset=%zu ret=%zd\n",
-                   (size_t)entry->offset, nread);
-
-              ret = nread;
-              goto errout_with_region;
-            }
-        }
-
-      /* Check for end of file. */
-
-      if (nread == 0)
-        {
-          break;
-        }
-
-      /* Increment number of bytes read */
-
-      rdbuffer += nread;
-      length   -= nread;
+      ret = nread;
+      goto errout_with_region;
     }
 
-  /* Zero any memory beyond the amount read from the file */
-
-  memset(rdbuffer, 0, length);
-
   /* Add the buffer to the list of regions */
 
   entry->priv.i = kernel;
@@ -262,4 +695,48 @@ errout_with_region:
   return ret;
 }
 
+/****************************************************************************
+ * Name: rammap_msync
+ *
+ * Description:
+ *   Write the changes to a MAP_SHARED mapping back to the file.  Other
+ *   mappings need no synchronization and are ignored.
+ *
+ * Input Parameters:
+ *   entry   The mapping that contains 'start'
+ *   start   Start of the range to synchronize
+ *   length  Length of the range to synchronize
+ *   flags   MS_SYNC, MS_ASYNC or MS_INVALIDATE
+ *
+ * Returned Value:
+ *   Zero on success, a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int rammap_msync(FAR struct mm_map_entry_s *entry, FAR void *start,
+                 size_t length, int flags)
+{
+  FAR struct rammap_region_s *region;
+  size_t offset;
+  int ret;
+
+  if (entry->munmap != unmap_sharedmap)
+    {
+      return OK;
+    }
+
+  region = entry->priv.p;
+  offset = (uintptr_t)start - (uintptr_t)region->vaddr;
+
+  ret = nxmutex_lock(&g_rammap_lock);
+  if (ret >= 0)
+    {
+      ret = rammap_writeback(region, offset, length,
+                             (flags & MS_SYNC) != 0);
+      nxmutex_unlock(&g_rammap_lock);
+    }
+
+  return ret;
+}
+
 #endif /* CONFIG_FS_RAMMAP */
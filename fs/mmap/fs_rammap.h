@@ -30,8 +30,12 @@
  * - All of the file must be present in memory.  This limits the size of
  *   files that may be memory mapped (especially on MCUs with no significant
  *   RAM resources).
- * - All mapped files are read-only.  You can write to the in-memory image,
- *   but the file contents will not change.
+ * - Private mappings are read-only.  You can write to the in-memory image,
+ *   but the file contents will not change.  MAP_SHARED mappings of the same
+ *   range of a file share one in-memory image, which is written back to
+ *   the file by msync() and when the last mapping is removed.  With
+ *   CONFIG_BUILD_KERNEL, the image is only shared within one process.
+ * - Nothing is paged in on demand, the whole range is read when mapped.
  * - There are not access privileges.
  */
 
@@ -89,8 +93,21 @@
 
 int rammap(FAR struct file *filep, FAR struct mm_map_entry_s *entry,
            bool kernel);
+
+/****************************************************************************
+ * Name: rammap_msync
+ *
+ * Description:
+ *   Write the changes to a MAP_SHARED mapping back to the file.  Other
+ *   mappings need no synchronization and are ignored.
+ *
+ ****************************************************************************/
+
+int rammap_msync(FAR struct mm_map_entry_s *entry, FAR void *start,
+                 size_t length, int flags);
 #else
 #  define rammap(file, entry, kernel) (-ENOSYS)
+#  define rammap_msync(entry, start, length, flags) (OK)
 #endif /* CONFIG_FS_RAMMAP */
 
 #endif /* __FS_MMAP_FS_RAMMAP_H */
@@ -112,6 +112,10 @@ extern "C"
 EXTERN int nfs_request(FAR struct nfsmount *nmp, int procnum,
                 FAR void *request, size_t reqlen,
                 FAR void *response, size_t resplen);
+EXTERN int nfs_request_send(FAR struct nfsmount *nmp, int procnum,
+                FAR void *request, size_t reqlen, FAR uint32_t *xid);
+EXTERN int nfs_request_recv(FAR struct nfsmount *nmp, FAR void *response,
+                size_t resplen, FAR uint32_t *xid);
 EXTERN int  nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
               FAR struct file_handle *fhandle,
               FAR struct nfs_fattr *obj_attributes,
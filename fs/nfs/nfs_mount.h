@@ -57,10 +57,40 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifndef CONFIG_NFS_LOOKUP_CACHE_MS
+#  define CONFIG_NFS_LOOKUP_CACHE_MS 0
+#endif
+
+/* Size of the lookup cache and longest name that it holds */
+
+#define NFS_LOOKUP_NENTRIES     8
+#define NFS_LOOKUP_NAMELEN      32
+
+/* Values for lc_flags */
+
+#define NFS_LOOKUP_VALID        (1 << 0) /* Entry is in use */
+#define NFS_LOOKUP_OBJATTR      (1 << 1) /* lc_objattr is valid */
+#define NFS_LOOKUP_DIRATTR      (1 << 2) /* lc_dirattr is valid */
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+/* The result of one LOOKUP RPC: 'lc_name' in the directory 'lc_dir' */
+
+struct nfs_lookup_s
+{
+  clock_t                   lc_time;          /* Time of the LOOKUP */
+  uint8_t                   lc_flags;         /* See NFS_LOOKUP_* */
+  char                      lc_name[NFS_LOOKUP_NAMELEN];
+  struct file_handle        lc_dir;           /* Handle of the directory */
+  struct file_handle        lc_obj;           /* Handle of the object */
+  struct nfs_fattr          lc_objattr;       /* Attributes of the object */
+  struct nfs_fattr          lc_dirattr;       /* Attributes of the dir */
+};
+#endif
+
 /* Mount structure. One mount structure is allocated for each NFS mount. This
  * structure holds NFS specific information for mount.
  */
@@ -79,6 +109,9 @@ struct nfsmount
   uint16_t                  nm_wsize;         /* Max size of write RPC */
   uint16_t                  nm_readdirsize;   /* Size of a readdir RPC */
   uint16_t                  nm_buflen;        /* Size of I/O buffer */
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+  struct nfs_lookup_s       nm_lookup[NFS_LOOKUP_NENTRIES]; /* Lookup cache */
+#endif
 
   /* Set aside memory on the stack to hold the largest call message.
    * NOTE that for the case of the write call message, it is the reply
@@ -98,6 +131,7 @@ struct nfsmount
     struct rpc_call_fs      fsstat;
     struct rpc_call_setattr setattr;
     struct rpc_call_fs      fsinfo;
+    struct rpc_call_commit  commit;
     struct rpc_reply_write  write;
   } nm_msgbuffer;
 
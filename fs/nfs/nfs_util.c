@@ -36,6 +36,8 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/clock.h>
+
 #include "rpc.h"
 #include "nfs.h"
 #include "nfs_proto.h"
@@ -99,6 +101,180 @@ static inline int nfs_pathsegment(FAR const char **path, FAR char *buffer,
     }
 }
 
+/****************************************************************************
+ * Name: nfs_checkreply
+ *
+ * Description:
+ *   Verify the NFS level of a reply.
+ *
+ ****************************************************************************/
+
+static int nfs_checkreply(FAR void *response)
+{
+  struct nfs_reply_header replyh;
+
+  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
+
+  if (replyh.nfs_status != 0)
+    {
+      /* NFS_ERRORS are the same as NuttX errno values */
+
+      return -fxdr_unsigned(uint32_t, replyh.nfs_status);
+    }
+
+  if (replyh.rh.rpc_verfi.authtype != 0)
+    {
+      ferr("ERROR: NFS authtype %d from server\n",
+           fxdr_unsigned(int, replyh.rh.rpc_verfi.authtype));
+      return -EOPNOTSUPP;
+    }
+
+  finfo("NFS_SUCCESS\n");
+  return OK;
+}
+
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+
+/****************************************************************************
+ * Name: nfs_lookup_find
+ *
+ * Description:
+ *   Find the unexpired lookup cache entry for 'filename' in the directory
+ *   'dir'.  Returns NULL if there is none.
+ *
+ ****************************************************************************/
+
+static FAR struct nfs_lookup_s *
+nfs_lookup_find(FAR struct nfsmount *nmp, FAR const char *filename,
+                FAR const struct file_handle *dir)
+{
+  FAR struct nfs_lookup_s *entry;
+  clock_t now = clock_systime_ticks();
+  int i;
+
+  for (i = 0; i < NFS_LOOKUP_NENTRIES; i++)
+    {
+      entry = &nmp->nm_lookup[i];
+      if ((entry->lc_flags & NFS_LOOKUP_VALID) == 0)
+        {
+          continue;
+        }
+
+      if (now - entry->lc_time >= MSEC2TICK(CONFIG_NFS_LOOKUP_CACHE_MS))
+        {
+          entry->lc_flags = 0;
+          continue;
+        }
+
+      if (entry->lc_dir.length == dir->length &&
+          strcmp(entry->lc_name, filename) == 0 &&
+          memcmp(&entry->lc_dir.handle, &dir->handle, dir->length) == 0)
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nfs_lookup_add
+ *
+ * Description:
+ *   Remember the result of a LOOKUP RPC, replacing the oldest entry.
+ *
+ ****************************************************************************/
+
+static void nfs_lookup_add(FAR struct nfsmount *nmp,
+                           FAR const char *filename,
+                           FAR const struct file_handle *dir,
+                           FAR const struct file_handle *obj,
+                           FAR const struct nfs_fattr *obj_attributes,
+                           FAR const struct nfs_fattr *dir_attributes)
+{
+  FAR struct nfs_lookup_s *entry = &nmp->nm_lookup[0];
+  clock_t now = clock_systime_ticks();
+  size_t namelen = strlen(filename);
+  int i;
+
+  if (namelen >= NFS_LOOKUP_NAMELEN)
+    {
+      return;
+    }
+
+  for (i = 0; i < NFS_LOOKUP_NENTRIES; i++)
+    {
+      if ((nmp->nm_lookup[i].lc_flags & NFS_LOOKUP_VALID) == 0)
+        {
+          entry = &nmp->nm_lookup[i];
+          break;
+        }
+
+      if (now - nmp->nm_lookup[i].lc_time > now - entry->lc_time)
+        {
+          entry = &nmp->nm_lookup[i];
+        }
+    }
+
+  entry->lc_time  = now;
+  entry->lc_flags = NFS_LOOKUP_VALID;
+  memcpy(entry->lc_name, filename, namelen + 1);
+  memcpy(&entry->lc_dir, dir, sizeof(struct file_handle));
+  memcpy(&entry->lc_obj, obj, sizeof(struct file_handle));
+
+  if (obj_attributes != NULL)
+    {
+      memcpy(&entry->lc_objattr, obj_attributes, sizeof(struct nfs_fattr));
+      entry->lc_flags |= NFS_LOOKUP_OBJATTR;
+    }
+
+  if (dir_attributes != NULL)
+    {
+      memcpy(&entry->lc_dirattr, dir_attributes, sizeof(struct nfs_fattr));
+      entry->lc_flags |= NFS_LOOKUP_DIRATTR;
+    }
+}
+
+/****************************************************************************
+ * Name: nfs_lookup_invalidate
+ *
+ * Description:
+ *   Forget the cached lookups if the procedure 'procnum' may change the
+ *   file system.
+ *
+ ****************************************************************************/
+
+static void nfs_lookup_invalidate(FAR struct nfsmount *nmp, int procnum)
+{
+  int i;
+
+  switch (procnum)
+    {
+      case NFSPROC_SETATTR:
+      case NFSPROC_WRITE:
+      case NFSPROC_CREATE:
+      case NFSPROC_MKDIR:
+      case NFSPROC_SYMLINK:
+      case NFSPROC_MKNOD:
+      case NFSPROC_REMOVE:
+      case NFSPROC_RMDIR:
+      case NFSPROC_RENAME:
+      case NFSPROC_LINK:
+      case NFSPROC_COMMIT:
+        for (i = 0; i < NFS_LOOKUP_NENTRIES; i++)
+          {
+            nmp->nm_lookup[i].lc_flags = 0;
+          }
+        break;
+
+      default:
+        break;
+    }
+}
+#else
+#  define nfs_lookup_invalidate(nmp, procnum)
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -120,9 +296,10 @@ int nfs_request(FAR struct nfsmount *nmp, int procnum,
                 FAR void *response, size_t resplen)
 {
   FAR struct rpcclnt *clnt = nmp->nm_rpcclnt;
-  struct nfs_reply_header replyh;
   int error;
 
+  nfs_lookup_invalidate(nmp, procnum);
+
   error = rpcclnt_request(clnt, procnum, NFS_PROG, NFS_VER3,
                           request, reqlen, response, resplen);
   if (error != 0)
@@ -156,25 +333,55 @@ int nfs_request(FAR struct nfsmount *nmp, int procnum,
         }
     }
 
-  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
+  return nfs_checkreply(response);
+}
 
-  if (replyh.nfs_status != 0)
-    {
-      /* NFS_ERRORS are the same as NuttX errno values */
+/****************************************************************************
+ * Name: nfs_request_send
+ *
+ * Description:
+ *   Send an NFS call without waiting for its reply.  The transaction id of
+ *   the call is returned in 'xid'.  Only procedures that do not change the
+ *   file system may be sent this way.
+ *
+ * Returned Value:
+ *   Zero on success; a negative errno value on failure.
+ *
+ ****************************************************************************/
 
-      return -fxdr_unsigned(uint32_t, replyh.nfs_status);
-    }
+int nfs_request_send(FAR struct nfsmount *nmp, int procnum,
+                     FAR void *request, size_t reqlen, FAR uint32_t *xid)
+{
+  return rpcclnt_send_call(nmp->nm_rpcclnt, procnum, NFS_PROG, NFS_VER3,
+                           request, reqlen, xid);
+}
 
-  if (replyh.rh.rpc_verfi.authtype != 0)
+/****************************************************************************
+ * Name: nfs_request_recv
+ *
+ * Description:
+ *   Receive the reply to any of the calls sent with nfs_request_send() and
+ *   verify its NFS level.  The transaction id of the reply is returned in
+ *   'xid', or zero if nothing was received, in which case the caller should
+ *   re-issue the calls still waiting for a reply with nfs_request().
+ *
+ * Returned Value:
+ *   Zero on success; a negative errno value on failure.
+ *
+ ****************************************************************************/
+
+int nfs_request_recv(FAR struct nfsmount *nmp, FAR void *response,
+                     size_t resplen, FAR uint32_t *xid)
+{
+  int error;
+
+  error = rpcclnt_recv_reply(nmp->nm_rpcclnt, response, resplen, xid);
+  if (error != OK)
     {
-      error = -EOPNOTSUPP;
-      ferr("ERROR: NFS authtype %d from server\n",
-           fxdr_unsigned(int, replyh.rh.rpc_verfi.authtype));
       return error;
     }
 
-  finfo("NFS_SUCCESS\n");
-  return OK;
+  return nfs_checkreply(response);
 }
 
 /****************************************************************************
@@ -196,6 +403,12 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
                FAR struct nfs_fattr *obj_attributes,
                FAR struct nfs_fattr *dir_attributes)
 {
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+  FAR struct nfs_lookup_s *entry;
+  FAR struct nfs_fattr *objattr = NULL;
+  FAR struct nfs_fattr *dirattr = NULL;
+  struct file_handle dir;
+#endif
   FAR uint32_t *ptr;
   uint32_t value;
   int reqlen;
@@ -204,6 +417,31 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
 
   DEBUGASSERT(nmp && filename && fhandle);
 
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+  /* Check for a recent LOOKUP of the same name */
+
+  entry = nfs_lookup_find(nmp, filename, fhandle);
+  if (entry != NULL)
+    {
+      memcpy(fhandle, &entry->lc_obj, sizeof(struct file_handle));
+      if (obj_attributes && (entry->lc_flags & NFS_LOOKUP_OBJATTR) != 0)
+        {
+          memcpy(obj_attributes, &entry->lc_objattr,
+                 sizeof(struct nfs_fattr));
+        }
+
+      if (dir_attributes && (entry->lc_flags & NFS_LOOKUP_DIRATTR) != 0)
+        {
+          memcpy(dir_attributes, &entry->lc_dirattr,
+                 sizeof(struct nfs_fattr));
+        }
+
+      return OK;
+    }
+
+  memcpy(&dir, fhandle, sizeof(struct file_handle));
+#endif
+
   /* Get the length of the string to be sent */
 
   namelen = strlen(filename);
@@ -279,6 +517,9 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
   value = *ptr++;
   if (value)
     {
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+      objattr = (FAR struct nfs_fattr *)ptr;
+#endif
       if (obj_attributes)
         {
           memcpy(obj_attributes, ptr, sizeof(struct nfs_fattr));
@@ -292,11 +533,21 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
    */
 
   value = *ptr++;
-  if (value && dir_attributes)
+  if (value)
     {
-      memcpy(dir_attributes, ptr, sizeof(struct nfs_fattr));
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+      dirattr = (FAR struct nfs_fattr *)ptr;
+#endif
+      if (dir_attributes)
+        {
+          memcpy(dir_attributes, ptr, sizeof(struct nfs_fattr));
+        }
     }
 
+#if CONFIG_NFS_LOOKUP_CACHE_MS > 0
+  nfs_lookup_add(nmp, filename, &dir, fhandle, objattr, dirattr);
+#endif
+
   return OK;
 }
 
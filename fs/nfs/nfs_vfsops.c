@@ -48,6 +48,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/statfs.h>
@@ -101,6 +102,10 @@
 
 #define CH_STAT_SIZE            (1 << 7)
 
+#ifndef CONFIG_NFS_READ_WINDOW
+#  define CONFIG_NFS_READ_WINDOW 1
+#endif
+
 /****************************************************************************
  * Private Type
  ****************************************************************************/
@@ -139,6 +144,23 @@ static int     nfs_fileopen(FAR struct nfsmount *nmp,
 static int     nfs_open(FAR struct file *filep, FAR const char *relpath,
                    int oflags, mode_t mode);
 static int     nfs_close(FAR struct file *filep);
+static size_t  nfs_readargs(FAR struct nfsmount *nmp,
+                            FAR struct nfsnode *np,
+                            off_t offset, size_t readsize);
+static ssize_t nfs_readreply(FAR struct nfsmount *nmp,
+                             FAR struct nfsnode *np, FAR char *buffer,
+                             size_t readsize, FAR bool *eof);
+static ssize_t nfs_readchunks(FAR struct nfsmount *nmp,
+                              FAR struct nfsnode *np, off_t offset,
+                              FAR char *buffer, size_t buflen,
+                              FAR bool *eof);
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+static int     nfs_filecommit(FAR struct nfsmount *nmp,
+                              FAR struct nfsnode *np);
+static int     nfs_unstable_reserve(FAR struct nfsmount *nmp,
+                                    FAR struct nfsnode *np, off_t offset,
+                                    size_t writesize);
+#endif
 static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
                         size_t buflen);
 static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
@@ -536,6 +558,336 @@ static int nfs_filechstat(FAR struct nfsmount *nmp, FAR struct nfsnode *np,
   return OK;
 }
 
+/****************************************************************************
+ * Name: nfs_writemax
+ *
+ * Description:
+ *   Limit the size of one WRITE RPC to the negotiated write size and to the
+ *   size of the I/O buffer.
+ *
+ ****************************************************************************/
+
+static size_t nfs_writemax(FAR struct nfsmount *nmp, size_t writesize)
+{
+  ssize_t bufsize;
+
+  /* Make sure that the attempted write size does not exceed the RPC
+   * maximum.
+   */
+
+  if (writesize > nmp->nm_wsize)
+    {
+      writesize = nmp->nm_wsize;
+    }
+
+  /* Make sure that the attempted write size does not exceed the IO
+   * buffer size.
+   */
+
+  bufsize = SIZEOF_rpc_call_write(writesize);
+  if (bufsize > nmp->nm_buflen)
+    {
+      writesize -= (bufsize - nmp->nm_buflen);
+    }
+
+  return writesize;
+}
+
+/****************************************************************************
+ * Name: nfs_writerpc
+ *
+ * Description:
+ *   Send one WRITE RPC of 'writesize' bytes at 'offset' with the stability
+ *   level 'stable'.  'writesize' must not exceed nfs_writemax().  The
+ *   stability level obtained and the write verifier of the server are
+ *   returned in 'commit' and 'verf'.
+ *
+ * Returned Value:
+ *   The number of bytes written on success; a negated errno value on
+ *   failure.
+ *
+ ****************************************************************************/
+
+static ssize_t nfs_writerpc(FAR struct nfsmount *nmp,
+                            FAR struct nfsnode *np, off_t offset,
+                            FAR const char *buffer, size_t writesize,
+                            int stable, FAR int *commit,
+                            FAR uint8_t *verf)
+{
+  size_t        reqlen;
+  FAR uint32_t *ptr;
+  uint32_t      tmp;
+  int           ret;
+
+  /* Initialize the request.  Here we need an offset pointer to the write
+   * arguments, skipping over the RPC header.  Write is unique among the
+   * RPC calls in that the entry RPC calls message lies in the I/O buffer
+   */
+
+  ptr     = (FAR uint32_t *)&((FAR struct rpc_call_write *)
+              nmp->nm_iobuffer)->write;
+  reqlen  = 0;
+
+  /* Copy the variable length, file handle */
+
+  *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
+  reqlen += sizeof(uint32_t);
+
+  memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+  reqlen += uint32_alignup(np->n_fhsize);
+  ptr    += uint32_increment(np->n_fhsize);
+
+  /* Copy the file offset */
+
+  txdr_hyper((uint64_t)offset, ptr);
+  ptr    += 2;
+  reqlen += 2*sizeof(uint32_t);
+
+  /* Copy the count and stable values */
+
+  *ptr++  = txdr_unsigned(writesize);
+  *ptr++  = txdr_unsigned(stable);
+  reqlen += 2*sizeof(uint32_t);
+
+  /* Copy a chunk of the user data into the I/O buffer */
+
+  *ptr++  = txdr_unsigned(writesize);
+  reqlen += sizeof(uint32_t);
+  memcpy(ptr, buffer, writesize);
+  reqlen += uint32_alignup(writesize);
+
+  /* Perform the write */
+
+  nfs_statistics(NFSPROC_WRITE);
+  ret = nfs_request(nmp, NFSPROC_WRITE,
+                    nmp->nm_iobuffer, reqlen,
+                    &nmp->nm_msgbuffer.write,
+                    sizeof(struct rpc_reply_write));
+  if (ret)
+    {
+      ferr("ERROR: nfs_request failed: %d\n", ret);
+      return ret;
+    }
+
+  /* Get a pointer to the WRITE reply data */
+
+  ptr = (FAR uint32_t *)&nmp->nm_msgbuffer.write.write;
+
+  /* Parse file_wcc.  First, check if WCC attributes follow. */
+
+  tmp = *ptr++;
+  if (tmp != 0)
+    {
+      /* Yes.. WCC attributes follow.  But we just skip over them. */
+
+      ptr += uint32_increment(sizeof(struct wcc_attr));
+    }
+
+  /* Check if normal file attributes follow */
+
+  tmp = *ptr++;
+  if (tmp != 0)
+    {
+      /* Yes.. Update the cached file status in the file structure. */
+
+      nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
+      ptr += uint32_increment(sizeof(struct nfs_fattr));
+    }
+
+  /* Get the count of bytes actually written */
+
+  tmp = fxdr_unsigned(uint32_t, *ptr);
+  ptr++;
+
+  if (tmp < 1 || tmp > writesize)
+    {
+      return -EIO;
+    }
+
+  /* Return the commitment level and the write verifier */
+
+  *commit = fxdr_unsigned(uint32_t, *ptr);
+  ptr++;
+
+  memcpy(verf, ptr, NFSX_V3WRITEVERF);
+  return tmp;
+}
+
+/****************************************************************************
+ * Name: nfs_filecommit
+ *
+ * Description:
+ *   Commit the unstable writes to a file with a COMMIT RPC.  If the write
+ *   verifier changed, the server may have lost the data and the retained
+ *   copy is sent again with stable writes.  The copy is kept until this
+ *   succeeds.
+ *
+ * Returned Value:
+ *   0 on success; a negative errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+static int nfs_filecommit(FAR struct nfsmount *nmp, FAR struct nfsnode *np)
+{
+  FAR uint32_t *ptr;
+  int           reqlen;
+  int           ret;
+
+  if ((np->n_flags & NFSNODE_UNCOMMITTED) == 0)
+    {
+      return OK;
+    }
+
+  /* Create the COMMIT RPC call arguments: commit the whole file */
+
+  ptr    = (FAR uint32_t *)&nmp->nm_msgbuffer.commit.commit;
+  reqlen = 0;
+
+  /* Copy the variable length file handle */
+
+  *ptr++  = txdr_unsigned(np->n_fhsize);
+  reqlen += sizeof(uint32_t);
+
+  memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+  reqlen += uint32_alignup(np->n_fhsize);
+  ptr    += uint32_increment(np->n_fhsize);
+
+  /* Offset and count are zero */
+
+  txdr_hyper((uint64_t)0, ptr);
+  ptr    += 2;
+  *ptr++  = 0;
+  reqlen += 3 * sizeof(uint32_t);
+
+  /* Perform the COMMIT RPC */
+
+  nfs_statistics(NFSPROC_COMMIT);
+  ret = nfs_request(nmp, NFSPROC_COMMIT,
+                    &nmp->nm_msgbuffer.commit, reqlen,
+                    nmp->nm_iobuffer, nmp->nm_buflen);
+  if (ret != OK)
+    {
+      ferr("ERROR: nfs_request failed: %d\n", ret);
+      return ret;
+    }
+
+  /* Get a pointer to the COMMIT reply data */
+
+  ptr = (FAR uint32_t *)&((FAR struct rpc_reply_commit *)
+    nmp->nm_iobuffer)->commit;
+
+  /* Parse file_wcc.  First, check if WCC attributes follow. */
+
+  if (*ptr++ != 0)
+    {
+      /* Yes.. WCC attributes follow.  But we just skip over them. */
+
+      ptr += uint32_increment(sizeof(struct wcc_attr));
+    }
+
+  /* Check if normal file attributes follow */
+
+  if (*ptr++ != 0)
+    {
+      /* Yes.. Update the cached file status in the file structure. */
+
+      nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
+      ptr += uint32_increment(sizeof(struct nfs_fattr));
+    }
+
+  /* A different verifier means that the server restarted since the data
+   * was written and the data may be lost.  Send it again.
+   */
+
+  if ((np->n_flags & NFSNODE_VERFCHANGED) != 0 ||
+      memcmp(np->n_verf, ptr, NFSX_V3WRITEVERF) != 0)
+    {
+      fwarn("WARNING: Write verifier changed, writing %zu bytes again\n",
+            np->n_ulen);
+
+      /* Send the rest again if this is interrupted */
+
+      np->n_flags |= NFSNODE_VERFCHANGED;
+
+      while (np->n_ulen > 0)
+        {
+          uint8_t verf[NFSX_V3WRITEVERF];
+          size_t  writesize;
+          int     commit;
+
+          writesize = nfs_writemax(nmp, np->n_ulen);
+          ret = nfs_writerpc(nmp, np, np->n_uoff,
+                             (FAR const char *)np->n_ubuf, writesize,
+                             NFSV3WRITE_FILESYNC, &commit, verf);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          /* Keep only the part that is not yet stable */
+
+          np->n_ulen -= ret;
+          np->n_uoff += ret;
+          memmove(np->n_ubuf, np->n_ubuf + ret, np->n_ulen);
+        }
+    }
+
+  np->n_flags &= ~(NFSNODE_UNCOMMITTED | NFSNODE_VERFCHANGED);
+  np->n_ulen   = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nfs_unstable_reserve
+ *
+ * Description:
+ *   Make room to keep a copy of 'writesize' bytes of data to be written at
+ *   'offset' until they are committed.  The data kept so far is committed
+ *   first if the new data does not follow it or does not fit.
+ *
+ * Returned Value:
+ *   The stability level to write the data with, NFSV3WRITE_UNSTABLE if a
+ *   copy can be kept or NFSV3WRITE_FILESYNC if not; a negated errno value
+ *   on failure.
+ *
+ ****************************************************************************/
+
+static int nfs_unstable_reserve(FAR struct nfsmount *nmp,
+                                FAR struct nfsnode *np, off_t offset,
+                                size_t writesize)
+{
+  int ret;
+
+  if ((np->n_flags & NFSNODE_UNCOMMITTED) != 0 &&
+      ((uint64_t)offset != np->n_uoff + np->n_ulen ||
+       writesize > CONFIG_NFS_UNSTABLE_BUFSIZE - np->n_ulen))
+    {
+      ret = nfs_filecommit(nmp, np);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  if (writesize > CONFIG_NFS_UNSTABLE_BUFSIZE)
+    {
+      return NFSV3WRITE_FILESYNC;
+    }
+
+  if (np->n_ubuf == NULL)
+    {
+      np->n_ubuf = kmm_malloc(CONFIG_NFS_UNSTABLE_BUFSIZE);
+      if (np->n_ubuf == NULL)
+        {
+          return NFSV3WRITE_FILESYNC;
+        }
+    }
+
+  return NFSV3WRITE_UNSTABLE;
+}
+#endif
+
 /****************************************************************************
  * Name: nfs_fileopen
  *
@@ -809,6 +1161,12 @@ static int nfs_close(FAR struct file *filep)
 
   else
     {
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+      /* Commit any unstable writes.  The file is closed regardless. */
+
+      int commitret = nfs_filecommit(nmp, np);
+#endif
+
       /* Assume file structure won't be found. This should never happen. */
 
       ret = -EINVAL;
@@ -838,11 +1196,21 @@ static int nfs_close(FAR struct file *filep)
 
               /* Then deallocate the file structure and return success */
 
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+              kmm_free(np->n_ubuf);
+#endif
               kmm_free(np);
               ret = OK;
               break;
             }
         }
+
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+      if (ret == OK)
+        {
+          ret = commitret;
+        }
+#endif
     }
 
   filep->f_priv = NULL;
@@ -851,157 +1219,349 @@ static int nfs_close(FAR struct file *filep)
 }
 
 /****************************************************************************
- * Name: nfs_read
+ * Name: nfs_readargs
+ *
+ * Description:
+ *   Format the arguments of a READ RPC in nm_msgbuffer.
+ *
+ * Returned Value:
+ *   The length of the arguments.
+ *
+ ****************************************************************************/
+
+static size_t nfs_readargs(FAR struct nfsmount *nmp,
+                           FAR struct nfsnode *np,
+                           off_t offset, size_t readsize)
+{
+  FAR uint32_t *ptr;
+  size_t        reqlen;
+
+  ptr     = (FAR uint32_t *)&nmp->nm_msgbuffer.read.read;
+  reqlen  = 0;
+
+  /* Copy the variable length, file handle */
+
+  *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
+  reqlen += sizeof(uint32_t);
+
+  memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+  reqlen += uint32_alignup(np->n_fhsize);
+  ptr    += uint32_increment(np->n_fhsize);
+
+  /* Copy the file offset */
+
+  txdr_hyper((uint64_t)offset, ptr);
+  ptr += 2;
+  reqlen += 2*sizeof(uint32_t);
+
+  /* Set the readsize */
+
+  *ptr = txdr_unsigned(readsize);
+  reqlen += sizeof(uint32_t);
+
+  return reqlen;
+}
+
+/****************************************************************************
+ * Name: nfs_readreply
+ *
+ * Description:
+ *   Copy the data of the READ reply in nm_iobuffer to the user buffer.
  *
  * Returned Value:
  *   The (non-negative) number of bytes read on success; a negated errno
- *   value on failure.
+ *   value on failure.  'eof' tells whether the end of file was reached.
  *
  ****************************************************************************/
 
-static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
-                        size_t buflen)
+static ssize_t nfs_readreply(FAR struct nfsmount *nmp,
+                             FAR struct nfsnode *np, FAR char *buffer,
+                             size_t readsize, FAR bool *eof)
 {
-  FAR struct nfsmount       *nmp;
-  FAR struct nfsnode        *np;
-  ssize_t                    readsize;
-  ssize_t                    tmp;
-  ssize_t                    bytesread;
-  size_t                     reqlen;
-  FAR uint32_t              *ptr;
-  int                        ret = 0;
+  FAR uint32_t *ptr;
+  uint32_t      tmp;
 
-  finfo("Read %zu bytes from offset %jd\n",
-        buflen, (intmax_t)filep->f_pos);
+  /* Get a pointer to the beginning of the NFS response data */
 
-  /* Sanity checks */
+  ptr = (FAR uint32_t *)
+    &((FAR struct rpc_reply_read *)nmp->nm_iobuffer)->read;
 
-  DEBUGASSERT(filep->f_priv != NULL);
+  /* Check if attributes are included in the responses */
 
-  /* Recover our private data from the struct file instance */
+  tmp = *ptr++;
+  if (tmp != 0)
+    {
+      /* Yes.. Update the cached file status in the file structure. */
 
-  nmp = filep->f_inode->i_private;
-  np  = (FAR struct nfsnode *)filep->f_priv;
+      nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
+      ptr += uint32_increment(sizeof(struct nfs_fattr));
+    }
 
-  DEBUGASSERT(nmp != NULL);
+  /* This is followed by the count of data read.  Isn't this
+   * the same as the length that is included in the read data?
+   *
+   * Just skip over if for now.
+   */
 
-  ret = nxmutex_lock(&nmp->nm_lock);
-  if (ret < 0)
+  ptr++;
+
+  /* Next comes an EOF indication */
+
+  *eof = *ptr++ != 0;
+
+  /* Then the length of the read data followed by the read data itself */
+
+  tmp = fxdr_unsigned(uint32_t, *ptr);
+  ptr++;
+
+  if (tmp > readsize)
     {
-      return (ssize_t)ret;
+      ferr("ERROR: Bad read length: %" PRIu32 "\n", tmp);
+      return -EIO;
     }
 
-  /* Get the number of bytes left in the file and truncate read count so that
-   * it does not exceed the number of bytes left in the file.
+  /* Copy the read data into the user buffer */
+
+  memcpy(buffer, ptr, tmp);
+  return tmp;
+}
+
+/****************************************************************************
+ * Name: nfs_readchunks
+ *
+ * Description:
+ *   Read up to 'buflen' bytes at 'offset'.  The request is split into READ
+ *   RPCs of at most the negotiated read size and up to
+ *   CONFIG_NFS_READ_WINDOW of them are sent before the replies are
+ *   collected, so that the round trips overlap.  The replies may come in
+ *   any order; each one is copied to its place in the user buffer as soon
+ *   as it is received.  Calls whose reply is lost are re-issued one at a
+ *   time, with the usual time-outs and re-transmissions.
+ *
+ * Returned Value:
+ *   The (non-negative) number of contiguous bytes read on success; a
+ *   negated errno value on failure.  'eof' tells whether the end of file
+ *   was reached.
+ *
+ ****************************************************************************/
+
+static ssize_t nfs_readchunks(FAR struct nfsmount *nmp,
+                              FAR struct nfsnode *np, off_t offset,
+                              FAR char *buffer, size_t buflen,
+                              FAR bool *eof)
+{
+#if CONFIG_NFS_READ_WINDOW > 1
+  uint32_t xids[CONFIG_NFS_READ_WINDOW];
+  ssize_t  nread[CONFIG_NFS_READ_WINDOW];
+  bool     eofs[CONFIG_NFS_READ_WINDOW];
+  uint32_t xid;
+  int      pending;
+  int      nchunks;
+  ssize_t  total;
+  int      i;
+#endif
+  size_t   readsize;
+  size_t   reqlen;
+  ssize_t  tmp;
+  int      ret;
+
+  /* Make sure that the read size of one RPC does not exceed the RPC
+   * maximum or the IO buffer size
    */
 
-  tmp = np->n_size - filep->f_pos;
-  if (buflen > tmp)
+  readsize = nmp->nm_rsize;
+  tmp = SIZEOF_rpc_reply_read(readsize);
+  if (tmp > nmp->nm_buflen)
     {
-      buflen = tmp;
-      finfo("Read size truncated to %zu\n", buflen);
+      readsize -= (tmp - nmp->nm_buflen);
     }
 
-  /* Now loop until we fill the user buffer (or hit the end of the file) */
+  *eof = false;
 
-  for (bytesread = 0; bytesread < buflen; )
+#if CONFIG_NFS_READ_WINDOW > 1
+  nchunks = (buflen + readsize - 1) / readsize;
+  if (nchunks > CONFIG_NFS_READ_WINDOW)
     {
-      /* Make sure that the attempted read size does not exceed the RPC
-       * maximum
-       */
+      nchunks = CONFIG_NFS_READ_WINDOW;
+    }
+
+  if (nchunks > 1)
+    {
+      /* Send all of the READ calls */
 
-      readsize = buflen - bytesread;
-      if (readsize > nmp->nm_rsize)
+      for (i = 0; i < nchunks; i++)
         {
-          readsize = nmp->nm_rsize;
+          reqlen = nfs_readargs(nmp, np, offset + i * readsize,
+                                MIN(readsize, buflen - i * readsize));
+
+          nfs_statistics(NFSPROC_READ);
+          ret = nfs_request_send(nmp, NFSPROC_READ,
+                                 &nmp->nm_msgbuffer.read, reqlen,
+                                 &xids[i]);
+          if (ret < 0)
+            {
+              break;
+            }
+
+          nread[i] = -EINPROGRESS;
         }
 
-      /* Make sure that the attempted read size does not exceed the IO buffer
-       * size
-       */
+      nchunks = i;
 
-      tmp = SIZEOF_rpc_reply_read(readsize);
-      if (tmp > nmp->nm_buflen)
+      /* Then collect the replies, in whatever order they come */
+
+      for (pending = nchunks; pending > 0; )
         {
-          readsize -= (tmp - nmp->nm_buflen);
-        }
+          ret = nfs_request_recv(nmp, nmp->nm_iobuffer, nmp->nm_buflen,
+                                 &xid);
+          if (xid == 0)
+            {
+              /* Nothing received, the remaining calls are re-issued */
 
-      /* Initialize the request */
+              break;
+            }
 
-      ptr     = (FAR uint32_t *)&nmp->nm_msgbuffer.read.read;
-      reqlen  = 0;
+          for (i = 0; i < nchunks; i++)
+            {
+              if (xids[i] == xid && nread[i] == -EINPROGRESS)
+                {
+                  break;
+                }
+            }
 
-      /* Copy the variable length, file handle */
+          if (i >= nchunks)
+            {
+              /* The late reply to some older call */
 
-      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
-      reqlen += sizeof(uint32_t);
+              continue;
+            }
 
-      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
-      reqlen += uint32_alignup(np->n_fhsize);
-      ptr    += uint32_increment(np->n_fhsize);
+          if (ret == OK)
+            {
+              ret = nfs_readreply(nmp, np, buffer + i * readsize,
+                                  MIN(readsize, buflen - i * readsize),
+                                  &eofs[i]);
+            }
 
-      /* Copy the file offset */
+          nread[i] = ret;
+          pending--;
+        }
 
-      txdr_hyper((uint64_t)filep->f_pos, ptr);
-      ptr += 2;
-      reqlen += 2*sizeof(uint32_t);
+      /* Return the data up to the first short read */
 
-      /* Set the readsize */
+      for (total = 0, i = 0; i < nchunks; i++)
+        {
+          if (nread[i] == -EINPROGRESS)
+            {
+              break;
+            }
 
-      *ptr = txdr_unsigned(readsize);
-      reqlen += sizeof(uint32_t);
+          if (nread[i] < 0)
+            {
+              return total > 0 ? total : nread[i];
+            }
 
-      /* Perform the read */
+          total += nread[i];
+          if (eofs[i] ||
+              (size_t)nread[i] < MIN(readsize, buflen - i * readsize))
+            {
+              *eof = eofs[i];
+              return total;
+            }
+        }
 
-      finfo("Reading %zu bytes\n", readsize);
-      nfs_statistics(NFSPROC_READ);
-      ret = nfs_request(nmp, NFSPROC_READ,
-                        &nmp->nm_msgbuffer.read, reqlen,
-                        nmp->nm_iobuffer, nmp->nm_buflen);
-      if (ret)
+      /* If the reply to the first call was lost, read that chunk
+       * synchronously below.
+       */
+
+      if (total > 0)
         {
-          ferr("ERROR: nfs_request failed: %d\n", ret);
-          goto errout_with_lock;
+          return total;
         }
+    }
+#endif
 
-      /* The read was successful.  Get a pointer to the beginning of the NFS
-       * response data.
-       */
+  /* Read one chunk synchronously */
 
-      ptr = (FAR uint32_t *)
-        &((FAR struct rpc_reply_read *)nmp->nm_iobuffer)->read;
+  readsize = MIN(readsize, buflen);
+  reqlen   = nfs_readargs(nmp, np, offset, readsize);
 
-      /* Check if attributes are included in the responses */
+  finfo("Reading %zu bytes\n", readsize);
+  nfs_statistics(NFSPROC_READ);
+  ret = nfs_request(nmp, NFSPROC_READ,
+                    &nmp->nm_msgbuffer.read, reqlen,
+                    nmp->nm_iobuffer, nmp->nm_buflen);
+  if (ret)
+    {
+      ferr("ERROR: nfs_request failed: %d\n", ret);
+      return ret;
+    }
 
-      tmp = *ptr++;
-      if (tmp != 0)
-        {
-          /* Yes.. Update the cached file status in the file structure. */
+  return nfs_readreply(nmp, np, buffer, readsize, eof);
+}
 
-          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
-        }
+/****************************************************************************
+ * Name: nfs_read
+ *
+ * Returned Value:
+ *   The (non-negative) number of bytes read on success; a negated errno
+ *   value on failure.
+ *
+ ****************************************************************************/
 
-      /* This is followed by the count of data read.  Isn't this
-       * the same as the length that is included in the read data?
-       *
-       * Just skip over if for now.
-       */
+static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
+                        size_t buflen)
+{
+  FAR struct nfsmount       *nmp;
+  FAR struct nfsnode        *np;
+  ssize_t                    readsize;
+  ssize_t                    tmp;
+  ssize_t                    bytesread;
+  bool                       eof;
+  int                        ret = 0;
 
-      ptr++;
+  finfo("Read %zu bytes from offset %jd\n",
+        buflen, (intmax_t)filep->f_pos);
 
-      /* Next comes an EOF indication.  Save that in tmp for now. */
+  /* Sanity checks */
 
-      tmp = *ptr++;
+  DEBUGASSERT(filep->f_priv != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  nmp = filep->f_inode->i_private;
+  np  = (FAR struct nfsnode *)filep->f_priv;
 
-      /* Then the length of the read data followed by the read data itself */
+  DEBUGASSERT(nmp != NULL);
 
-      readsize = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
+  ret = nxmutex_lock(&nmp->nm_lock);
+  if (ret < 0)
+    {
+      return (ssize_t)ret;
+    }
+
+  /* Get the number of bytes left in the file and truncate read count so that
+   * it does not exceed the number of bytes left in the file.
+   */
+
+  tmp = np->n_size - filep->f_pos;
+  if (buflen > tmp)
+    {
+      buflen = tmp;
+      finfo("Read size truncated to %zu\n", buflen);
+    }
 
-      /* Copy the read data into the user buffer */
+  /* Now loop until we fill the user buffer (or hit the end of the file) */
 
-      memcpy(buffer, ptr, readsize);
+  for (bytesread = 0; bytesread < buflen; )
+    {
+      readsize = nfs_readchunks(nmp, np, filep->f_pos, buffer,
+                                buflen - bytesread, &eof);
+      if (readsize < 0)
+        {
+          ret = readsize;
+          break;
+        }
 
       /* Update the read state data */
 
@@ -1011,13 +1571,12 @@ static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
 
       /* Check if we hit the end of file */
 
-      if (tmp != 0)
+      if (eof || readsize == 0)
         {
           break;
         }
     }
 
-errout_with_lock:
   nxmutex_unlock(&nmp->nm_lock);
   return bytesread > 0 ? bytesread : ret;
 }
@@ -1037,13 +1596,10 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
   FAR struct nfsmount *nmp;
   FAR struct nfsnode  *np;
   ssize_t              writesize;
-  ssize_t              bufsize;
   ssize_t              byteswritten = 0;
-  size_t               reqlen;
-  FAR uint32_t        *ptr;
-  uint32_t             tmp;
+  uint8_t              verf[NFSX_V3WRITEVERF];
   int                  commit = 0;
-  int                  committed = NFSV3WRITE_FILESYNC;
+  int                  stable = NFSV3WRITE_FILESYNC;
   int                  ret;
 
   finfo("Write %zu bytes to offset %jd\n",
@@ -1078,126 +1634,53 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
 
   for (byteswritten = 0; byteswritten < buflen; )
     {
-      /* Make sure that the attempted write size does not exceed the RPC
-       * maximum.
-       */
-
-      writesize = buflen - byteswritten;
-      if (writesize > nmp->nm_wsize)
-        {
-          writesize = nmp->nm_wsize;
-        }
+      writesize = nfs_writemax(nmp, buflen - byteswritten);
 
-      /* Make sure that the attempted read size does not exceed the IO
-       * buffer size.
-       */
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+      /* Send the data unstable only if it can be kept until committed */
 
-      bufsize = SIZEOF_rpc_call_write(writesize);
-      if (bufsize > nmp->nm_buflen)
+      ret = nfs_unstable_reserve(nmp, np, filep->f_pos, writesize);
+      if (ret < 0)
         {
-          writesize -= (bufsize - nmp->nm_buflen);
-        }
-
-      /* Initialize the request.  Here we need an offset pointer to the write
-       * arguments, skipping over the RPC header.  Write is unique among the
-       * RPC calls in that the entry RPC calls message lies in the I/O buffer
-       */
-
-      ptr     = (FAR uint32_t *)&((FAR struct rpc_call_write *)
-                  nmp->nm_iobuffer)->write;
-      reqlen  = 0;
-
-      /* Copy the variable length, file handle */
-
-      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
-      reqlen += sizeof(uint32_t);
-
-      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
-      reqlen += uint32_alignup(np->n_fhsize);
-      ptr    += uint32_increment(np->n_fhsize);
-
-      /* Copy the file offset */
-
-      txdr_hyper((uint64_t)filep->f_pos, ptr);
-      ptr    += 2;
-      reqlen += 2*sizeof(uint32_t);
-
-      /* Copy the count and stable values */
-
-      *ptr++  = txdr_unsigned(writesize);
-      *ptr++  = txdr_unsigned(committed);
-      reqlen += 2*sizeof(uint32_t);
-
-      /* Copy a chunk of the user data into the I/O buffer */
-
-      *ptr++  = txdr_unsigned(writesize);
-      reqlen += sizeof(uint32_t);
-      memcpy(ptr, buffer, writesize);
-      reqlen += uint32_alignup(writesize);
-
-      /* Perform the write */
-
-      nfs_statistics(NFSPROC_WRITE);
-      ret = nfs_request(nmp, NFSPROC_WRITE,
-                        nmp->nm_iobuffer, reqlen,
-                        &nmp->nm_msgbuffer.write,
-                        sizeof(struct rpc_reply_write));
-      if (ret)
-        {
-          ferr("ERROR: nfs_request failed: %d\n", ret);
           goto errout_with_lock;
         }
 
-      /* Get a pointer to the WRITE reply data */
-
-      ptr = (FAR uint32_t *)&nmp->nm_msgbuffer.write.write;
-
-      /* Parse file_wcc.  First, check if WCC attributes follow. */
-
-      tmp = *ptr++;
-      if (tmp != 0)
-        {
-          /* Yes.. WCC attributes follow.  But we just skip over them. */
-
-          ptr += uint32_increment(sizeof(struct wcc_attr));
-        }
-
-      /* Check if normal file attributes follow */
-
-      tmp = *ptr++;
-      if (tmp != 0)
-        {
-          /* Yes.. Update the cached file status in the file structure. */
-
-          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
-        }
-
-      /* Get the count of bytes actually written */
-
-      tmp = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
+      stable = ret;
+#endif
 
-      if (tmp < 1 || tmp > writesize)
+      ret = nfs_writerpc(nmp, np, filep->f_pos, buffer, writesize,
+                         stable, &commit, verf);
+      if (ret < 0)
         {
-          ret = -EIO;
           goto errout_with_lock;
         }
 
-      writesize = tmp;
+      writesize = ret;
 
-      /* Determine the lowest commitment level obtained by any of the RPCs. */
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+      /* Uncommitted data must be committed later.  Keep a copy so that it
+       * can be sent again if the write verifier changes in the meantime,
+       * meaning that the server restarted and may have lost the data.
+       */
 
-      commit = *ptr++;
-      if (committed == NFSV3WRITE_FILESYNC)
+      if (stable == NFSV3WRITE_UNSTABLE && commit == NFSV3WRITE_UNSTABLE)
         {
-          committed = commit;
-        }
-      else if (committed == NFSV3WRITE_DATASYNC &&
-               commit == NFSV3WRITE_UNSTABLE)
-        {
-          committed = commit;
+          if ((np->n_flags & NFSNODE_UNCOMMITTED) == 0)
+            {
+              memcpy(np->n_verf, verf, NFSX_V3WRITEVERF);
+              np->n_flags |= NFSNODE_UNCOMMITTED;
+              np->n_uoff   = filep->f_pos;
+            }
+          else if (memcmp(np->n_verf, verf, NFSX_V3WRITEVERF) != 0)
+            {
+              memcpy(np->n_verf, verf, NFSX_V3WRITEVERF);
+              np->n_flags |= NFSNODE_VERFCHANGED;
+            }
+
+          memcpy(np->n_ubuf + np->n_ulen, buffer, writesize);
+          np->n_ulen += writesize;
         }
+#endif
 
       /* Update the read state data */
 
@@ -1286,7 +1769,36 @@ static off_t nfs_seek(FAR struct file *filep, off_t offset, int whence)
 
 static int nfs_sync(FAR struct file *filep)
 {
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+  FAR struct nfsmount *nmp;
+  FAR struct nfsnode  *np;
+  int                  ret;
+
+  /* Sanity checks */
+
+  DEBUGASSERT(filep->f_priv != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  nmp = filep->f_inode->i_private;
+  np  = (FAR struct nfsnode *)filep->f_priv;
+
+  DEBUGASSERT(nmp != NULL);
+
+  ret = nxmutex_lock(&nmp->nm_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = nfs_filecommit(nmp, np);
+  nxmutex_unlock(&nmp->nm_lock);
+  return ret;
+#else
+  /* All writes are stable, there is nothing to do */
+
   return 0;
+#endif
 }
 
 /****************************************************************************
@@ -1457,10 +1969,18 @@ static int nfs_truncate(FAR struct file *filep, off_t length)
     {
       struct stat buf;
 
-      /* Then perform the SETATTR RPC to set the new file size */
+#ifdef CONFIG_NFS_UNSTABLE_WRITES
+      /* Commit first so that the data is not written again afterwards */
 
-      buf.st_size = length;
-      ret = nfs_filechstat(nmp, np, &buf, CH_STAT_SIZE);
+      ret = nfs_filecommit(nmp, np);
+      if (ret >= 0)
+#endif
+        {
+          /* Then perform the SETATTR RPC to set the new file size */
+
+          buf.st_size = length;
+          ret = nfs_filechstat(nmp, np, &buf, CH_STAT_SIZE);
+        }
 
       nxmutex_unlock(&nmp->nm_lock);
     }
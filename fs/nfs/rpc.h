@@ -328,6 +328,12 @@ struct rpc_call_fs
   struct FS3args fs;
 };
 
+struct rpc_call_commit
+{
+  struct rpc_call_header ch;
+  struct COMMIT3args commit;
+};
+
 /* Generic RPC reply headers */
 
 struct rpc_reply_header
@@ -389,6 +395,12 @@ struct rpc_reply_read
 #define SIZEOF_rpc_reply_read(n) \
   (sizeof(struct nfs_reply_header) + SIZEOF_READ3resok(n))
 
+struct rpc_reply_commit
+{
+  struct nfs_reply_header rh;
+  struct COMMIT3resok commit;
+};
+
 struct rpc_reply_remove
 {
   struct nfs_reply_header rh;
@@ -471,5 +483,10 @@ void rpcclnt_disconnect(FAR struct rpcclnt *rpc);
 int  rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
                      int version, FAR void *request, size_t reqlen,
                      FAR void *response, size_t resplen);
+int  rpcclnt_send_call(FAR struct rpcclnt *rpc, int procnum, int prog,
+                       int version, FAR void *request, size_t reqlen,
+                       FAR uint32_t *xid);
+int  rpcclnt_recv_reply(FAR struct rpcclnt *rpc, FAR void *response,
+                        size_t resplen, FAR uint32_t *xid);
 
 #endif /* __FS_NFS_RPC_H */
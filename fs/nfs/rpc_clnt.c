@@ -150,6 +150,7 @@ static int rpcclnt_reply(FAR struct rpcclnt *rpc, uint32_t xid,
                          FAR void *reply, size_t resplen);
 static void rpcclnt_fmtheader(FAR struct rpc_call_header *ch,
                               uint32_t xid, int procid, int prog, int vers);
+static int rpcclnt_checkreply(FAR void *response);
 
 /****************************************************************************
  * Private Functions
@@ -501,6 +502,43 @@ static void rpcclnt_fmtheader(FAR struct rpc_call_header *ch,
   ch->rpc_verf.authlen   = 0;
 }
 
+/****************************************************************************
+ * Name: rpcclnt_checkreply
+ *
+ * Description:
+ *   Verify the RPC level of a reply.
+ *
+ ****************************************************************************/
+
+static int rpcclnt_checkreply(FAR void *response)
+{
+  FAR struct rpc_reply_header *replymsg;
+  uint32_t tmp;
+
+  /* Break down the RPC header and check if it is OK */
+
+  replymsg = (FAR struct rpc_reply_header *)response;
+
+  tmp = fxdr_unsigned(uint32_t, replymsg->type);
+  if (tmp != RPC_MSGACCEPTED)
+    {
+      return -EOPNOTSUPP;
+    }
+
+  tmp = fxdr_unsigned(uint32_t, replymsg->status);
+  if (tmp == RPC_SUCCESS)
+    {
+      finfo("RPC_SUCCESS\n");
+    }
+  else
+    {
+      ferr("ERROR: Unsupported RPC type: %" PRId32 "\n", tmp);
+      return -EOPNOTSUPP;
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -763,8 +801,6 @@ int rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
                     int version, FAR void *request, size_t reqlen,
                     FAR void *response, size_t resplen)
 {
-  FAR struct rpc_reply_header *replymsg;
-  uint32_t tmp;
   uint32_t xid;
   int retries = 0;
   int error = 0;
@@ -838,26 +874,68 @@ int rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
       return error;
     }
 
-  /* Break down the RPC header and check if it is OK */
+  return rpcclnt_checkreply(response);
+}
 
-  replymsg = (FAR struct rpc_reply_header *)response;
+/****************************************************************************
+ * Name: rpcclnt_send_call
+ *
+ * Description:
+ *   Send an RPC CALL message without waiting for the reply, so that several
+ *   calls can be outstanding at the same time.  The transaction id of the
+ *   call is returned in 'xid'.  The replies are collected with
+ *   rpcclnt_recv_reply() and matched to their calls by transaction id.
+ *   There is no re-transmission here: the caller must re-issue any call
+ *   whose reply does not arrive, with rpcclnt_request() for example.
+ *
+ ****************************************************************************/
 
-  tmp = fxdr_unsigned(uint32_t, replymsg->type);
-  if (tmp != RPC_MSGACCEPTED)
-    {
-      return -EOPNOTSUPP;
-    }
+int rpcclnt_send_call(FAR struct rpcclnt *rpc, int procnum, int prog,
+                      int version, FAR void *request, size_t reqlen,
+                      FAR uint32_t *xid)
+{
+  *xid = ++rpc->rc_xid;
 
-  tmp = fxdr_unsigned(uint32_t, replymsg->status);
-  if (tmp == RPC_SUCCESS)
+  rpcclnt_fmtheader((FAR struct rpc_call_header *)request,
+                    *xid, prog, version, procnum);
+
+  rpc_statistics(rpcrequests);
+  return rpcclnt_send(rpc, request,
+                      reqlen + sizeof(struct rpc_call_header));
+}
+
+/****************************************************************************
+ * Name: rpcclnt_recv_reply
+ *
+ * Description:
+ *   Receive the next RPC reply, whichever call it answers, and verify its
+ *   RPC level.  The transaction id of the reply is returned in 'xid', or
+ *   zero if no reply could be received.
+ *
+ ****************************************************************************/
+
+int rpcclnt_recv_reply(FAR struct rpcclnt *rpc, FAR void *response,
+                       size_t resplen, FAR uint32_t *xid)
+{
+  FAR struct rpc_reply_header *replyheader =
+    (FAR struct rpc_reply_header *)response;
+  int error;
+
+  *xid  = 0;
+  error = rpcclnt_receive(rpc, response, resplen);
+  if (error != OK)
     {
-      finfo("RPC_SUCCESS\n");
+      ferr("ERROR: rpcclnt_receive returned: %d\n", error);
+      return error;
     }
-  else
+
+  if (replyheader->rp_direction != rpc_reply)
     {
-      ferr("ERROR: Unsupported RPC type: %" PRId32 "\n", tmp);
-      return -EOPNOTSUPP;
+      ferr("ERROR: Different RPC REPLY returned\n");
+      rpc_statistics(rpcinvalid);
+      return -EPROTO;
     }
 
-  return OK;
+  *xid = fxdr_unsigned(uint32_t, replyheader->rp_xid);
+  return rpcclnt_checkreply(response);
 }
@@ -153,6 +153,16 @@
 #define INODE_STATE_FILE          (CONFIG_NXFFS_ERASEDSTATE ^ 0x22)
 #define INODE_STATE_DELETED       (CONFIG_NXFFS_ERASEDSTATE ^ 0xaa)
 
+/* Values for the checkpoint state.  The checkpoint is valid only while
+ * its state is still erased:
+ *
+ * CHECKPOINT_STATE_VALID - The limits match the volume on FLASH.
+ * CHECKPOINT_STATE_STALE - The volume was modified after the checkpoint.
+ */
+
+#define CHECKPOINT_STATE_VALID    CONFIG_NXFFS_ERASEDSTATE
+#define CHECKPOINT_STATE_STALE    (CONFIG_NXFFS_ERASEDSTATE ^ 0xff)
+
 /* Number of bytes in an the NXFFS magic sequences */
 
 #define NXFFS_MAGICSIZE           4
@@ -210,6 +220,21 @@ struct nxffs_data_s
 };
 #define SIZEOF_NXFFS_DATA_HDR 10
 
+/* This structure defines the packed checkpoint of the file system limits
+ * that is saved at the beginning of the erase block after the volume.
+ */
+
+struct nxffs_checkpoint_s
+{
+  uint8_t                   magic[4];    /* 0-3: Magic number */
+  uint8_t                   state;       /* 4: See CHECKPOINT_STATE_* */
+  uint8_t                   crc[4];      /* 5-8: CRC32 of bytes 9-20 */
+  uint8_t                   nblocks[4];  /* 9-12: R/W blocks on volume */
+  uint8_t                   inoffset[4]; /* 13-16: First valid inode */
+  uint8_t                   froffset[4]; /* 17-20: First free byte */
+};
+#define SIZEOF_NXFFS_CHECKPOINT 21
+
 /* This is an in-memory representation of the NXFFS inode as extracted from
  * FLASH and with additional state information.
  */
@@ -279,6 +304,9 @@ struct nxffs_volume_s
   FAR struct nxffs_ofile_s *ofiles;    /* A singly-linked list of open files */
   FAR uint8_t              *cache;     /* On cached erase block for general I/O */
   FAR uint8_t              *pack;      /* A full erase block to support packing */
+#ifdef CONFIG_NXFFS_CHECKPOINT
+  bool                      cpvalid;   /* Checkpoint on FLASH is current */
+#endif
 };
 
 /* This structure describes the state of the blocks on the NXFFS volume */
@@ -354,6 +382,74 @@ extern struct nxffs_volume_s g_volume;
 
 int nxffs_limits(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_cpload
+ *
+ * Description:
+ *   Restore the file system limits from the checkpoint saved at the last
+ *   clean unmount, in place of nxffs_blockstats() and nxffs_limits().
+ *
+ * Input Parameters:
+ *   volume - Identifies the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero if the limits were restored.  A negated errno value is returned
+ *   if there is no usable checkpoint and the volume must be scanned.
+ *
+ * Defined in nxffs_checkpoint.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_CHECKPOINT
+int nxffs_cpload(FAR struct nxffs_volume_s *volume);
+#endif
+
+/****************************************************************************
+ * Name: nxffs_cpsave
+ *
+ * Description:
+ *   Save the file system limits so that the next mount can skip scanning
+ *   the volume.  The caller must hold the volume lock.
+ *
+ * Input Parameters:
+ *   volume - Identifies the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno on a failure.
+ *
+ * Defined in nxffs_checkpoint.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_CHECKPOINT
+int nxffs_cpsave(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_cpsave(v) (OK)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_cpinvalidate
+ *
+ * Description:
+ *   Mark the checkpoint stale.  This must be called before anything on the
+ *   volume is modified.
+ *
+ * Input Parameters:
+ *   volume - Identifies the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno on a failure.
+ *
+ * Defined in nxffs_checkpoint.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_CHECKPOINT
+int nxffs_cpinvalidate(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_cpinvalidate(v) (OK)
+#endif
+
 /****************************************************************************
  * Name: nxffs_rdle16
  *
@@ -1070,6 +1166,7 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume);
  * - nxffs_read() is defined in nxffs_read.c
  * - nxffs_write() is defined in nxffs_write.c
  * - nxffs_ioctl() is defined in nxffs_ioctl.c
+ * - nxffs_sync() is defined in nxffs_checkpoint.c
  * - nxffs_dup() is defined in nxffs_open.c
  * - nxffs_opendir(), nxffs_readdir(), and nxffs_rewindir() are defined in
  *   nxffs_dirent.c
@@ -1092,6 +1189,9 @@ ssize_t nxffs_read(FAR struct file *filep, FAR char *buffer, size_t buflen);
 ssize_t nxffs_write(FAR struct file *filep, FAR const char *buffer,
                     size_t buflen);
 int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg);
+#ifdef CONFIG_NXFFS_CHECKPOINT
+int nxffs_sync(FAR struct file *filep);
+#endif
 
 int nxffs_dup(FAR const struct file *oldp, FAR struct file *newp);
 int nxffs_fstat(FAR const struct file *filep, FAR struct stat *buf);
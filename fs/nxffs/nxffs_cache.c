@@ -97,6 +97,15 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block)
 int nxffs_wrcache(FAR struct nxffs_volume_s *volume)
 {
   size_t nxfrd;
+  int ret;
+
+  /* The volume is about to change, so the checkpoint no longer holds */
+
+  ret = nxffs_cpinvalidate(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
 
   /* Write the current block from the cache */
 
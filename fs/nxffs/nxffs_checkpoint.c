@@ -0,0 +1,326 @@
+/****************************************************************************
+ * fs/nxffs/nxffs_checkpoint.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/crc32.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "nxffs.h"
+
+#ifdef CONFIG_NXFFS_CHECKPOINT
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The checkpoint occupies the first logical block of the erase block that
+ * follows the last erase block of the volume.
+ */
+
+#define NXFFS_CPBLOCK(v)  ((off_t)(v)->geo.neraseblocks * (v)->blkper)
+
+/* The CRC covers everything after the CRC field */
+
+#define NXFFS_CPCRCOFFS   offsetof(struct nxffs_checkpoint_s, nblocks)
+#define NXFFS_CPCRC(c) \
+  crc32((FAR const uint8_t *)(c) + NXFFS_CPCRCOFFS, \
+        SIZEOF_NXFFS_CHECKPOINT - NXFFS_CPCRCOFFS)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The magic number that appears that the beginning of the checkpoint */
+
+static const uint8_t g_cpmagic[NXFFS_MAGICSIZE] =
+{
+  'C', 'k', 'p', 't'
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_cpwrite
+ *
+ * Description:
+ *   Write the checkpoint block image in volume->pack to FLASH with the
+ *   given state.
+ *
+ ****************************************************************************/
+
+static int nxffs_cpwrite(FAR struct nxffs_volume_s *volume, uint8_t state)
+{
+  FAR struct nxffs_checkpoint_s *cp;
+  ssize_t nxfrd;
+
+  cp        = (FAR struct nxffs_checkpoint_s *)volume->pack;
+  cp->state = state;
+
+  nxfrd = MTD_BWRITE(volume->mtd, NXFFS_CPBLOCK(volume), 1, volume->pack);
+  if (nxfrd != 1)
+    {
+      ferr("ERROR: Write checkpoint block %jd failed: %zd\n",
+           (intmax_t)NXFFS_CPBLOCK(volume), nxfrd);
+      return -EIO;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_cpimage
+ *
+ * Description:
+ *   Build the in-memory image of the checkpoint block in volume->pack.
+ *
+ ****************************************************************************/
+
+static void nxffs_cpimage(FAR struct nxffs_volume_s *volume)
+{
+  FAR struct nxffs_checkpoint_s *cp;
+
+  memset(volume->pack, CONFIG_NXFFS_ERASEDSTATE, volume->geo.blocksize);
+
+  cp = (FAR struct nxffs_checkpoint_s *)volume->pack;
+  memcpy(cp->magic, g_cpmagic, NXFFS_MAGICSIZE);
+  nxffs_wrle32(cp->nblocks, volume->nblocks);
+  nxffs_wrle32(cp->inoffset, volume->inoffset);
+  nxffs_wrle32(cp->froffset, volume->froffset);
+  nxffs_wrle32(cp->crc, NXFFS_CPCRC(cp));
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_cpload
+ *
+ * Description:
+ *   Restore the file system limits from the checkpoint saved at the last
+ *   clean unmount, in place of nxffs_blockstats() and nxffs_limits().
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero if the limits were restored.  A negated errno value is returned
+ *   if there is no usable checkpoint and the volume must be scanned.
+ *
+ ****************************************************************************/
+
+int nxffs_cpload(FAR struct nxffs_volume_s *volume)
+{
+  FAR struct nxffs_checkpoint_s *cp;
+  off_t inoffset;
+  off_t froffset;
+  off_t volsize;
+  ssize_t nxfrd;
+
+  nxfrd = MTD_BREAD(volume->mtd, NXFFS_CPBLOCK(volume), 1, volume->pack);
+  if (nxfrd != 1)
+    {
+      ferr("ERROR: Read checkpoint block %jd failed: %zd\n",
+           (intmax_t)NXFFS_CPBLOCK(volume), nxfrd);
+      return -EIO;
+    }
+
+  /* The checkpoint is valid only while its state is still erased */
+
+  cp = (FAR struct nxffs_checkpoint_s *)volume->pack;
+  if (memcmp(cp->magic, g_cpmagic, NXFFS_MAGICSIZE) != 0 ||
+      cp->state != CHECKPOINT_STATE_VALID ||
+      nxffs_rdle32(cp->crc) != NXFFS_CPCRC(cp))
+    {
+      finfo("No valid checkpoint\n");
+      return -ENOENT;
+    }
+
+  inoffset = nxffs_rdle32(cp->inoffset);
+  froffset = nxffs_rdle32(cp->froffset);
+  volsize  = volume->nblocks * volume->geo.blocksize;
+
+  if (nxffs_rdle32(cp->nblocks) != volume->nblocks ||
+      inoffset > froffset || froffset > volsize)
+    {
+      ferr("ERROR: Checkpoint does not match the volume\n");
+      return -EINVAL;
+    }
+
+  volume->inoffset = inoffset;
+  volume->froffset = froffset;
+  volume->cpvalid  = true;
+
+  finfo("Checkpoint inoffset: %jd froffset: %jd\n",
+        (intmax_t)inoffset, (intmax_t)froffset);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_cpsave
+ *
+ * Description:
+ *   Save the file system limits so that the next mount can skip scanning
+ *   the volume.  Nothing is done if the checkpoint on FLASH is still valid
+ *   or if a file is open for writing.  The caller must hold the volume
+ *   lock.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno on a failure.
+ *
+ ****************************************************************************/
+
+int nxffs_cpsave(FAR struct nxffs_volume_s *volume)
+{
+  FAR struct nxffs_ofile_s *ofile;
+  int ret;
+
+  if (volume->cpvalid)
+    {
+      return OK;
+    }
+
+  /* The limits of a volume with a writer still open are not final */
+
+  for (ofile = volume->ofiles; ofile; ofile = ofile->flink)
+    {
+      if ((ofile->oflags & O_WROK) != 0)
+        {
+          return OK;
+        }
+    }
+
+  ret = MTD_ERASE(volume->mtd, volume->geo.neraseblocks, 1);
+  if (ret < 0)
+    {
+      ferr("ERROR: Erase checkpoint block failed: %d\n", ret);
+      return ret;
+    }
+
+  /* The state is left erased, so the checkpoint is valid once written */
+
+  nxffs_cpimage(volume);
+  ret = nxffs_cpwrite(volume, CHECKPOINT_STATE_VALID);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  volume->cpvalid = true;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_cpinvalidate
+ *
+ * Description:
+ *   Mark the checkpoint stale before the volume is modified for the first
+ *   time after it was loaded or saved.  Once it is stale, an unclean
+ *   shutdown makes the next mount scan the volume.
+ *
+ *   This rewrites the checkpoint block as read back with only the state
+ *   changed, which burns bits from the erased to the non-erased state.
+ *   volume->pack is free to use here because nxffs_pack() and
+ *   nxffs_reformat() invalidate the checkpoint before they use it.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno on a failure.
+ *
+ ****************************************************************************/
+
+int nxffs_cpinvalidate(FAR struct nxffs_volume_s *volume)
+{
+  ssize_t nxfrd;
+  int ret;
+
+  if (!volume->cpvalid)
+    {
+      return OK;
+    }
+
+  nxfrd = MTD_BREAD(volume->mtd, NXFFS_CPBLOCK(volume), 1, volume->pack);
+  if (nxfrd != 1)
+    {
+      ferr("ERROR: Read checkpoint block %jd failed: %zd\n",
+           (intmax_t)NXFFS_CPBLOCK(volume), nxfrd);
+      return -EIO;
+    }
+
+  ret = nxffs_cpwrite(volume, CHECKPOINT_STATE_STALE);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  volume->cpvalid = false;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_sync
+ *
+ * Description:
+ *   There is no buffered data, but fsync() on any NXFFS file saves the
+ *   checkpoint if no file is open for writing.
+ *
+ ****************************************************************************/
+
+int nxffs_sync(FAR struct file *filep)
+{
+  FAR struct nxffs_volume_s *volume;
+  int ret;
+
+  volume = filep->f_inode->i_private;
+  DEBUGASSERT(volume != NULL);
+
+  ret = nxmutex_lock(&volume->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = nxffs_cpsave(volume);
+  nxmutex_unlock(&volume->lock);
+  return ret;
+}
+
+#endif /* CONFIG_NXFFS_CHECKPOINT */
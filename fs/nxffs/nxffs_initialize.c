@@ -61,7 +61,11 @@ const struct mountpt_operations g_nxffs_operations =
   NULL,              /* truncate */
 #endif
 
+#ifdef CONFIG_NXFFS_CHECKPOINT
+  nxffs_sync,        /* sync */
+#else
   NULL,              /* sync -- No buffered data */
+#endif
   nxffs_dup,         /* dup */
   nxffs_fstat,       /* fstat */
   NULL,              /* fchstat */
@@ -216,10 +220,37 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
    */
 
   volume->blkper  = volume->geo.erasesize / volume->geo.blocksize;
+
+#ifdef CONFIG_NXFFS_CHECKPOINT
+  /* The last erase block holds the checkpoint and is not part of the
+   * volume.
+   */
+
+  if (volume->geo.neraseblocks < 2)
+    {
+      ferr("ERROR: No room for the checkpoint\n");
+      ret = -ENOSPC;
+      goto errout_with_buffer;
+    }
+
+  volume->geo.neraseblocks--;
+#endif
+
   volume->nblocks = volume->geo.neraseblocks * volume->blkper;
   DEBUGASSERT((off_t)volume->blkper * volume->geo.blocksize ==
               volume->geo.erasesize);
 
+#ifdef CONFIG_NXFFS_CHECKPOINT
+  /* After a clean unmount the limits are restored from the checkpoint and
+   * neither nxffs_blockstats() nor nxffs_limits() has to scan the volume.
+   */
+
+  if (nxffs_cpload(volume) == OK)
+    {
+      return OK;
+    }
+#endif
+
 #ifdef CONFIG_NXFFS_SCAN_VOLUME
   /* Check if there is a valid NXFFS file system on the flash */
 
@@ -558,11 +589,31 @@ int nxffs_unbind(FAR void *handle, FAR struct inode **blkdriver,
    * open file references.
    */
 
+  int ret;
+
   if (flags != 0)
     {
       return -ENOSYS;
     }
 
-  return g_volume.ofiles ? -EBUSY : OK;
+  ret = nxmutex_lock(&g_volume.lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (g_volume.ofiles)
+    {
+      ret = -EBUSY;
+    }
+  else
+    {
+      /* Save the limits so that the next mount does not scan the volume */
+
+      nxffs_cpsave(&g_volume);
+    }
+
+  nxmutex_unlock(&g_volume.lock);
+  return ret;
 #endif
 }
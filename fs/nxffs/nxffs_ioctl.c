@@ -104,7 +104,19 @@ int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
     }
   else
     {
-      /* Command not recognized, forward to the MTD driver */
+      /* Command not recognized, forward to the MTD driver.  Anything but
+       * a query may change the FLASH under the checkpoint.
+       */
+
+      if (cmd != MTDIOC_GEOMETRY && cmd != BIOC_XIPBASE &&
+          cmd != BIOC_PARTINFO && cmd != MTDIOC_ERASESTATE)
+        {
+          ret = nxffs_cpinvalidate(volume);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+        }
 
       ret = MTD_IOCTL(volume->mtd, cmd, arg);
     }
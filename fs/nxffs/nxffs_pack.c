@@ -1274,6 +1274,14 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume)
   int i;
   int ret = OK;
 
+  /* Packing rewrites the volume and reuses the buffer of the checkpoint */
+
+  ret = nxffs_cpinvalidate(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Get the offset to the first valid inode entry */
 
   wrfile = NULL;
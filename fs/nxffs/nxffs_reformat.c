@@ -270,6 +270,14 @@ int nxffs_reformat(FAR struct nxffs_volume_s *volume)
 {
   int ret;
 
+  /* Nothing that the checkpoint describes survives the reformat */
+
+  ret = nxffs_cpinvalidate(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Erase and reformat the entire volume */
 
   ret = nxffs_format(volume);
@@ -239,10 +239,31 @@ static ssize_t critmon_read_cpu(FAR struct critmon_file_s *attr,
 
   /* Generate output for maximum time in a critical section */
 
+  linesize = procfs_snprintf(attr->line, CRITMON_LINELEN, "%lu.%09lu,",
+                             (unsigned long)maxtime.tv_sec,
+                             (unsigned long)maxtime.tv_nsec);
+  copysize = procfs_memcpy(attr->line, linesize, buffer, remaining,
+                           offset);
+
+  totalsize += copysize;
+  buffer    += copysize;
+  remaining -= copysize;
+
+  if (totalsize >= buflen)
+    {
+      return totalsize;
+    }
+
+  /* Generate output for the total time the CPU was busy.  Unlike the
+   * maxima, it is never reset.
+   */
+
+  clock_perf2time(g_busy_time[cpu], &maxtime);
   linesize = procfs_snprintf(attr->line, CRITMON_LINELEN, "%lu.%09lu\n",
                              (unsigned long)maxtime.tv_sec,
                              (unsigned long)maxtime.tv_nsec);
-  copysize = procfs_memcpy(attr->line, linesize, buffer, buflen, offset);
+  copysize = procfs_memcpy(attr->line, linesize, buffer, remaining,
+                           offset);
 
   totalsize += copysize;
   return totalsize;
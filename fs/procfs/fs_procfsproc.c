@@ -43,6 +43,7 @@
 #  include <time.h>
 #endif
 
+#include <nuttx/clock.h>
 #include <nuttx/irq.h>
 #include <nuttx/tls.h>
 #include <nuttx/sched.h>
@@ -852,7 +853,7 @@ static ssize_t proc_critmon(FAR struct proc_file_s *procfile,
   /* Reset the maximum */
 
   tcb->run_max = 0;
-  up_perf_convert(tcb->run_time, &runtime);
+  clock_perf2time(tcb->run_time, &runtime);
 
   /* Output the maximum time the thread has run and
    * the total time the thread has run
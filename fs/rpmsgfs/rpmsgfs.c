@@ -36,6 +36,8 @@
 #include <debug.h>
 #include <limits.h>
 
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
 #include <nuttx/lib/lib.h>
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
@@ -49,6 +51,10 @@
 
 #define RPMSGFS_RETRY_DELAY_MS       10
 
+/* Number of paths in the attribute cache */
+
+#define RPMSGFS_ATTRCACHE_SIZE       8
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -69,8 +75,26 @@ struct rpmsgfs_ofile_s
   int16_t                    crefs;    /* Reference count */
   mode_t                     oflags;   /* Open mode */
   int                        fd;
+#if CONFIG_FS_RPMSGFS_BUFSIZE > 0
+  int8_t                     buffered; /* 1 yes, 0 no, -1 not known yet */
+  bool                       dirty;    /* Buffer holds data to write */
+  FAR char                   *buf;     /* Read-ahead/write-behind buffer */
+  size_t                     buflen;   /* Bytes of valid data in buf */
+  size_t                     bufpos;   /* Bytes of read-ahead data consumed */
+#endif
 };
 
+#if CONFIG_FS_RPMSGFS_ATTRCACHE_MS > 0
+/* One cached stat() result */
+
+struct rpmsgfs_attr_s
+{
+  FAR char                   *path;    /* Remote path, NULL if unused */
+  clock_t                    time;     /* When the attributes were fetched */
+  struct stat                buf;      /* The attributes */
+};
+#endif
+
 /* This structure represents the overall mountpoint state.  An instance of
  * this structure is retained as inode private data on each mountpoint that
  * is mounted with a rpmsgfs filesystem.
@@ -84,6 +108,10 @@ struct rpmsgfs_mountpt_s
   void                       *handle;
   int                        timeout;  /* Connect timeout */
   struct statfs              statfs;
+#if CONFIG_FS_RPMSGFS_ATTRCACHE_MS > 0
+  struct rpmsgfs_attr_s      attr[RPMSGFS_ATTRCACHE_SIZE];
+  unsigned int               attrnext; /* Next attribute entry to replace */
+#endif
 };
 
 /****************************************************************************
@@ -266,6 +294,355 @@ static void rpmsgfs_mkpath(FAR struct rpmsgfs_mountpt_s *fs,
     }
 }
 
+#if CONFIG_FS_RPMSGFS_ATTRCACHE_MS > 0
+/****************************************************************************
+ * Name: rpmsgfs_attr_invalidate
+ *
+ * Description: Forget all cached attributes.  Called for every change made
+ *   through the mount point.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_attr_invalidate(FAR struct rpmsgfs_mountpt_s *fs)
+{
+  int i;
+
+  for (i = 0; i < RPMSGFS_ATTRCACHE_SIZE; i++)
+    {
+      kmm_free(fs->attr[i].path);
+      fs->attr[i].path = NULL;
+    }
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_attr_lookup
+ *
+ * Description: Get the cached attributes of a path if they have not timed
+ *   out.
+ *
+ ****************************************************************************/
+
+static bool rpmsgfs_attr_lookup(FAR struct rpmsgfs_mountpt_s *fs,
+                                FAR const char *path, FAR struct stat *buf)
+{
+  clock_t now = clock_systime_ticks();
+  int i;
+
+  for (i = 0; i < RPMSGFS_ATTRCACHE_SIZE; i++)
+    {
+      FAR struct rpmsgfs_attr_s *attr = &fs->attr[i];
+
+      if (attr->path != NULL && strcmp(attr->path, path) == 0)
+        {
+          if (now - attr->time < MSEC2TICK(CONFIG_FS_RPMSGFS_ATTRCACHE_MS))
+            {
+              memcpy(buf, &attr->buf, sizeof(*buf));
+              return true;
+            }
+
+          break;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_attr_add
+ *
+ * Description: Remember the attributes of a path, replacing an older
+ *   entry for the same path or else the entries in turn.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_attr_add(FAR struct rpmsgfs_mountpt_s *fs,
+                             FAR const char *path,
+                             FAR const struct stat *buf)
+{
+  FAR struct rpmsgfs_attr_s *attr = NULL;
+  int i;
+
+  for (i = 0; i < RPMSGFS_ATTRCACHE_SIZE; i++)
+    {
+      if (fs->attr[i].path != NULL && strcmp(fs->attr[i].path, path) == 0)
+        {
+          attr = &fs->attr[i];
+          break;
+        }
+    }
+
+  if (attr == NULL)
+    {
+      size_t len = strlen(path) + 1;
+
+      attr = &fs->attr[fs->attrnext];
+      fs->attrnext = (fs->attrnext + 1) % RPMSGFS_ATTRCACHE_SIZE;
+
+      kmm_free(attr->path);
+      attr->path = kmm_malloc(len);
+      if (attr->path == NULL)
+        {
+          return;
+        }
+
+      memcpy(attr->path, path, len);
+    }
+
+  attr->time = clock_systime_ticks();
+  memcpy(&attr->buf, buf, sizeof(*buf));
+}
+#else
+#  define rpmsgfs_attr_invalidate(fs)
+#  define rpmsgfs_attr_lookup(fs, path, buf) false
+#  define rpmsgfs_attr_add(fs, path, buf)
+#endif
+
+#if CONFIG_FS_RPMSGFS_BUFSIZE > 0
+/****************************************************************************
+ * Name: rpmsgfs_buffered
+ *
+ * Description: Check whether an open file uses the read-ahead/write-behind
+ *   buffer, allocating the buffer on first use.  Only regular files are
+ *   buffered: read-ahead data is given back by seeking the remote file.
+ *
+ ****************************************************************************/
+
+static bool rpmsgfs_buffered(FAR struct rpmsgfs_mountpt_s *fs,
+                             FAR struct rpmsgfs_ofile_s *hf)
+{
+  struct stat buf;
+
+  if (hf->buffered < 0)
+    {
+      hf->buffered = 0;
+      if (rpmsgfs_client_fstat(fs->handle, hf->fd, &buf) >= 0 &&
+          S_ISREG(buf.st_mode))
+        {
+          hf->buf = kmm_malloc(CONFIG_FS_RPMSGFS_BUFSIZE);
+          hf->buffered = hf->buf != NULL;
+        }
+    }
+
+  return hf->buffered > 0;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_flush
+ *
+ * Description: Send the gathered writes of a file, or give back the unread
+ *   read-ahead data by moving the remote file position back.  Must be
+ *   called before anything that depends on the remote file position or
+ *   contents.  If the writes fail, the data not written is kept.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_flush(FAR struct rpmsgfs_mountpt_s *fs,
+                         FAR struct rpmsgfs_ofile_s *hf)
+{
+  ssize_t ret = OK;
+  size_t nwritten = 0;
+
+  if (hf->dirty)
+    {
+      /* The server may write less than asked, send the rest again */
+
+      while (nwritten < hf->buflen)
+        {
+          ret = rpmsgfs_client_write(fs->handle, hf->fd,
+                                     hf->buf + nwritten,
+                                     hf->buflen - nwritten);
+          if (ret <= 0)
+            {
+              /* Keep what was not written for the next attempt */
+
+              hf->buflen -= nwritten;
+              memmove(hf->buf, hf->buf + nwritten, hf->buflen);
+              return ret < 0 ? ret : -EIO;
+            }
+
+          nwritten += ret;
+        }
+    }
+  else if (hf->bufpos < hf->buflen)
+    {
+      ret = rpmsgfs_client_lseek(fs->handle, hf->fd,
+                                 -(off_t)(hf->buflen - hf->bufpos),
+                                 SEEK_CUR);
+    }
+
+  hf->dirty  = false;
+  hf->buflen = 0;
+  hf->bufpos = 0;
+  return ret < 0 ? ret : OK;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_flush_writes
+ *
+ * Description: Send the gathered writes of a file, if there are any.  Any
+ *   read-ahead data is kept.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_flush_writes(FAR struct rpmsgfs_mountpt_s *fs,
+                                FAR struct rpmsgfs_ofile_s *hf)
+{
+  return hf->dirty ? rpmsgfs_flush(fs, hf) : OK;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_flush_dirty
+ *
+ * Description: Send the gathered writes of every open file of the mount.
+ *   Open files do not remember their path, so this is done before any
+ *   remote lookup by path that has to see the current file sizes.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_flush_dirty(FAR struct rpmsgfs_mountpt_s *fs)
+{
+  FAR struct rpmsgfs_ofile_s *hf;
+  int ret = OK;
+  int ret2;
+
+  for (hf = fs->fs_head; hf != NULL; hf = hf->fnext)
+    {
+      ret2 = rpmsgfs_flush_writes(fs, hf);
+      if (ret2 < 0 && ret >= 0)
+        {
+          ret = ret2;
+        }
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_bufread
+ *
+ * Description: Read through the read-ahead buffer.  Data left in the buffer
+ *   is served first; reads at least as large as the buffer go directly to
+ *   the caller's buffer.
+ *
+ ****************************************************************************/
+
+static ssize_t rpmsgfs_bufread(FAR struct rpmsgfs_mountpt_s *fs,
+                               FAR struct rpmsgfs_ofile_s *hf,
+                               FAR char *buffer, size_t buflen)
+{
+  size_t nread = 0;
+  ssize_t ret = 0;
+
+  /* Only gathered writes must go out first, read-ahead data is kept */
+
+  ret = rpmsgfs_flush_writes(fs, hf);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (!rpmsgfs_buffered(fs, hf))
+    {
+      return rpmsgfs_client_read(fs->handle, hf->fd, buffer, buflen);
+    }
+
+  while (nread < buflen)
+    {
+      size_t avail = hf->buflen - hf->bufpos;
+
+      if (avail > 0)
+        {
+          if (avail > buflen - nread)
+            {
+              avail = buflen - nread;
+            }
+
+          memcpy(buffer + nread, hf->buf + hf->bufpos, avail);
+          hf->bufpos += avail;
+          nread      += avail;
+        }
+      else if (buflen - nread >= CONFIG_FS_RPMSGFS_BUFSIZE)
+        {
+          ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer + nread,
+                                    buflen - nread);
+          if (ret > 0)
+            {
+              nread += ret;
+            }
+
+          break;
+        }
+      else
+        {
+          ret = rpmsgfs_client_read(fs->handle, hf->fd, hf->buf,
+                                    CONFIG_FS_RPMSGFS_BUFSIZE);
+          if (ret <= 0)
+            {
+              break;
+            }
+
+          hf->buflen = ret;
+          hf->bufpos = 0;
+
+          /* Stop after a short read, the file has no more data */
+
+          if ((size_t)ret < buflen - nread)
+            {
+              buflen = nread + ret;
+            }
+        }
+    }
+
+  return nread > 0 ? (ssize_t)nread : ret;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_bufwrite
+ *
+ * Description: Gather small writes in the write-behind buffer.  Writes at
+ *   least as large as the buffer are sent directly.
+ *
+ ****************************************************************************/
+
+static ssize_t rpmsgfs_bufwrite(FAR struct rpmsgfs_mountpt_s *fs,
+                                FAR struct rpmsgfs_ofile_s *hf,
+                                FAR const char *buffer, size_t buflen)
+{
+  int ret;
+
+  /* Drop any read-ahead data and send the gathered writes if they do not
+   * fit together with these.
+   */
+
+  if (!hf->dirty || hf->buflen + buflen > CONFIG_FS_RPMSGFS_BUFSIZE)
+    {
+      ret = rpmsgfs_flush(fs, hf);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  if (buflen >= CONFIG_FS_RPMSGFS_BUFSIZE || !rpmsgfs_buffered(fs, hf))
+    {
+      return rpmsgfs_client_write(fs->handle, hf->fd, buffer, buflen);
+    }
+
+  memcpy(hf->buf + hf->buflen, buffer, buflen);
+  hf->buflen += buflen;
+  hf->dirty   = true;
+  return buflen;
+}
+#else
+#  define rpmsgfs_flush(fs, hf) OK
+#  define rpmsgfs_flush_writes(fs, hf) OK
+#  define rpmsgfs_flush_dirty(fs) OK
+#  define rpmsgfs_bufread(fs, hf, buffer, buflen) \
+     rpmsgfs_client_read((fs)->handle, (hf)->fd, buffer, buflen)
+#  define rpmsgfs_bufwrite(fs, hf, buffer, buflen) \
+     rpmsgfs_client_write((fs)->handle, (hf)->fd, buffer, buflen)
+#endif
+
 /****************************************************************************
  * Name: rpmsgfs_open
  ****************************************************************************/
@@ -302,7 +679,7 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
 
   /* Allocate memory for the open file */
 
-  hf = kmm_malloc(sizeof *hf);
+  hf = kmm_zalloc(sizeof *hf);
   if (hf == NULL)
     {
       ret = -ENOMEM;
@@ -324,6 +701,15 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
       goto errout_with_buffer;
     }
 
+#if CONFIG_FS_RPMSGFS_BUFSIZE > 0
+  hf->buffered = -1;
+#endif
+
+  if ((oflags & (O_CREAT | O_TRUNC)) != 0)
+    {
+      rpmsgfs_attr_invalidate(fs);
+    }
+
   /* In write/append mode, we need to set the file pointer to the end of the
    * file.
    */
@@ -447,18 +833,22 @@ static int rpmsgfs_close(FAR struct file *filep)
         }
     }
 
-  /* Close the host file */
+  /* Send any gathered writes and close the host file */
 
+  ret = rpmsgfs_flush(fs, hf);
   rpmsgfs_client_close(fs->handle, hf->fd);
 
   /* Now free the pointer */
 
   filep->f_priv = NULL;
+#if CONFIG_FS_RPMSGFS_BUFSIZE > 0
+  kmm_free(hf->buf);
+#endif
   kmm_free(hf);
 
 okout:
   nxmutex_unlock(&fs->fs_lock);
-  return OK;
+  return ret;
 }
 
 /****************************************************************************
@@ -495,7 +885,7 @@ static ssize_t rpmsgfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Call the host to perform the read */
 
-  ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer, buflen);
+  ret = rpmsgfs_bufread(fs, hf, buffer, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -547,10 +937,11 @@ static ssize_t rpmsgfs_write(FAR struct file *filep, const char *buffer,
 
   /* Call the host to perform the write */
 
-  ret = rpmsgfs_client_write(fs->handle, hf->fd, buffer, buflen);
+  ret = rpmsgfs_bufwrite(fs, hf, buffer, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
+      rpmsgfs_attr_invalidate(fs);
     }
 
 errout_with_lock:
@@ -589,6 +980,30 @@ static off_t rpmsgfs_seek(FAR struct file *filep, off_t offset, int whence)
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_BUFSIZE > 0
+  /* Unread read-ahead data can simply be dropped, the seek moves the
+   * remote file position anyway.
+   */
+
+  if (!hf->dirty)
+    {
+      if (whence == SEEK_CUR)
+        {
+          offset -= (off_t)(hf->buflen - hf->bufpos);
+        }
+
+      hf->buflen = 0;
+      hf->bufpos = 0;
+    }
+#endif
+
+  ret = rpmsgfs_flush(fs, hf);
+  if (ret < 0)
+    {
+      nxmutex_unlock(&fs->fs_lock);
+      return ret;
+    }
+
   /* Call our internal routine to perform the seek */
 
   ret = rpmsgfs_client_lseek(fs->handle, hf->fd, offset, whence);
@@ -634,7 +1049,12 @@ static int rpmsgfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
   /* Call our internal routine to perform the ioctl */
 
-  ret = rpmsgfs_client_ioctl(fs->handle, hf->fd, cmd, arg);
+  ret = rpmsgfs_flush(fs, hf);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_ioctl(fs->handle, hf->fd, cmd, arg);
+    }
+
   if (ret == 0 && (cmd == FIONBIO || cmd == FIOCLEX || cmd == FIONCLEX))
     {
       ret = -ENOTTY;
@@ -679,10 +1099,11 @@ static int rpmsgfs_sync(FAR struct file *filep)
       return ret;
     }
 
+  ret = rpmsgfs_flush(fs, hf);
   rpmsgfs_client_sync(fs->handle, hf->fd);
 
   nxmutex_unlock(&fs->fs_lock);
-  return OK;
+  return ret;
 }
 
 /****************************************************************************
@@ -753,9 +1174,15 @@ static int rpmsgfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
       return ret;
     }
 
-  /* Call the host to perform the read */
+  /* Call the host to perform the fstat, with the gathered writes sent so
+   * that the size is right.
+   */
 
-  ret = rpmsgfs_client_fstat(fs->handle, hf->fd, buf);
+  ret = rpmsgfs_flush_writes(fs, hf);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_fstat(fs->handle, hf->fd, buf);
+    }
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -801,7 +1228,13 @@ static int rpmsgfs_fchstat(FAR const struct file *filep,
 
   /* Call the host to perform the change */
 
-  ret = rpmsgfs_client_fchstat(fs->handle, hf->fd, buf, flags);
+  ret = rpmsgfs_flush(fs, hf);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_fchstat(fs->handle, hf->fd, buf, flags);
+    }
+
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -842,7 +1275,13 @@ static int rpmsgfs_truncate(FAR struct file *filep, off_t length)
 
   /* Call the host to perform the truncate */
 
-  ret = rpmsgfs_client_ftruncate(fs->handle, hf->fd, length);
+  ret = rpmsgfs_flush(fs, hf);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_ftruncate(fs->handle, hf->fd, length);
+    }
+
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1190,6 +1629,7 @@ static int rpmsgfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
       return ret;
     }
 
+  rpmsgfs_attr_invalidate(fs);
   nxmutex_destroy(&fs->fs_lock);
   kmm_free(fs);
   return 0;
@@ -1273,6 +1713,7 @@ static int rpmsgfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host fs to perform the unlink */
 
   ret = rpmsgfs_client_unlink(fs->handle, path);
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1313,6 +1754,7 @@ static int rpmsgfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the mkdir */
 
   ret = rpmsgfs_client_mkdir(fs->handle, path, mode);
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1354,6 +1796,7 @@ int rpmsgfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host FS to do the mkdir */
 
   ret = rpmsgfs_client_rmdir(fs->handle, path);
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1398,6 +1841,7 @@ int rpmsgfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
   /* Call the host FS to do the mkdir */
 
   ret = rpmsgfs_client_rename(fs->handle, oldpath, newpath);
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1435,9 +1879,29 @@ static int rpmsgfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
   rpmsgfs_mkpath(fs, relpath, path, sizeof(path));
 
-  /* Call the host FS to do the stat operation */
+  /* Call the host FS to do the stat operation, unless the attributes are
+   * still in the cache.  Writes gathered on open files are sent first so
+   * that neither the caller nor the cache sees a stale size.  Every write
+   * drops the cache, so a cached entry is never older than the last one.
+   */
 
-  ret = rpmsgfs_client_stat(fs->handle, path, buf);
+  if (rpmsgfs_attr_lookup(fs, path, buf))
+    {
+      ret = OK;
+    }
+  else
+    {
+      ret = rpmsgfs_flush_dirty(fs);
+      if (ret >= 0)
+        {
+          ret = rpmsgfs_client_stat(fs->handle, path, buf);
+        }
+
+      if (ret >= 0)
+        {
+          rpmsgfs_attr_add(fs, path, buf);
+        }
+    }
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1478,6 +1942,7 @@ static int rpmsgfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the chstat operation */
 
   ret = rpmsgfs_client_chstat(fs->handle, path, buf, flags);
+  rpmsgfs_attr_invalidate(fs);
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
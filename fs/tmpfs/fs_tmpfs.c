@@ -49,8 +49,8 @@
 #  warning CONFIG_FS_TMPFS_DIRECTORY_FREEGUARD needs to be > ALLOCGUARD
 #endif
 
-#if CONFIG_FS_TMPFS_FILE_FREEGUARD <= CONFIG_FS_TMPFS_FILE_ALLOCGUARD
-#  warning CONFIG_FS_TMPFS_FILE_FREEGUARD needs to be > ALLOCGUARD
+#if CONFIG_FS_TMPFS_PAGESIZE <= 0
+#  error CONFIG_FS_TMPFS_PAGESIZE must be positive
 #endif
 
 #define tmpfs_lock(fs) \
@@ -89,8 +89,15 @@ struct tmpfs_dir_s
 
 static int  tmpfs_realloc_directory(FAR struct tmpfs_directory_s *tdo,
               unsigned int nentries);
-static int  tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
+static int  tmpfs_grow_pages(FAR struct tmpfs_file_s *tfo, size_t npages);
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+              size_t index, bool alloc);
+static void tmpfs_free_pages(FAR struct tmpfs_file_s *tfo, size_t first);
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo);
+static void tmpfs_resize_file(FAR struct tmpfs_file_s *tfo,
               size_t newsize);
+static int  tmpfs_map_pages(FAR struct tmpfs_file_s *tfo, size_t first,
+                            size_t npages);
 static void tmpfs_release_lockedobject(FAR struct tmpfs_object_s *to);
 static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo);
 static int  tmpfs_release_file(FAR struct tmpfs_file_s *tfo);
@@ -258,61 +265,315 @@ static int tmpfs_realloc_directory(FAR struct tmpfs_directory_s *tdo,
 }
 
 /****************************************************************************
- * Name: tmpfs_realloc_file
+ * Name: tmpfs_grow_pages
+ *
+ * Description:
+ *   Make room for at least npages entries in the page table of the file.
+ *
  ****************************************************************************/
 
-static int tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
-                              size_t newsize)
+static int tmpfs_grow_pages(FAR struct tmpfs_file_s *tfo, size_t npages)
 {
-  FAR uint8_t *newdata;
-  size_t allocsize;
-  size_t delta;
+  FAR uint8_t **newpages;
+  size_t count;
+
+  if (npages <= tfo->tfo_npages)
+    {
+      return OK;
+    }
+
+  /* Double the table each time so that appending to a file does not copy
+   * the table over and over again.
+   */
 
-  /* Are we growing or shrinking the object? */
+  count = tfo->tfo_npages * 2;
+  if (count < npages)
+    {
+      count = npages;
+    }
 
-  if (newsize <= tfo->tfo_alloc)
+  newpages = kmm_realloc(tfo->tfo_pages, count * sizeof(FAR uint8_t *));
+  if (newpages == NULL)
     {
-      /* Shrinking ... Shrink unconditionally if the size is shrinking to
-       * zero.
+      return -ENOMEM;
+    }
+
+  memset(&newpages[tfo->tfo_npages], 0,
+         (count - tfo->tfo_npages) * sizeof(FAR uint8_t *));
+
+  tfo->tfo_pages  = newpages;
+  tfo->tfo_npages = count;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tmpfs_get_page
+ *
+ * Description:
+ *   Return the page that holds the data at page index 'index' of the file.
+ *   A hole in the file returns NULL unless 'alloc' is true, in which case
+ *   a zeroed page is allocated for it.
+ *
+ ****************************************************************************/
+
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+                                   size_t index, bool alloc)
+{
+  FAR uint8_t *page = NULL;
+
+  if (index < tfo->tfo_npages)
+    {
+      page = tfo->tfo_pages[index];
+    }
+
+  if (page == NULL && alloc && tmpfs_grow_pages(tfo, index + 1) >= 0)
+    {
+      page = kmm_zalloc(TMPFS_PAGESIZE);
+      if (page != NULL)
+        {
+          tfo->tfo_pages[index] = page;
+          tfo->tfo_alloc       += TMPFS_PAGESIZE;
+        }
+    }
+
+  return page;
+}
+
+/****************************************************************************
+ * Name: tmpfs_free_pages
+ *
+ * Description:
+ *   Free the pages of the file from page index 'first' on.  Pages that live
+ *   in the contiguous mapping block are left alone.
+ *
+ ****************************************************************************/
+
+static void tmpfs_free_pages(FAR struct tmpfs_file_s *tfo, size_t first)
+{
+  size_t i;
+
+  for (i = first; i < tfo->tfo_npages; i++)
+    {
+      if (tfo->tfo_pages[i] != NULL && !TMPFS_INMAP(tfo, i))
+        {
+          kmm_free(tfo->tfo_pages[i]);
+          tfo->tfo_pages[i] = NULL;
+          tfo->tfo_alloc   -= TMPFS_PAGESIZE;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: tmpfs_free_data
+ *
+ * Description:
+ *   Release all memory holding the data of the file.
+ *
+ ****************************************************************************/
+
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo)
+{
+  tmpfs_free_pages(tfo, 0);
+  kmm_free(tfo->tfo_map);
+  kmm_free(tfo->tfo_pages);
+
+  tfo->tfo_alloc    = 0;
+  tfo->tfo_npages   = 0;
+  tfo->tfo_mapfirst = 0;
+  tfo->tfo_mappages = 0;
+  tfo->tfo_pages    = NULL;
+  tfo->tfo_map      = NULL;
+}
+
+/****************************************************************************
+ * Name: tmpfs_resize_file
+ *
+ * Description:
+ *   Set the size of the file.  Growing the file only creates a hole; the
+ *   pages are allocated when they are written.  Shrinking the file frees
+ *   the pages past the new end unless the file is mapped.
+ *
+ ****************************************************************************/
+
+static void tmpfs_resize_file(FAR struct tmpfs_file_s *tfo,
+                              size_t newsize)
+{
+  FAR uint8_t *page;
+  size_t first;
+  size_t last;
+  size_t end;
+  size_t i;
+
+  if (newsize < tfo->tfo_size)
+    {
+      /* Clear the discarded bytes that stay in memory so that they read
+       * back as zeroes if the file grows again.
        */
 
-      if (newsize > 0)
+      if (TMPFS_PAGEOFF(newsize) != 0)
         {
-          /* Otherwise, don't realloc unless the object has shrunk by a
-           * lot.
-           */
+          page = tmpfs_get_page(tfo, TMPFS_PAGE(newsize), false);
+          if (page != NULL)
+            {
+              memset(page + TMPFS_PAGEOFF(newsize), 0,
+                     TMPFS_PAGESIZE - TMPFS_PAGEOFF(newsize));
+            }
+        }
 
-          delta = tfo->tfo_alloc - newsize;
-          if (delta <= CONFIG_FS_TMPFS_FILE_FREEGUARD)
+      first = TMPFS_NPAGES(newsize);
+      if (tfo->tfo_nmaps > 0)
+        {
+          /* Mapped memory must stay where it is */
+
+          last = TMPFS_NPAGES(tfo->tfo_size);
+          for (i = first; i < last && i < tfo->tfo_npages; i++)
             {
-              /* Hasn't shrunk enough.. Return doing nothing for now */
+              if (tfo->tfo_pages[i] != NULL)
+                {
+                  memset(tfo->tfo_pages[i], 0, TMPFS_PAGESIZE);
+                }
+            }
+        }
+      else if (newsize == 0)
+        {
+          tmpfs_free_data(tfo);
+        }
+      else
+        {
+          /* The pages of the mapping block stay allocated */
 
-              tfo->tfo_size = newsize;
-              return OK;
+          end = tfo->tfo_mapfirst + tfo->tfo_mappages;
+          if (first < end)
+            {
+              i = first > tfo->tfo_mapfirst ? first : tfo->tfo_mapfirst;
+              memset(tfo->tfo_map +
+                     (i - tfo->tfo_mapfirst) * TMPFS_PAGESIZE, 0,
+                     (end - i) * TMPFS_PAGESIZE);
             }
+
+          tmpfs_free_pages(tfo, first);
         }
     }
 
-  /* Added some additional amount to the new size to account frequent
-   * reallocations.
+  tfo->tfo_size = newsize;
+}
+
+/****************************************************************************
+ * Name: tmpfs_map_pages
+ *
+ * Description:
+ *   Move the npages pages of the file from page index 'first' on into one
+ *   contiguous block so that a range spanning several pages can be mapped.
+ *   Pages of an earlier block outside of that range get memory of their
+ *   own again.
+ *
+ ****************************************************************************/
+
+static int tmpfs_map_pages(FAR struct tmpfs_file_s *tfo, size_t first,
+                           size_t npages)
+{
+  FAR uint8_t *oldmap = tfo->tfo_map;
+  size_t oldfirst = tfo->tfo_mapfirst;
+  size_t oldend = oldfirst + tfo->tfo_mappages;
+  FAR uint8_t *map;
+  FAR uint8_t *page;
+  size_t nmoved = 0;
+  size_t i;
+  int ret;
+
+  if (first >= oldfirst && first + npages <= oldend)
+    {
+      return OK;
+    }
+
+  /* Existing mappings would be left pointing to freed memory.  Let the
+   * caller fall back to a copy of the range.
    */
 
-  allocsize = newsize + CONFIG_FS_TMPFS_FILE_ALLOCGUARD;
+  if (tfo->tfo_nmaps > 0)
+    {
+      return -ENOTTY;
+    }
 
-  /* Realloc the file object */
+  ret = tmpfs_grow_pages(tfo, first + npages);
+  if (ret < 0)
+    {
+      return ret;
+    }
 
-  newdata = kmm_realloc(tfo->tfo_data, allocsize);
-  if (newdata == NULL)
+  map = kmm_malloc(npages * TMPFS_PAGESIZE);
+  if (map == NULL)
     {
       return -ENOMEM;
     }
 
-  /* Return the new address of the reallocated file object */
+  /* Pages of the old block that are not in the new one are copied out */
+
+  for (i = oldfirst; i < oldend; i++)
+    {
+      if (i >= first && i < first + npages)
+        {
+          continue;
+        }
+
+      page = kmm_malloc(TMPFS_PAGESIZE);
+      if (page == NULL)
+        {
+          goto errout_with_pages;
+        }
 
-  tfo->tfo_alloc = allocsize;
-  tfo->tfo_size  = newsize;
-  tfo->tfo_data  = newdata;
+      memcpy(page, tfo->tfo_pages[i], TMPFS_PAGESIZE);
+      tfo->tfo_pages[i] = page;
+      nmoved++;
+    }
+
+  /* Copy the pages into the block, releasing those that had memory of
+   * their own.  The pages of the old block are released with the block.
+   */
+
+  for (i = 0; i < npages; i++)
+    {
+      page = tfo->tfo_pages[first + i];
+      if (page != NULL)
+        {
+          memcpy(map + i * TMPFS_PAGESIZE, page, TMPFS_PAGESIZE);
+          if (first + i < oldfirst || first + i >= oldend)
+            {
+              kmm_free(page);
+              tfo->tfo_alloc -= TMPFS_PAGESIZE;
+            }
+        }
+      else
+        {
+          memset(map + i * TMPFS_PAGESIZE, 0, TMPFS_PAGESIZE);
+        }
+
+      tfo->tfo_pages[first + i] = map + i * TMPFS_PAGESIZE;
+    }
+
+  tfo->tfo_alloc += (nmoved + npages) * TMPFS_PAGESIZE;
+  tfo->tfo_alloc -= tfo->tfo_mappages * TMPFS_PAGESIZE;
+  kmm_free(oldmap);
+  tfo->tfo_map      = map;
+  tfo->tfo_mapfirst = first;
+  tfo->tfo_mappages = npages;
   return OK;
+
+errout_with_pages:
+
+  /* Put back the pages already copied out of the old block */
+
+  while (i-- > oldfirst)
+    {
+      if (i < first || i >= first + npages)
+        {
+          kmm_free(tfo->tfo_pages[i]);
+          tfo->tfo_pages[i] = oldmap + (i - oldfirst) * TMPFS_PAGESIZE;
+        }
+    }
+
+  kmm_free(map);
+  return -ENOMEM;
 }
 
 /****************************************************************************
@@ -352,7 +613,7 @@ static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo)
     {
       tmpfs_unlock_file(tfo);
       nxrmutex_destroy(&tfo->tfo_lock);
-      kmm_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       kmm_free(tfo);
     }
 
@@ -543,12 +804,17 @@ static FAR struct tmpfs_file_s *tmpfs_alloc_file(void)
    * locked with one reference count.
    */
 
-  tfo->tfo_alloc = 0;
-  tfo->tfo_type  = TMPFS_REGULAR;
-  tfo->tfo_refs  = 1;
-  tfo->tfo_flags = 0;
-  tfo->tfo_size  = 0;
-  tfo->tfo_data  = NULL;
+  tfo->tfo_alloc    = 0;
+  tfo->tfo_type     = TMPFS_REGULAR;
+  tfo->tfo_refs     = 1;
+  tfo->tfo_flags    = 0;
+  tfo->tfo_nmaps    = 0;
+  tfo->tfo_size     = 0;
+  tfo->tfo_npages   = 0;
+  tfo->tfo_mapfirst = 0;
+  tfo->tfo_mappages = 0;
+  tfo->tfo_pages    = NULL;
+  tfo->tfo_map      = NULL;
 
   nxrmutex_init(&tfo->tfo_lock);
   tmpfs_lock_file(tfo);
@@ -1098,8 +1364,16 @@ static int tmpfs_statfs_callout(FAR struct tmpfs_directory_s *tdo,
        */
 
       tmptfo             = (FAR struct tmpfs_file_s *)to;
-      tmpbuf->tsf_alloc += sizeof(struct tmpfs_file_s);
-      tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+      tmpbuf->tsf_alloc += sizeof(struct tmpfs_file_s) +
+                           tmptfo->tfo_npages * sizeof(FAR uint8_t *);
+
+      /* Holes in sparse files take no memory */
+
+      if (to->to_alloc > tmptfo->tfo_size)
+        {
+          tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+        }
+
       tmpbuf->tsf_files++;
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
@@ -1175,7 +1449,7 @@ static int tmpfs_free_callout(FAR struct tmpfs_directory_s *tdo,
           return TMPFS_UNLINKED;
         }
 
-      kmm_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
     {
@@ -1348,11 +1622,7 @@ static int tmpfs_open(FAR struct file *filep, FAR const char *relpath,
 
           if (tfo->tfo_size > 0)
             {
-              ret = tmpfs_realloc_file(tfo, 0);
-              if (ret < 0)
-                {
-                  goto errout_with_filelock;
-                }
+              tmpfs_resize_file(tfo, 0);
             }
         }
     }
@@ -1454,9 +1724,13 @@ static ssize_t tmpfs_read(FAR struct file *filep, FAR char *buffer,
                           size_t buflen)
 {
   FAR struct tmpfs_file_s *tfo;
+  FAR uint8_t *page;
   ssize_t nread;
   off_t startpos;
   off_t endpos;
+  size_t offset;
+  size_t chunk;
+  size_t remaining;
   int ret;
 
   finfo("filep: %p buffer: %p buflen: %lu\n",
@@ -1494,18 +1768,35 @@ static ssize_t tmpfs_read(FAR struct file *filep, FAR char *buffer,
       nread  = endpos - startpos;
     }
 
-  /* Copy data from the memory object to the user buffer */
+  /* Copy data from the file pages to the user buffer, page by page.
+   * Holes read as zeroes.
+   */
 
-  if (tfo->tfo_data != NULL)
-    {
-      memcpy(buffer, &tfo->tfo_data[startpos], nread);
-      filep->f_pos += nread;
-    }
-  else
+  for (remaining = nread; remaining > 0; remaining -= chunk)
     {
-      DEBUGASSERT(tfo->tfo_size == 0 && nread == 0);
+      offset = TMPFS_PAGEOFF(startpos);
+      chunk  = TMPFS_PAGESIZE - offset;
+      if (chunk > remaining)
+        {
+          chunk = remaining;
+        }
+
+      page = tmpfs_get_page(tfo, TMPFS_PAGE(startpos), false);
+      if (page != NULL)
+        {
+          memcpy(buffer, page + offset, chunk);
+        }
+      else
+        {
+          memset(buffer, 0, chunk);
+        }
+
+      buffer   += chunk;
+      startpos += chunk;
     }
 
+  filep->f_pos += nread;
+
   /* Release the lock on the file */
 
   tmpfs_unlock_file(tfo);
@@ -1520,9 +1811,11 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
                            size_t buflen)
 {
   FAR struct tmpfs_file_s *tfo;
+  FAR uint8_t *page;
   ssize_t nwritten;
   off_t startpos;
-  off_t endpos;
+  size_t offset;
+  size_t chunk;
   int ret;
 
   finfo("filep: %p buffer: %p buflen: %lu\n",
@@ -1541,33 +1834,41 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
       return ret;
     }
 
-  /* Handle attempts to write beyond the end of the file */
+  /* Copy data from the user buffer to the file pages, page by page,
+   * allocating pages as needed.  Writing past the end of the file leaves
+   * a hole between the old end and the new data.
+   */
 
   startpos = filep->f_pos;
-  nwritten = buflen;
-  endpos   = startpos + buflen;
-
-  if (endpos > tfo->tfo_size)
+  for (nwritten = 0; (size_t)nwritten < buflen; nwritten += chunk)
     {
-      /* Reallocate the file to handle the write past the end of the file. */
+      offset = TMPFS_PAGEOFF(startpos);
+      chunk  = TMPFS_PAGESIZE - offset;
+      if (chunk > buflen - nwritten)
+        {
+          chunk = buflen - nwritten;
+        }
 
-      ret = tmpfs_realloc_file(tfo, (size_t)endpos);
-      if (ret < 0)
+      page = tmpfs_get_page(tfo, TMPFS_PAGE(startpos), true);
+      if (page == NULL)
         {
-          goto errout_with_lock;
+          break;
         }
-    }
 
-  /* Copy data from the memory object to the user buffer */
+      memcpy(page + offset, buffer + nwritten, chunk);
+      startpos += chunk;
+    }
 
-  if (tfo->tfo_data != NULL)
+  if (nwritten == 0 && buflen > 0)
     {
-      memcpy(&tfo->tfo_data[startpos], buffer, nwritten);
-      filep->f_pos += nwritten;
+      ret = -ENOMEM;
+      goto errout_with_lock;
     }
-  else
+
+  filep->f_pos = startpos;
+  if (startpos > tfo->tfo_size)
     {
-      DEBUGASSERT(tfo->tfo_size == 0 && nwritten == 0);
+      tfo->tfo_size = startpos;
     }
 
   /* Release the lock on the file */
@@ -1654,7 +1955,12 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
       ret = mm_map_remove(get_group_mm(group), entry);
       if (ret >= 0)
         {
-          ret = tmpfs_release_file(tfo);
+          ret = tmpfs_lock_file(tfo);
+          if (ret >= 0)
+            {
+              tfo->tfo_nmaps--;
+              tmpfs_release_lockedfile(tfo);
+            }
         }
     }
 
@@ -1665,9 +1971,12 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
   else
     {
       entry->length = offset;
-      tmpfs_lock_file(tfo);
-      ret = tmpfs_realloc_file(tfo, offset);
-      tmpfs_unlock_file(tfo);
+      ret = tmpfs_lock_file(tfo);
+      if (ret >= 0)
+        {
+          tmpfs_resize_file(tfo, offset);
+          tmpfs_unlock_file(tfo);
+        }
     }
 
   return ret;
@@ -1676,7 +1985,10 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
 static int tmpfs_mmap(FAR struct file *filep, FAR struct mm_map_entry_s *map)
 {
   FAR struct tmpfs_file_s *tfo;
-  int ret = -EINVAL;
+  FAR uint8_t *page;
+  size_t first;
+  size_t last;
+  int ret;
 
   DEBUGASSERT(filep->f_priv != NULL);
 
@@ -1686,22 +1998,83 @@ static int tmpfs_mmap(FAR struct file *filep, FAR struct mm_map_entry_s *map)
 
   DEBUGASSERT(tfo != NULL);
 
-  if (map->offset >= 0 && map->offset < tfo->tfo_size &&
-      map->length && map->offset + map->length <= tfo->tfo_size)
+  ret = tmpfs_lock_file(tfo);
+  if (ret < 0)
     {
-      map->vaddr = tfo->tfo_data + map->offset;
-      map->priv.p = tfo;
-      map->munmap = tmpfs_unmap;
-      ret = mm_map_add(get_current_mm(), map);
+      return ret;
+    }
 
-      if (ret >= 0)
+  if (map->offset < 0 || map->offset >= tfo->tfo_size ||
+      map->length == 0 || map->offset + map->length > tfo->tfo_size)
+    {
+      ret = -EINVAL;
+      goto errout_with_lock;
+    }
+
+  /* Each mapping holds a reference and pins the pages.  Neither count may
+   * wrap, or the pages would be freed while they are still mapped.
+   */
+
+  if (tfo->tfo_refs >= UINT8_MAX || tfo->tfo_nmaps >= UINT16_MAX)
+    {
+      ret = -ENOMEM;
+      goto errout_with_lock;
+    }
+
+  first = TMPFS_PAGE(map->offset);
+  last  = TMPFS_PAGE(map->offset + map->length - 1);
+
+  if (first == last && !TMPFS_INMAP(tfo, first))
+    {
+      /* The range lies within one page, map the page in place */
+
+      page = tmpfs_get_page(tfo, first, true);
+      if (page == NULL)
         {
-          tmpfs_lock_file(tfo);
-          tfo->tfo_refs++;
-          tmpfs_unlock_file(tfo);
+          ret = -ENOMEM;
+          goto errout_with_lock;
+        }
+
+      map->vaddr = page + TMPFS_PAGEOFF(map->offset);
+    }
+  else
+    {
+      /* The range spans pages, they have to be contiguous in memory.
+       * Only the pages of the range are moved.
+       */
+
+      ret = tmpfs_map_pages(tfo, first, last - first + 1);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
         }
+
+      map->vaddr = tfo->tfo_map +
+                   (map->offset - tfo->tfo_mapfirst * TMPFS_PAGESIZE);
     }
 
+  /* Hold a reference and pin the pages before the mapping becomes
+   * visible.
+   */
+
+  tfo->tfo_refs++;
+  tfo->tfo_nmaps++;
+  tmpfs_unlock_file(tfo);
+
+  map->priv.p = tfo;
+  map->munmap = tmpfs_unmap;
+  ret = mm_map_add(get_current_mm(), map);
+  if (ret < 0)
+    {
+      tmpfs_lock_file(tfo);
+      tfo->tfo_nmaps--;
+      tmpfs_release_lockedfile(tfo);
+    }
+
+  return ret;
+
+errout_with_lock:
+  tmpfs_unlock_file(tfo);
   return ret;
 }
 
@@ -1824,31 +2197,18 @@ static int tmpfs_truncate(FAR struct file *filep, off_t length)
   oldsize = tfo->tfo_size;
   if (oldsize != length)
     {
-      /* The size is changing.. up or down.  Reallocate the file memory. */
-
-      ret = tmpfs_realloc_file(tfo, (size_t)length);
-      if (ret < 0)
-        {
-          goto errout_with_lock;
-        }
-
-      /* If the size has increased, then we need to zero the newly added
-       * memory.
+      /* The size is changing.. up or down.  Growing the file leaves a hole
+       * that reads as zeroes, shrinking it releases the pages past the new
+       * end.
        */
 
-      if (length > oldsize)
-        {
-          memset(&tfo->tfo_data[oldsize], 0, length - oldsize);
-        }
-
-      ret = OK;
+      tmpfs_resize_file(tfo, (size_t)length);
     }
 
   /* Release the lock on the file */
 
-errout_with_lock:
   tmpfs_unlock_file(tfo);
-  return ret;
+  return OK;
 }
 
 /****************************************************************************
@@ -2282,7 +2642,7 @@ static int tmpfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   else
     {
       nxrmutex_destroy(&tfo->tfo_lock);
-      kmm_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       kmm_free(tfo);
     }
 
@@ -40,6 +40,19 @@
 
 #define TFO_FLAG_UNLINKED (1 << 0)  /* Bit 0: File is unlinked */
 
+/* File data is held in pages of this size */
+
+#define TMPFS_PAGESIZE   CONFIG_FS_TMPFS_PAGESIZE
+#define TMPFS_PAGE(o)    ((size_t)(o) / TMPFS_PAGESIZE)
+#define TMPFS_PAGEOFF(o) ((size_t)(o) % TMPFS_PAGESIZE)
+#define TMPFS_NPAGES(s)  (((size_t)(s) + TMPFS_PAGESIZE - 1) / TMPFS_PAGESIZE)
+
+/* Is page 'i' of the file held in the contiguous mapping block? */
+
+#define TMPFS_INMAP(tfo, i) \
+  ((i) >= (tfo)->tfo_mapfirst && \
+   (i) - (tfo)->tfo_mapfirst < (tfo)->tfo_mappages)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -107,6 +120,14 @@ struct tmpfs_directory_s
  * state.  The file memory object also serves as the open file object,
  * saving an allocation.  This has the negative side effect that no per-
  * open state can be retained (such as open flags).
+ *
+ * The file data is held in pages of TMPFS_PAGESIZE bytes.  A NULL page is
+ * a hole that reads as zeroes.  Bytes beyond tfo_size are always zero.
+ * Mapping a range that spans several pages moves the pages of that range
+ * into one contiguous block, tfo_map; the tfo_mappages entries of
+ * tfo_pages from tfo_mapfirst on then point into that block rather than
+ * to pages of their own.  Pages are never moved or freed while the file
+ * is mapped.
  */
 
 struct tmpfs_file_s
@@ -121,9 +142,14 @@ struct tmpfs_file_s
 
   /* Remaining fields are unique to a directory object */
 
-  uint8_t       tfo_flags; /* See TFO_FLAG_* definitions */
-  size_t        tfo_size;  /* Valid file size */
-  FAR uint8_t  *tfo_data;  /* File data starts here */
+  uint8_t       tfo_flags;    /* See TFO_FLAG_* definitions */
+  uint16_t      tfo_nmaps;    /* Number of memory mappings of the file */
+  size_t        tfo_size;     /* Valid file size */
+  size_t        tfo_npages;   /* Number of entries in tfo_pages */
+  size_t        tfo_mapfirst; /* First page held in tfo_map */
+  size_t        tfo_mappages; /* Number of pages held in tfo_map */
+  FAR uint8_t **tfo_pages;    /* File data, one pointer per page */
+  FAR uint8_t  *tfo_map;      /* Contiguous pages for mmap */
 };
 
 /* This structure represents one instance of a TMPFS file system */
@@ -40,6 +40,8 @@
 #include <fixedmath.h>
 #include <debug.h>
 
+#include <nuttx/crc32.h>
+#include <nuttx/kmalloc.h>
 #include <nuttx/lib/lib.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
@@ -49,6 +51,34 @@
 
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_UNIONFS)
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_UNIONFS_LOOKUP_CACHE
+#  define CONFIG_FS_UNIONFS_LOOKUP_CACHE 0
+#endif
+
+/* Initial number of slots in the directory index hash table */
+
+#define UNIONFS_DIRINDEX_INIT  16
+
+/* Size of the buffer used to copy a file to the upper file system */
+
+#define UNIONFS_COPYUP_BUFSIZE 512
+
+#ifndef CONFIG_FS_UNIONFS_DIRINDEX
+#  define unionfs_dirindex_add(udir, name)
+#  define unionfs_dirindex_find(udir, name) true
+#  define unionfs_dirindex_reset(udir)
+#endif
+
+#if CONFIG_FS_UNIONFS_LOOKUP_CACHE == 0
+#  define unionfs_lookup_missing(ui, relpath, ndx) false
+#  define unionfs_lookup_setmissing(ui, relpath, ndx)
+#  define unionfs_lookup_flush(ui)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -61,7 +91,24 @@ struct unionfs_dir_s
   bool fu_prefix[2];                   /* True: Fake directory in prefix */
   FAR char *fu_relpath;                /* Path being enumerated */
   FAR struct fs_dirent_s *fu_lower[2]; /* dirent struct used by contained file system */
+#ifdef CONFIG_FS_UNIONFS_DIRINDEX
+  FAR uint32_t *fu_index;              /* Hashes of names on file system 1 */
+  uint16_t fu_nindex;                  /* Number of names in fu_index */
+  uint16_t fu_maxindex;                /* Number of slots in fu_index */
+  bool fu_noindex;                     /* True: Index incomplete, use stat */
+#endif
+};
+
+#if CONFIG_FS_UNIONFS_LOOKUP_CACHE > 0
+/* This structure describes one entry of the negative lookup cache */
+
+struct unionfs_lookup_s
+{
+  uint32_t ul_hash;                  /* CRC-32 of ul_path */
+  uint8_t ul_missing;                /* Bit n set: Not on file system n */
+  char ul_path[CONFIG_FS_UNIONFS_LOOKUP_PATHLEN];
 };
+#endif
 
 /* This structure describes one contained file system mountpoint */
 
@@ -79,6 +126,13 @@ struct unionfs_inode_s
   mutex_t ui_lock;                   /* Enforces mutually exclusive access */
   int16_t ui_nopen;                  /* Number of open references */
   bool ui_unmounted;                 /* File system has been unmounted */
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  bool ui_copyup;                    /* File system 2 is read-only lower */
+#endif
+#if CONFIG_FS_UNIONFS_LOOKUP_CACHE > 0
+  uint8_t ui_nextlookup;             /* Next lookup cache entry to replace */
+  struct unionfs_lookup_s ui_lookup[CONFIG_FS_UNIONFS_LOOKUP_CACHE];
+#endif
 };
 
 /* This structure descries one opened file */
@@ -130,6 +184,26 @@ static FAR char *unionfs_relpath(FAR const char *path,
 
 static int     unionfs_unbind_child(FAR struct unionfs_mountpt_s *um);
 static void    unionfs_destroy(FAR struct unionfs_inode_s *ui);
+#ifdef CONFIG_FS_UNIONFS_DIRINDEX
+static void    unionfs_dirindex_add(FAR struct unionfs_dir_s *udir,
+                 FAR const char *name);
+static bool    unionfs_dirindex_find(FAR struct unionfs_dir_s *udir,
+                 FAR const char *name);
+static void    unionfs_dirindex_reset(FAR struct unionfs_dir_s *udir);
+#endif
+#if CONFIG_FS_UNIONFS_LOOKUP_CACHE > 0
+static bool    unionfs_lookup_missing(FAR struct unionfs_inode_s *ui,
+                 FAR const char *relpath, int ndx);
+static void    unionfs_lookup_setmissing(FAR struct unionfs_inode_s *ui,
+                 FAR const char *relpath, int ndx);
+static void    unionfs_lookup_flush(FAR struct unionfs_inode_s *ui);
+#endif
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+static int     unionfs_copyup_parents(FAR struct unionfs_inode_s *ui,
+                 FAR const char *relpath);
+static int     unionfs_copyup(FAR struct unionfs_inode_s *ui,
+                 FAR const char *relpath, int oflags);
+#endif
 
 /* Operations on opened files (with struct file) */
 
@@ -838,6 +912,490 @@ static void unionfs_destroy(FAR struct unionfs_inode_s *ui)
   kmm_free(ui);
 }
 
+/****************************************************************************
+ * Name: unionfs_dirindex_hash
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_UNIONFS_DIRINDEX
+static uint32_t unionfs_dirindex_hash(FAR const char *name)
+{
+  uint32_t hash = crc32((FAR const uint8_t *)name, strlen(name));
+
+  /* Zero marks an empty slot */
+
+  return hash != 0 ? hash : 1;
+}
+
+/****************************************************************************
+ * Name: unionfs_dirindex_insert
+ ****************************************************************************/
+
+static void unionfs_dirindex_insert(FAR uint32_t *index, uint16_t maxindex,
+                                    uint32_t hash)
+{
+  uint16_t slot = hash & (maxindex - 1);
+
+  while (index[slot] != 0 && index[slot] != hash)
+    {
+      slot = (slot + 1) & (maxindex - 1);
+    }
+
+  index[slot] = hash;
+}
+
+/****************************************************************************
+ * Name: unionfs_dirindex_add
+ *
+ * Description:
+ *   Remember a name reported from file system 1.  If the index cannot be
+ *   grown, it is marked incomplete and every later lookup falls back to
+ *   stat().
+ *
+ ****************************************************************************/
+
+static void unionfs_dirindex_add(FAR struct unionfs_dir_s *udir,
+                                 FAR const char *name)
+{
+  FAR uint32_t *index;
+  uint16_t maxindex;
+  uint16_t i;
+
+  if (udir->fu_noindex)
+    {
+      return;
+    }
+
+  /* Keep the table at most 3/4 full */
+
+  if ((udir->fu_nindex + 1) * 4 > udir->fu_maxindex * 3)
+    {
+      maxindex = udir->fu_maxindex != 0 ? udir->fu_maxindex * 2 :
+                                          UNIONFS_DIRINDEX_INIT;
+      index    = maxindex > udir->fu_maxindex ?
+                 kmm_zalloc(maxindex * sizeof(uint32_t)) : NULL;
+      if (index == NULL)
+        {
+          udir->fu_noindex = true;
+          return;
+        }
+
+      for (i = 0; i < udir->fu_maxindex; i++)
+        {
+          if (udir->fu_index[i] != 0)
+            {
+              unionfs_dirindex_insert(index, maxindex, udir->fu_index[i]);
+            }
+        }
+
+      if (udir->fu_index != NULL)
+        {
+          kmm_free(udir->fu_index);
+        }
+
+      udir->fu_index    = index;
+      udir->fu_maxindex = maxindex;
+    }
+
+  unionfs_dirindex_insert(udir->fu_index, udir->fu_maxindex,
+                          unionfs_dirindex_hash(name));
+  udir->fu_nindex++;
+}
+
+/****************************************************************************
+ * Name: unionfs_dirindex_find
+ *
+ * Description:
+ *   Return false if the name was definitely not reported from file
+ *   system 1.  A true return must be confirmed by the caller.
+ *
+ ****************************************************************************/
+
+static bool unionfs_dirindex_find(FAR struct unionfs_dir_s *udir,
+                                  FAR const char *name)
+{
+  uint32_t hash;
+  uint16_t slot;
+
+  if (udir->fu_noindex)
+    {
+      return true;
+    }
+
+  if (udir->fu_maxindex == 0)
+    {
+      return false;
+    }
+
+  hash = unionfs_dirindex_hash(name);
+  slot = hash & (udir->fu_maxindex - 1);
+
+  while (udir->fu_index[slot] != 0)
+    {
+      if (udir->fu_index[slot] == hash)
+        {
+          return true;
+        }
+
+      slot = (slot + 1) & (udir->fu_maxindex - 1);
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: unionfs_dirindex_reset
+ ****************************************************************************/
+
+static void unionfs_dirindex_reset(FAR struct unionfs_dir_s *udir)
+{
+  if (udir->fu_index != NULL)
+    {
+      memset(udir->fu_index, 0, udir->fu_maxindex * sizeof(uint32_t));
+    }
+
+  udir->fu_nindex  = 0;
+  udir->fu_noindex = false;
+}
+#endif /* CONFIG_FS_UNIONFS_DIRINDEX */
+
+/****************************************************************************
+ * Name: unionfs_lookup_find
+ *
+ * Description:
+ *   Find the negative lookup cache entry of a path.  The caller must hold
+ *   ui_lock.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FS_UNIONFS_LOOKUP_CACHE > 0
+static FAR struct unionfs_lookup_s *
+unionfs_lookup_find(FAR struct unionfs_inode_s *ui, FAR const char *relpath,
+                    uint32_t hash)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_UNIONFS_LOOKUP_CACHE; i++)
+    {
+      FAR struct unionfs_lookup_s *ul = &ui->ui_lookup[i];
+
+      if (ul->ul_missing != 0 && ul->ul_hash == hash &&
+          strcmp(ul->ul_path, relpath) == 0)
+        {
+          return ul;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: unionfs_lookup_missing
+ *
+ * Description:
+ *   Return true if relpath is known not to exist on file system ndx.
+ *
+ ****************************************************************************/
+
+static bool unionfs_lookup_missing(FAR struct unionfs_inode_s *ui,
+                                   FAR const char *relpath, int ndx)
+{
+  FAR struct unionfs_lookup_s *ul;
+
+  ul = unionfs_lookup_find(ui, relpath,
+                           crc32((FAR const uint8_t *)relpath,
+                                 strlen(relpath)));
+  return ul != NULL && (ul->ul_missing & (1 << ndx)) != 0;
+}
+
+/****************************************************************************
+ * Name: unionfs_lookup_setmissing
+ *
+ * Description:
+ *   Record that relpath does not exist on file system ndx.
+ *
+ ****************************************************************************/
+
+static void unionfs_lookup_setmissing(FAR struct unionfs_inode_s *ui,
+                                      FAR const char *relpath, int ndx)
+{
+  FAR struct unionfs_lookup_s *ul;
+  size_t len = strlen(relpath);
+  uint32_t hash;
+
+  if (len >= CONFIG_FS_UNIONFS_LOOKUP_PATHLEN)
+    {
+      return;
+    }
+
+  hash = crc32((FAR const uint8_t *)relpath, len);
+  ul   = unionfs_lookup_find(ui, relpath, hash);
+  if (ul == NULL)
+    {
+      /* Replace the entries in round-robin order */
+
+      ul = &ui->ui_lookup[ui->ui_nextlookup];
+      if (++ui->ui_nextlookup >= CONFIG_FS_UNIONFS_LOOKUP_CACHE)
+        {
+          ui->ui_nextlookup = 0;
+        }
+
+      ul->ul_hash    = hash;
+      ul->ul_missing = 0;
+      memcpy(ul->ul_path, relpath, len + 1);
+    }
+
+  ul->ul_missing |= 1 << ndx;
+}
+
+/****************************************************************************
+ * Name: unionfs_lookup_flush
+ *
+ * Description:
+ *   Forget all cached lookup failures.  Called whenever a file or
+ *   directory may have been created.
+ *
+ ****************************************************************************/
+
+static void unionfs_lookup_flush(FAR struct unionfs_inode_s *ui)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_UNIONFS_LOOKUP_CACHE; i++)
+    {
+      ui->ui_lookup[i].ul_missing = 0;
+    }
+}
+#endif /* CONFIG_FS_UNIONFS_LOOKUP_CACHE > 0 */
+
+/****************************************************************************
+ * Name: unionfs_copyup_parents
+ *
+ * Description:
+ *   Create the parent directories of relpath on file system 1, using the
+ *   mode of the same directory on file system 2 where it exists.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+static int unionfs_copyup_parents(FAR struct unionfs_inode_s *ui,
+                                  FAR const char *relpath)
+{
+  FAR struct unionfs_mountpt_s *upper = &ui->ui_fs[0];
+  FAR struct unionfs_mountpt_s *lower = &ui->ui_fs[1];
+  struct stat buf;
+  FAR char *path;
+  FAR char *ptr;
+  mode_t mode;
+  int ret = OK;
+
+  path = strdup(relpath);
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (ptr = strchr(path, '/'); ptr != NULL; ptr = strchr(ptr + 1, '/'))
+    {
+      if (ptr == path)
+        {
+          continue;
+        }
+
+      *ptr = '\0';
+
+      mode = 0777;
+      if (unionfs_trystat(lower->um_node, path, lower->um_prefix,
+                          &buf) >= 0)
+        {
+          mode = buf.st_mode & 0777;
+        }
+
+      ret = unionfs_trymkdir(upper->um_node, path, upper->um_prefix, mode);
+      if (ret == -EEXIST)
+        {
+          ret = OK;
+        }
+
+      *ptr = '/';
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  lib_free(path);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: unionfs_copyup_data
+ ****************************************************************************/
+
+static int unionfs_copyup_data(FAR struct unionfs_inode_s *ui,
+                               FAR struct file *infile,
+                               FAR struct file *outfile)
+{
+  FAR const struct mountpt_operations *inops =
+    ui->ui_fs[1].um_node->u.i_mops;
+  FAR const struct mountpt_operations *outops =
+    ui->ui_fs[0].um_node->u.i_mops;
+  FAR char *buffer;
+  ssize_t nread;
+  ssize_t nwritten;
+  ssize_t offset;
+  int ret = OK;
+
+  if (inops->read == NULL || outops->write == NULL)
+    {
+      return -ENOSYS;
+    }
+
+  buffer = kmm_malloc(UNIONFS_COPYUP_BUFSIZE);
+  if (buffer == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  do
+    {
+      nread = inops->read(infile, buffer, UNIONFS_COPYUP_BUFSIZE);
+      if (nread < 0)
+        {
+          ret = nread;
+        }
+
+      for (offset = 0; ret >= 0 && offset < nread; offset += nwritten)
+        {
+          nwritten = outops->write(outfile, buffer + offset,
+                                   nread - offset);
+          if (nwritten <= 0)
+            {
+              ret = nwritten < 0 ? nwritten : -EIO;
+            }
+        }
+    }
+  while (ret >= 0 && nread > 0);
+
+  kmm_free(buffer);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: unionfs_copyup_file
+ *
+ * Description:
+ *   Copy a regular file from file system 2 to file system 1.  If truncate
+ *   is true, only an empty file with the same mode is created.
+ *
+ ****************************************************************************/
+
+static int unionfs_copyup_file(FAR struct unionfs_inode_s *ui,
+                               FAR const char *relpath, mode_t mode,
+                               bool truncate)
+{
+  FAR struct unionfs_mountpt_s *upper = &ui->ui_fs[0];
+  FAR struct unionfs_mountpt_s *lower = &ui->ui_fs[1];
+  FAR const struct mountpt_operations *ops;
+  struct file infile;
+  struct file outfile;
+  int ret;
+
+  memset(&outfile, 0, sizeof(outfile));
+  outfile.f_oflags = O_WRONLY | O_CREAT | O_TRUNC;
+  outfile.f_inode  = upper->um_node;
+
+  ret = unionfs_tryopen(&outfile, relpath, upper->um_prefix,
+                        outfile.f_oflags, mode);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (!truncate)
+    {
+      memset(&infile, 0, sizeof(infile));
+      infile.f_oflags = O_RDONLY;
+      infile.f_inode  = lower->um_node;
+
+      ret = unionfs_tryopen(&infile, relpath, lower->um_prefix,
+                            O_RDONLY, 0);
+      if (ret >= 0)
+        {
+          ret = unionfs_copyup_data(ui, &infile, &outfile);
+
+          ops = lower->um_node->u.i_mops;
+          if (ops->close != NULL)
+            {
+              ops->close(&infile);
+            }
+        }
+    }
+
+  ops = upper->um_node->u.i_mops;
+  if (ops->close != NULL)
+    {
+      ops->close(&outfile);
+    }
+
+  /* Do not leave a partial copy behind */
+
+  if (ret < 0)
+    {
+      unionfs_tryunlink(upper->um_node, relpath, upper->um_prefix);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: unionfs_copyup
+ *
+ * Description:
+ *   Prepare file system 1 for a writable open of relpath that was not
+ *   found there: create the missing parent directories and, if the file
+ *   exists on file system 2, copy it.  The caller must hold ui_lock and
+ *   then retry the open on file system 1.
+ *
+ ****************************************************************************/
+
+static int unionfs_copyup(FAR struct unionfs_inode_s *ui,
+                          FAR const char *relpath, int oflags)
+{
+  FAR struct unionfs_mountpt_s *lower = &ui->ui_fs[1];
+  struct stat buf;
+  bool exists;
+  int ret;
+
+  ret = unionfs_trystat(lower->um_node, relpath, lower->um_prefix, &buf);
+  if (ret < 0 && (ret != -ENOENT || (oflags & O_CREAT) == 0))
+    {
+      return ret;
+    }
+
+  exists = ret >= 0;
+  if (exists && (oflags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+    {
+      return -EEXIST;
+    }
+
+  if (exists && !S_ISREG(buf.st_mode))
+    {
+      return -EISDIR;
+    }
+
+  finfo("Copy-up: %s\n", relpath);
+
+  ret = unionfs_copyup_parents(ui, relpath);
+  if (ret < 0 || !exists)
+    {
+      return ret;
+    }
+
+  return unionfs_copyup_file(ui, relpath, buf.st_mode & 0777,
+                             (oflags & O_TRUNC) != 0);
+}
+#endif /* CONFIG_FS_UNIONFS_COPYUP */
+
 /****************************************************************************
  * Name: unionfs_open
  ****************************************************************************/
@@ -848,6 +1406,9 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_file_s *uf;
   FAR struct unionfs_mountpt_s *um;
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  struct stat buf;
+#endif
   int ret;
 
   /* Recover the open file data from the struct file instance */
@@ -874,6 +1435,13 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
       goto errout_with_lock;
     }
 
+  /* A file might be created, so forget any cached lookup failures */
+
+  if ((oflags & O_CREAT) != 0)
+    {
+      unionfs_lookup_flush(ui);
+    }
+
   /* Try to open the file on file system 1 */
 
   um = &ui->ui_fs[0];
@@ -883,7 +1451,70 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
   uf->uf_file.f_oflags = filep->f_oflags;
   uf->uf_file.f_inode  = um->um_node;
 
-  ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags, mode);
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* With O_CREAT, the open on file system 1 would create an empty file
+   * in front of one that exists on file system 2 (and O_EXCL would not
+   * see it).  Copy the file up before file system 1 is asked.
+   */
+
+  if (ui->ui_copyup &&
+      (oflags & (O_WROK | O_CREAT)) == (O_WROK | O_CREAT))
+    {
+      ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
+      if (ret == -ENOENT)
+        {
+          ret = unionfs_copyup(ui, relpath, oflags);
+          unionfs_lookup_flush(ui);
+        }
+
+      if (ret < 0)
+        {
+          goto errout_with_uf;
+        }
+    }
+#endif
+
+  if (unionfs_lookup_missing(ui, relpath, 0))
+    {
+      ret = -ENOENT;
+    }
+  else
+    {
+      ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags,
+                            mode);
+      if (ret == -ENOENT)
+        {
+          unionfs_lookup_setmissing(ui, relpath, 0);
+        }
+    }
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (ret == -ENOENT && ui->ui_copyup && (oflags & O_WROK) != 0)
+    {
+      /* Never write to the lower file system.  Copy the file up to file
+       * system 1 and open it there instead.
+       */
+
+      ret = unionfs_copyup(ui, relpath, oflags);
+      unionfs_lookup_flush(ui);
+      if (ret >= 0)
+        {
+          uf->uf_file.f_oflags = filep->f_oflags;
+          uf->uf_file.f_inode  = um->um_node;
+
+          ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix,
+                                oflags, mode);
+        }
+
+      if (ret < 0)
+        {
+          goto errout_with_uf;
+        }
+
+      uf->uf_ndx = 0;
+    }
+  else
+#endif
   if (ret >= 0)
     {
       /* Successfully opened on file system 1 */
@@ -892,21 +1523,33 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
     }
   else
     {
-      /* Try to open the file on file system 1 */
+      /* Try to open the file on file system 2 */
 
       um  = &ui->ui_fs[1];
 
       uf->uf_file.f_oflags = filep->f_oflags;
       uf->uf_file.f_inode  = um->um_node;
 
-      ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags,
-                            mode);
+      if (unionfs_lookup_missing(ui, relpath, 1))
+        {
+          ret = -ENOENT;
+        }
+      else
+        {
+          ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix,
+                                oflags, mode);
+          if (ret == -ENOENT)
+            {
+              unionfs_lookup_setmissing(ui, relpath, 1);
+            }
+        }
+
       if (ret < 0)
         {
-          goto errout_with_lock;
+          goto errout_with_uf;
         }
 
-      /* Successfully opened on file system 1 */
+      /* Successfully opened on file system 2 */
 
       uf->uf_ndx = 1;
     }
@@ -919,7 +1562,11 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
   /* Save our private data in the file structure */
 
   filep->f_priv = (FAR void *)uf;
-  ret = OK;
+  nxmutex_unlock(&ui->ui_lock);
+  return OK;
+
+errout_with_uf:
+  kmm_free(uf);
 
 errout_with_lock:
   nxmutex_unlock(&ui->ui_lock);
@@ -1579,6 +2226,13 @@ static int unionfs_closedir(FAR struct inode *mountpt,
       kmm_free(udir->fu_relpath);
     }
 
+#ifdef CONFIG_FS_UNIONFS_DIRINDEX
+  if (udir->fu_index != NULL)
+    {
+      kmm_free(udir->fu_index);
+    }
+#endif
+
   kmm_free(udir);
 
   /* Decrement the count of open reference.  If that count would go to zero
@@ -1818,7 +2472,18 @@ static int unionfs_readdir(FAR struct inode *mountpt,
            */
 
           duplicate = false;
-          if (ret >= 0 && udir->fu_ndx == 1 && udir->fu_lower[0] != NULL)
+
+          /* Remember the names reported from file system 1.  Names of
+           * file system 2 that are not in this index cannot be duplicates.
+           */
+
+          if (ret >= 0 && udir->fu_ndx == 0)
+            {
+              unionfs_dirindex_add(udir, entry->d_name);
+            }
+
+          if (ret >= 0 && udir->fu_ndx == 1 && udir->fu_lower[0] != NULL &&
+              unionfs_dirindex_find(udir, entry->d_name))
             {
               /* Get the relative path to the same file on file system 1.
                * NOTE: the on any failures we just assume that the filep
@@ -1891,6 +2556,10 @@ static int unionfs_rewinddir(struct inode *mountpt, struct fs_dirent_s *dir)
       udir->fu_ndx = 0;
     }
 
+  /* File system 1 will be enumerated again */
+
+  unionfs_dirindex_reset(udir);
+
   if (!udir->fu_prefix[udir->fu_ndx])
     {
       DEBUGASSERT(udir->fu_lower[udir->fu_ndx] != NULL);
@@ -1922,6 +2591,9 @@ static int unionfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   FAR const char *prefix1 = "";
   FAR const char *fspath2 = "";
   FAR const char *prefix2 = "";
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  bool copyup = false;
+#endif
   FAR char *dup;
   FAR char *tmp;
   FAR char *tok;
@@ -1953,6 +2625,12 @@ static int unionfs_bind(FAR struct inode *blkdriver, FAR const void *data,
         {
           prefix2 = tok + 8;
         }
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+      else if (strcmp(tok, "copyup") == 0)
+        {
+          copyup = true;
+        }
+#endif
     }
 
   /* Call unionfs_dobind to do the real work. */
@@ -1960,6 +2638,13 @@ static int unionfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   ret = unionfs_dobind(fspath1, prefix1, fspath2, prefix2, handle);
   lib_free(dup);
 
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (ret >= 0)
+    {
+      ((FAR struct unionfs_inode_s *)*handle)->ui_copyup = copyup;
+    }
+#endif
+
   return ret;
 }
 
@@ -2160,6 +2845,14 @@ static int unionfs_unlink(FAR struct inode *mountpt,
               relpath != NULL);
   ui = mountpt->i_private;
 
+  /* Get exclusive access to the file system data structures */
+
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Check if some exists at this path on file system 1.  This might be
    * a file or a directory
    */
@@ -2188,6 +2881,15 @@ static int unionfs_unlink(FAR struct inode *mountpt,
 
       um  = &ui->ui_fs[1];
       ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+      if (ret >= 0 && ui->ui_copyup)
+        {
+          /* The lower file system is never modified in copy-up mode */
+
+          ret = -EROFS;
+        }
+      else
+#endif
       if (ret >= 0)
         {
           /* Yes.. Try to unlink the file on file system 1.  This would fail
@@ -2199,6 +2901,10 @@ static int unionfs_unlink(FAR struct inode *mountpt,
         }
     }
 
+  /* Removing the file on file system 1 may expose one on file system 2 */
+
+  unionfs_lookup_flush(ui);
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2224,21 +2930,51 @@ static int unionfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
               relpath != NULL);
   ui = mountpt->i_private;
 
+  /* Get exclusive access to the file system data structures */
+
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Is there anything with this name on either file system? */
 
   um  = &ui->ui_fs[0];
   ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
   if (ret >= 0)
     {
-      return -EEXIST;
+      ret = -EEXIST;
+      goto errout_with_lock;
     }
 
   um  = &ui->ui_fs[1];
   ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
   if (ret >= 0)
     {
-      return -EEXIST;
+      ret = -EEXIST;
+      goto errout_with_lock;
+    }
+
+  unionfs_lookup_flush(ui);
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (ui->ui_copyup)
+    {
+      /* Only the upper file system is written.  Its parent directories
+       * may so far exist only on the lower file system.
+       */
+
+      ret = unionfs_copyup_parents(ui, relpath);
+      if (ret >= 0)
+        {
+          um  = &ui->ui_fs[0];
+          ret = unionfs_trymkdir(um->um_node, relpath, um->um_prefix, mode);
+        }
+
+      goto errout_with_lock;
     }
+#endif
 
   /* Try to create the directory on both file systems. */
 
@@ -2253,7 +2989,11 @@ static int unionfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
    * read-only and the other is write-able?
    */
 
-  return (ret1 >= 0 || ret2 >= 0) ? OK : ret1;
+  ret = (ret1 >= 0 || ret2 >= 0) ? OK : ret1;
+
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
+  return ret;
 }
 
 /****************************************************************************
@@ -2275,6 +3015,16 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
               relpath != NULL);
   ui = mountpt->i_private;
 
+  /* Get exclusive access to the file system data structures */
+
+  tmp = nxmutex_lock(&ui->ui_lock);
+  if (tmp < 0)
+    {
+      return tmp;
+    }
+
+  unionfs_lookup_flush(ui);
+
   /* We really don't know any better so we will try to remove the directory
    * from both file systems.
    */
@@ -2292,7 +3042,7 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
       ret = unionfs_tryrmdir(um->um_node, relpath, um->um_prefix);
       if (ret < 0)
         {
-          return ret;
+          goto errout_with_lock;
         }
     }
 
@@ -2302,6 +3052,20 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
 
   um   = &ui->ui_fs[1];
   tmp = unionfs_trystatdir(um->um_node, relpath, um->um_prefix);
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (tmp >= 0 && ui->ui_copyup)
+    {
+      /* The lower file system is never modified in copy-up mode.  A
+       * directory only found there cannot be removed.
+       */
+
+      if (ret == -ENOENT)
+        {
+          ret = -EROFS;
+        }
+    }
+  else
+#endif
   if (tmp >= 0)
     {
       /* Yes.. remove it.  Since we know that the directory exists, any
@@ -2315,6 +3079,8 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
        */
     }
 
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2340,6 +3106,16 @@ static int unionfs_rename(FAR struct inode *mountpt,
 
   DEBUGASSERT(oldrelpath != NULL && oldrelpath != NULL);
 
+  /* Get exclusive access to the file system data structures */
+
+  tmp = nxmutex_lock(&ui->ui_lock);
+  if (tmp < 0)
+    {
+      return tmp;
+    }
+
+  unionfs_lookup_flush(ui);
+
   /* Is there a file with this name on file system 1 */
 
   um   = &ui->ui_fs[0];
@@ -2360,7 +3136,7 @@ static int unionfs_rename(FAR struct inode *mountpt,
            * file of the same relative path will become visible.
            */
 
-          return OK;
+          goto errout_with_lock;
         }
     }
 
@@ -2371,6 +3147,20 @@ static int unionfs_rename(FAR struct inode *mountpt,
 
   um   = &ui->ui_fs[1];
   tmp = unionfs_trystatfile(um->um_node, oldrelpath, um->um_prefix);
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (tmp >= 0 && ui->ui_copyup)
+    {
+      /* The lower file system is never modified in copy-up mode.  Keep the
+       * error from file system 1, if there was one.
+       */
+
+      if (ret == -ENOENT)
+        {
+          ret = -EROFS;
+        }
+    }
+  else
+#endif
   if (tmp >= 0)
     {
       /* Yes.. remove it.  Since we know that the directory exists, any
@@ -2381,6 +3171,8 @@ static int unionfs_rename(FAR struct inode *mountpt,
                               um->um_prefix);
     }
 
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2403,30 +3195,48 @@ static int unionfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
               relpath != NULL);
   ui = mountpt->i_private;
 
+  /* Get exclusive access to the file system data structures */
+
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* stat this path on file system 1 */
 
   um  = &ui->ui_fs[0];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
+  ret = unionfs_lookup_missing(ui, relpath, 0) ? -ENOENT :
+        unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
   if (ret >= 0)
     {
       /* Return on the first success.  The first instance of the file will
        * shadow the second anyway.
        */
 
-      return OK;
+      goto errout_with_lock;
+    }
+  else if (ret == -ENOENT)
+    {
+      unionfs_lookup_setmissing(ui, relpath, 0);
     }
 
   /* stat failed on the file system 1.  Try again on file system 2. */
 
   um  = &ui->ui_fs[1];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
+  ret = unionfs_lookup_missing(ui, relpath, 1) ? -ENOENT :
+        unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
   if (ret >= 0)
     {
       /* Return on the first success.  The first instance of the file will
        * shadow the second anyway.
        */
 
-      return OK;
+      goto errout_with_lock;
+    }
+  else if (ret == -ENOENT)
+    {
+      unionfs_lookup_setmissing(ui, relpath, 1);
     }
 
   /* Special case the unionfs root directory when both file systems are
@@ -2458,6 +3268,8 @@ static int unionfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
         }
     }
 
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -35,6 +35,7 @@
 
 #include <nuttx/clock.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/irq.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/list.h>
 #include <nuttx/mutex.h>
@@ -46,9 +47,13 @@
  * Private Types
  ****************************************************************************/
 
+struct epoll_head_s;
+
 struct epoll_node_s
 {
   struct list_node      node;
+  struct list_node      rnode;    /* Link in the ready list of the head */
+  FAR struct epoll_head_s *eph;
   epoll_data_t          data;
   struct pollfd         pfd;
 };
@@ -82,6 +87,12 @@ struct epoll_head_s
                                    * first node, used to free the malloced
                                    * memory in epoll_do_close().
                                    */
+  struct list_node      ready;    /* The ready list, store all the setuped
+                                   * epoll node notified since they were
+                                   * last reported.  It is appended from
+                                   * the poll callback, so it is protected
+                                   * by a critical section instead of lock.
+                                   */
 };
 
 typedef struct epoll_head_s epoll_head_t;
@@ -94,6 +105,9 @@ static int epoll_do_open(FAR struct file *filep);
 static int epoll_do_close(FAR struct file *filep);
 static int epoll_do_poll(FAR struct file *filep,
                          FAR struct pollfd *fds, bool setup);
+static void epoll_wakeup(FAR epoll_head_t *eph);
+static void epoll_default_cb(FAR struct pollfd *fds);
+static void epoll_remove_ready(FAR epoll_node_t *epn);
 static int epoll_setup(FAR epoll_head_t *eph);
 static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
                           int maxevents);
@@ -241,6 +255,7 @@ static int epoll_do_create(int size, int flags)
   list_initialize(&eph->oneshot);
   list_initialize(&eph->extend);
   list_initialize(&eph->free);
+  list_initialize(&eph->ready);
   for (i = 0; i < size; i++)
     {
       list_add_tail(&eph->free, &epn[i].node);
@@ -262,6 +277,50 @@ static int epoll_do_create(int size, int flags)
   return fd;
 }
 
+static void epoll_wakeup(FAR epoll_head_t *eph)
+{
+  int semcount = 0;
+
+  nxsem_get_value(&eph->sem, &semcount);
+  if (semcount < 1)
+    {
+      nxsem_post(&eph->sem);
+    }
+}
+
+static void epoll_default_cb(FAR struct pollfd *fds)
+{
+  FAR epoll_node_t *epn = fds->arg;
+  FAR epoll_head_t *eph = epn->eph;
+  irqstate_t flags;
+
+  /* Queue the node so that epoll_wait() only has to look at the nodes
+   * which were really notified.
+   */
+
+  flags = enter_critical_section();
+  if (!list_in_list(&epn->rnode))
+    {
+      list_add_tail(&eph->ready, &epn->rnode);
+    }
+
+  leave_critical_section(flags);
+  epoll_wakeup(eph);
+}
+
+static void epoll_remove_ready(FAR epoll_node_t *epn)
+{
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  if (list_in_list(&epn->rnode))
+    {
+      list_delete(&epn->rnode);
+    }
+
+  leave_critical_section(flags);
+}
+
 static int epoll_setup(FAR epoll_head_t *eph)
 {
   FAR epoll_node_t *tepn;
@@ -293,6 +352,13 @@ static int epoll_setup(FAR epoll_head_t *eph)
       list_add_tail(&eph->setup, &epn->node);
     }
 
+  /* Don't wait if some events were left over by the last epoll_wait() */
+
+  if (!list_is_empty(&eph->ready))
+    {
+      epoll_wakeup(eph);
+    }
+
   nxmutex_unlock(&eph->lock);
   return ret;
 }
@@ -300,28 +366,63 @@ static int epoll_setup(FAR epoll_head_t *eph)
 static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
                           int maxevents)
 {
-  FAR epoll_node_t *tepn;
   FAR epoll_node_t *epn;
+  pollevent_t revents;
+  irqstate_t flags;
   int i = 0;
 
   nxmutex_lock(&eph->lock);
 
-  list_for_every_entry_safe(&eph->setup, epn, tepn, epoll_node_t, node)
+  while (i < maxevents)
     {
-      if (epn->pfd.revents != 0 && i < maxevents)
+      flags = enter_critical_section();
+      if (list_is_empty(&eph->ready))
         {
-          evs[i].data     = epn->data;
-          evs[i++].events = epn->pfd.revents;
-          poll_fdsetup(epn->pfd.fd, &epn->pfd, false);
-          list_delete(&epn->node);
-          if ((epn->pfd.events & EPOLLONESHOT) != 0)
-            {
-              list_add_tail(&eph->oneshot, &epn->node);
-            }
-          else
-            {
-              list_add_tail(&eph->teardown, &epn->node);
-            }
+          leave_critical_section(flags);
+          break;
+        }
+
+      epn = container_of(list_remove_head(&eph->ready), epoll_node_t,
+                         rnode);
+      revents = epn->pfd.revents;
+      if ((epn->pfd.events & EPOLLET) != 0)
+        {
+          /* Edge triggered, only the events notified from now on count */
+
+          epn->pfd.revents = 0;
+        }
+
+      leave_critical_section(flags);
+
+      if (revents == 0)
+        {
+          continue;
+        }
+
+      evs[i].data     = epn->data;
+      evs[i++].events = revents;
+
+      /* An edge triggered node stays setup and is queued again by the next
+       * notification.  Others are torn down, level triggered nodes will be
+       * setup again by the next epoll_wait() to check whether the events
+       * are still pending.
+       */
+
+      if ((epn->pfd.events & (EPOLLET | EPOLLONESHOT)) == EPOLLET)
+        {
+          continue;
+        }
+
+      poll_fdsetup(epn->pfd.fd, &epn->pfd, false);
+      epoll_remove_ready(epn);
+      list_delete(&epn->node);
+      if ((epn->pfd.events & EPOLLONESHOT) != 0)
+        {
+          list_add_tail(&eph->oneshot, &epn->node);
+        }
+      else
+        {
+          list_add_tail(&eph->teardown, &epn->node);
         }
     }
 
@@ -475,8 +576,9 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
         epn->data        = ev->data;
         epn->pfd.events  = ev->events;
         epn->pfd.fd      = fd;
-        epn->pfd.arg     = &eph->sem;
-        epn->pfd.cb      = poll_default_cb;
+        epn->eph         = eph;
+        epn->pfd.arg     = epn;
+        epn->pfd.cb      = epoll_default_cb;
         epn->pfd.revents = 0;
 
         ret = poll_fdsetup(fd, &epn->pfd, true);
@@ -496,6 +598,7 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
             if (epn->pfd.fd == fd)
               {
                 poll_fdsetup(fd, &epn->pfd, false);
+                epoll_remove_ready(epn);
                 list_delete(&epn->node);
                 list_add_tail(&eph->free, &epn->node);
                 goto out;
@@ -533,6 +636,7 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
                 if (epn->pfd.events != ev->events)
                   {
                     poll_fdsetup(fd, &epn->pfd, false);
+                    epoll_remove_ready(epn);
 
                     epn->data        = ev->data;
                     epn->pfd.events  = ev->events;
@@ -228,6 +228,24 @@ static int file_vfcntl(FAR struct file *filep, int cmd, va_list ap)
           ret = file_ioctl(filep, FIOC_FILEPATH, va_arg(ap, FAR char *));
         }
 
+        break;
+
+      case F_SETPIPE_SZ:
+        /* Set the capacity of the pipe to the value specified by the int
+         * argument.  The new capacity is returned.
+         */
+
+        ret = file_ioctl(filep, PIPEIOC_SETSIZE, va_arg(ap, int));
+        ret = ret == -ENOTTY ? -EBADF : ret;
+        break;
+
+      case F_GETPIPE_SZ:
+        /* Return the capacity of the pipe */
+
+        ret = file_ioctl(filep, PIPEIOC_GETSIZE, 0);
+        ret = ret == -ENOTTY ? -EBADF : ret;
+        break;
+
       default:
         break;
     }
@@ -0,0 +1,862 @@
+/****************************************************************************
+ * fs/vfs/fs_pagecache.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/pagecache.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if !defined(CONFIG_SCHED_WORKQUEUE) && CONFIG_FS_PAGECACHE_WRDELAY != 0
+#  error "Worker thread support is required (CONFIG_SCHED_WORKQUEUE)"
+#endif
+
+#define PAGECACHE_HASH(pc, page) ((size_t)(page) & ((pc)->nhash - 1))
+#define PAGECACHE_DATA(pg)       ((FAR uint8_t *)((pg) + 1))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One cached page.  The page data follows the structure. */
+
+struct pagecache_page_s
+{
+  struct list_node hnode;        /* Link in the hash bucket */
+  struct list_node lnode;        /* Link in the LRU list */
+  struct list_node dnode;        /* Link in the dirty list, if dirty */
+  off_t            page;         /* Page number on the media */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static mutex_t g_pagecache_lock = NXMUTEX_INITIALIZER;
+static struct list_node g_pagecache_list =
+  LIST_INITIAL_VALUE(g_pagecache_list);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pagecache_find
+ ****************************************************************************/
+
+static FAR struct pagecache_page_s *
+pagecache_find(FAR struct pagecache_s *pc, off_t page)
+{
+  FAR struct pagecache_page_s *pg;
+
+  list_for_every_entry(&pc->hash[PAGECACHE_HASH(pc, page)], pg,
+                       struct pagecache_page_s, hnode)
+    {
+      if (pg->page == page)
+        {
+          return pg;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: pagecache_insert
+ ****************************************************************************/
+
+static void pagecache_insert(FAR struct pagecache_s *pc,
+                             FAR struct pagecache_page_s *pg)
+{
+  list_add_head(&pc->hash[PAGECACHE_HASH(pc, pg->page)], &pg->hnode);
+  list_add_head(&pc->lru, &pg->lnode);
+}
+
+/****************************************************************************
+ * Name: pagecache_touch
+ ****************************************************************************/
+
+static void pagecache_touch(FAR struct pagecache_s *pc,
+                            FAR struct pagecache_page_s *pg)
+{
+  list_delete(&pg->lnode);
+  list_add_head(&pc->lru, &pg->lnode);
+}
+
+/****************************************************************************
+ * Name: pagecache_free
+ ****************************************************************************/
+
+static void pagecache_free(FAR struct pagecache_s *pc,
+                           FAR struct pagecache_page_s *pg)
+{
+  list_delete(&pg->hnode);
+  list_delete(&pg->lnode);
+  if (list_in_list(&pg->dnode))
+    {
+      list_delete(&pg->dnode);
+    }
+
+  pc->ncached--;
+  kmm_free(pg);
+}
+
+/****************************************************************************
+ * Name: pagecache_writeback
+ *
+ * Description:
+ *   Write all dirty pages back to the media.  Runs of contiguous dirty
+ *   pages are gathered so that each is written with a single transfer.
+ *
+ ****************************************************************************/
+
+static int pagecache_writeback(FAR struct pagecache_s *pc)
+{
+  FAR struct pagecache_page_s *first;
+  FAR struct pagecache_page_s *pg;
+  FAR uint8_t *buffer;
+  ssize_t nxfrd;
+  size_t npages;
+  off_t start;
+  off_t end;
+  size_t i;
+
+  while (!list_is_empty(&pc->dirty))
+    {
+      first = list_first_entry(&pc->dirty, struct pagecache_page_s, dnode);
+
+      /* Find the run of dirty pages around this one */
+
+      start = first->page;
+      while (start > 0 && (pg = pagecache_find(pc, start - 1)) != NULL &&
+             list_in_list(&pg->dnode))
+        {
+          start--;
+        }
+
+      end = first->page + 1;
+      while ((pg = pagecache_find(pc, end)) != NULL &&
+             list_in_list(&pg->dnode))
+        {
+          end++;
+        }
+
+      npages = end - start;
+      buffer = NULL;
+
+      if (npages > 1)
+        {
+          buffer = kmm_malloc(npages * pc->pagesize);
+        }
+
+      if (buffer != NULL)
+        {
+          for (i = 0; i < npages; i++)
+            {
+              pg = pagecache_find(pc, start + i);
+              memcpy(buffer + i * pc->pagesize, PAGECACHE_DATA(pg),
+                     pc->pagesize);
+            }
+
+          nxfrd = pc->flush(pc->dev, buffer, start, npages);
+          kmm_free(buffer);
+        }
+      else
+        {
+          /* No memory to gather the run, write the pages one by one */
+
+          start  = first->page;
+          npages = 1;
+          nxfrd  = pc->flush(pc->dev, PAGECACHE_DATA(first), start, 1);
+        }
+
+      if (nxfrd != (ssize_t)npages)
+        {
+          ferr("ERROR: Write back of %zu pages at %" PRIdOFF
+               " failed: %zd\n", npages, start, nxfrd);
+
+          /* Keep the error for the next writer or flush, a delayed
+           * write-back has nobody else to report it to.
+           */
+
+          pc->error = nxfrd < 0 ? (int)nxfrd : -EIO;
+          return pc->error;
+        }
+
+      for (i = 0; i < npages; i++)
+        {
+          pg = pagecache_find(pc, start + i);
+          list_delete(&pg->dnode);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_wrtimeout
+ ****************************************************************************/
+
+#if CONFIG_FS_PAGECACHE_WRDELAY != 0
+static void pagecache_wrtimeout(FAR void *arg)
+{
+  FAR struct pagecache_s *pc = arg;
+
+  if (nxmutex_lock(&pc->lock) >= 0)
+    {
+      pagecache_writeback(pc);
+      nxmutex_unlock(&pc->lock);
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: pagecache_alloc
+ *
+ * Description:
+ *   Get a page which is not yet in the cache for the given page number.
+ *   A new page is allocated until maxpages is reached, after that the
+ *   least recently used page is recycled.
+ *
+ ****************************************************************************/
+
+static FAR struct pagecache_page_s *
+pagecache_alloc(FAR struct pagecache_s *pc, off_t page)
+{
+  FAR struct pagecache_page_s *pg = NULL;
+  size_t size = sizeof(*pg) + pc->pagesize;
+
+  if (pc->ncached < pc->maxpages)
+    {
+      pg = kmm_malloc(size);
+      if (pg == NULL && pagecache_shrink(size) > 0)
+        {
+          pg = kmm_malloc(size);
+        }
+    }
+
+  if (pg != NULL)
+    {
+      pc->ncached++;
+      list_clear_node(&pg->dnode);
+    }
+  else
+    {
+      if (list_is_empty(&pc->lru))
+        {
+          return NULL;
+        }
+
+      pg = list_last_entry(&pc->lru, struct pagecache_page_s, lnode);
+      if (list_in_list(&pg->dnode) && pagecache_writeback(pc) < 0)
+        {
+          return NULL;
+        }
+
+      list_delete(&pg->hnode);
+      list_delete(&pg->lnode);
+    }
+
+  pg->page = page;
+  return pg;
+}
+
+/****************************************************************************
+ * Name: pagecache_readahead
+ *
+ * Description:
+ *   Load up to npages pages following a sequential read with a single
+ *   transfer.  Failures are not reported, the pages will simply be read
+ *   again on demand.
+ *
+ ****************************************************************************/
+
+static void pagecache_readahead(FAR struct pagecache_s *pc, off_t start,
+                                size_t npages)
+{
+  FAR struct pagecache_page_s *pg;
+  FAR uint8_t *buffer;
+  ssize_t nread;
+  size_t i;
+
+  /* Stop at the end of the media and at the first page already cached */
+
+  if (start >= (off_t)pc->npages)
+    {
+      return;
+    }
+
+  if (npages > pc->npages - (size_t)start)
+    {
+      npages = pc->npages - start;
+    }
+
+  for (i = 0; i < npages; i++)
+    {
+      if (pagecache_find(pc, start + i) != NULL)
+        {
+          break;
+        }
+    }
+
+  npages = i;
+  if (npages == 0)
+    {
+      return;
+    }
+
+  buffer = kmm_malloc(npages * pc->pagesize);
+  if (buffer == NULL)
+    {
+      return;
+    }
+
+  nread = pc->reload(pc->dev, buffer, start, npages);
+  for (i = 0; nread > 0 && i < (size_t)nread; i++)
+    {
+      pg = pagecache_alloc(pc, start + i);
+      if (pg == NULL)
+        {
+          break;
+        }
+
+      memcpy(PAGECACHE_DATA(pg), buffer + i * pc->pagesize, pc->pagesize);
+      pagecache_insert(pc, pg);
+    }
+
+  kmm_free(buffer);
+}
+
+/****************************************************************************
+ * Name: pagecache_discard
+ ****************************************************************************/
+
+static void pagecache_discard(FAR struct pagecache_s *pc, off_t startpage,
+                              size_t npages)
+{
+  FAR struct pagecache_page_s *pg;
+  FAR struct pagecache_page_s *tmp;
+
+  list_for_every_entry_safe(&pc->lru, pg, tmp, struct pagecache_page_s,
+                            lnode)
+    {
+      if (pg->page >= startpage && (size_t)(pg->page - startpage) < npages)
+        {
+          pagecache_free(pc, pg);
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pagecache_initialize
+ *
+ * Description:
+ *   Initialize a page cache.  The geometry, the cache sizes and the
+ *   callouts must have been set up by the caller.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned on
+ *   any failure.
+ *
+ ****************************************************************************/
+
+int pagecache_initialize(FAR struct pagecache_s *pc)
+{
+  int i;
+
+  DEBUGASSERT(pc != NULL);
+
+  if (pc->pagesize == 0 || pc->maxpages == 0 || pc->reload == NULL)
+    {
+      return -EINVAL;
+    }
+
+  /* Two pages per bucket on average when the cache is full */
+
+  pc->nhash = 1;
+  while (pc->nhash * 2 < pc->maxpages)
+    {
+      pc->nhash <<= 1;
+    }
+
+  pc->hash = kmm_malloc(pc->nhash * sizeof(struct list_node));
+  if (pc->hash == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < pc->nhash; i++)
+    {
+      list_initialize(&pc->hash[i]);
+    }
+
+  list_initialize(&pc->lru);
+  list_initialize(&pc->dirty);
+  nxmutex_init(&pc->lock);
+
+  pc->ncached = 0;
+  pc->rasize  = 0;
+  pc->ranext  = 0;
+  pc->error   = OK;
+
+  nxmutex_lock(&g_pagecache_lock);
+  list_add_tail(&g_pagecache_list, &pc->node);
+  nxmutex_unlock(&g_pagecache_lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_uninitialize
+ *
+ * Description:
+ *   Write back all dirty pages and release the memory of a page cache.
+ *
+ ****************************************************************************/
+
+void pagecache_uninitialize(FAR struct pagecache_s *pc)
+{
+  FAR struct pagecache_page_s *pg;
+  FAR struct pagecache_page_s *tmp;
+
+  DEBUGASSERT(pc != NULL);
+
+  nxmutex_lock(&g_pagecache_lock);
+  list_delete(&pc->node);
+  nxmutex_unlock(&g_pagecache_lock);
+
+#if CONFIG_FS_PAGECACHE_WRDELAY != 0
+  work_cancel(LPWORK, &pc->work);
+#endif
+
+  nxmutex_lock(&pc->lock);
+  if (pc->flush != NULL)
+    {
+      pagecache_writeback(pc);
+    }
+
+  list_for_every_entry_safe(&pc->lru, pg, tmp, struct pagecache_page_s,
+                            lnode)
+    {
+      pagecache_free(pc, pg);
+    }
+
+  nxmutex_unlock(&pc->lock);
+  nxmutex_destroy(&pc->lock);
+  kmm_free(pc->hash);
+}
+
+/****************************************************************************
+ * Name: pagecache_read
+ *
+ * Description:
+ *   Read pages through the cache.  Missing pages are loaded with as few
+ *   transfers as possible, and a sequential reader triggers read-ahead of
+ *   a window that doubles up to ramaxpages.
+ *
+ * Returned Value:
+ *   The number of pages read on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_read(FAR struct pagecache_s *pc, FAR uint8_t *buffer,
+                       off_t startpage, size_t npages)
+{
+  FAR struct pagecache_page_s *pg;
+  bool missed = false;
+  ssize_t nread;
+  ssize_t ret;
+  size_t nrun;
+  size_t i;
+  size_t j;
+
+  DEBUGASSERT(pc != NULL && buffer != NULL);
+
+  ret = nxmutex_lock(&pc->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (pc->directpages != 0 && npages >= pc->directpages)
+    {
+      /* Large transfer, read it straight from the media once any dirty
+       * page it covers has been written back.
+       */
+
+      for (i = 0; i < npages; i++)
+        {
+          pg = pagecache_find(pc, startpage + i);
+          if (pg != NULL && list_in_list(&pg->dnode))
+            {
+              ret = pagecache_writeback(pc);
+              break;
+            }
+        }
+
+      if (ret >= 0)
+        {
+          ret = pc->reload(pc->dev, buffer, startpage, npages);
+        }
+
+      pc->rasize = 0;
+      pc->ranext = startpage + npages;
+      goto out;
+    }
+
+  i = 0;
+  while (i < npages)
+    {
+      pg = pagecache_find(pc, startpage + i);
+      if (pg != NULL)
+        {
+          memcpy(buffer + i * pc->pagesize, PAGECACHE_DATA(pg),
+                 pc->pagesize);
+          pagecache_touch(pc, pg);
+          i++;
+          continue;
+        }
+
+      /* Read the whole run of missing pages into the user buffer with one
+       * transfer, then keep a copy of them.
+       */
+
+      for (nrun = 1; i + nrun < npages; nrun++)
+        {
+          if (pagecache_find(pc, startpage + i + nrun) != NULL)
+            {
+              break;
+            }
+        }
+
+      missed = true;
+      nread  = pc->reload(pc->dev, buffer + i * pc->pagesize,
+                          startpage + i, nrun);
+      if (nread <= 0)
+        {
+          ret = i > 0 ? (ssize_t)i : nread;
+          goto out;
+        }
+
+      for (j = 0; j < (size_t)nread; j++)
+        {
+          pg = pagecache_alloc(pc, startpage + i + j);
+          if (pg == NULL)
+            {
+              break;
+            }
+
+          memcpy(PAGECACHE_DATA(pg), buffer + (i + j) * pc->pagesize,
+                 pc->pagesize);
+          pagecache_insert(pc, pg);
+        }
+
+      i += nread;
+      if ((size_t)nread < nrun)
+        {
+          break;
+        }
+    }
+
+  ret = i;
+
+  /* Read ahead if this continues the previous read and had to go to the
+   * media.  Otherwise start over with the next sequential read.
+   */
+
+  if (pc->ramaxpages > 0 && startpage == pc->ranext)
+    {
+      if (missed)
+        {
+          pc->rasize = pc->rasize > 0 ? pc->rasize * 2 : npages;
+          if (pc->rasize > pc->ramaxpages)
+            {
+              pc->rasize = pc->ramaxpages;
+            }
+
+          if (pc->rasize > pc->maxpages / 2)
+            {
+              pc->rasize = pc->maxpages / 2;
+            }
+
+          pagecache_readahead(pc, startpage + i, pc->rasize);
+        }
+    }
+  else
+    {
+      pc->rasize = 0;
+    }
+
+  pc->ranext = startpage + i;
+
+out:
+  nxmutex_unlock(&pc->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_write
+ *
+ * Description:
+ *   Write pages through the cache.  The pages are only marked dirty; they
+ *   reach the media CONFIG_FS_PAGECACHE_WRDELAY milliseconds after the
+ *   first of them was dirtied, when they are evicted or when
+ *   pagecache_flush() is called.  An error of a write-back that nobody
+ *   waited for is returned by the next write that fails for lack of
+ *   pages, or else by the next pagecache_flush().
+ *
+ * Returned Value:
+ *   The number of pages written on success; a negated errno value on
+ *   failure.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_write(FAR struct pagecache_s *pc,
+                        FAR const uint8_t *buffer,
+                        off_t startpage, size_t npages)
+{
+  FAR struct pagecache_page_s *pg;
+  ssize_t ret;
+  size_t i;
+
+  DEBUGASSERT(pc != NULL && buffer != NULL);
+
+  if (pc->flush == NULL)
+    {
+      return -EACCES;
+    }
+
+  ret = nxmutex_lock(&pc->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (pc->directpages != 0 && npages >= pc->directpages)
+    {
+      /* Large transfer, the cached copies of the pages are obsolete */
+
+      pagecache_discard(pc, startpage, npages);
+      ret = pc->flush(pc->dev, buffer, startpage, npages);
+      goto out;
+    }
+
+  for (i = 0; i < npages; i++)
+    {
+      pg = pagecache_find(pc, startpage + i);
+      if (pg != NULL)
+        {
+          pagecache_touch(pc, pg);
+        }
+      else
+        {
+          pg = pagecache_alloc(pc, startpage + i);
+          if (pg == NULL)
+            {
+              break;
+            }
+
+          pagecache_insert(pc, pg);
+        }
+
+      memcpy(PAGECACHE_DATA(pg), buffer + i * pc->pagesize, pc->pagesize);
+      if (!list_in_list(&pg->dnode))
+        {
+          list_add_tail(&pc->dirty, &pg->dnode);
+        }
+    }
+
+  /* No page could be taken.  That is usually because dirty pages could
+   * not be written back to make room, so report why.
+   */
+
+  if (i > 0)
+    {
+      ret = i;
+    }
+  else if (pc->error < 0)
+    {
+      ret = pc->error;
+      pc->error = OK;
+    }
+  else
+    {
+      ret = -ENOMEM;
+    }
+
+#if CONFIG_FS_PAGECACHE_WRDELAY != 0
+  /* The delay runs from the first page dirtied, later writes do not push
+   * the write-back further out.
+   */
+
+  if (!list_is_empty(&pc->dirty) && work_available(&pc->work))
+    {
+      work_queue(LPWORK, &pc->work, pagecache_wrtimeout, pc,
+                 MSEC2TICK(CONFIG_FS_PAGECACHE_WRDELAY));
+    }
+#endif
+
+out:
+  nxmutex_unlock(&pc->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_flush
+ *
+ * Description:
+ *   Write back all dirty pages to the media.  Also returns the error of an
+ *   earlier write-back that was not reported yet.
+ *
+ ****************************************************************************/
+
+int pagecache_flush(FAR struct pagecache_s *pc)
+{
+  int ret;
+
+  DEBUGASSERT(pc != NULL);
+
+  ret = nxmutex_lock(&pc->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (pc->flush != NULL)
+    {
+      /* Also report a failed write-back that is not pending any more */
+
+      ret = pagecache_writeback(pc);
+      if (ret >= 0)
+        {
+          ret = pc->error;
+        }
+
+      pc->error = OK;
+    }
+
+  nxmutex_unlock(&pc->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_invalidate
+ *
+ * Description:
+ *   Discard the cached copies of a range of pages, including unwritten
+ *   modifications.
+ *
+ ****************************************************************************/
+
+int pagecache_invalidate(FAR struct pagecache_s *pc,
+                         off_t startpage, size_t npages)
+{
+  int ret;
+
+  DEBUGASSERT(pc != NULL);
+
+  ret = nxmutex_lock(&pc->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  pagecache_discard(pc, startpage, npages);
+  pc->rasize = 0;
+
+  nxmutex_unlock(&pc->lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_shrink
+ *
+ * Description:
+ *   Free clean, least recently used pages of all page caches until at
+ *   least nbytes of memory were released.  Caches which are busy are
+ *   skipped.
+ *
+ * Returned Value:
+ *   The number of bytes released.
+ *
+ ****************************************************************************/
+
+size_t pagecache_shrink(size_t nbytes)
+{
+  FAR struct pagecache_page_s *pg;
+  FAR struct pagecache_page_s *tmp;
+  FAR struct pagecache_s *pc;
+  size_t freed = 0;
+
+  if (nxmutex_lock(&g_pagecache_lock) < 0)
+    {
+      return 0;
+    }
+
+  list_for_every_entry(&g_pagecache_list, pc, struct pagecache_s, node)
+    {
+      if (nxmutex_trylock(&pc->lock) < 0)
+        {
+          continue;
+        }
+
+      for (pg = list_peek_tail_type(&pc->lru, struct pagecache_page_s,
+                                    lnode);
+           pg != NULL && freed < nbytes; pg = tmp)
+        {
+          tmp = list_prev_type(&pc->lru, &pg->lnode,
+                               struct pagecache_page_s, lnode);
+          if (!list_in_list(&pg->dnode))
+            {
+              freed += sizeof(*pg) + pc->pagesize;
+              pagecache_free(pc, pg);
+            }
+        }
+
+      nxmutex_unlock(&pc->lock);
+      if (freed >= nbytes)
+        {
+          break;
+        }
+    }
+
+  nxmutex_unlock(&g_pagecache_lock);
+  return freed;
+}
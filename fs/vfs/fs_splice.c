@@ -0,0 +1,242 @@
+/****************************************************************************
+ * fs/vfs/fs_splice.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/fs/fs.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SPLICE_F_ALL (SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | \
+                      SPLICE_F_GIFT)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: file_splice
+ *
+ * Description:
+ *   Equivalent to the standard splice function except that is accepts
+ *   struct file instances instead of file descriptors.
+ *
+ ****************************************************************************/
+
+ssize_t file_splice(FAR struct file *infile, FAR off_t *inoffset,
+                    FAR struct file *outfile, FAR off_t *outoffset,
+                    size_t len, unsigned int flags)
+{
+#ifdef CONFIG_PIPES
+  bool inpipe  = INODE_IS_PIPE(infile->f_inode);
+  bool outpipe = INODE_IS_PIPE(outfile->f_inode);
+
+  if ((flags & ~SPLICE_F_ALL) != 0 || infile->f_inode == outfile->f_inode)
+    {
+      return -EINVAL;
+    }
+
+  if ((infile->f_oflags & O_RDOK) == 0 || (outfile->f_oflags & O_WROK) == 0)
+    {
+      return -EBADF;
+    }
+
+  /* Pipes have no file position */
+
+  if ((inpipe && inoffset != NULL) || (outpipe && outoffset != NULL))
+    {
+      return -ESPIPE;
+    }
+
+  if (inpipe)
+    {
+      return pipecommon_splice_read(infile, outfile, outoffset, len, flags);
+    }
+  else if (outpipe)
+    {
+      return pipecommon_splice_write(outfile, infile, inoffset, len, flags);
+    }
+#endif
+
+  /* One end must be a pipe */
+
+  return -EINVAL;
+}
+
+/****************************************************************************
+ * Name: file_tee
+ *
+ * Description:
+ *   Equivalent to the standard tee function except that is accepts struct
+ *   file instances instead of file descriptors.
+ *
+ ****************************************************************************/
+
+ssize_t file_tee(FAR struct file *infile, FAR struct file *outfile,
+                 size_t len, unsigned int flags)
+{
+#ifdef CONFIG_PIPES
+  if ((flags & ~SPLICE_F_ALL) == 0 &&
+      infile->f_inode != outfile->f_inode &&
+      INODE_IS_PIPE(infile->f_inode) && INODE_IS_PIPE(outfile->f_inode))
+    {
+      if ((infile->f_oflags & O_RDOK) == 0 ||
+          (outfile->f_oflags & O_WROK) == 0)
+        {
+          return -EBADF;
+        }
+
+      return pipecommon_tee(infile, outfile, len, flags);
+    }
+#endif
+
+  /* Both ends must be different pipes */
+
+  return -EINVAL;
+}
+
+/****************************************************************************
+ * Name: splice
+ *
+ * Description:
+ *   splice() moves data between two file descriptors, one of which must
+ *   refer to a pipe, without a copy through a user space buffer.  Data
+ *   leaving a pipe is written to the other file straight from the pipe
+ *   buffer; data entering a pipe is read straight into the pipe buffer.
+ *   The other file may be a regular file, a character device or a socket.
+ *
+ *   NOTE: This interface is not specified in POSIX.  It follows the Linux
+ *   interface.
+ *
+ * Input Parameters:
+ *   fd_in   - The file descriptor to read from
+ *   off_in  - If 'fd_in' is not a pipe and 'off_in' is not NULL, the data
+ *             is read at '*off_in', which is advanced, and the file
+ *             position of 'fd_in' is not changed.  Must be NULL for a pipe.
+ *   fd_out  - The file descriptor to write to
+ *   off_out - Likewise for 'fd_out'
+ *   len     - The maximum number of bytes to move
+ *   flags   - SPLICE_F_NONBLOCK to not block on the pipe.  The other
+ *             SPLICE_F_* flags are accepted and ignored.
+ *
+ * Returned Value:
+ *   The number of bytes moved, 0 at end of input; on error, -1 is returned
+ *   and errno is set appropriately:
+ *
+ *   EINVAL - Neither descriptor is a pipe, both refer to the same pipe or
+ *            'flags' is invalid.
+ *   ESPIPE - An offset was given for a pipe.
+ *   EAGAIN - SPLICE_F_NONBLOCK was given and the pipe was not ready.
+ *
+ ****************************************************************************/
+
+ssize_t splice(int fd_in, FAR off_t *off_in, int fd_out,
+               FAR off_t *off_out, size_t len, unsigned int flags)
+{
+  FAR struct file *infile;
+  FAR struct file *outfile;
+  ssize_t ret;
+
+  ret = fs_getfilep(fd_in, &infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = fs_getfilep(fd_out, &outfile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = file_splice(infile, off_in, outfile, off_out, len, flags);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: tee
+ *
+ * Description:
+ *   tee() copies data from one pipe to another without consuming it, so
+ *   that the data can still be read or spliced from 'fd_in' afterwards.
+ *
+ *   NOTE: This interface is not specified in POSIX.  It follows the Linux
+ *   interface.
+ *
+ * Input Parameters:
+ *   fd_in  - The pipe to copy from
+ *   fd_out - The pipe to copy to
+ *   len    - The maximum number of bytes to copy
+ *   flags  - SPLICE_F_NONBLOCK to not block on either pipe
+ *
+ * Returned Value:
+ *   The number of bytes copied, 0 if 'fd_in' is empty and has no writers;
+ *   on error, -1 is returned and errno is set appropriately.
+ *
+ ****************************************************************************/
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags)
+{
+  FAR struct file *infile;
+  FAR struct file *outfile;
+  ssize_t ret;
+
+  ret = fs_getfilep(fd_in, &infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = fs_getfilep(fd_out, &outfile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = file_tee(infile, outfile, len, flags);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
@@ -577,6 +577,32 @@ int clock_time2ticks(FAR const struct timespec *reltime,
 
 int clock_ticks2time(sclock_t ticks, FAR struct timespec *reltime);
 
+/****************************************************************************
+ * Name: clock_perf2time
+ *
+ * Description:
+ *   Return an up_perf_gettime() interval as a struct timespec.  Unlike
+ *   up_perf_convert(), this takes a 64-bit interval, so run time totals
+ *   that no longer fit in an unsigned long can be converted.
+ *
+ *   NOTE:  This is an internal OS interface and should not be called from
+ *   application code.
+ *
+ * Input Parameters:
+ *   elapsed - Time interval in up_perf_gettime() units
+ *
+ * Output Parameters:
+ *   ts - Pointer to receive the time value presented as struct timespec
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_CRITMONITOR) || defined(CONFIG_SCHED_IRQMONITOR)
+void clock_perf2time(uint64_t elapsed, FAR struct timespec *ts);
+#endif
+
 /****************************************************************************
  * Name: clock_systime_timespec
  *
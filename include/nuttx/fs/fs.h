@@ -37,6 +37,7 @@
 
 #include <nuttx/mutex.h>
 #include <nuttx/semaphore.h>
+#include <nuttx/spinlock.h>
 #include <nuttx/mm/map.h>
 
 /****************************************************************************
@@ -451,6 +452,7 @@ struct file
 struct filelist
 {
   mutex_t           fl_lock;    /* Manage access to the file list */
+  spinlock_t        fl_spin;    /* Publish fl_files and fl_rows to readers */
   uint8_t           fl_rows;    /* The number of rows of fl_files array */
   FAR struct file **fl_files;   /* The pointer of two layer file descriptors array */
 };
@@ -760,6 +762,27 @@ int register_pipedriver(FAR const char *path,
 
 int unregister_pipedriver(FAR const char *path);
 
+/****************************************************************************
+ * Name: pipecommon_splice_read, pipecommon_splice_write and pipecommon_tee
+ *
+ * Description:
+ *   Transfer data between a pipe and another file directly from and to the
+ *   pipe buffer.  These implement file_splice() and file_tee() and should
+ *   not be called otherwise.
+ *
+ ****************************************************************************/
+
+ssize_t pipecommon_splice_read(FAR struct file *filep,
+                               FAR struct file *outfile,
+                               FAR off_t *offset, size_t len,
+                               unsigned int flags);
+ssize_t pipecommon_splice_write(FAR struct file *filep,
+                                FAR struct file *infile,
+                                FAR off_t *offset, size_t len,
+                                unsigned int flags);
+ssize_t pipecommon_tee(FAR struct file *filep, FAR struct file *outfile,
+                       size_t len, unsigned int flags);
+
 #endif /* CONFIG_PIPES */
 
 /****************************************************************************
@@ -1342,6 +1365,21 @@ ssize_t file_pwrite(FAR struct file *filep, FAR const void *buf,
 ssize_t file_sendfile(FAR struct file *outfile, FAR struct file *infile,
                       FAR off_t *offset, size_t count);
 
+/****************************************************************************
+ * Name: file_splice and file_tee
+ *
+ * Description:
+ *   Equivalent to the splice() and tee() functions except that they accept
+ *   struct file instances instead of file descriptors.
+ *
+ ****************************************************************************/
+
+ssize_t file_splice(FAR struct file *infile, FAR off_t *inoffset,
+                    FAR struct file *outfile, FAR off_t *outoffset,
+                    size_t len, unsigned int flags);
+ssize_t file_tee(FAR struct file *infile, FAR struct file *outfile,
+                 size_t len, unsigned int flags);
+
 /****************************************************************************
  * Name: file_seek
  *
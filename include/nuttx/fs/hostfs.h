@@ -231,6 +231,11 @@ int           host_rename(const char *oldpath, const char *newpath);
 int           host_stat(const char *path, struct stat *buf);
 int           host_chstat(const char *path,
                           const struct stat *buf, int flags);
+
+#ifdef CONFIG_SIM_HOSTFS_ASYNC
+ssize_t       sim_hostfs_read(int fd, void *buf, size_t count);
+ssize_t       sim_hostfs_write(int fd, const void *buf, size_t count);
+#endif
 #endif /* __SIM__ */
 
 #endif /* __INCLUDE_NUTTX_FS_HOSTFS_H */
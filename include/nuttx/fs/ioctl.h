@@ -311,6 +311,20 @@
                                            *      to return sector numbers.
                                            * OUT: Data return in user-provided
                                            *      buffer. */
+#define BIOC_DISCARD    _BIOC(0x0011)     /* Tell the block device that the
+                                           * content of a range of sectors is
+                                           * no longer needed.
+                                           * IN:  Pointer to a read-able array
+                                           *      of two blkcnt_t: the first
+                                           *      sector and the number of
+                                           *      sectors.
+                                           * OUT: None */
+#define BIOC_FTLSTATS   _BIOC(0x0012)     /* Get FTL statistics.
+                                           * IN:  Pointer to writable struct
+                                           *      ftl_stats_s in which to
+                                           *      return the statistics.
+                                           * OUT: Data return in user-provided
+                                           *      buffer. */
 
 /* NuttX MTD driver ioctl definitions ***************************************/
 
@@ -458,6 +472,16 @@
                                                * IN: pipe_peek_s
                                                * OUT: Length of data */
 
+#define PIPEIOC_SETSIZE     _PIPEIOC(0x0005)  /* Set the pipe capacity
+                                               * IN: unsigned long integer
+                                               * OUT: None.  Returns the
+                                               *      new capacity */
+
+#define PIPEIOC_GETSIZE     _PIPEIOC(0x0006)  /* Get the pipe capacity
+                                               * IN: None
+                                               * OUT: None.  Returns the
+                                               *      capacity */
+
 /* RTC driver ioctl definitions *********************************************/
 
 /* (see nuttx/include/rtc.h */
@@ -0,0 +1,154 @@
+/****************************************************************************
+ * include/nuttx/fs/pagecache.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_FS_PAGECACHE_H
+#define __INCLUDE_NUTTX_FS_PAGECACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include <nuttx/list.h>
+#include <nuttx/mutex.h>
+#include <nuttx/wqueue.h>
+
+#ifdef CONFIG_FS_PAGECACHE
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Data transfer callouts.  These must be provided by the owner of the cache
+ * (a block driver, the block-to-character layer or a file system) in order
+ * to load pages that are not in memory and to write back dirty pages.  They
+ * return the number of pages transferred or a negated errno value.
+ */
+
+typedef CODE ssize_t (*pgreload_t)(FAR void *dev, FAR uint8_t *buffer,
+                                   off_t startpage, size_t npages);
+typedef CODE ssize_t (*pgflush_t)(FAR void *dev, FAR const uint8_t *buffer,
+                                  off_t startpage, size_t npages);
+
+/* This structure holds the state of one page cache.  Each cache covers one
+ * linear space of fixed size pages, usually the blocks of one device, and
+ * is embedded in the state structure of its owner:
+ *
+ *  FAR struct foo_dev_s *priv;
+ *  ...
+ *  ... [Setup pagesize, npages, maxpages, ramaxpages, directpages, dev,
+ *       reload, flush] ...
+ *  ret = pagecache_initialize(&priv->pagecache);
+ *
+ * All caches are linked together so that pagecache_shrink() can release
+ * clean pages when memory runs low.
+ */
+
+struct pagecache_s
+{
+  /**************************************************************************/
+
+  /* These values must be provided by the user prior to calling
+   * pagecache_initialize()
+   */
+
+  uint16_t      pagesize;        /* The size of one page */
+  size_t        npages;          /* The total number of pages of the media */
+  uint16_t      maxpages;        /* The number of pages to cache in memory */
+  uint16_t      ramaxpages;      /* Maximum read-ahead in pages (0=none) */
+  uint16_t      directpages;     /* Transfers of this many pages or more
+                                  * bypass the cache (0=never) */
+
+  FAR void     *dev;             /* Device state passed to callouts */
+  pgreload_t    reload;          /* Callout to read pages from the media */
+  pgflush_t     flush;           /* Callout to write pages to the media,
+                                  * NULL if the media is read-only */
+
+  /**************************************************************************/
+
+  /* The user should never modify any of the remaining fields */
+
+  struct list_node node;         /* Link in the list of all page caches */
+  mutex_t       lock;            /* Enforces exclusive access to the cache */
+  FAR struct list_node *hash;    /* Cached pages, hashed by page number */
+  struct list_node lru;          /* Cached pages, most recently used first */
+  struct list_node dirty;        /* Pages not yet written to the media */
+  uint16_t      nhash;           /* Number of hash buckets (power of 2) */
+  uint16_t      ncached;         /* Number of pages allocated */
+  uint16_t      rasize;          /* Size of the next read-ahead in pages */
+  off_t         ranext;          /* Page that continues a sequential read */
+  int           error;           /* Write-back error not yet reported */
+#if CONFIG_FS_PAGECACHE_WRDELAY != 0
+  struct work_s work;            /* Delayed write-back of dirty pages */
+#endif
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/* Cache initialization */
+
+int pagecache_initialize(FAR struct pagecache_s *pc);
+void pagecache_uninitialize(FAR struct pagecache_s *pc);
+
+/* Page oriented transfers */
+
+ssize_t pagecache_read(FAR struct pagecache_s *pc, FAR uint8_t *buffer,
+                       off_t startpage, size_t npages);
+ssize_t pagecache_write(FAR struct pagecache_s *pc,
+                        FAR const uint8_t *buffer,
+                        off_t startpage, size_t npages);
+
+/* Write back all dirty pages, e.g. on fsync() or before unmount */
+
+int pagecache_flush(FAR struct pagecache_s *pc);
+
+/* Discard cached pages, dirty or not, e.g. when the media changed */
+
+int pagecache_invalidate(FAR struct pagecache_s *pc,
+                         off_t startpage, size_t npages);
+
+/* Release clean pages of all caches to recover from memory pressure.
+ * Returns the number of bytes freed.
+ */
+
+size_t pagecache_shrink(size_t nbytes);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_FS_PAGECACHE */
+#endif /* __INCLUDE_NUTTX_FS_PAGECACHE_H */
@@ -76,6 +76,10 @@
                                              *      erased state of the MTD cell */
 #define MTDIOC_ERASESECTORS _MTDIOC(0x000c) /* IN: Pointer to mtd_erase_s structure
                                              * OUT: None */
+#define MTDIOC_IOSCHEDSTATS _MTDIOC(0x000d) /* IN:  Pointer to write-able struct
+                                             *      mtd_iosched_stats_s
+                                             * OUT: Statistics of the I/O
+                                             *      scheduler */
 
 /* Macros to hide implementation */
 
@@ -149,6 +153,38 @@ struct mtd_erase_s
   uint32_t nblocks;     /* Number of blocks to be erased */
 };
 
+/* Statistics of an FTL block driver, returned by BIOC_FTLSTATS.  The write
+ * amplification is flashwrites / hostwrites.  The erase counts are only
+ * tracked by the log-structured FTL and are zero otherwise.
+ */
+
+struct ftl_stats_s
+{
+  uint64_t hostwrites;    /* Sectors written through the block driver */
+  uint64_t flashwrites;   /* Blocks programmed on the MTD device */
+  uint64_t erases;        /* Erase blocks erased */
+  uint64_t gcmoves;       /* Sectors moved by garbage collection */
+  uint64_t discards;      /* Sectors discarded */
+  uint32_t minerase;      /* Lowest erase count of a good erase block */
+  uint32_t maxerase;      /* Highest erase count of a good erase block */
+  uint32_t freeblocks;    /* Erase blocks available for writing */
+};
+
+/* Statistics of the MTD I/O scheduler, returned by MTDIOC_IOSCHEDSTATS.
+ * The average latency is latency / (requests - depth).
+ */
+
+struct mtd_iosched_stats_s
+{
+  uint32_t requests;      /* Requests submitted */
+  uint32_t dispatched;    /* Calls of the contained MTD driver */
+  uint32_t merged;        /* Requests merged with another one */
+  uint32_t depth;         /* Requests currently queued or in progress */
+  uint32_t maxdepth;      /* Highest queue depth */
+  uint32_t maxlatency;    /* Highest latency of a request in microseconds */
+  uint64_t latency;       /* Sum of the completed requests' latencies */
+};
+
 /* This structure defines the interface to a simple memory technology device.
  * It will likely need to be extended in the future to support more complex
  * devices.
@@ -287,6 +323,27 @@ int mtd_setpartitionname(FAR struct mtd_dev_s *mtd, FAR const char *name);
 FAR struct mtd_dev_s *mtd_rwb_initialize(FAR struct mtd_dev_s *mtd);
 #endif
 
+/****************************************************************************
+ * Name: mtd_iosched_initialize
+ *
+ * Description:
+ *   Create an initialized MTD device instance.  This MTD driver contains
+ *   another MTD driver and queues the requests to it.  A kernel thread
+ *   dispatches them: reads go before queued writes and erases of other
+ *   blocks, requests on adjacent blocks are merged and erases return
+ *   before they are done.  A failed asynchronous erase is reported by the
+ *   next erase or BIOC_FLUSH.
+ *
+ *   The I/O scheduler is best placed directly on top of the FLASH driver,
+ *   below any partitions, so that the requests of all file systems on the
+ *   device share one queue.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_IOSCHED
+FAR struct mtd_dev_s *mtd_iosched_initialize(FAR struct mtd_dev_s *mtd);
+#endif
+
 /****************************************************************************
  * Name: ftl_initialize_by_path
  *
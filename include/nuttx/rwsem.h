@@ -0,0 +1,206 @@
+/****************************************************************************
+ * include/nuttx/rwsem.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_RWSEM_H
+#define __INCLUDE_NUTTX_RWSEM_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/mutex.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RWSEM_NO_HOLDER      ((pid_t)-1)
+#define RWSEM_INITIALIZER    {NXMUTEX_INITIALIZER, \
+                              NXSEM_INITIALIZER(0, SEM_PRIO_NONE), \
+                              0, 0, 0, 0, RWSEM_NO_HOLDER}
+
+/* Number of readers tracked to catch a reader taking the lock again */
+
+#ifdef CONFIG_DEBUG_ASSERTIONS
+#  define RWSEM_NREADERS     8
+#endif
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+struct rw_semaphore_s
+{
+  mutex_t protect;    /* Protects the reader/writer counts */
+  sem_t   waiting;    /* Readers and writers waiting for the lock */
+  int     waiter;     /* Number of threads waiting on 'waiting' */
+  int     wwaiter;    /* Number of writers waiting for the lock */
+  int     reader;     /* Number of readers holding the lock */
+  int     writer;     /* Write lock recursion count of the holder */
+  pid_t   holder;     /* Thread holding the write lock */
+#ifdef CONFIG_DEBUG_ASSERTIONS
+  pid_t   readers[RWSEM_NREADERS]; /* Reader thread IDs + 1, 0 if unused */
+#endif
+};
+
+typedef struct rw_semaphore_s rw_semaphore_t;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: init_rwsem
+ *
+ * Description:
+ *   Initialize a read/write semaphore.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int init_rwsem(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: destroy_rwsem
+ *
+ * Description:
+ *   Destroy a read/write semaphore.  The semaphore must not be held.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void destroy_rwsem(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: down_read
+ *
+ * Description:
+ *   Obtain a shared read lock.  Any number of readers may hold the lock at
+ *   the same time, but only while no writer holds it or waits for it.  The
+ *   writer holding the lock may also take it for reading.
+ *
+ *   The read lock is not recursive: a reader that takes it again, or asks
+ *   for the write lock, deadlocks once a writer is waiting.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void down_read(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: down_read_trylock
+ *
+ * Description:
+ *   Try to obtain a shared read lock without waiting.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   1 if the lock was obtained, 0 otherwise.
+ *
+ ****************************************************************************/
+
+int down_read_trylock(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: up_read
+ *
+ * Description:
+ *   Release a read lock obtained with down_read() or down_read_trylock().
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void up_read(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: down_write
+ *
+ * Description:
+ *   Obtain an exclusive write lock.  The lock is recursive: the holder may
+ *   take it again and must then release it the same number of times.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void down_write(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: down_write_trylock
+ *
+ * Description:
+ *   Try to obtain an exclusive write lock without waiting.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   1 if the lock was obtained, 0 otherwise.
+ *
+ ****************************************************************************/
+
+int down_write_trylock(FAR rw_semaphore_t *rwsem);
+
+/****************************************************************************
+ * Name: up_write
+ *
+ * Description:
+ *   Release a write lock obtained with down_write() or
+ *   down_write_trylock().
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void up_write(FAR rw_semaphore_t *rwsem);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLY__ */
+#endif /* __INCLUDE_NUTTX_RWSEM_H */
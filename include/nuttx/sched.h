@@ -96,6 +96,7 @@
 #  define TCB_FLAG_SCHED_FIFO      (0 << TCB_FLAG_POLICY_SHIFT)  /* FIFO scheding policy */
 #  define TCB_FLAG_SCHED_RR        (1 << TCB_FLAG_POLICY_SHIFT)  /* Round robin scheding policy */
 #  define TCB_FLAG_SCHED_SPORADIC  (2 << TCB_FLAG_POLICY_SHIFT)  /* Sporadic scheding policy */
+#define TCB_FLAG_COND_REQUEUED     (1 << 7)                      /* Bit 7: Requeued from cond to mutex */
 #define TCB_FLAG_CPU_LOCKED        (1 << 8)                      /* Bit 7: Locked to this CPU */
 #define TCB_FLAG_SIGNAL_ACTION     (1 << 9)                      /* Bit 8: In a signal handler */
 #define TCB_FLAG_SYSCALL           (1 << 10)                     /* Bit 9: In a system call */
@@ -486,6 +487,9 @@ struct task_group_s
   /* POSIX Signal Control Fields ********************************************/
 
   sq_queue_t tg_sigactionq;         /* List of actions for signals              */
+#ifdef CONFIG_SIG_ACTION_TABLE
+  FAR struct sigactq *tg_sigaction[MAX_SIGNO + 1]; /* Actions by signo */
+#endif
   sq_queue_t tg_sigpendingq;        /* List of pending signals                  */
 #ifdef CONFIG_SIG_DEFAULT
   sigset_t tg_sigdefault;           /* Set of signals set to the default action */
@@ -637,7 +641,11 @@ struct tcb_s
   unsigned long crit_max;                /* Max time in critical section    */
   unsigned long run_start;               /* Time when thread begin run      */
   unsigned long run_max;                 /* Max time thread run             */
-  unsigned long run_time;                /* Total time thread run           */
+  uint64_t run_time;                     /* Total time thread run           */
+#endif
+
+#ifdef CONFIG_SCHED_CPULOAD_CRITMONITOR
+  unsigned long run_rem;                 /* Run time not yet counted in ticks */
 #endif
 
   /* State save areas *******************************************************/
@@ -764,6 +772,10 @@ extern "C"
 
 EXTERN unsigned long g_premp_max[CONFIG_SMP_NCPUS];
 EXTERN unsigned long g_crit_max[CONFIG_SMP_NCPUS];
+
+/* Total time each CPU ran threads other than its idle thread */
+
+EXTERN uint64_t g_busy_time[CONFIG_SMP_NCPUS];
 #endif /* CONFIG_SCHED_CRITMONITOR */
 
 EXTERN const struct tcbinfo_s g_tcbinfo;
@@ -263,10 +263,13 @@ typedef struct pthread_condattr_s pthread_condattr_t;
 #  define __PTHREAD_CONDATTR_T_DEFINED 1
 #endif
 
+struct pthread_mutex_s; /* Forward reference */
+
 struct pthread_cond_s
 {
   sem_t sem;
   clockid_t clockid;
+  FAR struct pthread_mutex_s *mutex; /* Mutex of the current waiters */
 };
 
 #ifndef __PTHREAD_COND_T_DEFINED
@@ -274,7 +277,7 @@ typedef struct pthread_cond_s pthread_cond_t;
 #  define __PTHREAD_COND_T_DEFINED 1
 #endif
 
-#define PTHREAD_COND_INITIALIZER {SEM_INITIALIZER(0), CLOCK_REALTIME }
+#define PTHREAD_COND_INITIALIZER {SEM_INITIALIZER(0), CLOCK_REALTIME, NULL}
 
 struct pthread_mutexattr_s
 {
@@ -389,7 +392,8 @@ typedef struct pthread_rwlockattr_s pthread_rwlockattr_t;
 struct pthread_rwlock_s
 {
   pthread_mutex_t lock;
-  pthread_cond_t  cv;
+  pthread_cond_t  cv;   /* Readers wait here */
+  pthread_cond_t  wcv;  /* Writers wait here */
   unsigned int num_readers;
   unsigned int num_writers;
   bool write_in_progress;
@@ -401,6 +405,7 @@ typedef struct pthread_rwlock_s pthread_rwlock_t;
 #endif
 
 #define PTHREAD_RWLOCK_INITIALIZER  {PTHREAD_MUTEX_INITIALIZER, \
+                                     PTHREAD_COND_INITIALIZER, \
                                      PTHREAD_COND_INITIALIZER, \
                                      0, 0, false}
 
@@ -0,0 +1,145 @@
+/****************************************************************************
+ * include/sys/aioring.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_SYS_AIORING_H
+#define __INCLUDE_SYS_AIORING_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <fcntl.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* aioring_setup() flags */
+
+#define AIORING_CLOEXEC    O_CLOEXEC
+
+/* Operation codes of a submission queue entry */
+
+#define AIORING_OP_NOP     0  /* Complete immediately with result 0 */
+#define AIORING_OP_READ    1  /* read()/pread() into buf */
+#define AIORING_OP_WRITE   2  /* write()/pwrite() from buf */
+#define AIORING_OP_FSYNC   3  /* fsync() */
+#define AIORING_OP_POLL    4  /* Wait for the poll events in 'events' */
+#define AIORING_OP_ACCEPT  5  /* accept4(), peer address in buf/len */
+#define AIORING_OP_SEND    6  /* send() from buf */
+#define AIORING_OP_RECV    7  /* recv() into buf */
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+/* One submission queue entry.  READ and WRITE transfer at the current file
+ * position if 'off' is negative.  'flags' holds the MSG_* flags of SEND and
+ * RECV and the SOCK_* flags of ACCEPT.
+ */
+
+struct aioring_sqe_s
+{
+  uint8_t   opcode;     /* AIORING_OP_* */
+  uint8_t   reserved;
+  uint16_t  events;     /* POLL: Events to wait for */
+  int       fd;         /* File descriptor to operate on */
+  int       flags;      /* Operation specific flags */
+  off_t     off;        /* READ/WRITE: File offset */
+  FAR void *buf;        /* Data buffer */
+  size_t    len;        /* Size of the data buffer */
+  uintptr_t user_data;  /* Returned unchanged in the completion */
+};
+
+/* One completion queue entry.  'res' is what the corresponding system call
+ * would have returned, or a negated errno value on failure.
+ */
+
+struct aioring_cqe_s
+{
+  uintptr_t user_data;  /* From the submission queue entry */
+  ssize_t   res;        /* Result of the operation */
+};
+
+/* The rings shared between the application and the kernel.  The memory is
+ * provided by the application and must stay valid until the ring file
+ * descriptor is closed.  Both entry counts must be powers of two.
+ *
+ * Closing the last descriptor cancels the operations that have not
+ * started yet and does not wait for the ones already executing, which
+ * may never complete.  Their results are dropped, but their data buffers
+ * are still accessed until they finish.
+ *
+ * The application fills sqes[sq_tail & (sq_entries - 1)] and then
+ * increments sq_tail; aioring_enter() consumes entries from sq_head.  The
+ * kernel posts completions at cq_tail; the application consumes them from
+ * cq_head.  No more operations are accepted than there are free
+ * completion entries, so the completion queue never overflows.
+ */
+
+struct aioring_s
+{
+  volatile uint32_t sq_head;            /* Next entry the kernel consumes */
+  volatile uint32_t sq_tail;            /* Next entry the application fills */
+  uint32_t          sq_entries;         /* Size of sqes[] */
+  FAR struct aioring_sqe_s *sqes;       /* Submission queue */
+
+  volatile uint32_t cq_head;            /* Next entry the application reads */
+  volatile uint32_t cq_tail;            /* Next entry the kernel posts */
+  uint32_t          cq_entries;         /* Size of cqes[] */
+  FAR struct aioring_cqe_s *cqes;       /* Completion queue */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/* Create a ring and return a file descriptor that refers to it.  The file
+ * descriptor polls readable when completions are available.
+ */
+
+int aioring_setup(FAR struct aioring_s *ring, int flags);
+
+/* Submit up to 'to_submit' queued entries and then wait until at least
+ * 'min_complete' completions are available or 'timeout' milliseconds have
+ * passed (-1: wait forever).  Returns the number of entries submitted.
+ */
+
+int aioring_enter(int fd, unsigned int to_submit,
+                  unsigned int min_complete, int timeout);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_SYS_AIORING_H */
@@ -207,6 +207,10 @@ SYSCALL_LOOKUP(pwrite,                     4)
   SYSCALL_LOOKUP(aio_write,                1)
   SYSCALL_LOOKUP(aio_fsync,                2)
   SYSCALL_LOOKUP(aio_cancel,               2)
+#  ifdef CONFIG_FS_AIO_RING
+  SYSCALL_LOOKUP(aioring_setup,            2)
+  SYSCALL_LOOKUP(aioring_enter,            4)
+#  endif
 #endif
   SYSCALL_LOOKUP(poll,                     3)
   SYSCALL_LOOKUP(select,                   5)
@@ -246,6 +250,8 @@ SYSCALL_LOOKUP(fstat,                      2)
 SYSCALL_LOOKUP(statfs,                     2)
 SYSCALL_LOOKUP(fstatfs,                    2)
 SYSCALL_LOOKUP(sendfile,                   4)
+SYSCALL_LOOKUP(splice,                     6)
+SYSCALL_LOOKUP(tee,                        4)
 SYSCALL_LOOKUP(sync,                       0)
 SYSCALL_LOOKUP(fsync,                      1)
 SYSCALL_LOOKUP(chmod,                      2)
@@ -258,6 +264,7 @@ SYSCALL_LOOKUP(utimens,                    2)
 SYSCALL_LOOKUP(lutimens,                   2)
 SYSCALL_LOOKUP(futimens,                   2)
 SYSCALL_LOOKUP(munmap,                     2)
+SYSCALL_LOOKUP(msync,                      3)
 
 #if defined(CONFIG_PSEUDOFS_SOFTLINKS)
   SYSCALL_LOOKUP(link,                     2)
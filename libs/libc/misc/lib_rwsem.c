@@ -0,0 +1,415 @@
+/****************************************************************************
+ * libs/libc/misc/lib_rwsem.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/rwsem.h>
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: rwsem_wait
+ *
+ * Description:
+ *   Wait until the lock state changes.  The caller must hold
+ *   rwsem->protect, which is released while waiting and re-acquired
+ *   before returning.
+ *
+ ****************************************************************************/
+
+static void rwsem_wait(FAR rw_semaphore_t *rwsem)
+{
+  rwsem->waiter++;
+  nxmutex_unlock(&rwsem->protect);
+  nxsem_wait_uninterruptible(&rwsem->waiting);
+  nxmutex_lock(&rwsem->protect);
+}
+
+/****************************************************************************
+ * Name: rwsem_wake
+ *
+ * Description:
+ *   Wake up all threads waiting for the lock state to change so that they
+ *   can re-evaluate it.  The caller must hold rwsem->protect.
+ *
+ ****************************************************************************/
+
+static void rwsem_wake(FAR rw_semaphore_t *rwsem)
+{
+  while (rwsem->waiter > 0)
+    {
+      rwsem->waiter--;
+      nxsem_post(&rwsem->waiting);
+    }
+}
+
+/****************************************************************************
+ * Name: rwsem_isreader, rwsem_addreader, rwsem_delreader
+ *
+ * Description:
+ *   Track the threads holding the read lock so that a reader taking the
+ *   lock again is caught instead of deadlocking behind a waiting writer.
+ *   Only the first RWSEM_NREADERS readers are tracked.  The caller must
+ *   hold rwsem->protect.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_DEBUG_ASSERTIONS
+static bool rwsem_isreader(FAR rw_semaphore_t *rwsem, pid_t tid)
+{
+  int i;
+
+  for (i = 0; i < RWSEM_NREADERS; i++)
+    {
+      if (rwsem->readers[i] == tid + 1)
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+static void rwsem_addreader(FAR rw_semaphore_t *rwsem, pid_t tid)
+{
+  int i;
+
+  for (i = 0; i < RWSEM_NREADERS; i++)
+    {
+      if (rwsem->readers[i] == 0)
+        {
+          rwsem->readers[i] = tid + 1;
+          break;
+        }
+    }
+}
+
+static void rwsem_delreader(FAR rw_semaphore_t *rwsem, pid_t tid)
+{
+  int i;
+
+  for (i = 0; i < RWSEM_NREADERS; i++)
+    {
+      if (rwsem->readers[i] == tid + 1)
+        {
+          rwsem->readers[i] = 0;
+          break;
+        }
+    }
+}
+#else
+#  define rwsem_isreader(rwsem, tid) false
+#  define rwsem_addreader(rwsem, tid)
+#  define rwsem_delreader(rwsem, tid)
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: init_rwsem
+ *
+ * Description:
+ *   Initialize a read/write semaphore.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int init_rwsem(FAR rw_semaphore_t *rwsem)
+{
+  int ret;
+
+  DEBUGASSERT(rwsem != NULL);
+
+  ret = nxmutex_init(&rwsem->protect);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = nxsem_init(&rwsem->waiting, 0, 0);
+  if (ret < 0)
+    {
+      nxmutex_destroy(&rwsem->protect);
+      return ret;
+    }
+
+  rwsem->waiter  = 0;
+  rwsem->wwaiter = 0;
+  rwsem->reader  = 0;
+  rwsem->writer  = 0;
+  rwsem->holder  = RWSEM_NO_HOLDER;
+#ifdef CONFIG_DEBUG_ASSERTIONS
+  memset(rwsem->readers, 0, sizeof(rwsem->readers));
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: destroy_rwsem
+ *
+ * Description:
+ *   Destroy a read/write semaphore.  The semaphore must not be held.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void destroy_rwsem(FAR rw_semaphore_t *rwsem)
+{
+  DEBUGASSERT(rwsem->waiter == 0 && rwsem->wwaiter == 0 &&
+              rwsem->reader == 0 &&
+              rwsem->writer == 0 && rwsem->holder == RWSEM_NO_HOLDER);
+
+  nxsem_destroy(&rwsem->waiting);
+  nxmutex_destroy(&rwsem->protect);
+}
+
+/****************************************************************************
+ * Name: down_read_trylock
+ *
+ * Description:
+ *   Try to obtain a shared read lock without waiting.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   1 if the lock was obtained, 0 otherwise.
+ *
+ ****************************************************************************/
+
+int down_read_trylock(FAR rw_semaphore_t *rwsem)
+{
+  pid_t tid = _SCHED_GETTID();
+
+  if (rwsem->holder == tid)
+    {
+      return down_write_trylock(rwsem);
+    }
+
+  nxmutex_lock(&rwsem->protect);
+
+  if (rwsem->writer > 0 || rwsem->wwaiter > 0)
+    {
+      nxmutex_unlock(&rwsem->protect);
+      return 0;
+    }
+
+  rwsem->reader++;
+  rwsem_addreader(rwsem, tid);
+  nxmutex_unlock(&rwsem->protect);
+  return 1;
+}
+
+/****************************************************************************
+ * Name: down_read
+ *
+ * Description:
+ *   Obtain a shared read lock.  Any number of readers may hold the lock at
+ *   the same time, but only while no writer holds it.  The writer holding
+ *   the lock may also take it for reading.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void down_read(FAR rw_semaphore_t *rwsem)
+{
+  pid_t tid = _SCHED_GETTID();
+
+  /* The holder of the write lock already has exclusive access.  Treat the
+   * read lock as a recursive write lock so that up_read() balances it.
+   */
+
+  if (rwsem->holder == tid)
+    {
+      down_write(rwsem);
+      return;
+    }
+
+  nxmutex_lock(&rwsem->protect);
+  DEBUGASSERT(!rwsem_isreader(rwsem, tid));
+
+  /* Queued writers go first, so that a steady stream of readers cannot
+   * starve them.
+   */
+
+  while (rwsem->writer > 0 || rwsem->wwaiter > 0)
+    {
+      rwsem_wait(rwsem);
+    }
+
+  rwsem->reader++;
+  rwsem_addreader(rwsem, tid);
+  nxmutex_unlock(&rwsem->protect);
+}
+
+/****************************************************************************
+ * Name: up_read
+ *
+ * Description:
+ *   Release a read lock obtained with down_read() or down_read_trylock().
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void up_read(FAR rw_semaphore_t *rwsem)
+{
+  pid_t tid = _SCHED_GETTID();
+
+  if (rwsem->holder == tid)
+    {
+      up_write(rwsem);
+      return;
+    }
+
+  nxmutex_lock(&rwsem->protect);
+
+  DEBUGASSERT(rwsem->reader > 0);
+  rwsem_delreader(rwsem, tid);
+  if (--rwsem->reader == 0)
+    {
+      rwsem_wake(rwsem);
+    }
+
+  nxmutex_unlock(&rwsem->protect);
+}
+
+/****************************************************************************
+ * Name: down_write_trylock
+ *
+ * Description:
+ *   Try to obtain an exclusive write lock without waiting.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ * Returned Value:
+ *   1 if the lock was obtained, 0 otherwise.
+ *
+ ****************************************************************************/
+
+int down_write_trylock(FAR rw_semaphore_t *rwsem)
+{
+  pid_t tid = _SCHED_GETTID();
+
+  nxmutex_lock(&rwsem->protect);
+
+  if (rwsem->holder != tid && (rwsem->reader > 0 || rwsem->writer > 0))
+    {
+      nxmutex_unlock(&rwsem->protect);
+      return 0;
+    }
+
+  rwsem->writer++;
+  rwsem->holder = tid;
+  nxmutex_unlock(&rwsem->protect);
+  return 1;
+}
+
+/****************************************************************************
+ * Name: down_write
+ *
+ * Description:
+ *   Obtain an exclusive write lock.  The lock is recursive: the holder may
+ *   take it again and must then release it the same number of times.
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void down_write(FAR rw_semaphore_t *rwsem)
+{
+  pid_t tid = _SCHED_GETTID();
+
+  nxmutex_lock(&rwsem->protect);
+
+  if (rwsem->holder != tid)
+    {
+      /* A reader asking for the write lock would wait for itself */
+
+      DEBUGASSERT(!rwsem_isreader(rwsem, tid));
+
+      rwsem->wwaiter++;
+      while (rwsem->reader > 0 || rwsem->writer > 0)
+        {
+          rwsem_wait(rwsem);
+        }
+
+      rwsem->wwaiter--;
+      rwsem->holder = tid;
+    }
+
+  rwsem->writer++;
+  nxmutex_unlock(&rwsem->protect);
+}
+
+/****************************************************************************
+ * Name: up_write
+ *
+ * Description:
+ *   Release a write lock obtained with down_write() or
+ *   down_write_trylock().
+ *
+ * Input Parameters:
+ *   rwsem - Pointer to the read/write semaphore
+ *
+ ****************************************************************************/
+
+void up_write(FAR rw_semaphore_t *rwsem)
+{
+  nxmutex_lock(&rwsem->protect);
+
+  DEBUGASSERT(rwsem->writer > 0 && rwsem->holder == _SCHED_GETTID());
+  if (--rwsem->writer == 0)
+    {
+      rwsem->holder = RWSEM_NO_HOLDER;
+      rwsem_wake(rwsem);
+    }
+
+  nxmutex_unlock(&rwsem->protect);
+}
@@ -72,6 +72,7 @@ int pthread_cond_init(FAR pthread_cond_t *cond,
   else
     {
       cond->clockid = attr ? attr->clockid : CLOCK_REALTIME;
+      cond->mutex   = NULL;
     }
 
   sinfo("Returning %d\n", ret);
@@ -48,9 +48,17 @@ int pthread_rwlock_init(FAR pthread_rwlock_t *lock,
       return err;
     }
 
+  err = pthread_cond_init(&lock->wcv, NULL);
+  if (err != 0)
+    {
+      pthread_cond_destroy(&lock->cv);
+      return err;
+    }
+
   err = pthread_mutex_init(&lock->lock, NULL);
   if (err != 0)
     {
+      pthread_cond_destroy(&lock->wcv);
       pthread_cond_destroy(&lock->cv);
       return err;
     }
@@ -61,6 +69,7 @@ int pthread_rwlock_init(FAR pthread_rwlock_t *lock,
 int pthread_rwlock_destroy(FAR pthread_rwlock_t *lock)
 {
   int cond_err  = pthread_cond_destroy(&lock->cv);
+  int wcond_err = pthread_cond_destroy(&lock->wcv);
   int mutex_err = pthread_mutex_destroy(&lock->lock);
 
   if (mutex_err)
@@ -68,7 +77,7 @@ int pthread_rwlock_destroy(FAR pthread_rwlock_t *lock)
       return mutex_err;
     }
 
-  return cond_err;
+  return cond_err ? cond_err : wcond_err;
 }
 
 int pthread_rwlock_unlock(FAR pthread_rwlock_t *rw_lock)
@@ -81,20 +90,32 @@ int pthread_rwlock_unlock(FAR pthread_rwlock_t *rw_lock)
       return err;
     }
 
+  /* Writers have preference: when the lock becomes free, hand it to a
+   * single waiting writer if there is one.  Readers only ever wait for
+   * writers, so they are all released at once when no writer is pending.
+   */
+
   if (rw_lock->num_readers > 0)
     {
       rw_lock->num_readers--;
 
-      if (rw_lock->num_readers == 0)
+      if (rw_lock->num_readers == 0 && rw_lock->num_writers > 0)
         {
-          err = pthread_cond_broadcast(&rw_lock->cv);
+          err = pthread_cond_signal(&rw_lock->wcv);
         }
     }
   else if (rw_lock->write_in_progress)
     {
       rw_lock->write_in_progress = false;
 
-      err = pthread_cond_broadcast(&rw_lock->cv);
+      if (rw_lock->num_writers > 0)
+        {
+          err = pthread_cond_signal(&rw_lock->wcv);
+        }
+      else
+        {
+          err = pthread_cond_broadcast(&rw_lock->cv);
+        }
     }
   else
     {
@@ -111,12 +111,12 @@ int pthread_rwlock_clockwrlock(FAR pthread_rwlock_t *rw_lock,
     {
       if (ts != NULL)
         {
-          err = pthread_cond_clockwait(&rw_lock->cv, &rw_lock->lock,
+          err = pthread_cond_clockwait(&rw_lock->wcv, &rw_lock->lock,
                                        clockid, ts);
         }
       else
         {
-          err = pthread_cond_wait(&rw_lock->cv, &rw_lock->lock);
+          err = pthread_cond_wait(&rw_lock->wcv, &rw_lock->lock);
         }
 
       if (err != 0)
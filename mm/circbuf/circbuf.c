@@ -571,7 +571,7 @@ FAR void *circbuf_get_writeptr(FAR struct circbuf_s *circ, FAR size_t *size)
 
   off = circ->head % circ->size;
   pos = circ->tail % circ->size;
-  if (off >= pos)
+  if (off > pos || (off == pos && circ->head == circ->tail))
     {
       *size = circ->size - off;
     }
@@ -607,7 +607,7 @@ FAR void *circbuf_get_readptr(FAR struct circbuf_s *circ, size_t *size)
 
   off = circ->head % circ->size;
   pos = circ->tail % circ->size;
-  if (pos > off)
+  if (pos > off || (pos == off && circ->head != circ->tail))
     {
       *size = circ->size - pos;
     }
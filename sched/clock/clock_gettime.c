@@ -35,6 +35,7 @@
 #include <nuttx/spinlock.h>
 
 #include "clock/clock.h"
+#include "sched/sched.h"
 #ifdef CONFIG_CLOCK_TIMEKEEPING
 #  include "clock/clock_timekeeping.h"
 #endif
@@ -153,12 +154,12 @@ int clock_gettime(clockid_t clock_id, struct timespec *tp)
           tcb = nxsched_get_tcb(pid);
         }
 
-      up_perf_convert(tcb->run_time, tp);
+      clock_perf2time(nxsched_critmon_runtime(tcb), tp);
     }
   else if (clock_type == CLOCK_PROCESS_CPUTIME_ID)
     {
       FAR struct task_group_s *group;
-      unsigned long runtime;
+      uint64_t runtime;
       irqstate_t flags;
       int i;
       FAR struct tcb_s *tcb;
@@ -181,11 +182,11 @@ int clock_gettime(clockid_t clock_id, struct timespec *tp)
       for (i = group->tg_nmembers - 1; i >= 0; i--)
         {
           tcb = nxsched_get_tcb(group->tg_members[i]);
-          runtime += tcb->run_time;
+          runtime += nxsched_critmon_runtime(tcb);
         }
 
       leave_critical_section(flags);
-      up_perf_convert(runtime, tp);
+      clock_perf2time(runtime, tp);
     }
 #endif
   else
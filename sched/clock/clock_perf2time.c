@@ -0,0 +1,65 @@
+/****************************************************************************
+ * sched/clock/clock_perf2time.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <assert.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: clock_perf2time
+ *
+ * Description:
+ *   Return an up_perf_gettime() interval as a struct timespec.  Whole
+ *   seconds are split off first, so up_perf_convert() only ever sees an
+ *   interval shorter than one second.
+ *
+ * Input Parameters:
+ *   elapsed - Time interval in up_perf_gettime() units
+ *
+ * Output Parameters:
+ *   ts - Pointer to receive the time value presented as struct timespec
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void clock_perf2time(uint64_t elapsed, FAR struct timespec *ts)
+{
+  unsigned long freq = up_perf_getfreq();
+
+  DEBUGASSERT(freq > 0);
+
+  up_perf_convert((unsigned long)(elapsed % freq), ts);
+  ts->tv_sec += (time_t)(elapsed / freq);
+}
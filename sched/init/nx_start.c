@@ -497,7 +497,8 @@ void nx_start(void)
   /* Initialize the logic that determine unique process IDs. */
 
   g_npidhash = 4;
-  while (g_npidhash <= CONFIG_SMP_NCPUS)
+  while (g_npidhash <= CONFIG_SMP_NCPUS ||
+         g_npidhash < CONFIG_PID_INITIAL_COUNT)
     {
       g_npidhash <<= 1;
     }
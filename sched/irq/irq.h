@@ -67,6 +67,7 @@ struct irq_info_s
   uint32_t lscount;  /* Number of interrupts on this IRQ (LS) */
 #endif
   uint32_t time;     /* Maximum execution time on this IRQ */
+  uint64_t runtime;  /* Total execution time on this IRQ */
 #endif
 };
 
@@ -117,6 +117,7 @@ int irq_attach(int irq, xcpt_t isr, FAR void *arg)
       g_irqvector[ndx].arg     = arg;
 #ifdef CONFIG_SCHED_IRQMONITOR
       g_irqvector[ndx].start   = clock_systime_ticks();
+      g_irqvector[ndx].runtime = 0;
 #ifdef CONFIG_HAVE_LONG_LONG
       g_irqvector[ndx].count   = 0;
 #else
@@ -88,6 +88,7 @@
          if (ndx < NUSER_IRQS) \
            { \
              INCR_COUNT(ndx); \
+             g_irqvector[ndx].runtime += elapsed; \
              if (elapsed > g_irqvector[ndx].time) \
                { \
                  g_irqvector[ndx].time = elapsed; \
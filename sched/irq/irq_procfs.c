@@ -32,6 +32,7 @@
 #include <debug.h>
 #include <errno.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/procfs.h>
@@ -47,26 +48,31 @@
 
 /* Output format:
  *
- *            1111111111222222222233333333334444444444
- *   1234567890123456789012345678901234567890123456789
+ *            11111111112222222222333333333344444444445555555555666
+ *   123456789012345678901234567890123456789012345678901234567890123
  *
- *   IRQ HANDLER  ARGUMENT    COUNT    RATE    TIME
- *   DDD XXXXXXXX XXXXXXXX DDDDDDDDDD DDDD.DDD DDDD
+ *   IRQ HANDLER  ARGUMENT    COUNT    RATE    TIME        TOTAL
+ *   DDD XXXXXXXX XXXXXXXX DDDDDDDDDD DDDD.DDD DDDD DDDDD.DDDDDD
+ *
+ * COUNT, RATE and TIME (the maximum execution time in microseconds) cover
+ * the period since the last read.  TOTAL is the execution time in seconds
+ * accumulated since the interrupt was attached and is never reset.
  *
  * NOTE:  This assumes that an address can be represented in 32-bits.  In
  * the typical configuration where CONFIG_HAVE_LONG_LONG=y, the COUNT field
  * may not be wide enough.
  */
 
-#define HDR_FMT "IRQ HANDLER  ARGUMENT    COUNT    RATE    TIME\n"
-#define IRQ_FMT "%3u %08lx %08lx %10lu %4lu.%03lu %4lu\n"
+#define HDR_FMT "IRQ HANDLER  ARGUMENT    COUNT    RATE    TIME" \
+                "        TOTAL\n"
+#define IRQ_FMT "%3u %08lx %08lx %10lu %4lu.%03lu %4lu %5lu.%06lu\n"
 
 /* Determines the size of an intermediate buffer that must be large enough
  * to handle the longest line generated by this logic (plus a couple of
  * bytes).
  */
 
-#define IRQ_LINELEN 50
+#define IRQ_LINELEN 64
 
 /****************************************************************************
  * Private Types
@@ -144,6 +150,7 @@ static int irq_callback(int irq, FAR struct irq_info_s *info,
   FAR struct irq_file_s *irqfile = (FAR struct irq_file_s *)arg;
   struct irq_info_s copy;
   struct timespec delta;
+  struct timespec total;
   irqstate_t flags;
   clock_t elapsed;
   clock_t now;
@@ -202,6 +209,7 @@ static int irq_callback(int irq, FAR struct irq_info_s *info,
 
   elapsed = now - copy.start;
   up_perf_convert(copy.time, &delta);
+  clock_perf2time(copy.runtime, &total);
 
 #ifdef CONFIG_HAVE_LONG_LONG
   /* elapsed = <current-time> - <start-time>, units=clock ticks
@@ -243,7 +251,9 @@ static int irq_callback(int irq, FAR struct irq_info_s *info,
                       (unsigned long)((uintptr_t)copy.handler),
                       (unsigned long)((uintptr_t)copy.arg),
                       count, intpart, fracpart,
-                      (unsigned long)delta.tv_nsec / 1000);
+                      (unsigned long)delta.tv_nsec / 1000,
+                      (unsigned long)total.tv_sec,
+                      (unsigned long)total.tv_nsec / 1000);
 
   copysize  = procfs_memcpy(irqfile->line, linesize, irqfile->buffer,
                             irqfile->remaining, &irqfile->offset);
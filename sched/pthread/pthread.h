@@ -94,13 +94,19 @@ int pthread_sem_trytake(FAR sem_t *sem);
 #endif
 int pthread_sem_give(FAR sem_t *sem);
 
+int pthread_cond_sem_take(FAR pthread_cond_t *cond, clockid_t clockid,
+                          FAR const struct timespec *abstime,
+                          FAR bool *acquired);
+
 #ifndef CONFIG_PTHREAD_MUTEX_UNSAFE
 int pthread_mutex_take(FAR struct pthread_mutex_s *mutex,
                        FAR const struct timespec *abs_timeout);
 int pthread_mutex_trytake(FAR struct pthread_mutex_s *mutex);
 int pthread_mutex_give(FAR struct pthread_mutex_s *mutex);
+int pthread_mutex_acquired(FAR struct pthread_mutex_s *mutex);
 void pthread_mutex_inconsistent(FAR struct tcb_s *tcb);
 #else
+#  define pthread_mutex_acquired(m)         OK
 #  define pthread_mutex_take(m,abs_timeout) pthread_sem_take(&(m)->sem,(abs_timeout))
 #  define pthread_mutex_trytake(m)          pthread_sem_trytake(&(m)->sem)
 #  define pthread_mutex_give(m)             pthread_sem_give(&(m)->sem)
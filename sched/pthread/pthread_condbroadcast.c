@@ -29,8 +29,82 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/irq.h>
+#include <nuttx/wdog.h>
+
+#include "sched/sched.h"
 #include "pthread/pthread.h"
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pthread_cond_requeue
+ *
+ * Description:
+ *   Move the highest priority thread waiting on the condition variable
+ *   directly onto the wait list of the mutex associated with the condition
+ *   (wait morphing).  The thread will be awakened when the mutex is
+ *   released, already owning the mutex, instead of being awakened now only
+ *   to block again on the mutex held by the caller.
+ *
+ *   Requeueing is only possible if the mutex is currently held.  It is not
+ *   done for priority inheritance mutexes since the priority boost of the
+ *   holder is performed by the waiting thread itself.
+ *
+ * Input Parameters:
+ *   cond - The condition variable with at least one waiting thread
+ *
+ * Returned Value:
+ *   true if a waiter was requeued; false if it must be awakened normally.
+ *
+ * Assumptions:
+ *   Called within a critical section.
+ *
+ ****************************************************************************/
+
+static bool pthread_cond_requeue(FAR pthread_cond_t *cond)
+{
+  FAR struct pthread_mutex_s *mutex = cond->mutex;
+  FAR struct tcb_s *stcb;
+
+  if (mutex == NULL || mutex->sem.semcount > 0)
+    {
+      return false;
+    }
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+  if ((mutex->sem.flags & SEM_PRIO_MASK) == SEM_PRIO_INHERIT)
+    {
+      return false;
+    }
+#endif
+
+  stcb = (FAR struct tcb_s *)dq_remfirst(SEM_WAITLIST(&cond->sem));
+  if (stcb == NULL)
+    {
+      return false;
+    }
+
+  cond->sem.semcount++;
+
+  /* The condition wait is over.  Waiting for the mutex is not timed. */
+
+  if (WDOG_ISACTIVE(&stcb->waitdog))
+    {
+      wd_cancel(&stcb->waitdog);
+    }
+
+  /* Wait for the mutex as if the thread called nxsem_wait() on it */
+
+  mutex->sem.semcount--;
+  stcb->waitobj = &mutex->sem;
+  stcb->flags  |= TCB_FLAG_COND_REQUEUED;
+  nxsched_add_prioritized(stcb, SEM_WAITLIST(&mutex->sem));
+  return true;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -53,6 +127,7 @@
 
 int pthread_cond_broadcast(FAR pthread_cond_t *cond)
 {
+  irqstate_t flags;
   int ret = OK;
   int sval;
 
@@ -70,6 +145,7 @@ int pthread_cond_broadcast(FAR pthread_cond_t *cond)
        */
 
       sched_lock();
+      flags = enter_critical_section();
 
       /* Get the current value of the semaphore */
 
@@ -84,11 +160,15 @@ int pthread_cond_broadcast(FAR pthread_cond_t *cond)
           while (sval < 0)
             {
               /* If the value is less than zero (meaning that one or more
-               * thread is waiting), then post the condition semaphore.
-               * Only the highest priority waiting thread will get to execute
+               * thread is waiting), then either requeue the waiter onto
+               * the mutex or post the condition semaphore.  Only the
+               * highest priority waiting thread will get to execute.
                */
 
-              ret = pthread_sem_give(&cond->sem);
+              if (!pthread_cond_requeue(cond))
+                {
+                  ret = pthread_sem_give(&cond->sem);
+                }
 
               /* Increment the semaphore count (as was done by the
                * above post).
@@ -100,6 +180,7 @@ int pthread_cond_broadcast(FAR pthread_cond_t *cond)
 
       /* Now we can let the restarted threads run */
 
+      leave_critical_section(flags);
       sched_unlock();
     }
 
@@ -116,6 +116,7 @@ int pthread_cond_clockwait(FAR pthread_cond_t *cond,
       uint8_t type;
       int16_t nlocks;
 #endif
+      bool acquired = false;
 
       sinfo("Give up mutex...\n");
 
@@ -131,6 +132,7 @@ int pthread_cond_clockwait(FAR pthread_cond_t *cond,
       /* Give up the mutex */
 
       mutex->pid = INVALID_PROCESS_ID;
+      cond->mutex = mutex;
 #ifndef CONFIG_PTHREAD_MUTEX_UNSAFE
       mflags     = mutex->flags;
 #endif
@@ -141,12 +143,7 @@ int pthread_cond_clockwait(FAR pthread_cond_t *cond,
       ret        = pthread_mutex_give(mutex);
       if (ret == 0)
         {
-          status = nxsem_clockwait_uninterruptible(&cond->sem,
-                                                   clockid, abstime);
-          if (status < 0)
-            {
-              ret = -status;
-            }
+          ret = pthread_cond_sem_take(cond, clockid, abstime, &acquired);
         }
 
       /* Restore interrupts  (pre-emption will be enabled
@@ -155,11 +152,21 @@ int pthread_cond_clockwait(FAR pthread_cond_t *cond,
 
       leave_critical_section(flags);
 
-      /* Reacquire the mutex (retaining the ret). */
+      /* Reacquire the mutex (retaining the ret) unless
+       * pthread_cond_broadcast() already handed it to us.
+       */
 
       sinfo("Re-locking...\n");
 
-      status = pthread_mutex_take(mutex, NULL);
+      if (acquired)
+        {
+          status = pthread_mutex_acquired(mutex);
+        }
+      else
+        {
+          status = pthread_mutex_take(mutex, NULL);
+        }
+
       if (status == OK)
         {
           mutex->pid    = mypid;
@@ -31,13 +31,82 @@
 #include <debug.h>
 
 #include <nuttx/cancelpt.h>
+#include <nuttx/semaphore.h>
 
+#include "sched/sched.h"
 #include "pthread/pthread.h"
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: pthread_cond_sem_take
+ *
+ * Description:
+ *   Wait on the semaphore underlying a condition variable.  Unlike
+ *   pthread_sem_take(), the wait also ends if pthread_cond_broadcast()
+ *   requeued the caller onto the wait list of the mutex associated with
+ *   the condition variable.  In that case the caller may already own the
+ *   mutex when this function returns.
+ *
+ * Input Parameters:
+ *   cond     - The condition variable to wait on
+ *   clockid  - The timing source to use in the conversion
+ *   abstime  - Wait until this absolute time (NULL: wait forever)
+ *   acquired - Returns true if the mutex was handed to the caller
+ *
+ * Returned Value:
+ *   0 on success or an errno value on failure.
+ *
+ ****************************************************************************/
+
+int pthread_cond_sem_take(FAR pthread_cond_t *cond, clockid_t clockid,
+                          FAR const struct timespec *abstime,
+                          FAR bool *acquired)
+{
+  FAR struct tcb_s *rtcb = this_task();
+  bool requeued;
+  int ret;
+
+  *acquired = false;
+
+  do
+    {
+      if (abstime == NULL)
+        {
+          ret = nxsem_wait(&cond->sem);
+        }
+      else
+        {
+          ret = nxsem_clockwait(&cond->sem, clockid, abstime);
+        }
+
+      requeued = (rtcb->flags & TCB_FLAG_COND_REQUEUED) != 0;
+    }
+  while (ret == -EINTR && !requeued);
+
+  if (requeued)
+    {
+      /* The condition was broadcast while we were waiting.  If the wait on
+       * the mutex was interrupted by a signal, the mutex still has to be
+       * taken by the caller.
+       */
+
+      rtcb->flags &= ~TCB_FLAG_COND_REQUEUED;
+      if (ret == OK)
+        {
+          *acquired = true;
+        }
+      else if (ret == -EINTR)
+        {
+          ret = OK;
+        }
+    }
+
+  return -ret;
+}
+
 /****************************************************************************
  * Name: int pthread_cond_wait
  *
@@ -88,6 +157,7 @@ int pthread_cond_wait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex)
       uint8_t type;
       int16_t nlocks;
 #endif
+      bool acquired;
 
       /* Give up the mutex */
 
@@ -96,6 +166,7 @@ int pthread_cond_wait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex)
       flags = enter_critical_section();
       sched_lock();
       mutex->pid = INVALID_PROCESS_ID;
+      cond->mutex = mutex;
 #ifndef CONFIG_PTHREAD_MUTEX_UNSAFE
       mflags     = mutex->flags;
 #endif
@@ -109,7 +180,7 @@ int pthread_cond_wait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex)
        * or if the thread is canceled (ECANCELED)
        */
 
-      status = pthread_sem_take(&cond->sem, NULL);
+      status = pthread_cond_sem_take(cond, 0, NULL, &acquired);
       if (ret == OK)
         {
           /* Report the first failure that occurs */
@@ -120,7 +191,8 @@ int pthread_cond_wait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex)
       sched_unlock();
       leave_critical_section(flags);
 
-      /* Reacquire the mutex.
+      /* Reacquire the mutex (unless pthread_cond_broadcast() already handed
+       * it to us).
        *
        * When cancellation points are enabled, we need to hold the mutex
        * when the pthread is canceled and cleanup handlers, if any, are
@@ -129,7 +201,15 @@ int pthread_cond_wait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex)
 
       sinfo("Reacquire mutex...\n");
 
-      status = pthread_mutex_take(mutex, NULL);
+      if (acquired)
+        {
+          status = pthread_mutex_acquired(mutex);
+        }
+      else
+        {
+          status = pthread_mutex_take(mutex, NULL);
+        }
+
       if (ret == OK)
         {
           /* Report the first failure that occurs */
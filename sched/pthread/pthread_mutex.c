@@ -192,6 +192,51 @@ int pthread_mutex_take(FAR struct pthread_mutex_s *mutex,
   return ret;
 }
 
+/****************************************************************************
+ * Name: pthread_mutex_acquired
+ *
+ * Description:
+ *   Complete taking a pthread_mutex whose underlying semaphore has already
+ *   been handed to this thread.  This happens when pthread_cond_broadcast()
+ *   requeued the waiting thread directly onto the mutex wait list.
+ *
+ * Input Parameters:
+ *  mutex - The mutex that was acquired
+ *
+ * Returned Value:
+ *   0 on success or an errno value on failure.
+ *
+ ****************************************************************************/
+
+int pthread_mutex_acquired(FAR struct pthread_mutex_s *mutex)
+{
+  int ret = OK;
+
+  DEBUGASSERT(mutex != NULL);
+
+  sched_lock();
+
+  /* Check if the holder of the mutex has terminated without releasing.
+   * In that case, the state of the mutex is inconsistent and we return
+   * EOWNERDEAD.
+   */
+
+  if ((mutex->flags & _PTHREAD_MFLAGS_INCONSISTENT) != 0)
+    {
+      ret = EOWNERDEAD;
+    }
+
+  /* Add the mutex to the list of mutexes held by this task */
+
+  else
+    {
+      pthread_mutex_add(mutex);
+    }
+
+  sched_unlock();
+  return ret;
+}
+
 /****************************************************************************
  * Name: pthread_mutex_trytake
  *
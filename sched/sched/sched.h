@@ -411,6 +411,7 @@ void nxsched_critmon_preemption(FAR struct tcb_s *tcb, bool state);
 void nxsched_critmon_csection(FAR struct tcb_s *tcb, bool state);
 void nxsched_resume_critmon(FAR struct tcb_s *tcb);
 void nxsched_suspend_critmon(FAR struct tcb_s *tcb);
+uint64_t nxsched_critmon_runtime(FAR struct tcb_s *tcb);
 #endif
 
 /* TCB operations */
@@ -115,6 +115,10 @@ static unsigned long g_crit_start[CONFIG_SMP_NCPUS];
 unsigned long g_premp_max[CONFIG_SMP_NCPUS];
 unsigned long g_crit_max[CONFIG_SMP_NCPUS];
 
+/* Total time each CPU ran threads other than its idle thread */
+
+uint64_t g_busy_time[CONFIG_SMP_NCPUS];
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -215,6 +219,35 @@ void nxsched_critmon_csection(FAR struct tcb_s *tcb, bool state)
     }
 }
 
+/****************************************************************************
+ * Name: nxsched_critmon_runtime
+ *
+ * Description:
+ *   Return the total execution time of a thread in up_perf_gettime() units,
+ *   including the time elapsed since the thread was last resumed if it is
+ *   running now.
+ *
+ * Assumptions:
+ *   - The TCB remains valid during the call.
+ *
+ ****************************************************************************/
+
+uint64_t nxsched_critmon_runtime(FAR struct tcb_s *tcb)
+{
+  uint64_t runtime;
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  runtime = tcb->run_time;
+  if (tcb->task_state == TSTATE_TASK_RUNNING)
+    {
+      runtime += up_perf_gettime() - tcb->run_start;
+    }
+
+  leave_critical_section(flags);
+  return runtime;
+}
+
 /****************************************************************************
  * Name: nxsched_resume_critmon
  *
@@ -298,11 +331,25 @@ void nxsched_suspend_critmon(FAR struct tcb_s *tcb)
   unsigned long elapsed = current - tcb->run_start;
 
 #ifdef CONFIG_SCHED_CPULOAD_CRITMONITOR
-  unsigned long tick = elapsed * CLOCKS_PER_SEC / up_perf_getfreq();
-  nxsched_process_taskload_ticks(tcb, tick);
+  unsigned long freq = up_perf_getfreq();
+  uint64_t load;
+
+  /* Convert the run time to ticks.  The remainder of less than one tick is
+   * carried over to the next time that the thread is suspended so that
+   * threads that always run for less than one tick are still accounted.
+   */
+
+  load = (uint64_t)elapsed * CLOCKS_PER_SEC + tcb->run_rem;
+  tcb->run_rem = load % freq;
+  nxsched_process_taskload_ticks(tcb, load / freq);
 #endif
 
   tcb->run_time += elapsed;
+  if (!is_idle_task(tcb))
+    {
+      g_busy_time[this_cpu()] += elapsed;
+    }
+
   if (elapsed > tcb->run_max)
     {
       tcb->run_max = elapsed;
@@ -332,6 +332,9 @@ int nxsig_action(int signo, FAR const struct sigaction *act,
           /* Yes.. Remove it from signal action queue */
 
           sq_rem((FAR sq_entry_t *)sigact, &group->tg_sigactionq);
+#ifdef CONFIG_SIG_ACTION_TABLE
+          group->tg_sigaction[signo] = NULL;
+#endif
 
           /* And deallocate it */
 
@@ -367,6 +370,9 @@ int nxsig_action(int signo, FAR const struct sigaction *act,
           /* Add the new sigaction to signal action queue */
 
           sq_addlast((FAR sq_entry_t *)sigact, &group->tg_sigactionq);
+#ifdef CONFIG_SIG_ACTION_TABLE
+          group->tg_sigaction[signo] = sigact;
+#endif
         }
 
       /* Set the new sigaction */
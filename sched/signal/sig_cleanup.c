@@ -86,6 +86,9 @@ void nxsig_release(FAR struct task_group_s *group)
   while ((sigact = (FAR sigactq_t *)sq_remfirst(&group->tg_sigactionq))
          != NULL)
     {
+#ifdef CONFIG_SIG_ACTION_TABLE
+      group->tg_sigaction[sigact->signo] = NULL;
+#endif
       nxsig_release_action(sigact);
     }
 
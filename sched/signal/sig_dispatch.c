@@ -73,11 +73,22 @@ static int nxsig_queue_action(FAR struct tcb_s *stcb, siginfo_t *info)
 
   sigact = nxsig_find_action(stcb->group, info->si_signo);
 
+  /* Kernel handlers (e.g. signalfd) do not need a signal frame on the
+   * recipient's thread.  Call them directly without allocating a pending
+   * signal action.
+   */
+
+  if (sigact && (sigact->act.sa_flags & SA_KERNELHAND) != 0)
+    {
+      info->si_user = sigact->act.sa_user;
+      (sigact->act.sa_sigaction)(info->si_signo, info, NULL);
+    }
+
   /* Check if a valid signal handler is available and if the signal is
    * unblocked. NOTE: There is no default action.
    */
 
-  if ((sigact) && (sigact->act.sa_u._sa_sigaction))
+  else if ((sigact) && (sigact->act.sa_u._sa_sigaction))
     {
       /* Allocate a new element for the signal queue. NOTE:
        * nxsig_alloc_pendingsigaction will force a system crash if it is
@@ -33,7 +33,7 @@
  * Name: nxsig_find_action
  *
  * Description:
- *   Allocate a new element for a signal queue
+ *   Find the sigaction associated with the signal number in the group
  *
  ****************************************************************************/
 
@@ -45,6 +45,14 @@ FAR sigactq_t *nxsig_find_action(FAR struct task_group_s *group, int signo)
 
   if (group)
     {
+#ifdef CONFIG_SIG_ACTION_TABLE
+      /* The action table is indexed directly by the signal number */
+
+      if (GOOD_SIGNO(signo))
+        {
+          sigact = group->tg_sigaction[signo];
+        }
+#else
       /* Sigactions can only be assigned to the currently executing
        * thread.  So, a simple lock ought to give us sufficient
        * protection.
@@ -59,6 +67,7 @@ FAR sigactq_t *nxsig_find_action(FAR struct task_group_s *group, int signo)
            sigact = sigact->flink);
 
       sched_unlock();
+#endif
     }
 
   return sigact;
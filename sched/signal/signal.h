@@ -43,8 +43,8 @@
  */
 
 #define NUM_SIGNAL_ACTIONS       4
-#define NUM_PENDING_ACTIONS      4
-#define NUM_SIGNALS_PENDING      4
+#define NUM_PENDING_ACTIONS      CONFIG_SIG_PREALLOC_ACTIONS
+#define NUM_SIGNALS_PENDING      CONFIG_SIG_PREALLOC_ACTIONS
 
 /****************************************************************************
  * Public Type Definitions
@@ -65,6 +65,74 @@ static const char g_noname[] = "<noname>";
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxtask_grow_pidhash
+ *
+ * Description:
+ *   Double the size of the g_pidhash[] table.
+ *
+ * Returned Value:
+ *   OK on success; -ENOMEM if the new table could not be allocated.
+ *
+ ****************************************************************************/
+
+static int nxtask_grow_pidhash(void)
+{
+  FAR struct tcb_s **pidhash;
+  irqstate_t flags;
+  int npidhash;
+  int hash_ndx;
+  void *temp;
+  int i;
+
+  /* Allocate the new table outside of the critical section.  Clearing a
+   * large table takes a while and other tasks need not be held off while
+   * it is done.
+   */
+
+  npidhash = g_npidhash * 2;
+  pidhash  = kmm_zalloc(npidhash * sizeof(*pidhash));
+  if (pidhash == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  flags = enter_critical_section();
+
+  /* Another task may have grown the table while we were allocating */
+
+  if (npidhash != g_npidhash * 2)
+    {
+      leave_critical_section(flags);
+      kmm_free(pidhash);
+      return OK;
+    }
+
+  /* All original pid and hash_ndx are mismatch,
+   * so we need to rebuild their relationship
+   */
+
+  for (i = 0; i < g_npidhash; i++)
+    {
+      if (g_pidhash[i] != NULL)
+        {
+          hash_ndx = g_pidhash[i]->pid & (npidhash - 1);
+          DEBUGASSERT(pidhash[hash_ndx] == NULL);
+          pidhash[hash_ndx] = g_pidhash[i];
+        }
+    }
+
+  /* Release resource for original g_pidhash, using new g_pidhash */
+
+  temp       = g_pidhash;
+  g_pidhash  = pidhash;
+  g_npidhash = npidhash;
+  kmm_free(temp);
+
+  leave_critical_section(flags);
+  return OK;
+}
+
 /****************************************************************************
  * Name: nxtask_assign_pid
  *
@@ -75,32 +143,28 @@ static const char g_noname[] = "<noname>";
  *   tcb - TCB of task
  *
  * Returned Value:
- *   OK on success; ERROR on failure (errno is not set)
+ *   OK on success; a negated errno value on failure.
  *
  ****************************************************************************/
 
 static int nxtask_assign_pid(FAR struct tcb_s *tcb)
 {
-  FAR struct tcb_s **pidhash;
+  irqstate_t flags;
   pid_t next_pid;
+  bool  grow;
   int   hash_ndx;
-  void *temp;
+  int   ret;
   int   i;
 
-  /* NOTE:
-   * ERROR means that the g_pidhash[] table is completely full.
-   * We cannot allow another task to be started.
-   */
+  /* We'll try every allowable pid */
+
+retry:
 
   /* Protect the following operation with a critical section
    * because g_pidhash is accessed from an interrupt context
    */
 
-  irqstate_t flags = enter_critical_section();
-
-  /* We'll try every allowable pid */
-
-retry:
+  flags = enter_critical_section();
 
   /* Get the next process ID candidate */
 
@@ -128,44 +192,39 @@ retry:
           tcb->pid = next_pid;
           g_lastpid = next_pid;
 
+          /* If more than half of the table had to be skipped, then it is
+           * getting crowded.  Grow it now rather than waiting until it is
+           * completely full so that later searches stay short.  Failing
+           * to do so is not an error; it will be tried again later.
+           */
+
+          grow = i > g_npidhash / 2;
           leave_critical_section(flags);
+
+          if (grow)
+            {
+              nxtask_grow_pidhash();
+            }
+
           return OK;
         }
 
       next_pid++;
     }
 
+  leave_critical_section(flags);
+
   /* If we get here, then the g_pidhash[] table is completely full.
    * We will alloc new space and copy original g_pidhash to it to
    * expand space.
    */
 
-  pidhash = kmm_zalloc(g_npidhash * 2 * sizeof(*pidhash));
-  if (pidhash == NULL)
-    {
-      leave_critical_section(flags);
-      return -ENOMEM;
-    }
-
-  g_npidhash *= 2;
-
-  /* All original pid and hash_ndx are mismatch,
-   * so we need to rebuild their relationship
-   */
-
-  for (i = 0; i < g_npidhash / 2; i++)
+  ret = nxtask_grow_pidhash();
+  if (ret < 0)
     {
-      hash_ndx = PIDHASH(g_pidhash[i]->pid);
-      DEBUGASSERT(pidhash[hash_ndx] == NULL);
-      pidhash[hash_ndx] = g_pidhash[i];
+      return ret;
     }
 
-  /* Release resource for original g_pidhash, using new g_pidhash */
-
-  temp = g_pidhash;
-  g_pidhash = pidhash;
-  kmm_free(temp);
-
   /* Let's try every allowable pid again */
 
   goto retry;